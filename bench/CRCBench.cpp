@@ -0,0 +1,73 @@
+/**
+ * \file CRCBench.cpp
+ *
+ * Compares our CRC-16-CCITT implementations against boost::crc_ccitt_type
+ * across a range of frame sizes. Build with `make crc_bench`.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <boost/crc.hpp>
+
+#include "CRC.hpp"
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+uint16_t boostCRC(const void* data, size_t len, uint16_t)
+{
+	boost::crc_ccitt_type gen;
+	gen.process_bytes(data, len);
+	return gen.checksum();
+}
+
+/// Returns the throughput of the given CRC function in MB/s
+double measure(uint16_t (*crc)(const void*, size_t, uint16_t), const vector<uint8_t>& data, size_t frameSize)
+{
+	// Aim for roughly the same amount of work regardless of frame size
+	const size_t iterations = max<size_t>(1, (64u << 20) / frameSize);
+
+	// Keep the compiler from optimizing the work away
+	volatile uint16_t sink = 0;
+
+	const auto start = Clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		sink = (uint16_t)(sink ^ crc(data.data() + (i & 15), frameSize, CRC::ccittInit));
+	const auto elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+	return (double)(iterations * frameSize) / elapsed / 1e6;
+}
+
+} // end anonymous namespace
+
+int main()
+{
+	// 9 bytes is an empty message; 65544 is the largest a message can be.
+	const size_t frameSizes[] = { 9, 15, 16, 32, 64, 128, 256, 1024, 4096, 65544 };
+
+	mt19937 rng(2564);
+	uniform_int_distribution<int> dist(0, 255);
+	vector<uint8_t> data(65544 + 16);
+	for (auto& b : data)
+		b = (uint8_t)dist(rng);
+
+	printf("Carry-less multiply %s\n\n", CRC::hasCarrylessMultiply() ? "available" : "unavailable");
+	printf("%8s %12s %12s %12s %12s\n", "bytes", "boost MB/s", "slicing", "folding", "ccitt");
+
+	for (size_t size : frameSizes) {
+		printf("%8zu %12.1f %12.1f %12.1f %12.1f\n", size,
+		       measure(&boostCRC, data, size),
+		       measure(&CRC::ccittSlicing, data, size),
+		       measure(&CRC::ccittFolding, data, size),
+		       measure(&CRC::ccitt, data, size));
+	}
+
+	return 0;
+}
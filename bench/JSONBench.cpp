@@ -0,0 +1,96 @@
+/**
+ * \file JSONBench.cpp
+ *
+ * Compares encoding and decoding messages through a Json::Value tree (the old way)
+ * against the streaming JSONWriter and JSONReader, using results responses of various sizes.
+ * Build with `make json_bench`.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "JSONWriter.hpp"
+#include "Message.hpp"
+#include "ResultsResponseMessage.hpp"
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+unique_ptr<Message> makeResults(size_t shotsPerPlayer)
+{
+	mt19937 rng(2564);
+	uniform_int_distribution<int> board(0, 15);
+	uniform_int_distribution<int> time(0, 600000);
+
+	ResultsResponseMessage::StatsList stats;
+	for (board_id_t p = 0; p < 4; ++p) {
+		vector<Shot> shots;
+		for (size_t s = 0; s < shotsPerPlayer; ++s)
+			shots.emplace_back(p, (board_id_t)board(rng), time(rng));
+		stats.emplace_back((score_t)(p * 100), (shot_t)shotsPerPlayer, move(shots));
+	}
+
+	return unique_ptr<Message>(new ResultsResponseMessage(1, 2, "Game over", move(stats)));
+}
+
+/// Runs f enough times to take a while, returning the average microseconds per call
+template <typename F>
+double measure(size_t iterations, F f)
+{
+	const auto start = Clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		f();
+	return chrono::duration<double, micro>(Clock::now() - start).count() / (double)iterations;
+}
+
+} // end anonymous namespace
+
+int main()
+{
+	const size_t shotCounts[] = { 0, 10, 100, 1000, 10000 };
+
+	printf("%8s %10s %12s %12s %12s %12s\n",
+	       "shots", "bytes", "tree enc us", "stream enc", "tree dec us", "stream dec");
+
+	for (size_t shots : shotCounts) {
+		const auto msg = makeResults(shots);
+		const size_t iterations = max<size_t>(10, 200000 / (shots + 1));
+
+		Json::FastWriter fastWriter;
+		string encoded;
+
+		const double treeEncode = measure(iterations, [&] {
+			encoded = fastWriter.write(msg->toJSON());
+		});
+
+		const double streamEncode = measure(iterations, [&] {
+			encoded.clear();
+			JSONWriter w(encoded);
+			msg->writeJSON(w);
+		});
+
+		Json::Reader reader;
+		volatile size_t sink = 0;
+
+		const double treeDecode = measure(iterations, [&] {
+			Json::Value val;
+			reader.parse(encoded, val);
+			sink = sink + (size_t)JSONToMessage(val)->id;
+		});
+
+		const double streamDecode = measure(iterations, [&] {
+			sink = sink + (size_t)JSONToMessage(encoded.data(), encoded.size())->id;
+		});
+
+		printf("%8zu %10zu %12.2f %12.2f %12.2f %12.2f\n", shots * 4, encoded.size(),
+		       treeEncode, streamEncode, treeDecode, streamDecode);
+	}
+
+	return 0;
+}
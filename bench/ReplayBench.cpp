@@ -0,0 +1,123 @@
+/**
+ * \file ReplayBench.cpp
+ *
+ * Measures how fast the game state machine gets through a trace when replayed with a virtual clock.
+ * Given a trace recorded with `gallery --trace <file>`, replays that. Otherwise it replays a made-up session
+ * of back-to-back pop-up games. Either way, it replays twice and checks that both replays sent the same bytes.
+ * Build with `make replay_bench`.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "CRC.hpp"
+#include "GameRunner.hpp"
+#include "ResultsMessage.hpp"
+#include "SetupMessage.hpp"
+#include "ShotMessage.hpp"
+#include "StartMessage.hpp"
+#include "Trace.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+typedef GameRunner::TimePoint TimePoint;
+
+/// Makes up a trace of `games` five minute pop-up games between four players, with a shot every 100 ms
+string makeTrace(int games)
+{
+	stringstream trace;
+	TraceWriter writer(trace);
+	MessageQueue out;
+	GameRunner runner(out, 8, 4, 2564);
+
+	TimePoint now;
+	writer.start(2564, 8, 4, now);
+
+	message_id_t id = 0;
+	const auto send = [&](Message* msg) {
+		unique_ptr<Message> toSend(msg);
+		writer.record(now, toSend.get());
+		runner.onMessage(move(toSend), now);
+	};
+
+	for (int g = 0; g < games; ++g) {
+		send(new SetupMessage(id++, GameType::POP_UP, 4, 300, -1));
+		send(new StartMessage(id++));
+
+		const TimePoint gameStart = now;
+		const TimePoint end = now + minutes(5) + seconds(1);
+		TimePoint nextShot = now + milliseconds(100);
+		while (now < end) {
+			if (runner.nextDeadline() <= nextShot) {
+				now = runner.nextDeadline();
+				writer.record(now, nullptr);
+				runner.onTick(now);
+			}
+			else {
+				now = nextShot;
+				nextShot += milliseconds(100);
+				const auto time = (timestamp_t)duration_cast<milliseconds>(now - gameStart).count();
+				send(new ShotMessage(id, Shot((board_id_t)(id % 4), (board_id_t)(id % 9) - 1, time)));
+				++id;
+			}
+
+			while (out.tryReceive() != nullptr) { }
+		}
+
+		send(new ResultsMessage(id++));
+		while (out.tryReceive() != nullptr) { }
+	}
+
+	return trace.str();
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv)
+{
+	string trace;
+	if (argc > 1) {
+		ifstream file(argv[1], ios::binary);
+		if (!file) {
+			fprintf(stderr, "Could not open %s\n", argv[1]);
+			return 1;
+		}
+		trace.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	}
+	else {
+		trace = makeTrace(20);
+	}
+
+	string outputs[2];
+	size_t steps = 0;
+	double seconds = 0;
+
+	for (auto& output : outputs) {
+		istringstream in(trace);
+		ostringstream out;
+
+		const auto start = steady_clock::now();
+		steps = replayTrace(in, out);
+		seconds = duration<double>(steady_clock::now() - start).count();
+
+		output = out.str();
+	}
+
+	printf("%zu steps (%zu bytes of trace) sent %zu bytes in %.3f s: %.0f steps/s\n",
+	       steps, trace.size(), outputs[1].size(), seconds, (double)steps / seconds);
+	printf("Output CRC: 0x%04x\n", CRC::ccitt(outputs[1].data(), outputs[1].size()));
+
+	if (outputs[0] != outputs[1]) {
+		printf("The replays differed!\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,6 +1,6 @@
 #include "BinaryMessage.hpp"
 
-#include <boost/crc.hpp>
+#include "CRC.hpp"
 
 namespace {
 	/// These bytes were chosen completely randomly
@@ -16,9 +16,7 @@ const std::array<uint8_t, 2>& getMagicBytes()
 
 uint16_t getCRC(const void* data, size_t len)
 {
-	boost::crc_ccitt_type gen; // Get a 16-bit
-	gen.process_bytes(data, len);
-	return gen.checksum();
+	return CRC::ccitt(data, len);
 }
 
 void appendInt(std::vector<uint8_t>& buf, uint16_t i)
@@ -35,6 +33,34 @@ void appendInt(std::vector<uint8_t>& buf, uint32_t i)
 	buf.emplace_back((uint8_t)((i & 0x000000ff) >> 0));
 }
 
+size_t finishMessage(uint8_t* buf, Message::Type type, message_id_t id, size_t payloadLength)
+{
+	ENFORCE(ArgumentOutOfRangeException, payloadLength <= maxPayloadLength,
+	        "The payload is too long to fit in a binary message.");
+
+	uint8_t* cursor = buf;
+
+	// Magic bytes
+	const auto& magic = getMagicBytes();
+	*cursor++ = magic[0];
+	*cursor++ = magic[1];
+
+	// Type
+	*cursor++ = (uint8_t)type;
+
+	// ID
+	cursor = writeInt(cursor, id);
+
+	// Length
+	cursor = writeInt(cursor, (uint16_t)payloadLength);
+
+	// The payload is already in place. Skip over it and append the CRC of everything before the CRC.
+	cursor += payloadLength;
+	writeInt(cursor, getCRC(buf, payloadOffset + payloadLength));
+
+	return payloadLength + frameOverhead;
+}
+
 uint16_t extractUInt16(const uint8_t* buf)
 {
 	return (uint16_t)(
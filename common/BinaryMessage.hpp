@@ -20,6 +20,17 @@ using namespace Exceptions;
 
 namespace BinaryMessage {
 
+/// The offset of the payload from the start of a binary message
+/// (2 magic bytes, type, 2 for ID, 2 for length)
+const size_t payloadOffset = 7;
+
+/// The number of bytes a binary message takes beyond its payload
+/// (the header before the payload and the 2-byte checksum after it)
+const size_t frameOverhead = payloadOffset + 2;
+
+/// The largest payload a binary message can carry, since its length is stored in 16 bits
+const size_t maxPayloadLength = 0xffff;
+
 /// Gets the magic bytes 'f' 'u'
 const std::array<uint8_t, 2>& getMagicBytes();
 
@@ -47,6 +58,36 @@ void appendInt(std::vector<uint8_t>& buf, uint32_t i);
 /// Appends a 32-bit signed integer to `buf`
 inline void appendInt(std::vector<uint8_t>& buf, int32_t i) { appendInt(buf, (uint32_t)i); }
 
+/// Don't let us accidentally call this for bytes, which would get promoted to a larger type
+inline uint8_t* writeInt(uint8_t*, uint8_t) { std::terminate(); }
+
+/// Don't let us accidentally call this for bytes, which would get promoted to a larger type
+inline uint8_t* writeInt(uint8_t*, int8_t) { std::terminate(); }
+
+/// Writes a 16-bit unsigned integer to `buf` and returns a pointer just past it
+inline uint8_t* writeInt(uint8_t* buf, uint16_t i)
+{
+	buf[0] = (uint8_t)((i & 0xff00) >> 8);
+	buf[1] = (uint8_t)((i & 0x00ff) >> 0);
+	return buf + 2;
+}
+
+/// Writes a 16-bit signed integer to `buf` and returns a pointer just past it
+inline uint8_t* writeInt(uint8_t* buf, int16_t i) { return writeInt(buf, (uint16_t)i); }
+
+/// Writes a 32-bit unsigned integer to `buf` and returns a pointer just past it
+inline uint8_t* writeInt(uint8_t* buf, uint32_t i)
+{
+	buf[0] = (uint8_t)((i & 0xff000000) >> 24);
+	buf[1] = (uint8_t)((i & 0x00ff0000) >> 16);
+	buf[2] = (uint8_t)((i & 0x0000ff00) >> 8);
+	buf[3] = (uint8_t)((i & 0x000000ff) >> 0);
+	return buf + 4;
+}
+
+/// Writes a 32-bit signed integer to `buf` and returns a pointer just past it
+inline uint8_t* writeInt(uint8_t* buf, int32_t i) { return writeInt(buf, (uint32_t)i); }
+
 /// Extracts at 16-bit unsigned integer from the memory at `buf`
 uint16_t extractUInt16(const uint8_t* buf);
 
@@ -59,6 +100,20 @@ uint32_t extractUInt32(const uint8_t* buf);
 /// Extracts at 32-bit signed integer from the memory at `buf`
 inline int32_t extractInt32(const uint8_t* buf) { return (int32_t)extractUInt32(buf); }
 
+/**
+ * \brief Fills in the header and checksum around a payload that has already been written in place
+ * \param buf The start of the message. The payload must already be at `buf + payloadOffset`,
+ *            and there must be room for the checksum after it.
+ * \param type The message type
+ * \param id The ID of the message
+ * \param payloadLength The length of the payload
+ * \returns The total length of the message, i.e. `payloadLength + frameOverhead`
+ *
+ * This lets a message be serialized straight into its final buffer without any intermediate copies.
+ * See makeMessage for the message format.
+ */
+size_t finishMessage(uint8_t* buf, Message::Type type, message_id_t id, size_t payloadLength);
+
 /**
  * \brief Generates a binary message
  * \param type The message type
@@ -76,7 +131,7 @@ inline int32_t extractInt32(const uint8_t* buf) { return (int32_t)extractUInt32(
  *   Specificially, it is the CRC-16-CCITT.
  *   See <http://en.wikipedia.org/wiki/Cyclic_redundancy_check#Commonly_used_and_standardized_CRCs>
  *
- * For individual payloads, see the getBinaryPayload function
+ * For individual payloads, see the writeBinaryPayload function
  * for the various message types.
  */
 template <typename InputIt>
@@ -86,30 +141,13 @@ std::vector<uint8_t> makeMessage(Message::Type type, message_id_t id,
 	if (payloadStart > payloadEnd)
 		THROW(ArgumentOutOfRangeException, "The start iterator is after the end iterator");
 
-	std::vector<uint8_t> ret;
-	// The message will be at least 9 bytes long
-	// (2 magic bytes, type, 2 for ID, 2 for length, 2 for checksum)
-	ret.reserve(9);
-
-	// Append magic bytes
-	auto magic = getMagicBytes();
-	ret.emplace_back(magic[0]);
-	ret.emplace_back(magic[1]);
-
-	// Append type
-	ret.emplace_back((int8_t)type);
-
-	// Append ID
-	appendInt(ret, id);
-
-	//Append length
-	appendInt(ret, (uint16_t)std::distance(payloadStart, payloadEnd));
+	const size_t payloadLength = (size_t)std::distance(payloadStart, payloadEnd);
 
-	// Append payload
-	ret.insert(end(ret), payloadStart, payloadEnd);
+	// Allocate the whole message up front and copy the payload into place
+	std::vector<uint8_t> ret(payloadLength + frameOverhead);
+	std::copy(payloadStart, payloadEnd, ret.begin() + payloadOffset);
 
-	// Append CRC
-	appendInt(ret, getCRC(ret));
+	finishMessage(ret.data(), type, id, payloadLength);
 
 	return ret;
 }
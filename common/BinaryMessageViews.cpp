@@ -0,0 +1,49 @@
+#include "BinaryMessageViews.hpp"
+
+#include <string>
+
+namespace BinaryMessage {
+
+MessageView::MessageView(const uint8_t* b, size_t len) :
+	buf(b)
+{
+	// Only build the error message if we need it so that valid messages don't cost an allocation.
+	std::string why;
+	if (!isValidMessage(buf, len, &why))
+		THROW(IOException, "Message is not valid: " + why);
+}
+
+ResponseView::ResponseView(const MessageView& message) :
+	msg(message)
+{
+	ENFORCE(IOException, msg.getType() == Message::Type::RESPONSE, "The message is not a response.");
+	// Make sure the payload contains for our expected data (respondingTo ID and code)
+	ENFORCE(IOException, msg.getPayloadLength() >= sizeof(message_id_t) + 1, "The provided message is too small.");
+}
+
+QueryView::QueryView(const MessageView& message) :
+	msg(message)
+{
+	ENFORCE(IOException, msg.getType() == Message::Type::QUERY, "The message is not a query.");
+	ENFORCE(IOException, msg.getPayloadLength() >= sizeof(board_id_t) + 1, "The provided message is too small");
+}
+
+ShotView::ShotView(const MessageView& message) :
+	msg(message)
+{
+	ENFORCE(IOException, msg.getType() == Message::Type::SHOT, "The message is not a shot.");
+	ENFORCE(IOException, msg.getPayloadLength() >= Shot::binaryLength,
+	        "This buffer does not have room for a shot.");
+}
+
+TargetControlView::TargetControlView(const MessageView& message) :
+	msg(message)
+{
+	ENFORCE(IOException, msg.getType() == Message::Type::TARGET_CONTROL,
+	        "The message is not a target control message.");
+	ENFORCE(IOException, msg.getPayloadLength() > 0, "The payload cannot fit target commands.");
+	ENFORCE(IOException, msg.getPayloadLength() % 2 == 0,
+	        "The payload is the incorrect size for target commands.");
+}
+
+} // end namespace BinaryMessage
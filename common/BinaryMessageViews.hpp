@@ -0,0 +1,211 @@
+#pragma once
+
+/**
+ * \file BinaryMessageViews.hpp
+ *
+ * Lightweight, non-owning views over binary messages.
+ * A view decodes fields straight out of the buffer it was handed as they are asked for,
+ * so code that just needs to look at (or route) a message does not have to
+ * allocate a Message object for it.
+ *
+ * Views do not copy the buffer, so it must outlive them.
+ */
+
+#include <cstdint>
+
+#include "BinaryMessage.hpp"
+#include "QueryMessage.hpp"
+#include "ResponseMessage.hpp"
+#include "Shot.hpp"
+#include "TargetControlMessage.hpp"
+
+namespace BinaryMessage {
+
+/// A view of any validated binary message
+class MessageView {
+
+public:
+
+	/**
+	 * \brief Validates the message in `buf` and creates a view of it
+	 * \param buf The buffer in which the message is held
+	 * \param len The length of the buffer
+	 * \throws Exceptions::IOException if the buffer does not hold a valid message
+	 */
+	MessageView(const uint8_t* buf, size_t len);
+
+	/**
+	 * \brief Creates a view of a message without checking it
+	 * \warning This assumes you have validated the message already (e.g. with isValidMessage).
+	 */
+	static MessageView fromValidated(const uint8_t* buf) { return MessageView(buf); }
+
+	Message::Type getType() const { return BinaryMessage::getType(buf); }
+
+	message_id_t getID() const { return BinaryMessage::getID(buf); }
+
+	/// Gets a pointer to the message's payload
+	const uint8_t* getPayload() const { return buf + payloadOffset; }
+
+	/// Gets the length of the message's payload
+	size_t getPayloadLength() const { return extractUInt16(buf + payloadOffset - 2); }
+
+	/// Gets a pointer to the start of the message
+	const uint8_t* data() const { return buf; }
+
+	/// Gets the length of the entire message, including its header and checksum
+	size_t size() const { return getPayloadLength() + frameOverhead; }
+
+private:
+
+	explicit MessageView(const uint8_t* b) : buf(b) { }
+
+	const uint8_t* buf;
+};
+
+/// A view of a binary ResponseMessage
+class ResponseView {
+
+public:
+
+	/// \throws Exceptions::IOException if the message is not a response or is too small to be one
+	explicit ResponseView(const MessageView& message);
+
+	message_id_t getID() const { return msg.getID(); }
+
+	message_id_t getRespondingTo() const { return extractUInt16(msg.getPayload()); }
+
+	ResponseMessage::Code getCode() const { return (ResponseMessage::Code)msg.getPayload()[2]; }
+
+private:
+
+	MessageView msg;
+};
+
+/// A view of a binary QueryMessage
+class QueryView {
+
+public:
+
+	/// \throws Exceptions::IOException if the message is not a query or is too small to be one
+	explicit QueryView(const MessageView& message);
+
+	message_id_t getID() const { return msg.getID(); }
+
+	board_id_t getBoardID() const { return (board_id_t)msg.getPayload()[0]; }
+
+	QueryMessage::BoardType getBoardType() const { return (QueryMessage::BoardType)msg.getPayload()[1]; }
+
+private:
+
+	MessageView msg;
+};
+
+/// A view of a binary ShotMessage
+class ShotView {
+
+public:
+
+	/// \throws Exceptions::IOException if the message is not a shot or is too small to be one
+	explicit ShotView(const MessageView& message);
+
+	message_id_t getID() const { return msg.getID(); }
+
+	/// Gets the ID of the player that took the shot
+	board_id_t getPlayer() const { return (board_id_t)msg.getPayload()[0]; }
+
+	/// Gets the ID of the target that was hit, or -1 for a miss
+	board_id_t getTarget() const { return (board_id_t)msg.getPayload()[1]; }
+
+	/// Gets the timestamp of the shot, in milliseconds since the game started
+	timestamp_t getTime() const { return extractInt32(msg.getPayload() + 2); }
+
+	/// Copies the shot out of the message
+	Shot toShot() const { return Shot(getPlayer(), getTarget(), getTime()); }
+
+private:
+
+	MessageView msg;
+};
+
+/// A view of a binary TargetControlMessage
+class TargetControlView {
+
+public:
+
+	/// \throws Exceptions::IOException if the message is not a target control message
+	///         or its payload is not a whole number of commands
+	explicit TargetControlView(const MessageView& message);
+
+	message_id_t getID() const { return msg.getID(); }
+
+	/// Gets the number of commands in the message
+	size_t size() const { return msg.getPayloadLength() / 2; }
+
+	/// Decodes the command at the given index
+	TargetCommand operator[](size_t i) const
+	{
+		const uint8_t* command = msg.getPayload() + i * 2;
+		return TargetCommand((board_id_t)command[0], command[1] != 0);
+	}
+
+private:
+
+	MessageView msg;
+};
+
+/**
+ * \brief Reads fields one after another out of a message's payload
+ *
+ * Used to decode messages whose payloads are variable-length,
+ * where a view with fixed offsets won't do. Every read is checked against the end of the payload.
+ */
+class PayloadReader {
+
+public:
+
+	explicit PayloadReader(const MessageView& message) :
+		cur(message.getPayload()),
+		end(message.getPayload() + message.getPayloadLength())
+	{ }
+
+	/// Gets the number of bytes not yet read
+	size_t remaining() const { return (size_t)(end - cur); }
+
+	bool atEnd() const { return cur == end; }
+
+	uint8_t readByte() { need(1); return *cur++; }
+
+	uint16_t readUInt16() { need(2); cur += 2; return extractUInt16(cur - 2); }
+
+	int16_t readInt16() { return (int16_t)readUInt16(); }
+
+	int32_t readInt32() { need(4); cur += 4; return extractInt32(cur - 4); }
+
+	Shot readShot()
+	{
+		const uint8_t* shot = readBytes(Shot::binaryLength);
+		return Shot::fromBinary(shot, Shot::binaryLength);
+	}
+
+	/// Gets a pointer to the next `len` bytes and skips over them
+	const uint8_t* readBytes(size_t len) { need(len); cur += len; return cur - len; }
+
+	// Disallow copy and assign
+	PayloadReader(const PayloadReader&) = delete;
+	PayloadReader& operator=(const PayloadReader&) = delete;
+
+private:
+
+	/// \throws Exceptions::IOException if fewer than `len` bytes are left
+	void need(size_t len) const
+	{
+		ENFORCE(Exceptions::IOException, remaining() >= len, "The provided message is too small.");
+	}
+
+	const uint8_t* cur;
+
+	const uint8_t* const end;
+};
+
+} // end namespace BinaryMessage
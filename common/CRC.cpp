@@ -0,0 +1,223 @@
+#include "CRC.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC_HAVE_CLMUL
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/// The CRC-16-CCITT polynomial, x^16 + x^12 + x^5 + 1, without its x^16 term
+const uint16_t polynomial = 0x1021;
+
+/// Buffers shorter than this aren't worth the setup of the folding path
+const size_t foldingThreshold = 32;
+
+/// Returns x^n mod P(x), where P is the CRC polynomial
+uint64_t xPowModP(unsigned int n)
+{
+	uint32_t r = 1;
+	for (unsigned int i = 0; i < n; ++i) {
+		r <<= 1;
+		if (r & 0x10000)
+			r ^= 0x10000 | polynomial;
+	}
+	return r;
+}
+
+/// Lookup tables and constants, computed once on first use
+struct Tables {
+
+	/// table[k][b] is the CRC (from zero) of the byte b followed by k zero bytes
+	uint16_t table[8][256];
+
+	/// x^192 mod P and x^128 mod P, used to fold a 128-bit block into the next one
+	uint64_t fold1Hi, fold1Lo;
+
+	/// x^576 mod P and x^512 mod P, used to fold a 128-bit block into one 64 bytes later
+	uint64_t fold4Hi, fold4Lo;
+
+	Tables() :
+		table(),
+		fold1Hi(xPowModP(192)),
+		fold1Lo(xPowModP(128)),
+		fold4Hi(xPowModP(576)),
+		fold4Lo(xPowModP(512))
+	{
+		for (unsigned int b = 0; b < 256; ++b) {
+			uint16_t crc = (uint16_t)(b << 8);
+			for (int bit = 0; bit < 8; ++bit)
+				crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ polynomial : crc << 1);
+			table[0][b] = crc;
+		}
+
+		// Each subsequent table runs the previous one through another zero byte
+		for (int k = 1; k < 8; ++k) {
+			for (unsigned int b = 0; b < 256; ++b) {
+				const uint16_t prev = table[k - 1][b];
+				table[k][b] = (uint16_t)((prev << 8) ^ table[0][prev >> 8]);
+			}
+		}
+	}
+};
+
+const Tables& getTables()
+{
+	static const Tables tables;
+	return tables;
+}
+
+uint16_t slicing(const uint8_t* p, size_t len, uint16_t crc)
+{
+	const auto& t = getTables().table;
+
+	// Since the CRC is 16 bits, it only mixes into the first two bytes of each group of eight.
+	while (len >= 8) {
+		const uint8_t b0 = (uint8_t)(p[0] ^ (crc >> 8));
+		const uint8_t b1 = (uint8_t)(p[1] ^ (crc & 0xff));
+		crc = (uint16_t)(t[7][b0] ^ t[6][b1] ^ t[5][p[2]] ^ t[4][p[3]]
+		               ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]]);
+		p += 8;
+		len -= 8;
+	}
+
+	while (len-- > 0)
+		crc = (uint16_t)((crc << 8) ^ t[0][(crc >> 8) ^ *p++]);
+
+	return crc;
+}
+
+#ifdef CRC_HAVE_CLMUL
+
+/*
+ * The folding path treats the message as one big polynomial over GF(2),
+ * with the first bit of the message as its highest-order term.
+ * We keep a 128-bit accumulator A that is congruent (mod P) to everything folded so far.
+ * To fold in the next 16 bytes B, we need A * x^128 + B. Splitting A into 64-bit halves,
+ * A * x^128 = A_hi * x^192 + A_lo * x^128, and we can replace x^192 and x^128
+ * with their (16-bit) remainders mod P. Both products then fit in 128 bits.
+ *
+ * Once we run out of whole blocks, A is fed through the table-driven code from a zero CRC,
+ * followed by whatever bytes are left over.
+ */
+
+#define CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+
+/// Loads 16 bytes, reversing them so that bit i of the result is the coefficient of x^i
+CLMUL_TARGET inline __m128i loadBlock(const uint8_t* p, __m128i reverse)
+{
+	return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p), reverse);
+}
+
+/// Multiplies the accumulator by x^n mod P, given (x^(n+64) mod P, x^n mod P) in k
+CLMUL_TARGET inline __m128i fold(__m128i a, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x11), _mm_clmulepi64_si128(a, k, 0x00));
+}
+
+CLMUL_TARGET uint16_t folding(const uint8_t* p, size_t len, uint16_t crc)
+{
+	const Tables& tables = getTables();
+
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i k1 = _mm_set_epi64x((long long)tables.fold1Hi, (long long)tables.fold1Lo);
+	const __m128i k4 = _mm_set_epi64x((long long)tables.fold4Hi, (long long)tables.fold4Lo);
+
+	// The initial CRC is equivalent to XORing it into the first 16 bits of the message.
+	const __m128i init = _mm_set_epi16((short)crc, 0, 0, 0, 0, 0, 0, 0);
+
+	__m128i a;
+
+	if (len >= 128) {
+		// Fold four independent lanes so the multiplies can overlap,
+		// then merge them into a single accumulator.
+		__m128i a0 = _mm_xor_si128(loadBlock(p, reverse), init);
+		__m128i a1 = loadBlock(p + 16, reverse);
+		__m128i a2 = loadBlock(p + 32, reverse);
+		__m128i a3 = loadBlock(p + 48, reverse);
+		p += 64;
+		len -= 64;
+
+		while (len >= 64) {
+			a0 = _mm_xor_si128(fold(a0, k4), loadBlock(p, reverse));
+			a1 = _mm_xor_si128(fold(a1, k4), loadBlock(p + 16, reverse));
+			a2 = _mm_xor_si128(fold(a2, k4), loadBlock(p + 32, reverse));
+			a3 = _mm_xor_si128(fold(a3, k4), loadBlock(p + 48, reverse));
+			p += 64;
+			len -= 64;
+		}
+
+		a = _mm_xor_si128(fold(a0, k1), a1);
+		a = _mm_xor_si128(fold(a, k1), a2);
+		a = _mm_xor_si128(fold(a, k1), a3);
+	}
+	else {
+		a = _mm_xor_si128(loadBlock(p, reverse), init);
+		p += 16;
+		len -= 16;
+	}
+
+	while (len >= 16) {
+		a = _mm_xor_si128(fold(a, k1), loadBlock(p, reverse));
+		p += 16;
+		len -= 16;
+	}
+
+	// Put the accumulator back in message order and let the tables reduce it.
+	uint8_t remainder[16];
+	_mm_storeu_si128((__m128i*)remainder, _mm_shuffle_epi8(a, reverse));
+
+	crc = slicing(remainder, sizeof(remainder), 0);
+	return slicing(p, len, crc);
+}
+
+#undef CLMUL_TARGET
+
+#endif // CRC_HAVE_CLMUL
+
+bool detectCarrylessMultiply()
+{
+#ifdef CRC_HAVE_CLMUL
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#else
+	return false;
+#endif
+}
+
+} // end anonymous namespace
+
+namespace CRC {
+
+uint16_t ccitt(const void* data, size_t len, uint16_t crc)
+{
+	// Most messages are short enough that the tables win.
+	if (len < foldingThreshold)
+		return slicing((const uint8_t*)data, len, crc);
+
+	return ccittFolding(data, len, crc);
+}
+
+uint16_t ccittSlicing(const void* data, size_t len, uint16_t crc)
+{
+	return slicing((const uint8_t*)data, len, crc);
+}
+
+uint16_t ccittFolding(const void* data, size_t len, uint16_t crc)
+{
+#ifdef CRC_HAVE_CLMUL
+	// The folding path needs at least one whole block
+	if (len >= 16 && hasCarrylessMultiply())
+		return folding((const uint8_t*)data, len, crc);
+#endif
+
+	return slicing((const uint8_t*)data, len, crc);
+}
+
+bool hasCarrylessMultiply()
+{
+	static const bool supported = detectCarrylessMultiply();
+	return supported;
+}
+
+} // end namespace CRC
@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * \file CRC.hpp
+ *
+ * An in-tree CRC-16-CCITT engine for binary messages.
+ *
+ * The CRC is the non-reflected CRC-16-CCITT with polynomial 0x1021, an initial value of 0xFFFF,
+ * and no final XOR (a.k.a. CRC-16/CCITT-FALSE). This matches boost::crc_ccitt_type and
+ * what the firmware on the guns and targets expects.
+ *
+ * Small buffers (which is what most of our messages are) are handled with slicing-by-8 tables.
+ * Larger ones are folded 16 bytes at a time with carry-less multiplication (PCLMULQDQ)
+ * when the CPU supports it. The choice is made at runtime, so the same binary
+ * runs everywhere.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CRC {
+
+/// The initial value of the CRC used by binary messages
+const uint16_t ccittInit = 0xffff;
+
+/**
+ * \brief Calculates the CRC-16-CCITT of `len` bytes starting at `data`
+ * \param data The bytes to checksum
+ * \param len The number of bytes to checksum
+ * \param crc The CRC to start from. Pass the result of a previous call
+ *            to continue a CRC across several buffers.
+ * \returns The CRC of the data
+ *
+ * This picks the fastest implementation available on the current CPU.
+ */
+uint16_t ccitt(const void* data, size_t len, uint16_t crc = ccittInit);
+
+/// Calculates the CRC-16-CCITT using only slicing-by-8 tables
+/// \see ccitt
+uint16_t ccittSlicing(const void* data, size_t len, uint16_t crc = ccittInit);
+
+/// Calculates the CRC-16-CCITT by folding with carry-less multiplication,
+/// or with slicing-by-8 tables if the CPU cannot do carry-less multiplication
+/// \see ccitt
+uint16_t ccittFolding(const void* data, size_t len, uint16_t crc = ccittInit);
+
+/// Returns true if the CPU supports the instructions used by ccittFolding
+bool hasCarrylessMultiply();
+
+} // end namespace CRC
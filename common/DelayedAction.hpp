@@ -1,61 +1,100 @@
 #pragma once
 
 #include <chrono>
-#include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 
-#include <type_traits>
+#include "TimerService.hpp"
 
 /**
  * \brief Fires off a some action after a given amount of time
- * \tparam A The action to take
+ * \tparam T The type of the delay
+ *
+ * The action is run by a TimerService when its delay is up,
+ * so any number of delayed actions can be waiting without a thread apiece.
+ * It is run exactly once: when the delay is up, when runEarly is called, or when the DelayedAction is destroyed,
+ * whichever comes first. Like any TimerService callback, it should be quick.
  */
 template <typename T = std::chrono::milliseconds>
 class DelayedAction  {
 public:
+	/// Runs the action on the shared TimerService
 	template <typename A>
-	DelayedAction(T del, A act) :
-		over(false),
-		mtx(),
-		cv(),
-		delay(del),
-		action(act),
-		worker(&DelayedAction::threadProc, this)
-	{ }
+	DelayedAction(T del, A act) : DelayedAction(TimerService::shared(), del, act) { }
+
+	template <typename A>
+	DelayedAction(TimerService& service, T del, A act) :
+		timers(service),
+		state(std::make_shared<State>(act)),
+		timer()
+	{
+		auto s = state;
+		timer = timers.scheduleAfter(del, [s] { s->run(); });
+	}
 
 	~DelayedAction()
 	{
 		// If we haven't exited yet, do it now
 		runEarly();
-		worker.join();
+		state->waitUntilDone();
 	}
 
+	/// Runs the action now (on the calling thread) if it hasn't been run yet
 	void runEarly()
 	{
-		std::lock_guard<std::mutex> guard(mtx);
-		over = true;
+		// If this loses the race with the timer, the action is already running (or done) on the service's thread.
+		timers.runNow(timer);
 	}
 
 	bool isOver()
 	{
-		std::lock_guard<std::mutex> guard(mtx);
-		return over;
+		std::lock_guard<std::mutex> guard(state->mtx);
+		return state->over;
 	}
 
 private:
 
-	void threadProc()
-	{
-		std::unique_lock<std::mutex> lock(mtx);
-		if (!cv.wait_for(lock, delay, [&] { return over; }))
-			over = true; // If we weren't over yet, we're over now.
-		action();
-	}
+	/// Shared with the timer, which may fire after we're gone if it loses the race with runEarly
+	struct State {
+		bool over; ///< Set once the action has started
+		bool done; ///< Set once the action has finished
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::function<void()> action;
+
+		template <typename A>
+		explicit State(A act) : over(false), done(false), mtx(), cv(), action(act) { }
+
+		void run()
+		{
+			{
+				std::lock_guard<std::mutex> guard(mtx);
+				if (over)
+					return;
+				over = true;
+			}
+
+			action();
+
+			std::lock_guard<std::mutex> guard(mtx);
+			done = true;
+			cv.notify_all();
+		}
+
+		void waitUntilDone()
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			cv.wait(lock, [this] { return done; });
+		}
+	};
+
+	// Disallow copy and assign
+	DelayedAction(const DelayedAction&) = delete;
+	DelayedAction& operator=(const DelayedAction&) = delete;
 
-	bool over;
-	std::mutex mtx;
-	std::condition_variable cv;
-	T delay;
-	std::function<void()> action;
-	std::thread worker;
+	TimerService& timers;
+	std::shared_ptr<State> state;
+	TimerService::TimerID timer;
 };
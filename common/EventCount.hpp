@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unistd.h>
+
+/**
+ * \brief A condition variable for lock-free data structures
+ *
+ * A waiter first takes a key with prepareWait(), then re-checks whatever it is waiting on
+ * (e.g. tries to pop from a queue). If the check succeeds, it calls cancelWait().
+ * Otherwise it calls wait() with the key, which returns as soon as notify() has been called
+ * at any point after the key was taken, so no wakeups are lost between the check and the wait.
+ *
+ * notify() only touches the mutex when somebody is actually waiting,
+ * so a producer talking to a busy consumer pays for a single atomic increment.
+ *
+ * A waiter that also waits on file descriptors (in epoll, say) can have notify() signal an eventfd
+ * (see setEventFD) and wait on that instead of calling wait(), calling cancelWait() once it wakes.
+ */
+class EventCount {
+
+public:
+
+	EventCount() : epoch(0), waiters(0), mtx(), cv(), eventFD(-1) { }
+
+	/// Announces the intent to wait and returns a key to pass to wait() or waitUntil()
+	uint32_t prepareWait()
+	{
+		waiters.fetch_add(1);
+		return epoch.load();
+	}
+
+	/// Backs out of a prepareWait() call, used if the condition was met after all
+	void cancelWait() { waiters.fetch_sub(1); }
+
+	/// Blocks until notify() is called after the given key was taken
+	void wait(uint32_t key)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, [&] { return epoch.load() != key; });
+		waiters.fetch_sub(1);
+	}
+
+	/**
+	 * \brief Blocks until notify() is called after the given key was taken, or until the given time
+	 * \returns false if the time was reached without a notification
+	 */
+	template <typename Clock, typename Duration>
+	bool waitUntil(uint32_t key, const std::chrono::time_point<Clock, Duration>& time)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		const bool notified = cv.wait_until(lock, time, [&] { return epoch.load() != key; });
+		waiters.fetch_sub(1);
+		return notified;
+	}
+
+	/// Wakes all current waiters
+	void notify()
+	{
+		epoch.fetch_add(1);
+
+		// Taking the mutex here ensures a waiter that just checked the epoch
+		// is actually asleep on the condition variable before we notify it.
+		if (waiters.load() > 0) {
+			std::lock_guard<std::mutex> guard(mtx);
+			cv.notify_all();
+
+			const int fd = eventFD.load();
+			if (fd >= 0) {
+				const uint64_t one = 1;
+				// If the counter is somehow full, the waiter is awake anyways.
+				const ssize_t ignored = write(fd, &one, sizeof(one));
+				(void)ignored;
+			}
+		}
+	}
+
+	/// Sets an eventfd for notify() to signal while anyone is waiting, or -1 to stop signaling one
+	void setEventFD(int fd) { eventFD.store(fd); }
+
+	// Disallow copy and assign
+	EventCount(const EventCount&) = delete;
+	EventCount& operator=(const EventCount&) = delete;
+
+private:
+
+	std::atomic<uint32_t> epoch;
+	std::atomic<int> waiters;
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::atomic<int> eventFD;
+};
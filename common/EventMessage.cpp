@@ -0,0 +1,163 @@
+#include "EventMessage.hpp"
+
+#include <cassert>
+
+#include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
+#include "Exceptions.hpp"
+#include "JSONWriter.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+#ifdef WITH_JSON
+using namespace Json;
+#endif
+
+namespace {
+
+/// Event kind names, indexed by kind
+const char* const kindNames[GameEvent::kindCount] = {
+	"shot",
+	"score",
+	"target up",
+	"target down",
+	"game over"
+};
+
+#ifdef WITH_JSON
+const StaticString eventKey("event");
+const StaticString playerKey("player");
+const StaticString targetKey("target");
+const StaticString scoreKey("score");
+const StaticString hitsKey("hits");
+const StaticString timeKey("time");
+
+int getInt(const Value& object, const StaticString& key, const char* missing, const char* notAnInt)
+{
+	ENFORCE(IOException, object.isMember(key), missing);
+	const Value& val = object[key];
+	ENFORCE(IOException, val.isInt(), notAnInt);
+	return val.asInt();
+}
+#endif
+
+} // end anonymous namespace
+
+const char* GameEvent::kindName(Kind k)
+{
+	assert((size_t)k < kindCount);
+	return kindNames[(size_t)k];
+}
+
+GameEvent::Kind GameEvent::kindFromName(const std::string& name)
+{
+	for (size_t i = 0; i < kindCount; ++i) {
+		if (name == kindNames[i])
+			return (Kind)i;
+	}
+
+	THROW(IOException, "The event kind is unknown.");
+}
+
+#ifdef WITH_JSON
+std::unique_ptr<EventMessage> EventMessage::fromJSON(const Json::Value& object)
+{
+	auto msg = Message::fromJSON(object);
+
+	ENFORCE(IOException, object.isMember(eventKey), "Event message is missing the event kind");
+	const Value& eventValue = object[eventKey];
+	ENFORCE(IOException, eventValue.isString(), "The event kind is not a string.");
+
+	const GameEvent e(GameEvent::kindFromName(eventValue.asString()),
+	                  (board_id_t)getInt(object, playerKey, "Event message is missing the player",
+	                                     "The event's player is not an integer."),
+	                  (board_id_t)getInt(object, targetKey, "Event message is missing the target",
+	                                     "The event's target is not an integer."),
+	                  (score_t)getInt(object, scoreKey, "Event message is missing the score",
+	                                  "The event's score is not an integer."),
+	                  (shot_t)getInt(object, hitsKey, "Event message is missing the hits",
+	                                 "The event's hit count is not an integer."),
+	                  (timestamp_t)getInt(object, timeKey, "Event message is missing the time",
+	                                      "The event's time is not an integer."));
+
+	return std::unique_ptr<EventMessage>(new EventMessage(msg->id, e));
+}
+
+Json::Value EventMessage::toJSON() const
+{
+	Value ret = Message::toJSON();
+
+	ret[eventKey] = GameEvent::kindName(event.kind);
+	ret[playerKey] = event.player;
+	ret[targetKey] = event.target;
+	ret[scoreKey] = event.score;
+	ret[hitsKey] = event.hits;
+	ret[timeKey] = event.time;
+
+	return ret;
+}
+
+void EventMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	writer.key(eventKey.c_str());
+	writer.value(GameEvent::kindName(event.kind));
+	writer.key(playerKey.c_str());
+	writer.value(event.player);
+	writer.key(targetKey.c_str());
+	writer.value(event.target);
+	writer.key(scoreKey.c_str());
+	writer.value(event.score);
+	writer.key(hitsKey.c_str());
+	writer.value(event.hits);
+	writer.key(timeKey.c_str());
+	writer.value(event.time);
+}
+#endif
+
+std::unique_ptr<EventMessage> EventMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<EventMessage> EventMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	BinaryMessage::PayloadReader reader(view);
+
+	const uint8_t kind = reader.readByte();
+	ENFORCE(IOException, kind < GameEvent::kindCount, "The event kind is unknown.");
+
+	const board_id_t player = (board_id_t)reader.readByte();
+	const board_id_t target = (board_id_t)reader.readByte();
+	const score_t score = reader.readInt16();
+	const shot_t hits = reader.readInt16();
+	const timestamp_t time = reader.readInt32();
+
+	return std::unique_ptr<EventMessage>(
+		new EventMessage(view.getID(), GameEvent((GameEvent::Kind)kind, player, target, score, hits, time)));
+}
+
+void EventMessage::writeBinaryPayload(uint8_t* buf) const
+{
+	*buf++ = (uint8_t)event.kind;
+	*buf++ = (uint8_t)event.player;
+	*buf++ = (uint8_t)event.target;
+	buf = BinaryMessage::writeInt(buf, event.score);
+	buf = BinaryMessage::writeInt(buf, event.hits);
+	BinaryMessage::writeInt(buf, event.time);
+}
+
+bool EventMessage::operator==(const Message& o) const
+{
+	if (!Message::operator==(o))
+		return false;
+
+	auto em = dynamic_cast<const EventMessage*>(&o);
+
+	if (em == nullptr)
+		return false;
+
+	return event == em->event;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "Message.hpp"
+#include "Shot.hpp"
+
+/**
+ * \brief Something that happened during a game, pushed to clients that subscribed to it
+ *
+ * Only the members that matter for an event's kind are filled in. The rest are -1 (for IDs) or 0.
+ * \see SubscribeMessage
+ */
+struct GameEvent {
+
+	/// The kinds of things that can happen
+	enum class Kind : uint8_t {
+		SHOT, ///< A shot was registered (player, target, time)
+		SCORE, ///< A player's score changed (player, score, hits, time)
+		TARGET_UP, ///< A target lit up (target, time)
+		TARGET_DOWN, ///< A target went dark (target, time)
+		GAME_OVER ///< The game ended (time)
+	};
+
+	/// A set of event kinds, with one bit per Kind
+	typedef uint8_t KindMask;
+
+	/// The number of event kinds
+	static const size_t kindCount = 5;
+
+	/// Every kind of event
+	static const KindMask allKinds = (1 << kindCount) - 1;
+
+	/// Returns the set containing only the given kind
+	static KindMask only(Kind k) { return (KindMask)(1 << (int)k); }
+
+	/// Gets the name of a kind as it appears in JSON
+	static const char* kindName(Kind k);
+
+	/// \throws Exceptions::IOException if the name is not that of a kind
+	static Kind kindFromName(const std::string& name);
+
+	static GameEvent shot(const Shot& s) { return GameEvent(Kind::SHOT, s.player, s.target, 0, 0, s.time); }
+
+	static GameEvent scoreChanged(board_id_t player, score_t score, shot_t hits, timestamp_t time)
+	{
+		return GameEvent(Kind::SCORE, player, -1, score, hits, time);
+	}
+
+	static GameEvent targetChanged(board_id_t target, bool up, timestamp_t time)
+	{
+		return GameEvent(up ? Kind::TARGET_UP : Kind::TARGET_DOWN, -1, target, 0, 0, time);
+	}
+
+	static GameEvent gameOver(timestamp_t time) { return GameEvent(Kind::GAME_OVER, -1, -1, 0, 0, time); }
+
+	GameEvent(Kind k, board_id_t p, board_id_t tar, score_t s, shot_t h, timestamp_t t) :
+		kind(k), player(p), target(tar), score(s), hits(h), time(t)
+	{ }
+
+	bool operator==(const GameEvent& o) const
+	{
+		return kind == o.kind && player == o.player && target == o.target
+			&& score == o.score && hits == o.hits && time == o.time;
+	}
+
+	Kind kind;
+	board_id_t player; ///< The player involved, or -1
+	board_id_t target; ///< The target involved, or -1
+	score_t score; ///< The player's new score
+	shot_t hits; ///< The player's new hit count
+	timestamp_t time; ///< When it happened, in milliseconds since the game started
+};
+
+/**
+ * \brief Sent by the state machine as things happen during a game
+ *
+ * Live displays subscribe to these (see SubscribeMessage) instead of polling with StatusMessage.
+ */
+class EventMessage : public Message {
+
+public:
+
+	EventMessage(message_id_t id, const GameEvent& e) : Message(id), event(e) { }
+
+#ifdef WITH_JSON
+	/// Deserializes a message from a JSON object.
+	/// \warning Do not call this directly. Call JSONToMessage instead.
+	static std::unique_ptr<EventMessage> fromJSON(const Json::Value& object);
+
+	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
+#endif
+
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<EventMessage> fromBinary(uint8_t* buf, size_t len);
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<EventMessage> fromBinary(const BinaryMessage::MessageView& view);
+
+	/**
+	 * \brief Writes the event message's binary payload
+	 *
+	 * An event message has the following payload:
+	 * - One byte for the kind of event
+	 * - One signed byte for the player
+	 * - One signed byte for the target
+	 * - A 16-bit signed integer for the score
+	 * - A 16-bit signed integer for the hit count
+	 * - A 32-bit signed integer for the time
+	 */
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override { return 3 + 2 * sizeof(int16_t) + sizeof(timestamp_t); }
+
+	Type getType() const override { return Type::EVENT; }
+
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new EventMessage(*this)); }
+
+	bool operator==(const Message& o) const override;
+
+	const GameEvent event;
+};
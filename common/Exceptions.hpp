@@ -288,6 +288,15 @@ namespace Exceptions
 			throw T(message, file, line);
 	}
 
+	/// An overload of enforce for string literals,
+	/// which only builds a std::string for the message if the check fails
+	template <typename T = Exception>
+	inline void enforce(bool cond, const char* message, const char* file, int line)
+	{
+		if (!cond)
+			throw T(message, file, line);
+	}
+
 } // end namespace Exceptions
 
 #ifdef ENFORCE
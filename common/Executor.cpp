@@ -0,0 +1,210 @@
+#include "Executor.hpp"
+
+#include <algorithm>
+
+#include "Exceptions.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+namespace {
+
+/// The executor the current thread works for, if any
+thread_local const Executor* currentExecutor = nullptr;
+
+/// The index of the current thread's deque in its executor
+thread_local size_t currentWorker = 0;
+
+} // end anonymous namespace
+
+Executor::Executor(size_t workerCount, size_t blockingCount) :
+	workers(),
+	queued(0),
+	nextWorker(0),
+	sleepers(0),
+	sleepMutex(),
+	wakeUp(),
+	stopping(false),
+	blockingMutex(),
+	blockingReady(),
+	blockingTasks(),
+	blockingStopping(false),
+	workerThreads(),
+	blockingThreads(),
+	timers()
+{
+	if (workerCount == 0)
+		workerCount = max(thread::hardware_concurrency(), 1u);
+
+	// All the deques must exist before any worker goes looking through them.
+	for (size_t i = 0; i < workerCount; ++i)
+		workers.emplace_back(new Worker);
+
+	for (size_t i = 0; i < workerCount; ++i)
+		workerThreads.emplace_back(&Executor::workerProc, this, i);
+
+	for (size_t i = 0; i < blockingCount; ++i)
+		blockingThreads.emplace_back(&Executor::blockingProc, this);
+}
+
+Executor::~Executor()
+{
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+
+	for (auto& t : workerThreads)
+		t.join();
+
+	{
+		lock_guard<mutex> lock(blockingMutex);
+		blockingStopping = true;
+	}
+	blockingReady.notify_all();
+
+	for (auto& t : blockingThreads)
+		t.join();
+}
+
+void Executor::post(Task&& task)
+{
+	if (isWorker())
+		push(currentWorker, move(task));
+	else
+		push(nextWorker.fetch_add(1) % workers.size(), move(task));
+
+	wakeOne();
+}
+
+Executor::TimerID Executor::postAt(TimePoint when, Task&& task)
+{
+	// std::function needs something it can copy, so share the task instead of moving it into the lambda.
+	auto shared = make_shared<Task>(move(task));
+	return timers.schedule(when, [this, shared] { post(move(*shared)); });
+}
+
+bool Executor::cancel(TimerID timer)
+{
+	return timers.cancel(timer);
+}
+
+void Executor::postBlocking(Task&& task)
+{
+	ENFORCE(InvalidOperationException, !blockingThreads.empty(), "The executor has no blocking threads.");
+
+	{
+		lock_guard<mutex> lock(blockingMutex);
+		blockingTasks.emplace_back(move(task));
+	}
+	blockingReady.notify_one();
+}
+
+bool Executor::isWorker() const
+{
+	return currentExecutor == this;
+}
+
+void Executor::workerProc(size_t index)
+{
+	currentExecutor = this;
+	currentWorker = index;
+
+	Task task;
+
+	while (true) {
+		if (pop(index, task) || steal(index, task)) {
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		unique_lock<mutex> lock(sleepMutex);
+
+		// Finish everything that was posted before we go.
+		if (stopping && queued == 0)
+			return;
+
+		// Announce that we're about to sleep before checking for work one last time.
+		// post() bumps queued before it checks sleepers, so one of us is sure to see the other.
+		++sleepers;
+
+		if (queued == 0 && !stopping)
+			wakeUp.wait(lock);
+
+		--sleepers;
+	}
+}
+
+void Executor::blockingProc()
+{
+	unique_lock<mutex> lock(blockingMutex);
+
+	while (true) {
+		blockingReady.wait(lock, [this] { return blockingStopping || !blockingTasks.empty(); });
+
+		if (blockingTasks.empty())
+			return;
+
+		Task task = move(blockingTasks.front());
+		blockingTasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+void Executor::push(size_t index, Task&& task)
+{
+	Worker& w = *workers[index];
+	{
+		lock_guard<mutex> lock(w.tasksMutex);
+		w.tasks.emplace_back(move(task));
+	}
+	++queued;
+}
+
+bool Executor::pop(size_t index, Task& task)
+{
+	Worker& w = *workers[index];
+	lock_guard<mutex> lock(w.tasksMutex);
+	if (w.tasks.empty())
+		return false;
+
+	task = move(w.tasks.back());
+	w.tasks.pop_back();
+	--queued;
+	return true;
+}
+
+bool Executor::steal(size_t thief, Task& task)
+{
+	if (queued == 0)
+		return false;
+
+	for (size_t i = 1; i < workers.size(); ++i) {
+		Worker& victim = *workers[(thief + i) % workers.size()];
+		lock_guard<mutex> lock(victim.tasksMutex);
+		if (victim.tasks.empty())
+			continue;
+
+		// Take the oldest task, which is the least likely to be in the victim's cache.
+		task = move(victim.tasks.front());
+		victim.tasks.pop_front();
+		--queued;
+		return true;
+	}
+	return false;
+}
+
+void Executor::wakeOne()
+{
+	if (sleepers == 0)
+		return;
+
+	// Taking the mutex ensures that a worker that just checked for work is actually waiting before we notify it.
+	lock_guard<mutex> lock(sleepMutex);
+	wakeUp.notify_one();
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TimerService.hpp"
+
+/**
+ * \brief A fixed pool of threads that runs short tasks, timers, and blocking work
+ *
+ * Each worker has its own deque of tasks. Tasks posted from a worker go on the back of its own deque,
+ * and it takes its next task from the back as well, so work that spawns more work stays on one core
+ * while its data is still in cache. Tasks posted from any other thread are dealt out round-robin.
+ * A worker that runs out of tasks steals from the front of the others' deques before it goes to sleep.
+ *
+ * Timers (see postAt) are kept by a TimerService of the executor's own, which posts each one to the workers
+ * when it comes due.
+ *
+ * Tasks run on the workers must not block, since they hold up everything queued behind them.
+ * Work that does (like waiting on a MessageQueue or a socket) goes to a separate pool with postBlocking.
+ * Tasks must not throw, either. Like an exception escaping a std::thread, that ends the process.
+ */
+class Executor {
+
+public:
+
+	typedef std::function<void()> Task;
+
+	typedef TimerService::Clock Clock;
+
+	typedef TimerService::TimePoint TimePoint;
+
+	/// Identifies a timer so that it can be canceled
+	typedef TimerService::TimerID TimerID;
+
+	/**
+	 * \brief Starts the executor's threads
+	 * \param workerCount The number of threads that run tasks and timers. Zero starts one per core.
+	 * \param blockingCount The number of threads that run blocking tasks. Each blocking task holds a thread
+	 *                      for as long as it runs, so there must be at least as many as will run at once.
+	 */
+	explicit Executor(size_t workerCount = 0, size_t blockingCount = 0);
+
+	/**
+	 * \brief Waits for all posted tasks to finish, then stops the executor's threads
+	 *
+	 * Timers that haven't fired yet are dropped.
+	 * Blocking tasks must have returned (or be about to) for this to return.
+	 */
+	~Executor();
+
+	/// Runs a task on one of the workers as soon as one is free
+	void post(Task&& task);
+
+	/**
+	 * \brief Runs a task on one of the workers once the given time arrives
+	 * \returns An ID that can be passed to cancel
+	 */
+	TimerID postAt(TimePoint when, Task&& task);
+
+	/// Runs a task on one of the workers after the given delay. \see postAt
+	template <typename Rep, typename Period>
+	TimerID postAfter(const std::chrono::duration<Rep, Period>& delay, Task&& task)
+	{
+		return postAt(Clock::now() + std::chrono::duration_cast<Clock::duration>(delay), std::move(task));
+	}
+
+	/**
+	 * \brief Cancels a timer
+	 * \returns true if the timer was canceled, or false if it has already fired (or been canceled)
+	 */
+	bool cancel(TimerID timer);
+
+	/// Runs a task that may block on one of the blocking threads
+	void postBlocking(Task&& task);
+
+	size_t getWorkerCount() const { return workers.size(); }
+
+	size_t getBlockingCount() const { return blockingThreads.size(); }
+
+	/// Returns true if the calling thread is one of this executor's workers
+	bool isWorker() const;
+
+private:
+
+	/// One worker's tasks, which other workers may steal
+	struct Worker {
+		std::mutex tasksMutex;
+		std::deque<Task> tasks;
+
+		Worker() : tasksMutex(), tasks() { }
+	};
+
+	void workerProc(size_t index);
+
+	void blockingProc();
+
+	/// Puts a task on the back of the given worker's deque
+	void push(size_t index, Task&& task);
+
+	/// Takes a task from the back of the given worker's deque
+	bool pop(size_t index, Task& task);
+
+	/// Takes a task from the front of some other worker's deque
+	bool steal(size_t thief, Task& task);
+
+	/// Wakes a sleeping worker, if there is one
+	void wakeOne();
+
+	// Disallow copy and assign
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	/// The number of tasks in all the workers' deques
+	std::atomic<size_t> queued;
+
+	/// Where the next task posted from outside the workers goes
+	std::atomic<size_t> nextWorker;
+
+	/// The number of workers that are (or are about to be) asleep
+	std::atomic<size_t> sleepers;
+
+	/// Guards stopping, and is what sleeping workers wait on
+	std::mutex sleepMutex;
+
+	std::condition_variable wakeUp;
+
+	bool stopping;
+
+	std::mutex blockingMutex;
+
+	std::condition_variable blockingReady;
+
+	std::deque<Task> blockingTasks;
+
+	bool blockingStopping;
+
+	std::vector<std::thread> workerThreads;
+
+	std::vector<std::thread> blockingThreads;
+
+	/// Declared last so that it is stopped first, before anything a timer might post to goes away
+	TimerService timers;
+};
@@ -1,7 +1,7 @@
 #pragma once
 
+#include "BinaryMessageViews.hpp"
 #include "Message.hpp"
-#include "Exceptions.hpp"
 
 /// Indicates that the receiver should finish/exit.
 /// Not used with the boards, but internally with the state machine and UI
@@ -19,16 +19,24 @@ public:
 	}
 #endif
 
-	/// The ExitMessage is not serializable to binary
-	/// \throws Exceptions::InvalidOperationException upon being called
-	std::vector<uint8_t> getBinaryPayload() const override
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ExitMessage> fromBinary(uint8_t* buf, size_t len)
 	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
+		return fromBinary(BinaryMessage::MessageView(buf, len));
+	}
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ExitMessage> fromBinary(const BinaryMessage::MessageView& view)
+	{
+		return std::unique_ptr<ExitMessage>(new ExitMessage(view.getID()));
 	}
 
 	Type getType() const override { return Type::EXIT; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new ExitMessage(*this)); }
+
 	bool operator==(const Message& o) const override
 	{
 		return Message::operator==(o) && dynamic_cast<const ExitMessage*>(&o) != nullptr;
@@ -0,0 +1,137 @@
+#include "FrameDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Exceptions.hpp"
+
+namespace BinaryMessage {
+
+FrameDecoder::FrameDecoder(size_t maxPayloadLen, size_t capacity) :
+	maxPayload(maxPayloadLen),
+	buf(capacity == 0 ? maxPayloadLen + frameOverhead : capacity),
+	start(0),
+	end(0),
+	stats()
+{
+	ENFORCE(ArgumentOutOfRangeException, maxPayload <= maxPayloadLength,
+	        "The maximum payload length cannot exceed what a binary message can carry.");
+	ENFORCE(ArgumentOutOfRangeException, buf.size() >= maxPayload + frameOverhead,
+	        "The decoder's buffer must be able to hold the largest frame it accepts.");
+}
+
+std::pair<uint8_t*, size_t> FrameDecoder::prepare()
+{
+	// Slide whatever is left to the front of the buffer to make room at the end.
+	if (start > 0) {
+		std::memmove(buf.data(), buf.data() + start, end - start);
+		end -= start;
+		start = 0;
+	}
+
+	return std::pair<uint8_t*, size_t>(buf.data() + end, buf.size() - end);
+}
+
+void FrameDecoder::commit(size_t len)
+{
+	ENFORCE(ArgumentOutOfRangeException, len <= buf.size() - end,
+	        "Cannot commit more bytes than prepare() made room for.");
+	end += len;
+}
+
+size_t FrameDecoder::feed(const uint8_t* data, size_t len)
+{
+	auto space = prepare();
+	const size_t accepted = std::min(len, space.second);
+	std::memcpy(space.first, data, accepted);
+	commit(accepted);
+	return accepted;
+}
+
+const uint8_t* FrameDecoder::next()
+{
+	const auto& magic = getMagicBytes();
+
+	while (end - start >= payloadOffset) {
+		const uint8_t* frame = buf.data() + start;
+
+		if (frame[0] != magic[0] || frame[1] != magic[1]) {
+			resync();
+			continue;
+		}
+
+		// The firmware can't send anything past UNKNOWN, so a bad type means we're not looking at a frame.
+		if ((int8_t)frame[2] < 0 || frame[2] > (uint8_t)Message::Type::UNKNOWN) {
+			resync();
+			continue;
+		}
+
+		const size_t payloadLength = extractUInt16(frame + payloadOffset - 2);
+		if (payloadLength > maxPayload) {
+			++stats.oversized;
+			resync();
+			continue;
+		}
+
+		// Wait for the rest of the frame
+		if (end - start < payloadLength + frameOverhead)
+			return nullptr;
+
+		const uint8_t* crc = frame + payloadOffset + payloadLength;
+		if (extractUInt16(crc) != getCRC(frame, payloadOffset + payloadLength)) {
+			++stats.crcFailures;
+			resync();
+			continue;
+		}
+
+		start += payloadLength + frameOverhead;
+		++stats.frames;
+		return frame;
+	}
+
+	// Don't let a partial header that can't possibly be the start of a frame sit around.
+	if (end > start && (buf[start] != magic[0] || (end - start > 1 && buf[start + 1] != magic[1])))
+		resync();
+
+	return nullptr;
+}
+
+void FrameDecoder::discard(size_t count)
+{
+	start += count;
+	stats.bytesDiscarded += count;
+
+	// If everything has been consumed, start from the front of the buffer again.
+	if (start == end)
+		start = end = 0;
+}
+
+void FrameDecoder::resync()
+{
+	++stats.resyncs;
+
+	const auto& magic = getMagicBytes();
+
+	// The byte at start is known to be bad, so begin looking at the one after it.
+	const uint8_t* first = buf.data() + start + 1;
+	const uint8_t* last = buf.data() + end;
+
+	while (first < last) {
+		first = (const uint8_t*)std::memchr(first, magic[0], (size_t)(last - first));
+		if (first == nullptr) {
+			first = last;
+			break;
+		}
+
+		// Stop if we find both magic bytes, or if the first one is the last byte we have
+		// (the second might be on its way).
+		if (first + 1 == last || first[1] == magic[1])
+			break;
+
+		++first;
+	}
+
+	discard((size_t)(first - (buf.data() + start)));
+}
+
+} // end namespace BinaryMessage
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "BinaryMessage.hpp"
+
+namespace BinaryMessage {
+
+/**
+ * \brief Reassembles binary messages from a byte stream
+ *
+ * Serial ports and sockets hand us bytes in whatever chunks they please,
+ * so a read may contain part of a frame, several frames back to back, or line noise.
+ * The decoder buffers what it is given and hands back complete, validated frames
+ * (see makeMessage for the frame format) as pointers into its own buffer, so nothing is copied.
+ *
+ * When the decoder finds garbage or a frame fails its CRC, it skips ahead
+ * to the next pair of magic bytes and tries again.
+ *
+ * Typical use:
+ * \code
+ * auto space = decoder.prepare();
+ * decoder.commit(read(fd, space.first, space.second));
+ * while (const uint8_t* frame = decoder.next())
+ *     handle(MessageView::fromValidated(frame));
+ * \endcode
+ *
+ * A decoder is not thread-safe.
+ */
+class FrameDecoder {
+
+public:
+
+	/// Counters describing the health of the stream
+	struct Statistics {
+		uint64_t frames; ///< Valid frames handed out
+		uint64_t resyncs; ///< Times the decoder had to skip bytes to find the next frame
+		uint64_t crcFailures; ///< Frames that had a bad CRC
+		uint64_t oversized; ///< Frames whose length exceeded the maximum payload length
+		uint64_t bytesDiscarded; ///< Bytes skipped while resyncing
+
+		Statistics() : frames(0), resyncs(0), crcFailures(0), oversized(0), bytesDiscarded(0) { }
+	};
+
+	/**
+	 * \brief Constructs a frame decoder
+	 * \param maxPayloadLen The longest payload to accept. Anything claiming to be longer is treated as noise.
+	 *                   Lower this to match the boards on the other end of the stream.
+	 * \param capacity The size of the decoder's buffer. It must be able to hold a frame
+	 *                 with the maximum payload length. Defaults to exactly that.
+	 */
+	explicit FrameDecoder(size_t maxPayloadLen = maxPayloadLength, size_t capacity = 0);
+
+	/**
+	 * \brief Gets space to read more bytes into
+	 * \returns A pointer to the free space at the end of the buffer and the size of that space.
+	 *          The size is zero if the buffer is full, in which case the caller
+	 *          should drain frames with next() before reading more.
+	 * \warning This may move buffered bytes, invalidating frames previously returned by next().
+	 */
+	std::pair<uint8_t*, size_t> prepare();
+
+	/// Marks `len` bytes of the space returned by prepare() as filled
+	void commit(size_t len);
+
+	/**
+	 * \brief Copies bytes into the decoder
+	 * \returns The number of bytes accepted, which is less than `len` if the buffer fills up
+	 * \warning This may move buffered bytes, invalidating frames previously returned by next().
+	 */
+	size_t feed(const uint8_t* data, size_t len);
+
+	/**
+	 * \brief Gets the next complete frame from the buffer
+	 * \returns A pointer to the start of a validated frame, or null if no complete frame is buffered.
+	 *          The frame remains valid until the next call to prepare() or feed().
+	 */
+	const uint8_t* next();
+
+	/// Gets the number of bytes buffered but not yet decoded
+	size_t buffered() const { return end - start; }
+
+	const Statistics& getStatistics() const { return stats; }
+
+	/// Throws out any buffered bytes (but keeps the statistics)
+	void clear() { start = end = 0; }
+
+private:
+
+	/// Skips `count` bytes at the start of the buffer
+	void discard(size_t count);
+
+	/// Skips to the next spot that could be the start of a frame
+	void resync();
+
+	/// The longest payload we accept
+	const size_t maxPayload;
+
+	std::vector<uint8_t> buf;
+
+	/// The index of the first byte not yet decoded
+	size_t start;
+
+	/// One past the index of the last byte buffered
+	size_t end;
+
+	Statistics stats;
+};
+
+} // end namespace BinaryMessage
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * \brief The clock a game state machine reads the time from
+ *
+ * Left alone, it reads std::chrono::steady_clock.
+ * GameRunner pins it to the time at which each message or tick is handled,
+ * so a machine sees one consistent time for everything it does in a step,
+ * and a replay can hand it the times from a trace instead of the real ones.
+ */
+class GameClock {
+
+public:
+
+	/// We opt for steady_clock since it never shifts (see en.cppreference.com/w/cpp/chrono/steady_clock)
+	typedef std::chrono::steady_clock Clock;
+
+	typedef Clock::time_point TimePoint;
+
+	GameClock() : pinned(false), pinnedTo() { }
+
+	/// Gets the time the clock is pinned to, or the current time if it isn't pinned
+	TimePoint now() const { return pinned ? pinnedTo : Clock::now(); }
+
+	/// Stops the clock at the given time until it is pinned elsewhere or unpinned
+	void pin(TimePoint when)
+	{
+		pinned = true;
+		pinnedTo = when;
+	}
+
+	/// Lets the clock follow the real time again
+	void unpin() { pinned = false; }
+
+	bool isPinned() const { return pinned; }
+
+private:
+
+	bool pinned;
+
+	TimePoint pinnedTo;
+};
@@ -0,0 +1,123 @@
+#include "GameMode.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Exceptions.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+namespace {
+
+typedef GameModeSpec::Event Event;
+typedef GameModeSpec::Op Op;
+
+/// Finds a state's index by name
+uint8_t stateIndex(const GameModeSpec& spec, const string& name)
+{
+	const auto it = find(spec.states.begin(), spec.states.end(), name);
+	ENFORCE(ArgumentException, it != spec.states.end(), "The game mode has no state named \"" + name + "\".");
+	return (uint8_t)(it - spec.states.begin());
+}
+
+/// The time between rounds, in milliseconds
+const int32_t minDelay = 3000;
+const int32_t maxDelay = 6000;
+
+} // end anonymous namespace
+
+const int GameMode::maxSlots;
+const uint8_t GameMode::noState;
+
+GameMode::GameMode(const GameModeSpec& spec) :
+	table(),
+	actions(),
+	armed(),
+	sequence(spec.sequence)
+{
+	ENFORCE(ArgumentException, !spec.states.empty(), "A game mode needs at least one state.");
+	ENFORCE(ArgumentException, spec.states.size() < noState, "The game mode has too many states.");
+	ENFORCE(ArgumentException, !sequence.empty(), "A game mode needs something for players to hit.");
+
+	for (const auto& step : sequence) {
+		ENFORCE(ArgumentException, step.slot >= 0 && step.slot < maxSlots, "A step of the sequence has a bad slot.");
+		ENFORCE(ArgumentException, step.hits > 0, "Each step of the sequence needs at least one hit.");
+	}
+
+	table.resize(spec.states.size() * (size_t)Event::COUNT);
+	armed.resize(spec.states.size(), 0);
+
+	for (const auto& name : spec.armed)
+		armed[stateIndex(spec, name)] = 1;
+
+	for (const auto& t : spec.transitions) {
+		ENFORCE(ArgumentException, t.on < Event::COUNT, "A transition has a bad event.");
+		Row& row = table[stateIndex(spec, t.from) * (size_t)Event::COUNT + (size_t)t.on];
+		ENFORCE(ArgumentException, row.to == noState,
+		        "The game mode has two transitions for the same event in state \"" + t.from + "\".");
+		ENFORCE(ArgumentException, t.actions.size() <= UINT8_MAX, "A transition has too many actions.");
+		ENFORCE(ArgumentException, actions.size() + t.actions.size() <= UINT16_MAX, "The game mode has too many actions.");
+
+		for (const auto& a : t.actions) {
+			ENFORCE(ArgumentException, a.op < Op::COUNT, "A transition has a bad action.");
+			ENFORCE(ArgumentException, a.slot >= 0 && a.slot < maxSlots, "An action has a bad slot.");
+			ENFORCE(ArgumentException, a.op != Op::WAIT || (a.min >= 0 && a.min <= a.max),
+			        "A wait has a bad range.");
+		}
+
+		row.firstAction = (uint16_t)actions.size();
+		row.actionCount = (uint8_t)t.actions.size();
+		row.to = stateIndex(spec, t.to);
+		actions.insert(actions.end(), t.actions.begin(), t.actions.end());
+	}
+}
+
+GameModeSpec GameMode::followUp()
+{
+	typedef GameModeSpec::Action A;
+
+	// The second target comes on this long after the first, then both stay on for the window.
+	static const int32_t followDelay = 1000;
+	static const int32_t window = 5000;
+
+	GameModeSpec spec;
+	spec.states = { "startup", "delay", "first", "second" };
+	spec.armed = { "first", "second" };
+	spec.transitions = {
+		{ "startup", Event::START, { A(Op::WAIT, 0, minDelay, maxDelay) }, "delay" },
+		{ "delay", Event::TIMER,
+			{ A(Op::BEGIN_ROUND), A(Op::PICK, 0), A(Op::LIGHT, 0), A(Op::WAIT, 0, followDelay, followDelay) },
+			"first" },
+		{ "first", Event::TIMER, { A(Op::PICK, 1), A(Op::LIGHT, 1), A(Op::WAIT, 0, window, window) }, "second" },
+		{ "second", Event::TIMER, { A(Op::DARKEN), A(Op::WAIT, 0, minDelay, maxDelay) }, "delay" },
+		{ "second", Event::WON, { A(Op::AWARD), A(Op::DARKEN), A(Op::WAIT, 0, minDelay, maxDelay) }, "delay" }
+	};
+	spec.sequence = { { 0, 1 }, { 1, 1 } };
+	return spec;
+}
+
+GameModeSpec GameMode::dump(int shotCount)
+{
+	typedef GameModeSpec::Action A;
+
+	ENFORCE(ArgumentOutOfRangeException, shotCount > 0 && shotCount <= INT16_MAX,
+	        "A dump game needs a positive shot count.");
+
+	// Give players a few seconds, plus a second for each shot they have to fire.
+	const int32_t window = 3000 + 1000 * shotCount;
+
+	GameModeSpec spec;
+	spec.states = { "startup", "delay", "up" };
+	spec.armed = { "up" };
+	spec.transitions = {
+		{ "startup", Event::START, { A(Op::WAIT, 0, minDelay, maxDelay) }, "delay" },
+		{ "delay", Event::TIMER,
+			{ A(Op::BEGIN_ROUND), A(Op::PICK, 0), A(Op::LIGHT, 0), A(Op::WAIT, 0, window, window) },
+			"up" },
+		{ "up", Event::TIMER, { A(Op::DARKEN), A(Op::WAIT, 0, minDelay, maxDelay) }, "delay" },
+		{ "up", Event::WON, { A(Op::AWARD), A(Op::DARKEN), A(Op::WAIT, 0, minDelay, maxDelay) }, "delay" }
+	};
+	spec.sequence = { { 0, (int16_t)shotCount } };
+	return spec;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief A declarative description of a game mode, which GameMode compiles into a transition table
+ *
+ * A mode is a set of named states (the first is where every game starts),
+ * and for each state, what to do and where to go when one of the Events happens.
+ * What to do is a list of Actions, each of which picks or lights targets, sets the state's timer,
+ * or scores the round.
+ *
+ * Each round, the mode picks targets into numbered slots,
+ * and players have to work through `sequence` by hitting the target in each step's slot `hits` times, in order.
+ * Only hits made while the game is in an `armed` state count.
+ * The first player to finish the sequence wins the round, which raises Event::WON.
+ */
+struct GameModeSpec {
+
+	/// The things that move a game from one state to another
+	enum class Event : uint8_t {
+		START, ///< The game just started
+		TIMER, ///< The state's timer ran out
+		WON, ///< A player finished the round's sequence
+		COUNT ///< The number of events. Not an event itself.
+	};
+
+	/// The things a game mode can do on a transition
+	enum class Op : uint8_t {
+		PICK, ///< Picks a random target for `slot`, avoiding the targets in the other slots if it can
+		LIGHT, ///< Turns on the target in `slot`
+		DARKEN, ///< Turns off every target that is on
+		BEGIN_ROUND, ///< Forgets everyone's progress through the sequence and notes the time for scoring
+		WAIT, ///< Sets the next state's timer for a random time between `min` and `max` milliseconds
+		AWARD, ///< Gives the round's winner a hit and a score based on the time left on the timer
+		COUNT ///< The number of ops. Not an op itself.
+	};
+
+	/// A single step of a transition
+	struct Action {
+		Op op;
+		int8_t slot;
+		int32_t min;
+		int32_t max;
+
+		Action(Op o, int8_t s = 0, int32_t mn = 0, int32_t mx = 0) : op(o), slot(s), min(mn), max(mx) { }
+	};
+
+	/// What to do when `on` happens in state `from`
+	struct Transition {
+		std::string from;
+		Event on;
+		std::vector<Action> actions;
+		std::string to;
+
+		Transition(std::string f, Event e, std::vector<Action> a, std::string t) :
+			from(std::move(f)), on(e), actions(std::move(a)), to(std::move(t))
+		{ }
+	};
+
+	/// One step of the round's sequence: hit the target in `slot` `hits` times
+	struct Step {
+		int8_t slot;
+		int16_t hits;
+
+		Step(int8_t s, int16_t h) : slot(s), hits(h) { }
+	};
+
+	GameModeSpec() : states(), armed(), transitions(), sequence() { }
+
+	/// The names of the mode's states, starting with the one games start in
+	std::vector<std::string> states;
+
+	/// The states in which hits count toward the sequence
+	std::vector<std::string> armed;
+
+	std::vector<Transition> transitions;
+
+	std::vector<Step> sequence;
+};
+
+/**
+ * \brief A GameModeSpec, compiled into a table that a ModeStateMachine can run
+ *
+ * Every (state, event) pair gets a row in one flat table,
+ * and the actions of every transition are laid end to end in a single array,
+ * so finding out what to do is an index calculation instead of a search or a chain of conditions.
+ */
+class GameMode {
+
+public:
+
+	typedef GameModeSpec::Event Event;
+
+	typedef GameModeSpec::Action Action;
+
+	typedef GameModeSpec::Step Step;
+
+	/// The most slots a mode can use
+	static const int maxSlots = 4;
+
+	/// Marks a table row with nowhere to go
+	static const uint8_t noState = 0xff;
+
+	/// A row of the transition table
+	struct Row {
+		uint16_t firstAction;
+		uint8_t actionCount;
+		uint8_t to;
+
+		Row() : firstAction(0), actionCount(0), to(noState) { }
+	};
+
+	/**
+	 * \brief Compiles a mode description
+	 * \throws ArgumentException if the description names a state it doesn't declare, has two transitions
+	 *         for the same state and event, uses a slot it can't, or has an empty sequence
+	 */
+	explicit GameMode(const GameModeSpec& spec);
+
+	/// Gets the transition for the given event in the given state. Its `to` is noState if there is none.
+	const Row& transition(uint8_t state, Event e) const
+	{
+		return table[state * (size_t)Event::COUNT + (size_t)e];
+	}
+
+	/// Gets the first action of a transition
+	const Action* actionsOf(const Row& row) const { return actions.data() + row.firstAction; }
+
+	bool isArmed(uint8_t state) const { return armed[state] != 0; }
+
+	const std::vector<Step>& getSequence() const { return sequence; }
+
+	size_t getStateCount() const { return armed.size(); }
+
+	/// Targets go on in succession and have to be hit in the order they came on.
+	/// \see doc/schemas.md
+	static GameModeSpec followUp();
+
+	/// A target goes on and has to be hit shotCount times
+	/// \see doc/schemas.md
+	static GameModeSpec dump(int shotCount);
+
+private:
+
+	std::vector<Row> table;
+
+	std::vector<Action> actions;
+
+	/// One per state. Not a vector<bool> so that a lookup is a plain load.
+	std::vector<uint8_t> armed;
+
+	std::vector<Step> sequence;
+};
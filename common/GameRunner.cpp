@@ -0,0 +1,322 @@
+#include "GameRunner.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "Exceptions.hpp"
+#include "MatchHistory.hpp"
+#include "MemoryUtils.hpp"
+#include "ModeStateMachine.hpp"
+#include "PopUpStateMachine.hpp"
+#include "SetupMessage.hpp"
+#include "ShotMessage.hpp"
+#include "TargetControlMessage.hpp"
+#include "Trace.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+using Code = ResponseMessage::Code;
+
+void runGame(MessageQueue& in, MessageQueue& out, board_id_t numberTargets, board_id_t numberPlayers,
+             MatchHistory* history, TraceWriter* trace, bool acknowledgeShots)
+{
+	typedef GameRunner::Clock Clock;
+
+	const uint32_t seed = random_device()();
+	GameRunner runner(out, numberTargets, numberPlayers, seed, history, acknowledgeShots);
+
+	if (trace != nullptr)
+		trace->start(seed, numberTargets, numberPlayers, Clock::now(), acknowledgeShots);
+
+	// Receive messages as they come in until we get an exit message,
+	// and tick the state machine whenever one of its deadlines arrives.
+	while (true) {
+		unique_ptr<Message> msg;
+
+		const auto deadline = runner.nextDeadline();
+
+		// Don't let a steady stream of messages hold off a tick that is due.
+		if (deadline > Clock::now()) {
+			if (deadline == GameRunner::TimePoint::max())
+				msg = in.receive();
+			else
+				msg = in.receiveUntil(deadline);
+
+			if (msg != nullptr && msg->getType() == Message::Type::EXIT)
+				return;
+		}
+
+		// Everything the state machine does in this step happens at this time.
+		const auto now = Clock::now();
+
+		// Record the step before we take it, so a trace of a crash includes what caused it.
+		// Like the match history, losing the trace is no reason to stop the game.
+		if (trace != nullptr) {
+			try {
+				trace->record(now, msg.get());
+			}
+			catch (const IOException& e) {
+				fprintf(stderr, "Could not write to the trace, so tracing has stopped: %s\n", e.what());
+				trace = nullptr;
+			}
+		}
+
+		// If there is no message, that means a deadline has arrived and we need to tick.
+		if (msg == nullptr)
+			runner.onTick(now);
+		else
+			runner.onMessage(move(msg), now);
+	}
+}
+
+GameRunner::GameRunner(MessageQueue& outQueue, board_id_t targets, board_id_t players, uint32_t seed,
+                       MatchHistory* matchHistory, bool acknowledge) :
+	out(outQueue),
+	numberTargets(targets),
+	numberPlayers(players),
+	seeder(seed),
+	history(matchHistory),
+	acknowledgeShots(acknowledge),
+	machine(),
+	gameType(GameType::POP_UP),
+	stepTime(),
+	uid(0)
+{
+	ENFORCE(ArgumentException, numberTargets > 0, "You must have at least one target.");
+	ENFORCE(ArgumentException, numberPlayers > 0, "You must have at least one player.");
+}
+
+GameRunner::TimePoint GameRunner::nextDeadline() const
+{
+	return machine != nullptr ? machine->nextDeadline() : TimePoint::max();
+}
+
+void GameRunner::onMessage(std::unique_ptr<Message>&& msg, TimePoint now)
+{
+	stepTime = now;
+
+	// So we know to save the game to the history if this message ends it
+	const bool wasRunning = machine != nullptr && machine->isRunning();
+	if (machine != nullptr)
+		machine->getClock().pin(now);
+
+	using Type = Message::Type;
+	switch (msg->getType()) {
+
+		case Type::SETUP:
+			setup(move(msg));
+			break;
+
+		case Type::START:
+			start(*msg);
+			break;
+
+		case Type::STOP:
+			stop(*msg);
+			break;
+
+		case Type::SHOT:
+			shot(move(msg));
+			break;
+
+		case Type::STATUS:
+			status(*msg);
+			break;
+
+		case Type::RESULTS:
+			results(*msg);
+			break;
+
+		default: // We don't know what this is.
+			respond(*msg, Code::INVALID_REQUEST, "The request is invalid.");
+			break;
+	}
+
+	finishStep(wasRunning);
+}
+
+void GameRunner::onTick(TimePoint now)
+{
+	stepTime = now;
+
+	if (machine == nullptr)
+		return;
+
+	const bool wasRunning = machine->isRunning();
+	machine->getClock().pin(now);
+
+	auto toSend = machine->onTick(uid++);
+	if (toSend != nullptr)
+		out.send(move(toSend));
+
+	finishStep(wasRunning);
+}
+
+void GameRunner::setup(std::unique_ptr<Message>&& msg)
+{
+	if (machine != nullptr && machine->isRunning()) {
+		respond(*msg, Code::INVALID_REQUEST, "You cannot set up a new game while one is in progress");
+		return;
+	}
+
+	auto setupMessage = unique_dynamic_cast<SetupMessage>(move(msg));
+	// There should be no way it has a SETUP type and is not a setup message.
+	// See the switch statement in onMessage
+	assert(setupMessage != nullptr);
+
+	// Ensure we are not requesting more players than we actually support
+	if (setupMessage->playerCount > numberPlayers) {
+		respond(*setupMessage, Code::INVALID_REQUEST, "The setup request asked for more players than the game has.");
+		return;
+	}
+
+	const auto gameDuration = chrono::seconds(setupMessage->gameLength);
+
+	switch(setupMessage->gameType) {
+		case GameType::POP_UP: {
+			const auto targetsUp = setupMessage->gameData.find("targets up");
+			int upAtOnce = 1;
+			if (targetsUp != setupMessage->gameData.end()) {
+				upAtOnce = targetsUp->second;
+				if (upAtOnce <= 0 || upAtOnce > numberTargets) {
+					respond(*setupMessage, Code::INVALID_REQUEST,
+					        "The \"targets up\" for a pop-up game must be between one and the number of targets.");
+					return;
+				}
+			}
+			machine.reset(new PopUpStateMachine(numberTargets, setupMessage->playerCount,
+			                                    gameDuration, setupMessage->winningScore, (uint32_t)seeder(),
+			                                    (board_id_t)upAtOnce));
+			break;
+		}
+
+		case GameType::FOLLOW_UP: {
+			// Follow-up takes no game data, so every game can share one compiled mode.
+			static const shared_ptr<const GameMode> followUp = make_shared<GameMode>(GameMode::followUp());
+			machine.reset(new ModeStateMachine(followUp, numberTargets, setupMessage->playerCount,
+			                                   gameDuration, setupMessage->winningScore, (uint32_t)seeder()));
+			break;
+		}
+
+		case GameType::DUMP: {
+			const auto shotCount = setupMessage->gameData.find("shot count");
+			if (shotCount == setupMessage->gameData.end() || shotCount->second <= 0 || shotCount->second > INT16_MAX) {
+				respond(*setupMessage, Code::INVALID_REQUEST,
+				        "A dump game needs a positive \"shot count\" in its game data.");
+				return;
+			}
+			machine.reset(new ModeStateMachine(make_shared<GameMode>(GameMode::dump(shotCount->second)),
+			                                   numberTargets, setupMessage->playerCount,
+			                                   gameDuration, setupMessage->winningScore, (uint32_t)seeder()));
+			break;
+		}
+
+		default:
+			respond(*setupMessage, Code::UNSUPPORTED_REQUEST, "This game mode is not supported yet.");
+			return;
+	}
+
+	machine->getClock().pin(stepTime);
+	gameType = setupMessage->gameType;
+
+	respond(*setupMessage, Code::OK, "Game set up.");
+}
+
+void GameRunner::start(const Message& msg)
+{
+	if (machine == nullptr)
+		respond(msg, Code::INVALID_REQUEST, "You must set up a game before starting it.");
+	else
+		out.send(machine->start(uid++, msg.id));
+}
+
+void GameRunner::stop(const Message& msg)
+{
+	if (machine == nullptr) {
+		respond(msg, Code::INVALID_REQUEST, "A game has not even been set up yet. There is nothing to stop.");
+	}
+	else {
+		out.send(machine->stop(uid++, msg.id));
+		lightsOut();
+	}
+}
+
+void GameRunner::shot(std::unique_ptr<Message>&& msg)
+{
+	if (machine == nullptr) {
+		if (acknowledgeShots) {
+			respond(*msg, Code::INVALID_REQUEST,
+			        "A game has not been set up. A shot message should not be arriving now.");
+		}
+	}
+	else {
+		auto response = machine->onShot(uid++, *unique_dynamic_cast<ShotMessage>(move(msg)));
+		if (acknowledgeShots)
+			out.send(move(response));
+	}
+}
+
+void GameRunner::status(const Message& msg)
+{
+	if (machine == nullptr) {
+		out.send(unique_ptr<StatusResponseMessage>(
+			new StatusResponseMessage(uid++, msg.id, "No game has been set up yet.",
+			                          false, -1, -1, StatusResponseMessage::PlayerList())));
+	}
+	else {
+		out.send(machine->getStatusResponse(++uid, msg.id));
+	}
+}
+
+void GameRunner::results(const Message& msg)
+{
+	if (machine == nullptr)
+		respond(msg, Code::INVALID_REQUEST, "A game has not been set up. There are no results to get.");
+	else
+		out.send(machine->getResultsResponse(uid++, msg.id));
+}
+
+void GameRunner::lightsOut()
+{
+	TargetControlMessage::CommandList cl;
+
+	for (int i = 0; i < numberTargets; ++i)
+		cl.emplace_back(i, false);
+
+	out.send(unique_ptr<TargetControlMessage>(
+		new TargetControlMessage(uid++, move(cl))));
+}
+
+void GameRunner::respond(const Message& msg, ResponseMessage::Code code, const std::string& response)
+{
+	out.send(unique_ptr<ResponseMessage>(new ResponseMessage(uid++, msg.id, code, response)));
+}
+
+void GameRunner::finishStep(bool wasRunning)
+{
+	if (machine == nullptr)
+		return;
+
+	// Pass along whatever happened in the game while handling the message or tick.
+	for (const auto& event : machine->getEvents())
+		out.send(unique_ptr<EventMessage>(new EventMessage(uid++, event)));
+	machine->clearEvents();
+
+	// Save the game once it's over, before a new setup can replace it.
+	if (history != nullptr && wasRunning && machine->isOver()) {
+		auto results = unique_dynamic_cast<ResultsResponseMessage>(machine->getResultsResponse(0, 0));
+		assert(results != nullptr);
+
+		// Losing the history is no reason to stop the games.
+		try {
+			history->append(gameType, chrono::system_clock::to_time_t(chrono::system_clock::now()),
+			                results->stats);
+		}
+		catch (const IOException& e) {
+			fprintf(stderr, "Could not save the game to the match history: %s\n", e.what());
+		}
+	}
+}
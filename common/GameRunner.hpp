@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "GameStateMachine.hpp"
+#include "MessageQueue.hpp"
+
+// Forward declarations. We just have pointers to these here.
+class MatchHistory;
+class TraceWriter;
+
+/**
+ * \brief Runs a game via a game state machine
+ * \param in The MessageQueue on which the machine will receive messages
+ * \param out The MessageQueue the machine will use to talk to the UI and hardware.
+ *            It is assumed that the two destinations will be multiplexed elsewhere for simplicity here.
+ * \param numberTargets The number of targets we currently have up in our hardware setup.
+ * \param numberPlayers The number of guns we currently have in our hardware setup.
+ * \param history If not null, each game's results are appended to it when the game ends.
+ * \param trace If not null, every message received and every tick is recorded to it
+ *              so that the session can be replayed later. \see replayTrace
+ * \param acknowledgeShots Whether shots get a response. \see GameRunner::GameRunner
+ *
+ * Start this function in another thread, and use the message queues to interface it
+ * with our UI and hardware.
+ */
+void runGame(MessageQueue& in, MessageQueue& out, board_id_t numberTargets, board_id_t numberPlayers,
+             MatchHistory* history = nullptr, TraceWriter* trace = nullptr, bool acknowledgeShots = true);
+
+/**
+ * \brief Sets up and drives game state machines in response to messages and ticks
+ *
+ * This is the heart of runGame, minus the waiting.
+ * Whoever drives it says what time it is at each step, and the state machine's clock is pinned to that time,
+ * so the same messages at the same times (with the same seed) always give the same output.
+ * runGame drives it with the real time; replayTrace drives it with the times from a trace.
+ */
+class GameRunner {
+
+public:
+
+	typedef GameStateMachine::Clock Clock;
+
+	typedef GameStateMachine::TimePoint TimePoint;
+
+	/**
+	 * \param out The queue to send responses, target commands, and events to
+	 * \param numberTargets The number of targets we currently have up in our hardware setup.
+	 * \param numberPlayers The number of guns we currently have in our hardware setup.
+	 * \param seed The seed from which each game's random numbers are drawn
+	 * \param history If not null, each game's results are appended to it when the game ends.
+	 * \param acknowledgeShots Whether shots get a response like any other request.
+	 *                         Shots come from the hardware, which doesn't listen for responses,
+	 *                         and the IDs it gives them have nothing to do with the UI's,
+	 *                         so a range with a UI should turn this off lest the UI mistake
+	 *                         a shot's response for the response to one of its own requests.
+	 */
+	GameRunner(MessageQueue& out, board_id_t numberTargets, board_id_t numberPlayers, uint32_t seed,
+	           MatchHistory* history = nullptr, bool acknowledgeShots = true);
+
+	/// Gets the time at which onTick next needs to be called, or TimePoint::max() if there is nothing to wait for
+	TimePoint nextDeadline() const;
+
+	/// Handles a message that arrived at the given time
+	void onMessage(std::unique_ptr<Message>&& msg, TimePoint now);
+
+	/// Ticks the state machine at the given time
+	void onTick(TimePoint now);
+
+private:
+
+	/// Sets up a new state machine, or complains if now is not the time to do so.
+	void setup(std::unique_ptr<Message>&& msg);
+
+	/// Starts the state machine, or complains if now is not the time to do so.
+	void start(const Message& msg);
+
+	/// Stops the state machine, or complains if now is not the time to do so.
+	void stop(const Message& msg);
+
+	/// Responds to a shot message
+	void shot(std::unique_ptr<Message>&& msg);
+
+	/// Gets the status from the state machine, or returns our own if there is not a state machine to ask.
+	void status(const Message& msg);
+
+	/// Gets the results from the state machine, or returns our own if there is no state machine to ask.
+	void results(const Message& msg);
+
+	/// Shuts off all target LEDs. Useful at the stop point.
+	void lightsOut();
+
+	/// Sends a response to the given message
+	void respond(const Message& msg, ResponseMessage::Code code, const std::string& response);
+
+	/// Passes along whatever happened in the game during a step, and saves the game if the step ended it
+	void finishStep(bool wasRunning);
+
+	// Disallow copy and assign
+	GameRunner(const GameRunner&) = delete;
+	GameRunner& operator=(const GameRunner&) = delete;
+
+	MessageQueue& out;
+
+	const board_id_t numberTargets;
+
+	const board_id_t numberPlayers;
+
+	/// Where each new game gets its seed
+	std::mt19937 seeder;
+
+	MatchHistory* const history;
+
+	const bool acknowledgeShots;
+
+	/// The state machine running the game
+	std::unique_ptr<GameStateMachine> machine;
+
+	/// The type of game the machine is running, for the match history
+	GameType gameType;
+
+	/// The time of the current step, which new machines' clocks are pinned to
+	TimePoint stepTime;
+
+	/// A unique ID we can use for sending messages (each message must have its own unique ID)
+	message_id_t uid;
+};
@@ -1,226 +1,27 @@
 #include "GameStateMachine.hpp"
 
 #include <algorithm>
-#include <cassert>
 #include <sstream>
 
 #include "Exceptions.hpp"
-#include "MemoryUtils.hpp"
-#include "SetupMessage.hpp"
-#include "TargetControlMessage.hpp"
 #include "ShotMessage.hpp"
-#include "PopUpStateMachine.hpp"
 
 using namespace std;
 using namespace Exceptions;
 
-void runGame(MessageQueue& in, MessageQueue& out, board_id_t numberTargets, board_id_t numberPlayers)
-{
-	ENFORCE(ArgumentException, numberTargets > 0, "You must have at least one target.");
-	ENFORCE(ArgumentException, numberPlayers > 0, "You must have at least one player.");
-
-	using Code = ResponseMessage::Code;
-
-	// A pointer to the state machine running the game
-	unique_ptr<GameStateMachine> machine;
-
-	// A unique ID we can use for sending messages (each message must have its own unique ID)
-	uint16_t uid = 0;
-
-	// The interval in which we should call the state machine's onTick if there are no unprocessed messages.
-	static const auto tickInterval = chrono::milliseconds(100);
-
-	// The next time at which we should call onTick
-	auto nextTick = chrono::steady_clock::now() + tickInterval;
-
-	// Receive messages as they come in until we get an exit message,
-	// and tick in the meantime if we don't receive one.
-	for (unique_ptr<Message> msg; msg == nullptr || msg->getType() != Message::Type::EXIT;
-		msg = in.receiveUntil(nextTick)) {
-
-		// These are just convenience lambda functions so the switch statement below is less cluttered
-
-		// Shut off all target LEDs. Useful at the stop point.
-		const auto lightsOut = [&] {
-			TargetControlMessage::CommandList cl;
-
-			for (int i = 0; i < numberTargets; ++i)
-				cl.emplace_back(i, false);
-
-			out.send(unique_ptr<TargetControlMessage>(
-				new TargetControlMessage(uid++, move(cl))));
-		};
-
-		// Setup a new state machine, or complain if now is not the time to do so.
-		const auto doSetup = [&] {
-			if (machine != nullptr && machine->isRunning()) {
-				out.send(unique_ptr<ResponseMessage>(
-					new ResponseMessage(uid++, msg->id, Code::INVALID_REQUEST,
-					                    "You cannot set up a new game while one is in progress")));
-			}
-			else {
-				auto setupMessage = unique_dynamic_cast<SetupMessage>(move(msg));
-				// There should be no way it has a SETUP type and is not a setup message.
-				// See the switch statement below
-				assert(setupMessage != nullptr);
-
-				// Ensure we are not requesting more players than we actually support
-				if (setupMessage->playerCount > numberPlayers) {
-					out.send(unique_ptr<ResponseMessage>(
-						new ResponseMessage(uid++, msg->id, Code::INVALID_REQUEST,
-						                    "The setup request asked for more players than the game has.")));
-					return;
-				}
-
-				const auto gameDuration = chrono::seconds(setupMessage->gameLength);
-
-				// TODO: Be able to pass game data into the state machines
-				switch(setupMessage->gameType) {
-					case GameType::POP_UP:
-						machine.reset(new PopUpStateMachine(numberTargets, setupMessage->playerCount,
-						                                         gameDuration, setupMessage->winningScore));
-						break;
-
-					default:
-						out.send(unique_ptr<ResponseMessage>(
-							new ResponseMessage(uid++, setupMessage->id, Code::UNSUPPORTED_REQUEST,
-							                    "This game mode is not supported yet.")));
-						return;
-				}
-
-				out.send(unique_ptr<ResponseMessage>(
-					new ResponseMessage(uid++, setupMessage->id, Code::OK, "Game set up.")));
-			}
-		};
-
-		// Start the state machine, or complain if now is not the time to do so.
-		const auto start = [&] {
-			if (machine == nullptr) {
-				out.send(unique_ptr<ResponseMessage>(
-					new ResponseMessage(uid++, msg->id, Code::INVALID_REQUEST,
-					                    "You must set up a game before starting it.")));
-			}
-			else {
-				out.send(machine->start(uid++, msg->id));
-			}
-		};
-
-		// Stop the state machine, or complain if now is not the time to do so.
-		const auto stop = [&] {
-			if (machine == nullptr) {
-				out.send(unique_ptr<ResponseMessage>(
-					new ResponseMessage(uid++, msg->id, Code::INVALID_REQUEST,
-					                    "A game has not even been set up yet. There is nothing to stop.")));
-			}
-			else {
-				out.send(machine->stop(uid++, msg->id));
-				lightsOut();
-			}
-		};
-
-		// Respond to a shot message
-		const auto onShot = [&](const ShotMessage& shot) {
-			if (machine == nullptr) {
-				out.send(unique_ptr<ResponseMessage>(
-					new ResponseMessage(uid++, shot.id, Code::INVALID_REQUEST,
-					                    "A game has not been set up. A shot message should not be arriving now.")));
-			}
-			else {
-				out.send(machine->onShot(uid++, shot));
-			}
-		};
-
-		// Get the status from the state machine,
-		// or return our own if there is not a state machine to ask.
-		const auto getStatus = [&] {
-			if (machine == nullptr) {
-				out.send(unique_ptr<StatusResponseMessage>(
-					new StatusResponseMessage(uid++, msg->id, "No game has been set up yet.",
-					                          false, -1, -1, StatusResponseMessage::PlayerList())));
-			}
-			else {
-				out.send(machine->getStatusResponse(++uid, msg->id));
-			}
-		};
-
-		// Gets the results from the state machine,
-		// or return our own if there is no state machine to ask.
-		const auto getResults = [&] {
-			if (machine == nullptr) {
-				out.send(unique_ptr<ResponseMessage>(
-					new ResponseMessage(uid++, msg->id, Code::INVALID_REQUEST,
-					                    "A game has not been set up. There are no results to get.")));
-			}
-			else {
-				out.send(machine->getResultsResponse(uid++, msg->id));
-			}
-		};
-
-		// Respond to invalid requests.
-		const auto wat = [&] {
-			out.send(unique_ptr<ResponseMessage>(
-				new ResponseMessage(uid++, msg->id, Code::INVALID_REQUEST,
-				                    "The request is invalid.")));
-		};
-
-
-		// If there is no message, that means we need to tick.
-		if (msg == nullptr) {
-			if (machine != nullptr) {
-				auto toSend = machine->onTick(uid++);
-				if (toSend != nullptr)
-					out.send(move(toSend));
-			}
-
-			// Bump up the next tick
-			while (chrono::steady_clock::now() > nextTick)
-				nextTick += tickInterval;
-		}
-		else {
-			// Respond to messages. See the lambda functions above.
-			using Type = Message::Type;
-			switch (msg->getType()) {
-
-				case Type::SETUP:
-					doSetup();
-					break;
-
-				case Type::START:
-					start();
-					break;
-
-				case Type::STOP:
-					stop();
-					break;
-
-				case Type::SHOT:
-					onShot(*unique_dynamic_cast<ShotMessage>(move(msg)));
-					break;
-
-				case Type::STATUS:
-					getStatus();
-					break;
-
-				case Type::RESULTS:
-					getResults();
-					break;
-
-				default: // We don't know what this is.
-					wat();
-					break;
-			}
-		}
-	}
-}
-
 GameStateMachine::GameStateMachine(board_id_t numTargets, board_id_t numPlayers,
 	                               const std::chrono::seconds& gameDuration, shot_t scoreToWin) :
 	targetCount(numTargets),
 	players(numPlayers),
+	statistics(numPlayers),
+	gameStartTime(),
 	gameEndTime(TimePoint::max()), // Max this out so we don't time out before we even start
 	duration(gameDuration),
 	winningScore(scoreToWin),
-	shots()
+	shots(numPlayers),
+	clock(),
+	deadlines(),
+	events()
 {
 	ENFORCE(ArgumentException, numTargets > 0, "You must have at least one target.");
 	ENFORCE(ArgumentException, numPlayers > 0, "You must have at least one player.");
@@ -238,13 +39,24 @@ std::unique_ptr<ResponseMessage> GameStateMachine::start(message_id_t responseID
 	for (auto& player : players)
 		player = Player();
 
+	for (auto& stats : statistics)
+		stats = PlayerStatistics();
+
 	// Zero shots
 	shots.clear();
 
-	// Set the game's end time
-	gameEndTime = Clock::now() + duration;
-	// And we're off!
+	// Forget the last game's deadlines and whatever the game type kept about it.
+	deadlines = decltype(deadlines)();
+	resetGame();
+
+	// Set the game's start and end times
+	gameStartTime = now();
+	gameEndTime = gameStartTime + duration;
+	if (duration > chrono::seconds(0))
+		scheduleTick(gameEndTime);
+	// And we're off! Tick right away so the game can get going.
 	gameState = State::RUNNING;
+	scheduleTick(now());
 
 	return unique_ptr<ResponseMessage>(
 		new ResponseMessage(responseID, respondingTo, ResponseMessage::Code::OK,
@@ -259,7 +71,7 @@ std::unique_ptr<ResponseMessage> GameStateMachine::stop(message_id_t responseID,
 			                    "There is no running game to stop."));
 	}
 
-	gameState = State::OVER;
+	endGame();
 
 	return unique_ptr<ResponseMessage>(
 		new ResponseMessage(responseID, respondingTo, ResponseMessage::Code::OK,
@@ -275,7 +87,17 @@ std::unique_ptr<ResponseMessage> GameStateMachine::onShot(message_id_t responseI
 			                    "Shots cannot be registered before the game even starts."));
 	}
 
-	shots.emplace(shot.shot);
+	if (shot.shot.player < 0 || (size_t)shot.shot.player >= players.size()) {
+		return unique_ptr<ResponseMessage>(
+			new ResponseMessage(responseID, shot.id, ResponseMessage::Code::INVALID_REQUEST,
+			                    "The shot came from a player who isn't in the game."));
+	}
+
+	// Don't count the same shot twice.
+	if (shots.record(shot.shot)) {
+		statistics[(size_t)shot.shot.player].recordShot(shot.shot.target < 0);
+		postEvent(GameEvent::shot(shot.shot));
+	}
 
 	stringstream ss;
 	ss << "Shot fired at " << shot.shot.time << " registered";
@@ -288,8 +110,8 @@ std::unique_ptr<StatusResponseMessage> GameStateMachine::getStatusResponse(messa
                                                                            message_id_t respondingTo)
 {
 	StatusResponseMessage::PlayerList statsList;
-	for (const auto& player : players)
-		statsList.emplace_back(player.score, player.hits);
+	for (size_t i = 0; i < players.size(); ++i)
+		statsList.emplace_back(players[i].score, players[i].hits, statistics[i].summarize());
 
 	string response;
 
@@ -307,7 +129,7 @@ std::unique_ptr<StatusResponseMessage> GameStateMachine::getStatusResponse(messa
 			break;
 	}
 
-	const chrono::seconds remaining = chrono::duration_cast<chrono::seconds>(gameEndTime - Clock::now());
+	const chrono::seconds remaining = chrono::duration_cast<chrono::seconds>(gameEndTime - now());
 
 	return unique_ptr<StatusResponseMessage>(
 		new StatusResponseMessage(responseID, respondingTo, response, gameState == State::RUNNING,
@@ -324,24 +146,12 @@ std::unique_ptr<ResponseMessage> GameStateMachine::getResultsResponse(message_id
 			                    "You can only get results once the game is over."));
 	}
 
-	// An array of shots for each player
-	std::vector<std::vector<Shot>> shotsByPlayer(players.size());
-
-	// Go through our shots and sort them into our player lists
-	for (const auto& shot : shots)
-		shotsByPlayer[shot.player].emplace_back(shot);
-
-	for (auto playerShots : shotsByPlayer) {
-		sort(begin(playerShots), end(playerShots), [](const Shot& swm1, const Shot& swm2) {
-			return swm1.time < swm2.time;
-		});
-	}
-
+	// The log already has each player's shots in time order.
 	ResultsResponseMessage::StatsList resList;
 
-	for (size_t i = 0; i < players.size(); ++i) {
-		resList.emplace_back(players[i].score, players[i].hits, move(shotsByPlayer[i]));
-	}
+	for (size_t i = 0; i < players.size(); ++i)
+		resList.emplace_back(players[i].score, players[i].hits, shots.shotsFor((board_id_t)i),
+		                     statistics[i].summarize());
 
 	return unique_ptr<ResponseMessage>(
 		new ResultsResponseMessage(responseID, respondingTo, "Game results:", move(resList)));
@@ -349,12 +159,39 @@ std::unique_ptr<ResponseMessage> GameStateMachine::getResultsResponse(message_id
 
 std::unique_ptr<Message> GameStateMachine::onTick(uint16_t)
 {
+	const TimePoint current = now();
+	while (!deadlines.empty() && deadlines.top() <= current)
+		deadlines.pop();
+
 	if (winningScore > 0
 		&& any_of(begin(players), end(players), [this](const Player& p) { return p.score >= winningScore; }))
-		gameState = State::OVER;
+		endGame();
 
-	if (duration > chrono::seconds(0) && Clock::now() >= gameEndTime)
-		gameState = State::OVER;
+	if (duration > chrono::seconds(0) && current >= gameEndTime)
+		endGame();
 
 	return nullptr;
 }
+
+timestamp_t GameStateMachine::gameTime() const
+{
+	return (timestamp_t)chrono::duration_cast<chrono::milliseconds>(now() - gameStartTime).count();
+}
+
+void GameStateMachine::recordHit(board_id_t player, timestamp_t reactionTime)
+{
+	++players[(size_t)player].hits;
+	statistics[(size_t)player].recordHit(reactionTime);
+}
+
+void GameStateMachine::endGame()
+{
+	if (gameState != State::RUNNING) {
+		gameState = State::OVER;
+		return;
+	}
+
+	postEvent(GameEvent::gameOver(gameTime()));
+	gameState = State::OVER;
+	resetGame();
+}
@@ -1,31 +1,23 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <queue>
 #include <set>
-#include <unordered_set>
 
+#include "EventMessage.hpp"
+#include "GameClock.hpp"
 #include "MessageQueue.hpp"
+#include "PlayerStatistics.hpp"
 #include "ResponseMessage.hpp"
 #include "StatusResponseMessage.hpp"
 #include "ResultsResponseMessage.hpp"
+#include "ShotLog.hpp"
 
 // Forward declarations. We don't need to include the hearders because we just have references here.
 // We'll include the headers in the .cpp file
 class ShotMessage;
 
-/**
- * \brief Runs a game via a game state machine
- * \param in The MessageQueue on which the machine will receive messages
- * \param out The MessageQueue the machine will use to talk to the UI and hardware.
- *            It is assumed that the two destinations will be multiplexed elsewhere for simplicity here.
- * \param numberTargets The number of targets we currently have up in our hardware setup.
- * \param numberPlayers The number of guns we currently have in our hardware setup.
- *
- * Start this function in another thread, and use the message queues to interface it
- * with our UI and hardware.
- */
-void runGame(MessageQueue& in, MessageQueue& out, board_id_t numberTargets, board_id_t numberPlayers);
-
 /// A base class for a game state machine.
 /// Each game type should derive a state machine class from this one.
 class GameStateMachine {
@@ -49,9 +41,8 @@ public:
 		OVER ///< The game is over.
 	};
 
-	/// The clock to use from the C++ standard library.
-	/// We opt for steady_clock since it never shifts (see en.cppreference.com/w/cpp/chrono/steady_clock)
-	typedef std::chrono::steady_clock Clock;
+	/// The clock to use from the C++ standard library. \see GameClock
+	typedef GameClock::Clock Clock;
 
 	/// Shorthand for the time_point of Clock
 	typedef Clock::time_point TimePoint;
@@ -121,25 +112,95 @@ public:
 	std::unique_ptr<ResponseMessage> getResultsResponse(message_id_t responseID, message_id_t respondingTo);
 
 	/**
-	 * \brief Called on a fairly short (100 ms range) periodic interval to allow the state machine to update.
+	 * \brief Called when a deadline from scheduleTick arrives to allow the state machine to update.
 	 * \param messageID A unique ID that the state machine could use to send a message
 	 * \returns A message if the machine wants to send one, otherwise null
+	 *
+	 * Derived classes should call the base version first, which retires the deadlines that have passed.
+	 * A tick may come after a deadline that no longer matters (say, a target's timeout after it was hit),
+	 * so check the clock instead of assuming why the tick happened.
 	 */
 	virtual std::unique_ptr<Message> onTick(message_id_t messageID);
 
+	/// Gets the time at which onTick next needs to be called,
+	/// or TimePoint::max() if the machine is only waiting on messages.
+	TimePoint nextDeadline() const { return deadlines.empty() ? TimePoint::max() : deadlines.top(); }
+
+	/**
+	 * \brief Gets the events that have happened since clearEvents was last called, oldest first
+	 *
+	 * runGame sends each of these out as an EventMessage after every message and tick it hands the machine,
+	 * so that live displays don't have to poll for status.
+	 */
+	const std::vector<GameEvent>& getEvents() const { return events; }
+
+	/// Forgets the events returned by getEvents
+	void clearEvents() { events.clear(); }
+
+	/// Gets the clock the machine reads the time from, so that it can be pinned. \see GameRunner
+	GameClock& getClock() { return clock; }
+
 protected:
 
+	/// Gets the current time, according to the machine's clock
+	TimePoint now() const { return clock.now(); }
+
+	/// Records an event to be sent to subscribers. \see getEvents
+	void postEvent(const GameEvent& e) { events.emplace_back(e); }
+
+	/// Gets the time since the game started, in milliseconds
+	timestamp_t gameTime() const;
+
+	/// Ends the game, posting a GAME_OVER event and calling resetGame if it was running
+	void endGame();
+
+	/**
+	 * \brief Forgets whatever a derived class kept about the last game
+	 *
+	 * Called when a game ends and again when the next one starts, since a game can be stopped and restarted
+	 * without a tick in between. Targets that are still on should be turned off on the next tick.
+	 */
+	virtual void resetGame() { }
+
+	/// Awards a player a hit that took them `reactionTime` milliseconds
+	void recordHit(board_id_t player, timestamp_t reactionTime);
+
+	/**
+	 * \brief Asks for onTick to be called at the given time
+	 *
+	 * runGame sleeps until the earliest deadline or the next message, whichever comes first,
+	 * so the state machine is ticked on time and isn't woken when there is nothing to do.
+	 * Scheduling a time that has already passed gets a tick as soon as the current message is handled.
+	 */
+	void scheduleTick(TimePoint when) { deadlines.push(when); }
+
 	State gameState = State::SETUP;
 
 	const int targetCount;
 
 	std::vector<Player> players;
 
+	/// Statistics for each player, updated as they shoot so that they are ready whenever somebody asks
+	std::vector<PlayerStatistics> statistics;
+
+	TimePoint gameStartTime;
+
 	TimePoint  gameEndTime;
 
 	const std::chrono::seconds duration;
 
 	const score_t winningScore;
 
-	std::unordered_set<Shot> shots;
+	/// Every shot fired this game, by player and in time order
+	ShotLog shots;
+
+private:
+
+	GameClock clock;
+
+	/// Times at which onTick should be called, earliest first
+	std::priority_queue<TimePoint, std::vector<TimePoint>, std::greater<TimePoint>> deadlines;
+
+	/// Events that haven't been sent yet. Cleared instead of replaced so its storage gets reused.
+	std::vector<GameEvent> events;
 };
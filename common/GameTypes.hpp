@@ -25,3 +25,5 @@ typedef int16_t score_t;
 typedef int32_t timestamp_t;
 /// Game durations are in seconds and are 16 bits wide
 typedef int16_t duration_t;
+/// Lane IDs are 8-bits wide and unsigned
+typedef uint8_t lane_id_t;
@@ -0,0 +1,389 @@
+#include "JSONReader.hpp"
+
+#include <climits>
+#include <cstdint>
+
+#include "Exceptions.hpp"
+
+using namespace Exceptions;
+
+namespace {
+
+int hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+void appendUTF8(std::string& out, uint32_t cp)
+{
+	if (cp < 0x80) {
+		out += (char)cp;
+	}
+	else if (cp < 0x800) {
+		out += (char)(0xc0 | (cp >> 6));
+		out += (char)(0x80 | (cp & 0x3f));
+	}
+	else if (cp < 0x10000) {
+		out += (char)(0xe0 | (cp >> 12));
+		out += (char)(0x80 | ((cp >> 6) & 0x3f));
+		out += (char)(0x80 | (cp & 0x3f));
+	}
+	else {
+		out += (char)(0xf0 | (cp >> 18));
+		out += (char)(0x80 | ((cp >> 12) & 0x3f));
+		out += (char)(0x80 | ((cp >> 6) & 0x3f));
+		out += (char)(0x80 | (cp & 0x3f));
+	}
+}
+
+/// How deeply nested a value skipValue will skip
+const int maxSkipDepth = 64;
+
+} // end anonymous namespace
+
+JSONReader::JSONReader(const char* text, size_t len) :
+	cur(text),
+	end(text + len),
+	afterOpen(false),
+	keyData(nullptr),
+	keyLength(0),
+	keyScratch()
+{
+}
+
+char JSONReader::skipWhitespace()
+{
+	while (cur != end) {
+		switch (*cur) {
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+				++cur;
+				break;
+
+			default:
+				return *cur;
+		}
+	}
+	return 0;
+}
+
+void JSONReader::expect(char c, const char* what)
+{
+	if (skipWhitespace() != c)
+		fail(what);
+	++cur;
+}
+
+void JSONReader::fail(const char* what) const
+{
+	THROW(IOException, std::string("Malformed JSON: ") + what);
+}
+
+JSONReader::Token JSONReader::peek()
+{
+	switch (skipWhitespace()) {
+		case '{': return Token::OBJECT;
+		case '[': return Token::ARRAY;
+		case '"': return Token::STRING;
+		case 't':
+		case 'f': return Token::BOOLEAN;
+		case 'n': return Token::NUL;
+		case '-':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			return Token::NUMBER;
+		case 0:
+			fail("unexpected end of text");
+		default:
+			fail("expected a value");
+	}
+}
+
+void JSONReader::beginObject()
+{
+	expect('{', "expected an object");
+	afterOpen = true;
+}
+
+void JSONReader::beginArray()
+{
+	expect('[', "expected an array");
+	afterOpen = true;
+}
+
+bool JSONReader::nextItem(char close)
+{
+	const char c = skipWhitespace();
+
+	if (c == close) {
+		++cur;
+		afterOpen = false;
+		return false;
+	}
+
+	if (!afterOpen) {
+		if (c != ',')
+			fail("expected a comma");
+		++cur;
+	}
+
+	afterOpen = false;
+	return true;
+}
+
+bool JSONReader::nextMember()
+{
+	if (!nextItem('}'))
+		return false;
+
+	if (skipWhitespace() != '"')
+		fail("expected a key");
+
+	readRawString(keyData, keyLength, keyScratch);
+	expect(':', "expected a colon after a key");
+	return true;
+}
+
+bool JSONReader::nextElement()
+{
+	return nextItem(']');
+}
+
+int JSONReader::readInt()
+{
+	if (peek() != Token::NUMBER)
+		fail("expected a number");
+
+	const bool negative = *cur == '-';
+	if (negative)
+		++cur;
+
+	if (cur == end || *cur < '0' || *cur > '9')
+		fail("expected a digit");
+
+	// Accumulate the magnitude, which can be one bigger than INT_MAX if the number is negative.
+	const int64_t limit = negative ? -(int64_t)INT_MIN : INT_MAX;
+	int64_t magnitude = 0;
+	bool tooBig = false;
+
+	for (; cur != end && *cur >= '0' && *cur <= '9'; ++cur) {
+		magnitude = magnitude * 10 + (*cur - '0');
+		if (magnitude > limit) {
+			tooBig = true;
+			magnitude = limit;
+		}
+	}
+
+	if (cur != end && (*cur == '.' || *cur == 'e' || *cur == 'E'))
+		fail("expected an integer");
+
+	if (tooBig)
+		fail("an integer is out of range");
+
+	return (int)(negative ? -magnitude : magnitude);
+}
+
+bool JSONReader::readBool()
+{
+	skipWhitespace();
+
+	if (end - cur >= 4 && memcmp(cur, "true", 4) == 0) {
+		cur += 4;
+		return true;
+	}
+
+	if (end - cur >= 5 && memcmp(cur, "false", 5) == 0) {
+		cur += 5;
+		return false;
+	}
+
+	fail("expected a boolean");
+}
+
+void JSONReader::readString(std::string& out)
+{
+	if (skipWhitespace() != '"')
+		fail("expected a string");
+
+	const char* data;
+	size_t length;
+	readRawString(data, length, out);
+
+	// If there were no escapes, the string is still sitting in the text.
+	if (data != out.data())
+		out.assign(data, length);
+}
+
+void JSONReader::readRawString(const char*& data, size_t& length, std::string& scratch)
+{
+	++cur; // The opening quote
+
+	// Fast path: find the closing quote, hoping to not see any escapes on the way.
+	const char* start = cur;
+	while (cur != end && *cur != '"' && *cur != '\\') {
+		if ((unsigned char)*cur < 0x20)
+			fail("a string contains a control character");
+		++cur;
+	}
+
+	if (cur == end)
+		fail("a string is missing its closing quote");
+
+	if (*cur == '"') {
+		data = start;
+		length = (size_t)(cur - start);
+		++cur;
+		return;
+	}
+
+	// We hit an escape. Build the string up in scratch space.
+	scratch.assign(start, (size_t)(cur - start));
+
+	while (true) {
+		if (cur == end)
+			fail("a string is missing its closing quote");
+
+		const char c = *cur++;
+
+		if (c == '"')
+			break;
+
+		if ((unsigned char)c < 0x20)
+			fail("a string contains a control character");
+
+		if (c != '\\') {
+			scratch += c;
+			continue;
+		}
+
+		if (cur == end)
+			fail("a string ends in the middle of an escape sequence");
+
+		switch (*cur++) {
+			case '"': scratch += '"'; break;
+			case '\\': scratch += '\\'; break;
+			case '/': scratch += '/'; break;
+			case 'b': scratch += '\b'; break;
+			case 'f': scratch += '\f'; break;
+			case 'n': scratch += '\n'; break;
+			case 'r': scratch += '\r'; break;
+			case 't': scratch += '\t'; break;
+
+			case 'u': {
+				const auto readHex = [this]() -> uint32_t {
+					if (end - cur < 4)
+						fail("a string ends in the middle of an escape sequence");
+					uint32_t v = 0;
+					for (int i = 0; i < 4; ++i) {
+						const int h = hexValue(*cur++);
+						if (h < 0)
+							fail("a string has a bad \\u escape sequence");
+						v = (v << 4) | (uint32_t)h;
+					}
+					return v;
+				};
+
+				uint32_t cp = readHex();
+
+				// Characters outside the BMP come as a pair of UTF-16 surrogates.
+				if (cp >= 0xd800 && cp < 0xdc00) {
+					if (end - cur < 2 || cur[0] != '\\' || cur[1] != 'u')
+						fail("a string has an unpaired surrogate");
+					cur += 2;
+					const uint32_t low = readHex();
+					if (low < 0xdc00 || low >= 0xe000)
+						fail("a string has an unpaired surrogate");
+					cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+				}
+
+				appendUTF8(scratch, cp);
+				break;
+			}
+
+			default:
+				fail("a string has an unknown escape sequence");
+		}
+	}
+
+	data = scratch.data();
+	length = scratch.size();
+}
+
+void JSONReader::skipString()
+{
+	++cur; // The opening quote
+
+	while (cur != end) {
+		const char c = *cur++;
+		if (c == '"')
+			return;
+		if (c == '\\') {
+			if (cur == end)
+				break;
+			++cur;
+		}
+	}
+
+	fail("a string is missing its closing quote");
+}
+
+void JSONReader::skipValue()
+{
+	skipValue(0);
+}
+
+void JSONReader::skipValue(int depth)
+{
+	// Don't let something like a line full of [ blow the stack.
+	if (depth > maxSkipDepth)
+		fail("values are nested too deeply");
+
+	switch (peek()) {
+		case Token::STRING:
+			skipString();
+			break;
+
+		case Token::BOOLEAN:
+			readBool();
+			break;
+
+		case Token::NUL:
+			if (end - cur < 4 || memcmp(cur, "null", 4) != 0)
+				fail("expected null");
+			cur += 4;
+			break;
+
+		case Token::NUMBER:
+			// Be lenient about the number's exact form. We're throwing it away.
+			while (cur != end && ((*cur >= '0' && *cur <= '9') ||
+			                      *cur == '-' || *cur == '+' || *cur == '.' || *cur == 'e' || *cur == 'E'))
+				++cur;
+			break;
+
+		case Token::OBJECT:
+			beginObject();
+			while (nextMember())
+				skipValue(depth + 1);
+			break;
+
+		case Token::ARRAY:
+			beginArray();
+			while (nextElement())
+				skipValue(depth + 1);
+			break;
+	}
+}
+
+void JSONReader::finish()
+{
+	if (skipWhitespace() != 0)
+		fail("there is text after the end of the value");
+}
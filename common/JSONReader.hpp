@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+/**
+ * \brief Reads JSON text one value at a time, without building a tree
+ *
+ * The reader is a pull parser: the caller walks the document in the order it expects it,
+ * asking for objects, arrays, and scalar values as it goes, and skipping anything it doesn't care about.
+ * Messages from the UI are decoded this way (see JSONToMessage(const char*, size_t))
+ * instead of being parsed into a Json::Value and then picked apart.
+ *
+ * \code
+ * JSONReader r(text, len);
+ * r.beginObject();
+ * while (r.nextMember()) {
+ *     if (r.isKey("id"))
+ *         id = r.readInt();
+ *     else
+ *         r.skipValue();
+ * }
+ * r.finish();
+ * \endcode
+ *
+ * Strings are only copied when asked for with readString, and keys are compared in place
+ * unless they contain escape sequences.
+ *
+ * \throws Exceptions::IOException from any member function if the text is not well-formed JSON
+ *         or does not contain what was asked for.
+ */
+class JSONReader {
+
+public:
+
+	/// The kinds of value JSON has
+	enum class Token {
+		OBJECT,
+		ARRAY,
+		STRING,
+		NUMBER,
+		BOOLEAN,
+		NUL ///< null
+	};
+
+	/// Constructs a reader over the given text, which must outlive the reader
+	JSONReader(const char* text, size_t len);
+
+	/// Gets the kind of the next value without consuming it
+	Token peek();
+
+	/// Consumes the opening brace of an object
+	void beginObject();
+
+	/**
+	 * \brief Moves to the next member of the current object and reads its key
+	 * \returns true if there was another member, whose value should be read (or skipped) next,
+	 *          or false, having consumed the closing brace, if the object is finished
+	 */
+	bool nextMember();
+
+	/// Returns true if the key read by the last call to nextMember is `k`
+	bool isKey(const char* k) const
+	{
+		return strlen(k) == keyLength && memcmp(k, keyData, keyLength) == 0;
+	}
+
+	/// Gets the key read by the last call to nextMember
+	std::string getKey() const { return std::string(keyData, keyLength); }
+
+	/// Consumes the opening bracket of an array
+	void beginArray();
+
+	/**
+	 * \brief Moves to the next element of the current array
+	 * \returns true if there was another element, which should be read (or skipped) next,
+	 *          or false, having consumed the closing bracket, if the array is finished
+	 */
+	bool nextElement();
+
+	/// Reads a number that must be an integer that fits in an int
+	int readInt();
+
+	/// Reads true or false
+	bool readBool();
+
+	/// Reads a string into `out`, replacing its contents and unescaping as needed
+	void readString(std::string& out);
+
+	/// Skips the next value, including everything inside it if it is an object or array
+	void skipValue();
+
+	/// Checks that nothing but whitespace is left
+	void finish();
+
+	// Disallow copy and assign
+	JSONReader(const JSONReader&) = delete;
+	JSONReader& operator=(const JSONReader&) = delete;
+
+private:
+
+	/// Skips whitespace, returning the next character, or 0 at the end of the text
+	char skipWhitespace();
+
+	/// Consumes the given character after any whitespace, or throws
+	void expect(char c, const char* what);
+
+	/// Handles the comma between members or elements. Returns false if `close` comes next instead.
+	bool nextItem(char close);
+
+	/// Reads a string starting at the opening quote.
+	/// If it has no escapes, `data` and `length` point into the text and `scratch` is untouched.
+	/// Otherwise the unescaped string is put in `scratch`, and `data` and `length` point into it.
+	void readRawString(const char*& data, size_t& length, std::string& scratch);
+
+	/// Skips a string starting at the opening quote
+	void skipString();
+
+	/// Skips a value nested `depth` levels inside the one skipValue() was called on
+	void skipValue(int depth);
+
+	[[noreturn]] void fail(const char* what) const;
+
+	const char* cur;
+
+	const char* const end;
+
+	/// True right after an opening brace or bracket, when no comma is expected
+	bool afterOpen;
+
+	const char* keyData;
+
+	size_t keyLength;
+
+	/// Holds keys that had escape sequences in them
+	std::string keyScratch;
+};
@@ -0,0 +1,97 @@
+#include "JSONWriter.hpp"
+
+#include <cstring>
+
+namespace {
+
+const char hexDigits[] = "0123456789abcdef";
+
+} // end anonymous namespace
+
+void JSONWriter::key(const char* k)
+{
+	separate();
+	out += '"';
+	out += k;
+	out += "\":";
+	needComma = false;
+}
+
+void JSONWriter::value(int64_t v)
+{
+	separate();
+
+	// Build the digits backwards from the end of a buffer big enough for any int64_t.
+	char buf[20];
+	char* p = buf + sizeof(buf);
+
+	// Work with the magnitude as unsigned so that the most negative value doesn't overflow.
+	uint64_t magnitude = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+	do {
+		*--p = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (v < 0)
+		out += '-';
+
+	out.append(p, (size_t)(buf + sizeof(buf) - p));
+	needComma = true;
+}
+
+void JSONWriter::value(bool v)
+{
+	separate();
+	out += v ? "true" : "false";
+	needComma = true;
+}
+
+void JSONWriter::value(const char* v)
+{
+	value(v, strlen(v));
+}
+
+void JSONWriter::value(const char* v, size_t len)
+{
+	separate();
+	out += '"';
+
+	// Copy runs of characters that don't need escaping in one go.
+	const char* run = v;
+	const char* const end = v + len;
+
+	for (const char* c = v; c != end; ++c) {
+		const unsigned char u = (unsigned char)*c;
+		if (u >= 0x20 && u != '"' && u != '\\')
+			continue;
+
+		out.append(run, (size_t)(c - run));
+		run = c + 1;
+
+		switch (u) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\b': out += "\\b"; break;
+			case '\f': out += "\\f"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				out += "\\u00";
+				out += hexDigits[u >> 4];
+				out += hexDigits[u & 0xf];
+				break;
+		}
+	}
+
+	out.append(run, (size_t)(end - run));
+	out += '"';
+	needComma = true;
+}
+
+void JSONWriter::raw(const char* json, size_t len)
+{
+	separate();
+	out.append(json, len);
+	needComma = true;
+}
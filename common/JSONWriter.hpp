@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Writes JSON text straight into a string, one token at a time
+ *
+ * Messages use this to serialize themselves for the UI without building a Json::Value tree first
+ * (see Message::writeJSON). The writer appends to a caller-owned string, so a connection can keep one
+ * around and reuse its capacity for every message it sends.
+ *
+ * The writer takes care of commas, quoting, and escaping, but it is up to the caller to produce
+ * a well-formed document (i.e. to match each begin with an end and to give every object member a key).
+ * The output has no whitespace, just like Json::FastWriter's.
+ *
+ * \code
+ * std::string out;
+ * JSONWriter w(out);
+ * w.beginObject();
+ * w.key("id");
+ * w.value(42);
+ * w.endObject(); // out is now {"id":42}
+ * \endcode
+ */
+class JSONWriter {
+
+public:
+
+	/// Constructs a writer that appends to `output`
+	explicit JSONWriter(std::string& output) : out(output), needComma(false) { }
+
+	void beginObject() { separate(); out += '{'; needComma = false; }
+
+	void endObject() { out += '}'; needComma = true; }
+
+	void beginArray() { separate(); out += '['; needComma = false; }
+
+	void endArray() { out += ']'; needComma = true; }
+
+	/// Writes the key of the next object member. `k` is assumed to need no escaping.
+	void key(const char* k);
+
+	void value(int64_t v);
+
+	void value(int v) { value((int64_t)v); }
+
+	void value(bool v);
+
+	void value(const std::string& v) { value(v.data(), v.size()); }
+
+	/// Writes a string value. Quotes, backslashes, and control characters are escaped.
+	void value(const char* v, size_t len);
+
+	void value(const char* v);
+
+	/// Writes an already-serialized JSON value as-is
+	void raw(const char* json, size_t len);
+
+	/// Gets the string being written to
+	std::string& output() { return out; }
+
+	// Disallow copy and assign
+	JSONWriter(const JSONWriter&) = delete;
+	JSONWriter& operator=(const JSONWriter&) = delete;
+
+private:
+
+	/// Writes a comma if the last thing written was a value
+	void separate()
+	{
+		if (needComma)
+			out += ',';
+	}
+
+	std::string& out;
+
+	/// True if the next key or value needs a comma before it
+	bool needComma;
+};
@@ -0,0 +1,63 @@
+#include "LaneMap.hpp"
+
+#include <bitset>
+#include <cstdint>
+
+#include "Exceptions.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+LaneMap::LaneMap() :
+	lanes(),
+	targetLocations(),
+	gunLocations()
+{
+}
+
+LaneMap LaneMap::uniform(size_t laneCount, board_id_t targetsPerLane, board_id_t gunsPerLane)
+{
+	ENFORCE(ArgumentException, laneCount * (size_t)max(targetsPerLane, gunsPerLane) <= INT8_MAX + 1,
+	        "There are not enough board IDs for that many lanes.");
+
+	LaneMap ret;
+	for (size_t l = 0; l < laneCount; ++l) {
+		vector<board_id_t> targets, guns;
+		for (board_id_t t = 0; t < targetsPerLane; ++t)
+			targets.emplace_back((board_id_t)(l * (size_t)targetsPerLane + (size_t)t));
+		for (board_id_t g = 0; g < gunsPerLane; ++g)
+			guns.emplace_back((board_id_t)(l * (size_t)gunsPerLane + (size_t)g));
+
+		ret.addLane(move(targets), move(guns));
+	}
+	return ret;
+}
+
+lane_id_t LaneMap::addLane(std::vector<board_id_t> targets, std::vector<board_id_t> guns)
+{
+	ENFORCE(ArgumentException, lanes.size() <= UINT8_MAX, "There are no more lane IDs.");
+	ENFORCE(ArgumentException, !targets.empty(), "A lane needs at least one target.");
+	ENFORCE(ArgumentException, !guns.empty(), "A lane needs at least one gun.");
+
+	// Check everything before adding anything, so a bad lane doesn't leave half of itself behind.
+	const auto check = [](const Locations& locations, const vector<board_id_t>& boards, const char* taken) {
+		bitset<tuple_size<Locations>::value> seen;
+		for (board_id_t b : boards) {
+			ENFORCE(ArgumentOutOfRangeException, b >= 0, "Board IDs cannot be negative.");
+			ENFORCE(ArgumentException, !locations[(size_t)b].isValid() && !seen[(size_t)b], taken);
+			seen[(size_t)b] = true;
+		}
+	};
+	check(targetLocations, targets, "A target can only be in one lane.");
+	check(gunLocations, guns, "A gun can only be in one lane.");
+
+	const auto lane = (lane_id_t)lanes.size();
+
+	for (size_t i = 0; i < targets.size(); ++i)
+		targetLocations[(size_t)targets[i]] = Location(lane, (board_id_t)i);
+	for (size_t i = 0; i < guns.size(); ++i)
+		gunLocations[(size_t)guns[i]] = Location(lane, (board_id_t)i);
+
+	lanes.emplace_back(move(targets), move(guns));
+	return lane;
+}
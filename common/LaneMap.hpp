@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "GameTypes.hpp"
+
+/**
+ * \brief Which targets and guns belong to which lane of the range
+ *
+ * The hardware numbers its boards across the whole facility,
+ * but each lane runs its own game, which numbers its targets and players from zero.
+ * A lane's n-th target (or gun) is the n-th one it was given.
+ */
+class LaneMap {
+
+public:
+
+	/// The boards in a lane, by their facility-wide IDs
+	struct Lane {
+		std::vector<board_id_t> targets;
+		std::vector<board_id_t> guns;
+
+		Lane(std::vector<board_id_t>&& t, std::vector<board_id_t>&& g) : targets(std::move(t)), guns(std::move(g)) { }
+	};
+
+	/// Where a board is: the lane it belongs to and its number within the lane
+	struct Location {
+		lane_id_t lane;
+		board_id_t local; ///< -1 if the board isn't in any lane
+
+		Location() : lane(0), local(-1) { }
+
+		Location(lane_id_t l, board_id_t i) : lane(l), local(i) { }
+
+		bool isValid() const { return local >= 0; }
+	};
+
+	LaneMap();
+
+	/**
+	 * \brief Makes a map of identical lanes whose boards are numbered one lane after another
+	 *
+	 * For example, two lanes of two targets and two guns get targets 0 and 1 and guns 0 and 1 in the first lane,
+	 * and targets 2 and 3 and guns 2 and 3 in the second.
+	 */
+	static LaneMap uniform(size_t laneCount, board_id_t targetsPerLane, board_id_t gunsPerLane);
+
+	/**
+	 * \brief Adds a lane with the given boards
+	 * \returns The new lane's ID
+	 * \throws Exceptions::ArgumentException if the lane has no targets or guns, or a board is already in a lane
+	 */
+	lane_id_t addLane(std::vector<board_id_t> targets, std::vector<board_id_t> guns);
+
+	/// Gets the number of lanes
+	size_t size() const { return lanes.size(); }
+
+	/// Gets a lane's boards
+	const Lane& at(lane_id_t lane) const { return lanes.at(lane); }
+
+	/// Finds the lane a target belongs to
+	Location findTarget(board_id_t target) const { return lookUp(targetLocations, target); }
+
+	/// Finds the lane a gun belongs to
+	Location findGun(board_id_t gun) const { return lookUp(gunLocations, gun); }
+
+	/// Gets the facility-wide ID of one of a lane's targets
+	board_id_t globalTarget(lane_id_t lane, board_id_t local) const
+	{
+		return lanes.at(lane).targets.at((size_t)local);
+	}
+
+private:
+
+	/// Board IDs are 8-bit and non-negative, so we can look every one of them up directly
+	typedef std::array<Location, 128> Locations;
+
+	static Location lookUp(const Locations& locations, board_id_t board)
+	{
+		return board >= 0 ? locations[(size_t)board] : Location();
+	}
+
+	std::vector<Lane> lanes;
+
+	Locations targetLocations;
+
+	Locations gunLocations;
+};
@@ -0,0 +1,312 @@
+#include "LaneServer.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "GameRunner.hpp"
+#include "MemoryUtils.hpp"
+#include "ResponseMessage.hpp"
+#include "ShotMessage.hpp"
+#include "TargetControlMessage.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+namespace {
+
+typedef GameRunner::Clock Clock;
+typedef GameRunner::TimePoint TimePoint;
+
+/// One lane's game, and what is waiting for it
+struct Lane {
+	/// What the runner sends, before it is translated and passed along
+	MessageQueue sent;
+
+	GameRunner runner;
+
+	/// Messages that have been dispatched to the lane but not handed to its runner yet
+	deque<unique_ptr<Message>> inbox;
+
+	/// Set while the lane is posted to the executor or running on it, so that it only ever runs in one place
+	bool scheduled;
+
+	/// Set while a timer is waiting to run the lane at its runner's next deadline
+	bool timerSet;
+
+	Executor::TimerID timer;
+
+	Lane(board_id_t numberTargets, board_id_t numberPlayers, uint32_t seed, MatchHistory* history,
+	     bool acknowledgeShots) :
+		sent(),
+		runner(sent, numberTargets, numberPlayers, seed, history, acknowledgeShots),
+		inbox(),
+		scheduled(false),
+		timerSet(false),
+		timer(0)
+	{ }
+};
+
+/**
+ * \brief Hands messages to lanes and lanes to an executor
+ *
+ * Whenever a lane gets a message, it is posted to the executor, which feeds it everything in its inbox,
+ * ticks it if need be, and passes along what it sent. Between messages, a timer runs it at its next deadline.
+ */
+class LaneScheduler {
+
+public:
+
+	LaneScheduler(MessageQueue& out, const LaneMap& map, Executor& executor, MatchHistory* history,
+	              bool acknowledgeShots);
+
+	/// Routes a message to its lane, or answers it if it has nowhere to go
+	void dispatch(unique_ptr<Message>&& msg);
+
+	/// Stops scheduling lanes and waits for any that are running to finish
+	void stop();
+
+private:
+
+	/// Posts a lane to the executor unless it is already there. The caller must hold lanesMutex.
+	void schedule(lane_id_t id);
+
+	/// Feeds a lane its inbox and ticks it if it is due. Run on the executor.
+	void run(lane_id_t id);
+
+	/// Runs when a lane's deadline arrives
+	void onTimer(lane_id_t id);
+
+	/// Marks one of the tasks we gave the executor as done. The caller must hold lanesMutex.
+	void finishTask();
+
+	/// Passes along what a lane sent, translated to the hardware's numbering
+	void forward(lane_id_t id);
+
+	/// Responds to a message we could not route
+	void reject(const Message& msg, const string& why);
+
+	// Disallow copy and assign
+	LaneScheduler(const LaneScheduler&) = delete;
+	LaneScheduler& operator=(const LaneScheduler&) = delete;
+
+	MessageQueue& out;
+
+	const LaneMap& map;
+
+	Executor& executor;
+
+	const bool acknowledgeShots;
+
+	vector<unique_ptr<Lane>> lanes;
+
+	/// Guards the lanes' inboxes, flags, and timers, as well as outstanding and stopping
+	mutex lanesMutex;
+
+	/// The number of tasks and timers we have given the executor that haven't finished
+	size_t outstanding;
+
+	/// Signaled when outstanding drops to zero
+	condition_variable idle;
+
+	bool stopping;
+
+	/// A unique ID for the responses the dispatcher sends itself
+	message_id_t uid;
+};
+
+LaneScheduler::LaneScheduler(MessageQueue& outQueue, const LaneMap& laneMap, Executor& exec,
+                             MatchHistory* history, bool acknowledge) :
+	out(outQueue),
+	map(laneMap),
+	executor(exec),
+	acknowledgeShots(acknowledge),
+	lanes(),
+	lanesMutex(),
+	outstanding(0),
+	idle(),
+	stopping(false),
+	uid(0)
+{
+	ENFORCE(ArgumentException, map.size() > 0, "You must have at least one lane.");
+
+	random_device seeds;
+	for (size_t i = 0; i < map.size(); ++i) {
+		const auto& lane = map.at((lane_id_t)i);
+		lanes.emplace_back(new Lane((board_id_t)lane.targets.size(), (board_id_t)lane.guns.size(),
+		                            seeds(), history, acknowledgeShots));
+	}
+}
+
+void LaneScheduler::dispatch(unique_ptr<Message>&& msg)
+{
+	lane_id_t id;
+
+	if (msg->getType() == Message::Type::SHOT) {
+		// Shots come straight from the hardware, which doesn't know about lanes, so go by the gun that took them.
+		auto& shot = static_cast<ShotMessage*>(msg.get())->shot;
+
+		const auto gun = map.findGun(shot.player);
+		if (!gun.isValid()) {
+			if (acknowledgeShots)
+				reject(*msg, "Gun " + to_string(shot.player) + " is not in any lane.");
+			return;
+		}
+
+		const auto target = map.findTarget(shot.target);
+		shot.player = gun.local;
+		// A target in someone else's lane is as good as a miss.
+		shot.target = target.isValid() && target.lane == gun.lane ? target.local : -1;
+
+		id = gun.lane;
+		msg->lane = id;
+	}
+	else {
+		id = msg->lane;
+		if (id >= lanes.size()) {
+			reject(*msg, "There is no lane " + to_string(id) + ".");
+			return;
+		}
+	}
+
+	lock_guard<mutex> lock(lanesMutex);
+	lanes[id]->inbox.emplace_back(move(msg));
+	schedule(id);
+}
+
+void LaneScheduler::stop()
+{
+	unique_lock<mutex> lock(lanesMutex);
+	stopping = true;
+
+	for (auto& lane : lanes) {
+		if (lane->timerSet && executor.cancel(lane->timer)) {
+			lane->timerSet = false;
+			finishTask();
+		}
+	}
+
+	idle.wait(lock, [this] { return outstanding == 0; });
+}
+
+void LaneScheduler::schedule(lane_id_t id)
+{
+	Lane& lane = *lanes[id];
+	if (lane.scheduled || stopping)
+		return;
+
+	lane.scheduled = true;
+	++outstanding;
+	executor.post([this, id] { run(id); });
+}
+
+void LaneScheduler::run(lane_id_t id)
+{
+	Lane& lane = *lanes[id];
+
+	deque<unique_ptr<Message>> batch;
+	{
+		lock_guard<mutex> lock(lanesMutex);
+		batch.swap(lane.inbox);
+
+		// We're about to run the lane anyways. If the timer already fired, it will just find nothing to do.
+		if (lane.timerSet && executor.cancel(lane.timer)) {
+			lane.timerSet = false;
+			finishTask();
+		}
+	}
+
+	// Nobody else touches the runner while we're scheduled.
+	for (auto& msg : batch)
+		lane.runner.onMessage(move(msg), Clock::now());
+
+	const auto now = Clock::now();
+	if (lane.runner.nextDeadline() <= now)
+		lane.runner.onTick(now);
+
+	forward(id);
+
+	const auto deadline = lane.runner.nextDeadline();
+
+	lock_guard<mutex> lock(lanesMutex);
+	lane.scheduled = false;
+
+	if (!lane.inbox.empty()) {
+		// More arrived while we were running.
+		schedule(id);
+	}
+	else if (deadline != TimePoint::max() && !lane.timerSet && !stopping) {
+		lane.timer = executor.postAt(deadline, [this, id] { onTimer(id); });
+		lane.timerSet = true;
+		++outstanding;
+	}
+
+	finishTask();
+}
+
+void LaneScheduler::onTimer(lane_id_t id)
+{
+	lock_guard<mutex> lock(lanesMutex);
+	lanes[id]->timerSet = false;
+	schedule(id);
+	finishTask();
+}
+
+void LaneScheduler::finishTask()
+{
+	if (--outstanding == 0)
+		idle.notify_all();
+}
+
+void LaneScheduler::forward(lane_id_t id)
+{
+	MessageQueue& sent = lanes[id]->sent;
+
+	while (auto msg = sent.tryReceive()) {
+		if (msg->getType() == Message::Type::TARGET_CONTROL) {
+			const auto& commands = static_cast<const TargetControlMessage&>(*msg).commands;
+
+			TargetControlMessage::CommandList global;
+			global.reserve(commands.size());
+			for (const auto& command : commands)
+				global.emplace_back(map.globalTarget(id, command.id), command.on);
+
+			const message_id_t msgID = msg->id;
+			msg.reset(new TargetControlMessage(msgID, move(global)));
+		}
+
+		msg->lane = id;
+		out.send(move(msg));
+	}
+}
+
+void LaneScheduler::reject(const Message& msg, const string& why)
+{
+	unique_ptr<Message> response(new ResponseMessage(uid++, msg.id, ResponseMessage::Code::INVALID_REQUEST, why));
+	response->lane = msg.lane;
+	out.send(move(response));
+}
+
+} // end anonymous namespace
+
+void runLanes(MessageQueue& in, MessageQueue& out, const LaneMap& lanes, Executor& executor,
+              MatchHistory* history, bool acknowledgeShots)
+{
+	LaneScheduler scheduler(out, lanes, executor, history, acknowledgeShots);
+
+	while (true) {
+		auto msg = in.receive();
+
+		if (msg == nullptr || msg->getType() == Message::Type::EXIT)
+			break;
+
+		scheduler.dispatch(move(msg));
+	}
+
+	scheduler.stop();
+}
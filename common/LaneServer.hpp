@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Executor.hpp"
+#include "LaneMap.hpp"
+#include "MessageQueue.hpp"
+
+// Forward declarations. We just have pointers to these here.
+class MatchHistory;
+
+/**
+ * \brief Runs an independent game in each lane of the range, sharing an executor's workers between them
+ * \param in The MessageQueue on which the lanes receive messages
+ * \param out The MessageQueue the lanes use to talk to the UI and hardware,
+ *            multiplexed elsewhere just like runGame's.
+ * \param lanes Which targets and guns belong to which lane
+ * \param executor Runs the lanes' games. Each lane is posted to it whenever it has messages waiting,
+ *                 and a timer runs it whenever its game has a deadline.
+ *                 A lane only ever runs on one worker at a time, so lanes add tasks, not threads.
+ * \param history If not null, every lane's games are appended to it as they end.
+ * \param acknowledgeShots Whether shots get a response, including shots from guns in no lane.
+ *                         \see GameRunner::GameRunner
+ *
+ * This is runGame for many lanes. Each lane has its own GameRunner, which only knows about its own
+ * targets and players, numbered from zero.
+ *
+ * - Shots are routed by the gun that took them, and their gun and target are translated to the lane's numbering.
+ *   A shot that hit a target in another lane counts as a miss.
+ * - Everything else is routed by its lane field. Messages for a lane that doesn't exist get an
+ *   INVALID_REQUEST response.
+ * - Target control messages sent by a lane have their targets translated back to the hardware's numbering,
+ *   and everything a lane sends is stamped with the lane's ID.
+ *
+ * Message IDs are only unique within a lane, so the UI should match responses by their lane as well as their ID.
+ *
+ * Call this function from its own thread (say, with Executor::postBlocking), since it waits on `in`.
+ * It returns once it receives an exit message and any lanes that were running have finished.
+ */
+void runLanes(MessageQueue& in, MessageQueue& out, const LaneMap& lanes, Executor& executor,
+              MatchHistory* history = nullptr, bool acknowledgeShots = true);
@@ -0,0 +1,439 @@
+#include "MatchHistory.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BinaryMessage.hpp"
+#include "CRC.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+namespace {
+
+/// Every match history file starts with this, followed by a 16-bit version and 16 reserved bits.
+const uint8_t magic[4] = {'M', 'H', 'S', 'T'};
+
+const uint16_t version = 1;
+
+const size_t headerLength = 8;
+
+/// The length field at the start of each record
+const size_t lengthLength = 4;
+
+/// The date, game type, and player count at the start of each record's body
+const size_t fixedBodyLength = 8 + 1 + 1;
+
+/// A player's score, hits, statistics, and shot count
+const size_t summaryLength = sizeof(score_t) + sizeof(shot_t) + ShotStatistics::binaryLength + 2;
+
+const size_t crcLength = 2;
+
+/// How big a new file starts out. It doubles every time it runs out of room.
+const size_t initialCapacity = 64 * 1024;
+
+size_t pageSize()
+{
+	static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+	return size;
+}
+
+uint8_t* writeDate(uint8_t* buf, time_t date)
+{
+	const auto d = (uint64_t)(int64_t)date;
+	buf = BinaryMessage::writeInt(buf, (uint32_t)(d >> 32));
+	return BinaryMessage::writeInt(buf, (uint32_t)d);
+}
+
+time_t extractDate(const uint8_t* buf)
+{
+	const uint64_t d = ((uint64_t)BinaryMessage::extractUInt32(buf) << 32) | BinaryMessage::extractUInt32(buf + 4);
+	return (time_t)(int64_t)d;
+}
+
+/// Returns true if a record's body has the length its player count and shot counts say it should
+bool bodyIsConsistent(const uint8_t* body, size_t length)
+{
+	if (length < fixedBodyLength)
+		return false;
+
+	const size_t playerCount = body[fixedBodyLength - 1];
+	size_t expected = fixedBodyLength + playerCount * summaryLength;
+	if (length < expected)
+		return false;
+
+	for (size_t i = 0; i < playerCount; ++i) {
+		const uint8_t* summary = body + fixedBodyLength + i * summaryLength;
+		expected += BinaryMessage::extractUInt16(summary + summaryLength - 2) * Shot::binaryLength;
+	}
+
+	return length == expected;
+}
+
+} // end anonymous namespace
+
+const size_t MatchHistory::MatchView::dateOffset;
+
+time_t MatchHistory::MatchView::getDate() const
+{
+	return extractDate(record + dateOffset);
+}
+
+const uint8_t* MatchHistory::MatchView::summaryOf(board_id_t player) const
+{
+	ENFORCE(ArgumentOutOfRangeException, player >= 0 && player < getPlayerCount(),
+	        "The player was not in the game.");
+	return record + lengthLength + fixedBodyLength + (size_t)player * summaryLength;
+}
+
+score_t MatchHistory::MatchView::getScore(board_id_t player) const
+{
+	return BinaryMessage::extractInt16(summaryOf(player));
+}
+
+shot_t MatchHistory::MatchView::getHits(board_id_t player) const
+{
+	return BinaryMessage::extractInt16(summaryOf(player) + 2);
+}
+
+ShotStatistics MatchHistory::MatchView::getStatistics(board_id_t player) const
+{
+	return ShotStatistics::fromBinary(summaryOf(player) + 4, ShotStatistics::binaryLength);
+}
+
+size_t MatchHistory::MatchView::getShotCount(board_id_t player) const
+{
+	return BinaryMessage::extractUInt16(summaryOf(player) + summaryLength - 2);
+}
+
+std::vector<Shot> MatchHistory::MatchView::getShots(board_id_t player) const
+{
+	const size_t count = getShotCount(player);
+
+	// Skip past the summaries and everybody's shots before this player's.
+	const uint8_t* it = record + lengthLength + fixedBodyLength + (size_t)getPlayerCount() * summaryLength;
+	for (board_id_t p = 0; p < player; ++p)
+		it += getShotCount(p) * Shot::binaryLength;
+
+	vector<Shot> ret;
+	ret.reserve(count);
+	for (size_t i = 0; i < count; ++i, it += Shot::binaryLength)
+		ret.emplace_back(Shot::fromBinary(it, Shot::binaryLength));
+
+	return ret;
+}
+
+MatchHistory::MatchHistory(const std::string& path, size_t syncEvery) :
+	fd(-1),
+	data(nullptr),
+	capacity(0),
+	end(headerLength),
+	syncedTo(headerLength),
+	syncInterval(max(syncEvery, (size_t)1)),
+	pendingSyncs(0),
+	resized(false),
+	records(),
+	byDate(),
+	byPlayer(),
+	appendMutex()
+{
+	fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		THROW(IOException, "Could not open the match history " + path + ": " + strerror(errno));
+
+	try {
+		struct stat st;
+		ENFORCE(IOException, fstat(fd, &st) == 0, "Could not get the size of the match history " + path);
+
+		const bool isNew = st.st_size == 0;
+		ENFORCE(IOException, isNew || (size_t)st.st_size >= headerLength, path + " is not a match history.");
+
+		map(max((size_t)st.st_size, initialCapacity));
+
+		if (isNew) {
+			memcpy(data, magic, sizeof(magic));
+			uint8_t* it = BinaryMessage::writeInt(data + sizeof(magic), version);
+			BinaryMessage::writeInt(it, (uint16_t)0);
+			resized = true;
+			flush();
+		}
+		else {
+			ENFORCE(IOException, memcmp(data, magic, sizeof(magic)) == 0, path + " is not a match history.");
+			ENFORCE(IOException, BinaryMessage::extractUInt16(data + sizeof(magic)) == version,
+			        path + " is from an unknown version of the match history.");
+			scan();
+		}
+	}
+	catch (...) {
+		unmap();
+		close(fd);
+		throw;
+	}
+}
+
+MatchHistory::~MatchHistory()
+{
+	try {
+		flush();
+	}
+	catch (...) {
+		// There's nobody left to tell.
+	}
+
+	unmap();
+	close(fd);
+}
+
+void MatchHistory::append(GameType type, time_t date, const ResultsResponseMessage::StatsList& stats)
+{
+	ENFORCE(ArgumentException, stats.size() <= INT8_MAX, "A game cannot have that many players.");
+
+	size_t bodyLength = fixedBodyLength + stats.size() * summaryLength;
+	for (const auto& player : stats) {
+		ENFORCE(ArgumentException, player.shots.size() <= UINT16_MAX, "A player took too many shots to record.");
+		bodyLength += player.shots.size() * Shot::binaryLength;
+	}
+
+	const size_t recordLength = lengthLength + bodyLength + crcLength;
+
+	lock_guard<mutex> lock(appendMutex);
+
+	if (end + recordLength > capacity) {
+		size_t newCapacity = capacity;
+		while (end + recordLength > newCapacity)
+			newCapacity *= 2;
+
+		map(newCapacity);
+	}
+
+	// Write the record in place. The CRC goes last, so until it's written the record doesn't count.
+	uint8_t* const start = data + end;
+	uint8_t* it = BinaryMessage::writeInt(start, (uint32_t)bodyLength);
+	it = writeDate(it, date);
+	*it++ = (uint8_t)type;
+	*it++ = (uint8_t)stats.size();
+
+	for (const auto& player : stats) {
+		it = BinaryMessage::writeInt(it, player.score);
+		it = BinaryMessage::writeInt(it, player.hits);
+		it = player.statistics.writeBinary(it);
+		it = BinaryMessage::writeInt(it, (uint16_t)player.shots.size());
+	}
+
+	for (const auto& player : stats) {
+		for (const auto& shot : player.shots)
+			it = shot.writeBinary(it);
+	}
+
+	BinaryMessage::writeInt(it, CRC::ccitt(start, lengthLength + bodyLength));
+
+	records.emplace_back(end, date);
+	index(records.size() - 1);
+	end += recordLength;
+
+	if (++pendingSyncs >= syncInterval)
+		flush();
+}
+
+void MatchHistory::sync()
+{
+	lock_guard<mutex> lock(appendMutex);
+	flush();
+}
+
+void MatchHistory::flush()
+{
+	if (data == nullptr || (syncedTo == end && !resized))
+		return;
+
+	// msync wants a page-aligned address.
+	const size_t from = syncedTo - syncedTo % pageSize();
+	ENFORCE(IOException, msync(data + from, end - from, MS_SYNC) == 0,
+	        string("Could not flush the match history: ") + strerror(errno));
+
+	// The file's new size has to make it to disk too, or the records past the old size are lost.
+	if (resized) {
+		ENFORCE(IOException, fdatasync(fd) == 0, string("Could not flush the match history: ") + strerror(errno));
+		resized = false;
+	}
+
+	syncedTo = end;
+	pendingSyncs = 0;
+}
+
+std::vector<MatchHistory::MatchView> MatchHistory::lastGames(size_t n) const
+{
+	return newestFirst(begin(byDate), std::end(byDate), n);
+}
+
+std::vector<MatchHistory::MatchView> MatchHistory::lastGamesFor(board_id_t player, size_t n) const
+{
+	ENFORCE(ArgumentOutOfRangeException, player >= 0, "Players are numbered from zero.");
+
+	if ((size_t)player >= byPlayer.size())
+		return vector<MatchView>();
+
+	const auto& games = byPlayer[(size_t)player];
+	return newestFirst(begin(games), std::end(games), n);
+}
+
+std::vector<MatchHistory::MatchView> MatchHistory::gamesBetween(time_t from, time_t to) const
+{
+	const auto before = [this](size_t r, time_t date) { return records[r].date < date; };
+
+	const auto first = lower_bound(begin(byDate), std::end(byDate), from, before);
+	const auto last = lower_bound(first, std::end(byDate), to, before);
+
+	vector<MatchView> ret;
+	ret.reserve((size_t)(last - first));
+	for (auto it = first; it != last; ++it)
+		ret.emplace_back(view(*it));
+
+	return ret;
+}
+
+std::vector<MatchHistory::LeaderboardEntry> MatchHistory::leaderboard(size_t n, time_t since) const
+{
+	const auto ranksAbove = [](const LeaderboardEntry& a, const LeaderboardEntry& b) {
+		if (a.score != b.score)
+			return a.score > b.score;
+		if (a.date != b.date)
+			return a.date < b.date;
+		return a.player < b.player;
+	};
+
+	// Keep the best n so far in a heap with the worst of them on top.
+	vector<LeaderboardEntry> best;
+	if (n == 0)
+		return best;
+
+	best.reserve(n);
+
+	const auto first = lower_bound(begin(byDate), std::end(byDate), since,
+	                               [this](size_t r, time_t date) { return records[r].date < date; });
+
+	for (auto it = first; it != std::end(byDate); ++it) {
+		const MatchView game = view(*it);
+		const time_t date = records[*it].date;
+
+		for (board_id_t p = 0; p < game.getPlayerCount(); ++p) {
+			const LeaderboardEntry entry(date, p, game.getScore(p), game.getHits(p));
+
+			if (best.size() < n) {
+				best.emplace_back(entry);
+				push_heap(begin(best), std::end(best), ranksAbove);
+			}
+			else if (ranksAbove(entry, best.front())) {
+				pop_heap(begin(best), std::end(best), ranksAbove);
+				best.back() = entry;
+				push_heap(begin(best), std::end(best), ranksAbove);
+			}
+		}
+	}
+
+	sort_heap(begin(best), std::end(best), ranksAbove);
+	return best;
+}
+
+void MatchHistory::map(size_t newCapacity)
+{
+	if (newCapacity != capacity) {
+		ENFORCE(IOException, ftruncate(fd, (off_t)newCapacity) == 0,
+		        string("Could not grow the match history: ") + strerror(errno));
+		resized = true;
+	}
+
+	void* mapped = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED)
+		THROW(IOException, string("Could not map the match history: ") + strerror(errno));
+
+	// Only let go of the old mapping once the new one is in place, so a failure leaves everything as it was.
+	unmap();
+	data = static_cast<uint8_t*>(mapped);
+	capacity = newCapacity;
+}
+
+void MatchHistory::unmap()
+{
+	if (data != nullptr)
+		munmap(data, capacity);
+
+	data = nullptr;
+}
+
+void MatchHistory::scan()
+{
+	size_t pos = headerLength;
+
+	while (pos + lengthLength <= capacity) {
+		const size_t bodyLength = BinaryMessage::extractUInt32(data + pos);
+
+		// A zero length is the untouched space past the last record.
+		if (bodyLength == 0)
+			break;
+
+		const uint8_t* body = data + pos + lengthLength;
+		const size_t recordLength = lengthLength + bodyLength + crcLength;
+
+		if (recordLength > capacity - pos
+		    || !bodyIsConsistent(body, bodyLength)
+		    || CRC::ccitt(data + pos, lengthLength + bodyLength) != BinaryMessage::extractUInt16(body + bodyLength)) {
+			// A torn or corrupt record. Clear it and everything past it
+			// so that nothing after it can be mistaken for a record once we start appending over it.
+			memset(data + pos, 0, capacity - pos);
+
+			const size_t from = pos - pos % pageSize();
+			ENFORCE(IOException, msync(data + from, capacity - from, MS_SYNC) == 0,
+			        string("Could not clear a torn record from the match history: ") + strerror(errno));
+			break;
+		}
+
+		records.emplace_back(pos, extractDate(body));
+		index(records.size() - 1);
+		pos += recordLength;
+	}
+
+	end = pos;
+	syncedTo = pos;
+}
+
+void MatchHistory::index(size_t recordIndex)
+{
+	const time_t date = records[recordIndex].date;
+	const auto after = [this](time_t d, size_t r) { return d < records[r].date; };
+
+	// Games almost always end in order, so this is almost always an append.
+	byDate.insert(upper_bound(begin(byDate), std::end(byDate), date, after), recordIndex);
+
+	const MatchView game = view(recordIndex);
+	const auto playerCount = (size_t)game.getPlayerCount();
+	if (byPlayer.size() < playerCount)
+		byPlayer.resize(playerCount);
+
+	for (size_t p = 0; p < playerCount; ++p) {
+		if (game.getShotCount((board_id_t)p) == 0)
+			continue;
+
+		auto& games = byPlayer[p];
+		games.insert(upper_bound(begin(games), std::end(games), date, after), recordIndex);
+	}
+}
+
+template <typename It>
+std::vector<MatchHistory::MatchView> MatchHistory::newestFirst(It first, It last, size_t n) const
+{
+	n = min(n, (size_t)(last - first));
+
+	vector<MatchView> ret;
+	ret.reserve(n);
+	for (auto it = last; it != last - (ptrdiff_t)n;)
+		ret.emplace_back(view(*--it));
+
+	return ret;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "GameTypes.hpp"
+#include "PlayerStatistics.hpp"
+#include "ResultsResponseMessage.hpp"
+#include "Shot.hpp"
+
+/**
+ * \brief A persistent record of every game played, kept in a memory-mapped append-only log
+ *
+ * Each game is appended as one binary record (big-endian, like binary messages):
+ *
+ * - The length of the rest of the record, excluding its CRC (32 bits)
+ * - The date the game ended, in seconds since the epoch (64 bits)
+ * - The game type and player count (8 bits each)
+ * - For each player, their score and hits (16 bits each), their ShotStatistics,
+ *   and how many shots they took (16 bits)
+ * - Each player's shots in turn, as written by Shot::writeBinary
+ * - A CRC-16-CCITT of everything above
+ *
+ * The per-player summaries come before the shots so that leaderboards can be read
+ * without touching (or decoding) any shots.
+ *
+ * A record only counts once its CRC checks out, so if the process dies partway through an append,
+ * the torn record is ignored (and later overwritten) the next time the history is opened.
+ * Appends are flushed to disk in batches (see the constructor) or whenever sync is called.
+ *
+ * The history keeps an index of its records by date and by player in memory,
+ * which it rebuilds when it is opened.
+ *
+ * Games can be appended from several threads at once (say, one per lane; see runLanes),
+ * but queries must not overlap appends, since an append can move the mapping out from under them.
+ */
+class MatchHistory {
+
+public:
+
+	/**
+	 * \brief A view of one game in the history, decoded from the mapped file as fields are asked for
+	 *
+	 * \warning Views point straight into the mapping, so they are invalidated by the next append.
+	 */
+	class MatchView {
+
+	public:
+
+		/// Gets the date the game ended, in seconds since the epoch
+		time_t getDate() const;
+
+		GameType getGameType() const { return (GameType)record[dateOffset + 8]; }
+
+		board_id_t getPlayerCount() const { return (board_id_t)record[dateOffset + 9]; }
+
+		score_t getScore(board_id_t player) const;
+
+		shot_t getHits(board_id_t player) const;
+
+		ShotStatistics getStatistics(board_id_t player) const;
+
+		/// Gets the number of shots a player took
+		size_t getShotCount(board_id_t player) const;
+
+		/// Decodes a player's shots, in the order they were taken
+		std::vector<Shot> getShots(board_id_t player) const;
+
+	private:
+
+		friend class MatchHistory;
+
+		explicit MatchView(const uint8_t* r) : record(r) { }
+
+		/// Gets a pointer to a player's summary, checking that the player was in the game
+		const uint8_t* summaryOf(board_id_t player) const;
+
+		/// Where the date starts, after the record's length
+		static const size_t dateOffset = 4;
+
+		const uint8_t* record;
+	};
+
+	/// One player's score in one game, as ranked by leaderboard
+	struct LeaderboardEntry {
+		time_t date; ///< The date the game ended
+		board_id_t player;
+		score_t score;
+		shot_t hits;
+
+		LeaderboardEntry(time_t d, board_id_t p, score_t s, shot_t h) : date(d), player(p), score(s), hits(h) { }
+	};
+
+	/**
+	 * \brief Opens (or creates) a match history file
+	 * \param path The file to keep the history in
+	 * \param syncEvery The number of appends between flushes to disk.
+	 *                  1 flushes every game as it is appended. Higher values trade durability
+	 *                  of the last few games for fewer flushes.
+	 * \throws Exceptions::IOException if the file cannot be opened or is not a match history
+	 */
+	explicit MatchHistory(const std::string& path, size_t syncEvery = 1);
+
+	/// Flushes any outstanding appends and closes the file
+	~MatchHistory();
+
+	/**
+	 * \brief Appends a finished game to the history
+	 * \param type The type of game played
+	 * \param date The date the game ended, in seconds since the epoch
+	 * \param stats The game's results, as given by GameStateMachine::getResultsResponse
+	 * \throws Exceptions::IOException if the file cannot be grown or flushed
+	 */
+	void append(GameType type, time_t date, const ResultsResponseMessage::StatsList& stats);
+
+	/// Flushes all appends to disk
+	void sync();
+
+	/// Gets the number of games in the history
+	size_t size() const { return records.size(); }
+
+	/// Gets the number of appends that haven't been flushed to disk yet
+	size_t unsynced() const { return pendingSyncs; }
+
+	/// Gets up to the `n` most recent games, newest first
+	std::vector<MatchView> lastGames(size_t n) const;
+
+	/// Gets up to the `n` most recent games in which a player took a shot, newest first
+	std::vector<MatchView> lastGamesFor(board_id_t player, size_t n) const;
+
+	/// Gets the games that ended in [from, to), oldest first
+	std::vector<MatchView> gamesBetween(time_t from, time_t to) const;
+
+	/**
+	 * \brief Gets the `n` highest scores in games that ended at or after `since`, highest first
+	 *
+	 * Ties go to the earlier game. Only the players' summaries are read.
+	 */
+	std::vector<LeaderboardEntry> leaderboard(size_t n, time_t since = 0) const;
+
+private:
+
+	/// Where a game's record is in the file, and when the game ended
+	struct Record {
+		size_t offset;
+		time_t date;
+
+		Record(size_t o, time_t d) : offset(o), date(d) { }
+	};
+
+	/// Maps the file with at least the given capacity, growing the file if needed.
+	/// If that fails, the old mapping (if any) is left as it was.
+	void map(size_t capacity);
+
+	void unmap();
+
+	/// Reads the records that are already in the file, stopping at the first one that is torn or corrupt
+	void scan();
+
+	/// Adds the record at the given index of `records` to the date and player indexes
+	void index(size_t recordIndex);
+
+	/// Flushes all appends to disk. The caller must hold appendMutex.
+	void flush();
+
+	MatchView view(size_t recordIndex) const { return MatchView(data + records[recordIndex].offset); }
+
+	/// Converts a range of indexes into `records` (oldest first) into views, newest first
+	template <typename It>
+	std::vector<MatchView> newestFirst(It first, It last, size_t n) const;
+
+	// Disallow copy and assign
+	MatchHistory(const MatchHistory&) = delete;
+	MatchHistory& operator=(const MatchHistory&) = delete;
+
+	int fd;
+
+	uint8_t* data;
+
+	/// The size of the file (and the mapping)
+	size_t capacity;
+
+	/// Where the next record goes
+	size_t end;
+
+	/// Where the first unflushed byte is
+	size_t syncedTo;
+
+	const size_t syncInterval;
+
+	size_t pendingSyncs;
+
+	/// Set when the file grows, so that the next sync flushes its new size too
+	bool resized;
+
+	/// Every record, in the order they were appended
+	std::vector<Record> records;
+
+	/// Indexes into `records`, sorted by date
+	std::vector<size_t> byDate;
+
+	/// For each player, indexes into `records` of the games in which they took a shot, sorted by date
+	std::vector<std::vector<size_t>> byPlayer;
+
+	/// Held while appending or flushing
+	std::mutex appendMutex;
+};
@@ -1,9 +1,13 @@
 #include "Message.hpp"
 
 #include <cassert>
+#include <limits>
 
 #include "Exceptions.hpp"
+#include "JSONReader.hpp"
+#include "JSONWriter.hpp"
 #include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "ResponseMessage.hpp"
 #include "QueryMessage.hpp"
 #include "SetupMessage.hpp"
@@ -17,6 +21,8 @@
 #include "TargetControlMessage.hpp"
 #include "ExitMessage.hpp"
 #include "TestMessage.hpp"
+#include "SubscribeMessage.hpp"
+#include "EventMessage.hpp"
 
 using namespace Exceptions;
 
@@ -29,6 +35,7 @@ namespace {
 #ifdef WITH_JSON
 // Using StaticString allows JSONCPP to make some optimzations because it knows the strings are static.
 const StaticString idKey("id");
+const StaticString laneKey("lane");
 #endif
 
 } // end anonymous namespace
@@ -52,7 +59,9 @@ const std::unordered_map<Message::Type, std::string> Message::nameLookup = {
 	{Message::Type::MOVEMENT, "movement"},
 	{Message::Type::TARGET_CONTROL, "target control"},
 	{Message::Type::EXIT, "exit"},
-	{Message::Type::TEST, "test"}
+	{Message::Type::TEST, "test"},
+	{Message::Type::SUBSCRIBE, "subscribe"},
+	{Message::Type::EVENT, "event"}
 	// {Message::Type::UNKNOWN, "unknown"}
 };
 
@@ -71,14 +80,17 @@ const std::unordered_map<std::string, Message::Type> Message::typeLookup = {
 	{"movement", Message::Type::MOVEMENT},
 	{"target control", Message::Type::TARGET_CONTROL},
 	{"exit", Message::Type::EXIT},
-	{"test", Message::Type::TEST}
+	{"test", Message::Type::TEST},
+	{"subscribe", Message::Type::SUBSCRIBE},
+	{"event", Message::Type::EVENT}
 	// {"unknown", Message::Type::UNKNOWN}
 };
 
 
 
 Message::Message(message_id_t idNum) :
-	id(idNum)
+	id(idNum),
+	lane(0)
 {
 }
 
@@ -100,37 +112,97 @@ Json::Value Message::toJSON() const
 	Value ret(objectValue);
 	ret[idKey] = id;
 	ret[typeKey] = nameLookup.at(getType());
+	if (lane != 0)
+		ret[laneKey] = lane;
 	return ret;
 }
+
+void Message::writeJSON(JSONWriter& writer) const
+{
+	writer.beginObject();
+	writeJSONFields(writer);
+	writer.endObject();
+}
+
+void Message::writeJSONFields(JSONWriter& writer) const
+{
+	writer.key(idKey.c_str());
+	writer.value(id);
+	writer.key(typeKey.c_str());
+	writer.value(nameLookup.at(getType()));
+	if (lane != 0) {
+		writer.key(laneKey.c_str());
+		writer.value(lane);
+	}
+}
 #endif
 
 std::unique_ptr<Message> Message::fromBinary(uint8_t* buf, size_t len)
 {
-	using namespace BinaryMessage;
-	ENFORCE(IOException, isValidMessage(buf, len), "Message is not valid");
-	return std::unique_ptr<Message>(new Message(getID(buf)));
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<Message> Message::fromBinary(const BinaryMessage::MessageView& view)
+{
+	return std::unique_ptr<Message>(new Message(view.getID()));
 }
 
 std::vector<uint8_t> Message::toBinary() const
 {
-	// Send a binary message with whatever payload is needed
-	auto payload = getBinaryPayload();
-	return BinaryMessage::makeMessage(getType(), id, begin(payload), end(payload));
+	// Size the buffer once and serialize straight into it
+	std::vector<uint8_t> ret(getBinaryLength());
+	toBinary(ret.data(), ret.size());
+	return ret;
+}
+
+size_t Message::toBinary(uint8_t* buf, size_t len) const
+{
+	using namespace BinaryMessage;
+
+	const size_t payloadLength = getBinaryPayloadLength();
+	ENFORCE(ArgumentOutOfRangeException, payloadLength + frameOverhead <= len,
+	        "The buffer is too small to hold the message.");
+
+	// Write the payload in place, then wrap the header and CRC around it.
+	writeBinaryPayload(buf + payloadOffset);
+	return finishMessage(buf, getType(), id, payloadLength);
+}
+
+size_t Message::getBinaryLength() const
+{
+	return getBinaryPayloadLength() + BinaryMessage::frameOverhead;
 }
 
 std::vector<uint8_t> Message::getBinaryPayload() const
 {
-	// An empty message has no payload.
-	return vector<uint8_t>();
+	std::vector<uint8_t> ret(getBinaryPayloadLength());
+	writeBinaryPayload(ret.data());
+	return ret;
 }
 
 bool Message::operator==(const Message& o) const
 {
-	return id == o.id;
+	return id == o.id && lane == o.lane;
 }
 
 #ifdef WITH_JSON
-std::unique_ptr<Message> JSONToMessage(const Json::Value& object)
+namespace {
+
+/// Reads a message's lane, which is optional, from its JSON object
+lane_id_t laneFromJSON(const Json::Value& object)
+{
+	if (!object.isMember(laneKey))
+		return 0;
+
+	const Value& laneValue = object[laneKey];
+	ENFORCE(IOException, laneValue.isInt(), "The message's lane is not an integer.");
+	const int rawLane = laneValue.asInt();
+	ENFORCE(IOException, rawLane >= 0 && rawLane <= UINT8_MAX, "The message's lane is out of range.");
+	return (lane_id_t)rawLane;
+}
+
+/// Deserializes everything but the lane of a message from a JSON object
+std::unique_ptr<Message> messageFromJSON(const Json::Value& object)
 {
 	using Type = Message::Type;
 
@@ -190,56 +262,628 @@ std::unique_ptr<Message> JSONToMessage(const Json::Value& object)
 		case Type::TEST:
 			return TestMessage::fromJSON(object);
 
+		case Type::SUBSCRIBE:
+			return SubscribeMessage::fromJSON(object);
+
+		case Type::EVENT:
+			return EventMessage::fromJSON(object);
+
 		default:
 			assert(false);
 	}
 }
-#endif
 
-std::unique_ptr<Message> binaryToMessage(uint8_t* buf, size_t len)
+} // end anonymous namespace
+
+std::unique_ptr<Message> JSONToMessage(const Json::Value& object)
+{
+	auto ret = messageFromJSON(object);
+	ret->lane = laneFromJSON(object);
+	return ret;
+}
+
+namespace {
+
+typedef JSONReader::Token Token;
+
+int readIntField(JSONReader& reader, const char* notAnInt)
+{
+	ENFORCE(IOException, reader.peek() == Token::NUMBER, notAnInt);
+	return reader.readInt();
+}
+
+void readStringField(JSONReader& reader, std::string& out, const char* notAString)
+{
+	ENFORCE(IOException, reader.peek() == Token::STRING, notAString);
+	reader.readString(out);
+}
+
+/**
+ * \brief Everything a JSON message might contain, filled in as a JSONReader walks the message's object
+ *
+ * Members can come in any order (jsoncpp, for one, sorts them, which puts the type last),
+ * so readType() first looks for the type alone, then read() collects only the members that type uses.
+ * Like the fromJSON functions, a message type ignores members it has no use for, whatever their values.
+ * One of these is kept per thread so that its strings and lists hold on to their capacity.
+ */
+struct JSONFields {
+
+	/// Bits in `present`, one per top-level member
+	enum Field : uint32_t {
+		ID = 1 << 0,
+		RESPONDING_TO = 1 << 1,
+		CODE = 1 << 2,
+		MESSAGE = 1 << 3,
+		BOARD_ID = 1 << 4,
+		BOARD_TYPE = 1 << 5,
+		GAME_TYPE = 1 << 6,
+		PLAYER_COUNT = 1 << 7,
+		GAME_LENGTH = 1 << 8,
+		WINNING_SCORE = 1 << 9,
+		GAME_DATA = 1 << 10,
+		RUNNING = 1 << 11,
+		TIME_REMAINING = 1 << 12,
+		PLAYER_STATS = 1 << 13,
+		SHOT = 1 << 14,
+		COMMANDS = 1 << 15,
+		EVENT = 1 << 16,
+		EVENTS = 1 << 17,
+		PLAYER = 1 << 18,
+		TARGET = 1 << 19,
+		SCORE = 1 << 20,
+		HITS = 1 << 21,
+		TIME = 1 << 22,
+		LANE = 1 << 23
+	};
+
+	/// A player's stats from a status or results response
+	struct Stats {
+		bool hasScore;
+		bool hasHits;
+		bool hasShots;
+		int score;
+		int hits;
+		std::vector<Shot> shots;
+		ShotStatistics statistics;
+
+		Stats() : hasScore(false), hasHits(false), hasShots(false), score(0), hits(0), shots(), statistics() { }
+	};
+
+	uint32_t present;
+
+	/// The members read() collects for the message's type
+	uint32_t wanted;
+
+	int id;
+	std::string type;
+	int respondingTo;
+	std::string code;
+	std::string message;
+	int boardID;
+	std::string boardType;
+	int gameType;
+	int playerCount;
+	int gameLength;
+	int winningScore;
+	SetupMessage::DataMap gameData;
+	bool running;
+	int timeRemaining;
+	std::vector<Stats> stats;
+	std::vector<Shot> shot; // Shot has no default constructor, so this holds zero or one.
+	TargetControlMessage::CommandList commands;
+	std::string event;
+	GameEvent::KindMask events;
+	int player;
+	int target;
+	int score;
+	int hits;
+	int time;
+	int lane;
+
+	JSONFields() :
+		present(0), wanted(0), id(0), type(), respondingTo(0), code(), message(), boardID(0), boardType(),
+		gameType(0), playerCount(0), gameLength(0), winningScore(0), gameData(), running(false),
+		timeRemaining(0), stats(), shot(), commands(), event(), events(0),
+		player(0), target(0), score(0), hits(0), time(0), lane(0)
+	{ }
+
+	bool has(Field f) const { return (present & f) != 0; }
+
+	/// Finds the message's type without validating any other member
+	Message::Type readType(const char* json, size_t len);
+
+	void read(JSONReader& reader, Message::Type t);
+
+	std::unique_ptr<Message> build(Message::Type t);
+
+private:
+
+	static uint32_t fieldsFor(Message::Type t);
+
+	bool wants(const JSONReader& reader, const char* key, Field f) const
+	{
+		return (wanted & f) != 0 && reader.isKey(key);
+	}
+
+	void readStats(JSONReader& reader);
+
+	void readEvents(JSONReader& reader);
+
+	void require(Field f, const char* missing) const { ENFORCE(IOException, has(f), missing); }
+
+	message_id_t getID() const;
+
+	message_id_t getRespondingTo() const;
+};
+
+Message::Type JSONFields::readType(const char* json, size_t len)
+{
+	JSONReader reader(json, len);
+
+	ENFORCE(IOException, reader.peek() == Token::OBJECT, "The JSON value is not an object");
+
+	reader.beginObject();
+	while (reader.nextMember()) {
+		if (reader.isKey("type")) {
+			readStringField(reader, type, "The JSON object's type field is not a string");
+
+			auto it = Message::typeLookup.find(type);
+			ENFORCE(IOException, it != end(Message::typeLookup), "The JSON object's type field is unknown");
+			return it->second;
+		}
+		reader.skipValue();
+	}
+
+	THROW(IOException, "JSON object has no type field");
+}
+
+uint32_t JSONFields::fieldsFor(Message::Type t)
+{
+	using Type = Message::Type;
+
+	const uint32_t common = ID | LANE;
+
+	switch (t) {
+		case Type::RESPONSE:
+			return common | RESPONDING_TO | CODE | MESSAGE;
+
+		case Type::STATUS_RESPONSE:
+			return common | RESPONDING_TO | CODE | MESSAGE | RUNNING | TIME_REMAINING | WINNING_SCORE | PLAYER_STATS;
+
+		case Type::RESULTS_RESPONSE:
+			return common | RESPONDING_TO | CODE | MESSAGE | PLAYER_STATS;
+
+		case Type::QUERY:
+			return common | BOARD_ID | BOARD_TYPE;
+
+		case Type::SETUP:
+			return common | GAME_TYPE | PLAYER_COUNT | GAME_LENGTH | WINNING_SCORE | GAME_DATA;
+
+		case Type::SHOT:
+			return common | SHOT;
+
+		case Type::TARGET_CONTROL:
+			return common | COMMANDS;
+
+		case Type::SUBSCRIBE:
+			return common | EVENTS;
+
+		case Type::EVENT:
+			return common | EVENT | PLAYER | TARGET | SCORE | HITS | TIME;
+
+		default:
+			return common;
+	}
+}
+
+void JSONFields::read(JSONReader& reader, Message::Type t)
+{
+	present = 0;
+	wanted = fieldsFor(t);
+
+	ENFORCE(IOException, reader.peek() == Token::OBJECT, "The JSON value is not an object");
+
+	reader.beginObject();
+	while (reader.nextMember()) {
+		if (wants(reader, "id", ID)) {
+			id = readIntField(reader, "The message's ID field is not an integer.");
+			present |= ID;
+		}
+		else if (wants(reader, "responding to", RESPONDING_TO)) {
+			respondingTo = readIntField(reader, "The response ID is not an integer.");
+			present |= RESPONDING_TO;
+		}
+		else if (wants(reader, "code", CODE)) {
+			readStringField(reader, code, "The response code is not a string.");
+			present |= CODE;
+		}
+		else if (wants(reader, "message", MESSAGE)) {
+			readStringField(reader, message, "The response message is not a string.");
+			present |= MESSAGE;
+		}
+		else if (wants(reader, "board ID", BOARD_ID)) {
+			boardID = readIntField(reader, "The board ID is not an integer.");
+			present |= BOARD_ID;
+		}
+		else if (wants(reader, "board type", BOARD_TYPE)) {
+			readStringField(reader, boardType, "The board type is not a string");
+			present |= BOARD_TYPE;
+		}
+		else if (wants(reader, "game type", GAME_TYPE)) {
+			gameType = readIntField(reader, "The game type is not an integer.");
+			present |= GAME_TYPE;
+		}
+		else if (wants(reader, "player count", PLAYER_COUNT)) {
+			playerCount = readIntField(reader, "The player count is not an integer.");
+			present |= PLAYER_COUNT;
+		}
+		else if (wants(reader, "game length", GAME_LENGTH)) {
+			gameLength = readIntField(reader, "The end time is not an integer.");
+			present |= GAME_LENGTH;
+		}
+		else if (wants(reader, "winning score", WINNING_SCORE)) {
+			winningScore = readIntField(reader, "The winning score is not an integer.");
+			present |= WINNING_SCORE;
+		}
+		else if (wants(reader, "game data", GAME_DATA)) {
+			ENFORCE(IOException, reader.peek() == Token::OBJECT, "The additional game data is not an object.");
+			gameData.clear();
+			reader.beginObject();
+			while (reader.nextMember()) {
+				std::string key = reader.getKey();
+				gameData[move(key)] =
+					readIntField(reader, "The game data contained a value that was not an integer.");
+			}
+			present |= GAME_DATA;
+		}
+		else if (wants(reader, "running", RUNNING)) {
+			ENFORCE(IOException, reader.peek() == Token::BOOLEAN, "The \"running\" flag is not a boolean.");
+			running = reader.readBool();
+			present |= RUNNING;
+		}
+		else if (wants(reader, "time remaining", TIME_REMAINING)) {
+			timeRemaining = readIntField(reader, "The time remaining value is not an integer.");
+			present |= TIME_REMAINING;
+		}
+		else if (wants(reader, "player stats", PLAYER_STATS)) {
+			readStats(reader);
+			present |= PLAYER_STATS;
+		}
+		else if (wants(reader, "shot", SHOT)) {
+			shot.clear();
+			shot.emplace_back(Shot::readJSON(reader));
+			present |= SHOT;
+		}
+		else if (wants(reader, "commands", COMMANDS)) {
+			ENFORCE(IOException, reader.peek() == Token::ARRAY, "The commands list is not an array.");
+			commands.clear();
+			reader.beginArray();
+			while (reader.nextElement())
+				commands.emplace_back(TargetCommand::readJSON(reader));
+			present |= COMMANDS;
+		}
+		else if (wants(reader, "event", EVENT)) {
+			readStringField(reader, event, "The event kind is not a string.");
+			present |= EVENT;
+		}
+		else if (wants(reader, "events", EVENTS)) {
+			readEvents(reader);
+			present |= EVENTS;
+		}
+		else if (wants(reader, "player", PLAYER)) {
+			player = readIntField(reader, "The event's player is not an integer.");
+			present |= PLAYER;
+		}
+		else if (wants(reader, "target", TARGET)) {
+			target = readIntField(reader, "The event's target is not an integer.");
+			present |= TARGET;
+		}
+		else if (wants(reader, "score", SCORE)) {
+			score = readIntField(reader, "The event's score is not an integer.");
+			present |= SCORE;
+		}
+		else if (wants(reader, "hits", HITS)) {
+			hits = readIntField(reader, "The event's hit count is not an integer.");
+			present |= HITS;
+		}
+		else if (wants(reader, "time", TIME)) {
+			time = readIntField(reader, "The event's time is not an integer.");
+			present |= TIME;
+		}
+		else if (wants(reader, "lane", LANE)) {
+			lane = readIntField(reader, "The message's lane is not an integer.");
+			ENFORCE(IOException, lane >= 0 && lane <= UINT8_MAX, "The message's lane is out of range.");
+			present |= LANE;
+		}
+		else {
+			reader.skipValue();
+		}
+	}
+}
+
+void JSONFields::readStats(JSONReader& reader)
+{
+	ENFORCE(IOException, reader.peek() == Token::ARRAY, "The player stats value is not an array.");
+
+	stats.clear();
+	reader.beginArray();
+	while (reader.nextElement()) {
+		ENFORCE(IOException, reader.peek() == Token::OBJECT, "An element of the player stats is not an object.");
+
+		stats.emplace_back();
+		Stats& stat = stats.back();
+
+		reader.beginObject();
+		while (reader.nextMember()) {
+			if (reader.isKey("score")) {
+				stat.score = readIntField(reader, "An element of the player stats does not have an integer score.");
+				stat.hasScore = true;
+			}
+			else if (reader.isKey("hits")) {
+				stat.hits = readIntField(reader, "An element of the player stats does not have an integer hits value.");
+				stat.hasHits = true;
+			}
+			else if (reader.isKey("shots")) {
+				ENFORCE(IOException, reader.peek() == Token::ARRAY, "A player's shot list is not an array.");
+				reader.beginArray();
+				while (reader.nextElement())
+					stat.shots.emplace_back(Shot::readJSON(reader));
+				stat.hasShots = true;
+			}
+			else if (!stat.statistics.readJSONMember(reader)) {
+				reader.skipValue();
+			}
+		}
+
+		ENFORCE(IOException, stat.hasScore, "An element of the player stats is missing the score.");
+		ENFORCE(IOException, stat.hasHits, "An element of the player stats is missing the hits value.");
+	}
+}
+
+void JSONFields::readEvents(JSONReader& reader)
+{
+	ENFORCE(IOException, reader.peek() == Token::ARRAY, "The subscribed events are not an array.");
+
+	events = 0;
+	std::string name;
+	reader.beginArray();
+	while (reader.nextElement()) {
+		readStringField(reader, name, "A subscribed event is not a string.");
+		events = (GameEvent::KindMask)(events | GameEvent::only(GameEvent::kindFromName(name)));
+	}
+}
+
+message_id_t JSONFields::getID() const
+{
+	require(ID, "The message contains no ID");
+	ENFORCE(IOException, id >= 0, "The message's ID must be positive");
+	return (message_id_t)id;
+}
+
+message_id_t JSONFields::getRespondingTo() const
+{
+	require(RESPONDING_TO, "Response payload is missing the response ID");
+	ENFORCE(IOException, respondingTo >= 0, "The response ID must be positive");
+	return (message_id_t)respondingTo;
+}
+
+std::unique_ptr<Message> JSONFields::build(Message::Type t)
 {
 	using Type = Message::Type;
 
-	// May be a duplicate, but hell, unless it's a performance concern, we'll take it.
-	// If we want to eliminate the duplicate, take a look at the fromBinary functions
-	ENFORCE(IOException, BinaryMessage::isValidMessage(buf, len), "Message is not valid");
+	const message_id_t msgID = getID();
+
+	switch (t) {
+
+		case Type::EMPTY:
+			return std::unique_ptr<Message>(new Message(msgID));
+
+		case Type::START:
+			return std::unique_ptr<Message>(new StartMessage(msgID));
 
-	auto type = BinaryMessage::getType(buf);
+		case Type::STOP:
+			return std::unique_ptr<Message>(new StopMessage(msgID));
+
+		case Type::STATUS:
+			return std::unique_ptr<Message>(new StatusMessage(msgID));
+
+		case Type::RESULTS:
+			return std::unique_ptr<Message>(new ResultsMessage(msgID));
+
+		case Type::EXIT:
+			return std::unique_ptr<Message>(new ExitMessage(msgID));
+
+		case Type::RESPONSE:
+		case Type::STATUS_RESPONSE:
+		case Type::RESULTS_RESPONSE: {
+			const message_id_t respID = getRespondingTo();
+			require(CODE, "Response payload is missing the code");
+			require(MESSAGE, "Response payload is missing the message");
+			const ResponseMessage::Code c = ResponseMessage::stringToCode(code);
+
+			if (t == Type::RESPONSE)
+				return std::unique_ptr<Message>(new ResponseMessage(msgID, respID, c, message));
+
+			if (t == Type::STATUS_RESPONSE) {
+				ENFORCE(IOException, c == ResponseMessage::Code::OK,
+				        "Full status response messages must have an OK response code.");
+				require(RUNNING, "Status response message is missing the \"running\" flag");
+				require(TIME_REMAINING, "Status response message has no time remaining");
+				require(WINNING_SCORE, "Status response message has no winning score");
+				require(PLAYER_STATS, "Status response message has no player statistics");
+
+				StatusResponseMessage::PlayerList players;
+				players.reserve(stats.size());
+				for (const auto& stat : stats)
+					players.emplace_back((score_t)stat.score, (shot_t)stat.hits, stat.statistics);
+
+				return std::unique_ptr<Message>(
+					new StatusResponseMessage(msgID, respID, message, running,
+					                          (duration_t)timeRemaining, (score_t)winningScore, move(players)));
+			}
+
+			ENFORCE(IOException, c == ResponseMessage::Code::OK,
+			        "Full results response payloads must have an OK response code.");
+			require(PLAYER_STATS, "Results response payload is missing player stats");
+
+			ResultsResponseMessage::StatsList results;
+			results.reserve(stats.size());
+			for (auto& stat : stats) {
+				ENFORCE(IOException, stat.hasShots, "A player results set is missing its shots list.");
+				results.emplace_back((score_t)stat.score, (shot_t)stat.hits, move(stat.shots), stat.statistics);
+			}
+
+			return std::unique_ptr<Message>(new ResultsResponseMessage(msgID, respID, message, move(results)));
+		}
+
+		case Type::QUERY: {
+			require(BOARD_ID, "Query payload is missing the board ID");
+			require(BOARD_TYPE, "Query payload is missing the board type");
+			ENFORCE(IOException, boardID >= 0, "The board ID cannot be negative");
+			ENFORCE(IOException, boardID <= std::numeric_limits<message_id_t>::max(),
+			        "The board ID has too high of a value");
+
+			QueryMessage::BoardType bt;
+			if (boardType == "target")
+				bt = QueryMessage::BoardType::TARGET;
+			else if (boardType == "gun")
+				bt = QueryMessage::BoardType::GUN;
+			else
+				THROW(IOException, "The board type is an unknown value.");
+
+			return std::unique_ptr<Message>(new QueryMessage(msgID, (board_id_t)boardID, bt));
+		}
+
+		case Type::SETUP:
+			require(GAME_TYPE, "Setup message is missing the game type");
+			require(PLAYER_COUNT, "Setup message is missing the player count");
+			require(GAME_LENGTH, "Setup message is missing the end time");
+			require(WINNING_SCORE, "Setup message is missing the winning score");
+			require(GAME_DATA, "Setup message is missing additional game data");
+
+			return std::unique_ptr<Message>(
+				new SetupMessage(msgID, (GameType)gameType, (board_id_t)playerCount,
+				                 (duration_t)gameLength, (score_t)winningScore, move(gameData)));
+
+		case Type::SHOT:
+			require(SHOT, "Shot message is missing its shot");
+			return std::unique_ptr<Message>(new ShotMessage(msgID, shot.front()));
 
+		case Type::TARGET_CONTROL:
+			require(COMMANDS, "Target control message is missing its commands");
+			return std::unique_ptr<Message>(new TargetControlMessage(msgID, move(commands)));
+
+		case Type::SUBSCRIBE:
+			require(EVENTS, "Subscribe message is missing its events");
+			return std::unique_ptr<Message>(new SubscribeMessage(msgID, events));
+
+		case Type::EVENT:
+			require(EVENT, "Event message is missing the event kind");
+			require(PLAYER, "Event message is missing the player");
+			require(TARGET, "Event message is missing the target");
+			require(SCORE, "Event message is missing the score");
+			require(HITS, "Event message is missing the hits");
+			require(TIME, "Event message is missing the time");
+
+			return std::unique_ptr<Message>(
+				new EventMessage(msgID, GameEvent(GameEvent::kindFromName(event), (board_id_t)player,
+				                                  (board_id_t)target, (score_t)score, (shot_t)hits, time)));
+
+		default:
+			THROW(IOException, "The JSON object's type field is unknown");
+	}
+}
+
+} // end anonymous namespace
+
+std::unique_ptr<Message> JSONToMessage(const char* json, size_t len)
+{
+	thread_local static JSONFields fields;
+
+	const Message::Type t = fields.readType(json, len);
+
+	// Test messages can hold anything at all, so leave them to jsoncpp.
+	if (t == Message::Type::TEST) {
+		thread_local static Json::Reader jsonReader;
+		Value val;
+		ENFORCE(IOException, jsonReader.parse(json, json + len, val), "Could not parse the test message");
+		return JSONToMessage(val);
+	}
+
+	JSONReader reader(json, len);
+	fields.read(reader, t);
+	reader.finish();
+
+	auto ret = fields.build(t);
+	if (fields.has(JSONFields::LANE))
+		ret->lane = (lane_id_t)fields.lane;
+	return ret;
+}
+#endif
+
+std::unique_ptr<Message> binaryToMessage(const uint8_t* buf, size_t len)
+{
+	return binaryToMessage(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<Message> binaryToMessage(const BinaryMessage::MessageView& view)
+{
 	using Type = Message::Type;
 
-	switch (type) {
+	// The view has already been validated, so the fromBinary functions can decode it directly.
+	switch (view.getType()) {
 
 		case Type::EMPTY:
-			return Message::fromBinary(buf, len);
+			return Message::fromBinary(view);
 
 		case Type::RESPONSE:
-			return ResponseMessage::fromBinary(buf, len);
+			return ResponseMessage::fromBinary(view);
 
 		case Type::QUERY:
-			return QueryMessage::fromBinary(buf, len);
+			return QueryMessage::fromBinary(view);
 
 		case Type::START:
-			return StartMessage::fromBinary(buf, len);
+			return StartMessage::fromBinary(view);
 
 		case Type::STOP:
-			return StopMessage::fromBinary(buf, len);
+			return StopMessage::fromBinary(view);
 
 		case Type::SHOT:
-			return ShotMessage::fromBinary(buf, len);
+			return ShotMessage::fromBinary(view);
 
 		case Type::TARGET_CONTROL:
-			return TargetControlMessage::fromBinary(buf, len);
+			return TargetControlMessage::fromBinary(view);
+
+		case Type::SETUP:
+			return SetupMessage::fromBinary(view);
 
-		// We don't have binary versions of these
 		case Type::STATUS:
+			return StatusMessage::fromBinary(view);
+
 		case Type::STATUS_RESPONSE:
+			return StatusResponseMessage::fromBinary(view);
+
 		case Type::RESULTS:
+			return ResultsMessage::fromBinary(view);
+
 		case Type::RESULTS_RESPONSE:
-		case Type::SETUP:
-		case Type::TEST:
+			return ResultsResponseMessage::fromBinary(view);
+
 		case Type::EXIT:
+			return ExitMessage::fromBinary(view);
+
+		case Type::SUBSCRIBE:
+			return SubscribeMessage::fromBinary(view);
+
+		case Type::EVENT:
+			return EventMessage::fromBinary(view);
+
+#ifdef WITH_JSON
+		case Type::TEST:
+			return TestMessage::fromBinary(view);
+#endif
+
 		default:
-			assert(false);
+			THROW(IOException, "This message type has no binary representation.");
 	}
 }
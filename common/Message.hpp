@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
@@ -10,6 +11,14 @@
 #endif
 
 #include "GameTypes.hpp"
+#include "MessagePool.hpp"
+
+namespace BinaryMessage {
+	class MessageView;
+}
+
+class JSONReader;
+class JSONWriter;
 
 /**
  * \brief A message to pass between entities.
@@ -44,6 +53,8 @@ public:
 		TARGET_CONTROL, ///< A message to set target lights on or off
 		EXIT, ///< The entity receiving this message should exit/finish
 		TEST, ///< A test payload that holds a string
+		SUBSCRIBE, ///< Subscribe to events pushed as they happen during a game
+		EVENT, ///< Something that happened during a game
 		UNKNOWN ///< An unknown/invalid payload type
 	};
 
@@ -56,6 +67,12 @@ public:
 
 	virtual ~Message() { }
 
+	/// Messages are allocated from recycling pools. \see MessagePool.hpp
+	static void* operator new(size_t size) { return MessagePool::allocate(size); }
+
+	/// Since the destructor is virtual, `size` is the size of the derived message being deleted.
+	static void operator delete(void* p, size_t size) { MessagePool::deallocate(p, size); }
+
 #ifdef WITH_JSON
 	/// Deserializes a message from a JSON object.
 	/// \warning Do not call this directly. Call JSONToMessage instead.
@@ -66,12 +83,29 @@ public:
 
 	/// Serializes a message to a JSON object
 	virtual Json::Value toJSON() const;
+
+	/**
+	 * \brief Serializes a message straight to JSON text, without building a Json::Value
+	 *
+	 * The text is the same object toJSON() would give, though its members may be in a different order.
+	 * \see JSONWriter
+	 */
+	void writeJSON(JSONWriter& writer) const;
+
+	/// Writes the message's members into the JSON object being written.
+	/// Messages with members of their own should override this, calling their base class's version first.
+	/// \warning Do not call this directly. Call writeJSON instead.
+	virtual void writeJSONFields(JSONWriter& writer) const;
 #endif
 
 	/// \brief Deserializes a message from a binary buffer
 	/// \warning Do not call this directly. Call binaryToMessage instead.
 	static std::unique_ptr<Message> fromBinary(uint8_t* buf, size_t len);
 
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<Message> fromBinary(const BinaryMessage::MessageView& view);
+
 	/**
 	 * \brief Returns a binary representation of a Message
 	 * \see BinaryMessage.hpp
@@ -79,16 +113,50 @@ public:
 	std::vector<uint8_t> toBinary() const;
 
 	/**
-	 * \brief Returns a binary representation of the message's payload
+	 * \brief Writes a binary representation of a Message into a caller-supplied buffer
+	 * \param buf The buffer to write the message into
+	 * \param len The length of the buffer
+	 * \returns The number of bytes written, i.e. getBinaryLength()
+	 * \throws Exceptions::ArgumentOutOfRangeException if the message does not fit in the buffer
+	 *
+	 * Unlike the vector-returning overload, this does not allocate,
+	 * so it can be used to serialize messages on a hot path.
+	 * \see BinaryMessage.hpp
+	 */
+	size_t toBinary(uint8_t* buf, size_t len) const;
+
+	/// Writes a binary representation of a Message into a fixed-size (e.g. stack) buffer
+	/// \see toBinary(uint8_t*, size_t)
+	template <size_t N>
+	size_t toBinary(std::array<uint8_t, N>& buf) const { return toBinary(buf.data(), N); }
+
+	/// Returns the length of the message's binary representation, including the header and checksum
+	size_t getBinaryLength() const;
+
+	/**
+	 * \brief Returns the length of the message's binary payload
 	 *
 	 * Since all binary representations of message differ only in type and payload,
 	 * toBinary is not a virtual method - it remains the same for all messages.
 	 * Messages derived from this base class should override this function
-	 * in order to fill messages with their unique message type's content.
+	 * and writeBinaryPayload in order to fill messages with their unique message type's content.
 	 *
-	 * A plain message has no payload, so this returns an empty vector.
+	 * A plain message has no payload, so this returns 0.
 	 */
-	virtual std::vector<uint8_t> getBinaryPayload() const;
+	virtual size_t getBinaryPayloadLength() const { return 0; }
+
+	/**
+	 * \brief Writes the message's binary payload to `buf`
+	 * \param buf The location to write the payload to,
+	 *            which must have room for getBinaryPayloadLength() bytes
+	 *
+	 * A plain message has no payload, so this writes nothing.
+	 */
+	virtual void writeBinaryPayload(uint8_t* buf) const { (void)buf; }
+
+	/// Returns a binary representation of the message's payload
+	/// \see writeBinaryPayload
+	std::vector<uint8_t> getBinaryPayload() const;
 
 	/**
 	 * \brief Gets the message's type
@@ -101,9 +169,21 @@ public:
 	 */
 	virtual Type getType() const { return Type::EMPTY; }
 
+	/// Returns a copy of the message, e.g. for sending the same message to more than one place
+	virtual std::unique_ptr<Message> clone() const { return std::unique_ptr<Message>(new Message(*this)); }
+
 	/// The message's type.
 	const message_id_t id;
 
+	/**
+	 * \brief The lane (see LaneMap) the message is for or came from
+	 *
+	 * This is routing information rather than content, so it can be changed as the message is passed along.
+	 * It is only carried in JSON, and only when it isn't lane 0, the one lane of a single-lane setup.
+	 * Binary messages come from and go to boards, and those belong to a lane already.
+	 */
+	lane_id_t lane;
+
 	/// Comparison operator.
 	/// Returns true iff the other message is the same type
 	/// with the same contenets.
@@ -122,7 +202,18 @@ namespace std
 #ifdef WITH_JSON
 /// Deserializes a JSON object into the correct message type and returns a pointer to it
 std::unique_ptr<Message> JSONToMessage(const Json::Value& object);
+
+/**
+ * \brief Deserializes JSON text into the correct message type and returns a pointer to it
+ * \throws Exceptions::IOException if the text is not a valid message
+ *
+ * This reads the text in a single pass with a JSONReader instead of parsing it into a Json::Value first.
+ */
+std::unique_ptr<Message> JSONToMessage(const char* json, size_t len);
 #endif
 
 /// Deserializes a binary representaiton into the correct message type and returns a pointer to it.
-std::unique_ptr<Message> binaryToMessage(uint8_t* buf, size_t len);
+std::unique_ptr<Message> binaryToMessage(const uint8_t* buf, size_t len);
+
+/// Deserializes a view of a binary message into the correct message type and returns a pointer to it.
+std::unique_ptr<Message> binaryToMessage(const BinaryMessage::MessageView& view);
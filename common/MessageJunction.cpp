@@ -1,70 +1,148 @@
 #include "MessageJunction.hpp"
-#include "MemoryUtils.hpp"
 
-#include "Exceptions.hpp"
-#include "ResponseMessage.hpp"
+#include <array>
 
-#include <chrono>
+#include "EventCount.hpp"
+#include "Exceptions.hpp"
 
 using namespace std;
-using namespace std::chrono;
 using namespace Exceptions;
 
-typedef std::chrono::steady_clock Clock;
+typedef MessageRouter::Endpoint Endpoint;
+
+namespace {
+
+/// The most messages we forward from one source before giving the others a turn
+const int quota = 16;
+
+/// Has a set of queues notify an EventCount for as long as it is in scope
+class ListenerScope {
+
+public:
+
+	ListenerScope(EventCount& events, MessageQueue& a, MessageQueue& b, MessageQueue& c) :
+		qa(a), qb(b), qc(c)
+	{
+		qa.setListener(&events);
+		qb.setListener(&events);
+		qc.setListener(&events);
+	}
+
+	~ListenerScope()
+	{
+		qa.setListener(nullptr);
+		qb.setListener(nullptr);
+		qc.setListener(nullptr);
+	}
+
+	ListenerScope(const ListenerScope&) = delete;
+	ListenerScope& operator=(const ListenerScope&) = delete;
+
+private:
+
+	MessageQueue& qa;
+	MessageQueue& qb;
+	MessageQueue& qc;
+};
+
+const char* endpointName(Endpoint e)
+{
+	switch (e) {
+		case Endpoint::STATE_MACHINE: return "the state machine";
+		case Endpoint::UI: return "the UI";
+		case Endpoint::SYSTEM: return "the system";
+	}
+	return "an unknown endpoint";
+}
+
+/**
+ * \brief Sends a message to each of the given destinations
+ *
+ * The message is copied for all but the last destination, which gets the original.
+ * \throws InvalidOperationException if there are no destinations
+ */
+void forward(std::unique_ptr<Message>&& msg, Endpoint from, MessageRouter::Destinations to,
+             const array<MessageQueue*, MessageRouter::endpointCount>& destinations)
+{
+	if (to == MessageRouter::nowhere) {
+		THROW(InvalidOperationException, "No route for a " + Message::nameLookup.at(msg->getType()) +
+		                                 " message from " + endpointName(from));
+	}
+
+	for (size_t i = 0; i < destinations.size(); ++i) {
+		const MessageRouter::Destinations here = MessageRouter::only((Endpoint)i);
+		if ((to & here) == 0)
+			continue;
+
+		to = (MessageRouter::Destinations)(to & ~here);
+
+		if (to == MessageRouter::nowhere) {
+			destinations[i]->send(move(msg));
+			return;
+		}
+
+		destinations[i]->send(msg->clone());
+	}
+}
+
+} // end anonymous namespace
 
 void runMessageJunction(MessageQueue& toSM, MessageQueue& fromSM,
                         MessageQueue& toUI, MessageQueue& fromUI,
                         MessageQueue& toSys, MessageQueue& fromSys)
 {
-	// Somewhat arbitrarily chosen, but currently 1/3 of the game state machine tick time.
-	static const auto timeSlice = milliseconds(33);
+	static const MessageRouter defaultRouter;
+	runRoutedMessageJunction(toSM, fromSM, toUI, fromUI, toSys, fromSys, defaultRouter);
+}
+
+void runRoutedMessageJunction(MessageQueue& toSM, MessageQueue& fromSM,
+                              MessageQueue& toUI, MessageQueue& fromUI,
+                              MessageQueue& toSys, MessageQueue& fromSys,
+                              const MessageRouter& router)
+{
+	// Indexed by MessageRouter::Endpoint
+	const array<MessageQueue*, MessageRouter::endpointCount> destinations = {{ &toSM, &toUI, &toSys }};
+	const array<MessageQueue*, MessageRouter::endpointCount> sources = {{ &fromSM, &fromUI, &fromSys }};
+
+	EventCount events;
+	ListenerScope scope(events, fromSM, fromUI, fromSys);
 
 	while (true) {
-		// Only spend a certain amount of time handling each source,
-		// so we don't starve another.
-		const auto start = Clock::now();
-		const auto stateMachineEnd = start + timeSlice;
-		const auto userInterfaceEnd = stateMachineEnd + timeSlice;
-		const auto systemEnd = userInterfaceEnd + timeSlice;
-
-		for (auto msg = fromSM.receiveUntil(stateMachineEnd);
-			msg != nullptr;
-			msg = fromSM.receiveUntil(stateMachineEnd)) {
-
-			// Try casting to a response.
-			// Responses from the state machine are going to the UI.
-			// Otherwise they are commands and go to the system
-			auto response = unique_dynamic_cast<ResponseMessage>(move(msg));
-
-			if (response != nullptr)
-				toUI.send(move(response));
-			else
-				toSys.send(move(msg));
-		}
+		bool forwarded = false;
+
+		for (size_t s = 0; s < sources.size(); ++s) {
+			const Endpoint from = (Endpoint)s;
 
-		for (auto msg = fromUI.receiveUntil(userInterfaceEnd);
-			msg != nullptr;
-			msg = fromUI.receiveUntil(stateMachineEnd)) {
+			for (int i = 0; i < quota; ++i) {
+				auto msg = sources[s]->tryReceive();
+				if (msg == nullptr)
+					break;
 
-			// Try casting to a response.
-			// Things shouldn't be sending messages to the UI,
-			// so it shouldn't be responding.
-			// Messages from the UI go to the state machine
-			auto response = unique_dynamic_cast<ResponseMessage>(move(msg));
+				forwarded = true;
 
-			if (response != nullptr)
-				THROW(InvalidOperationException, "Response from UI: " + response->message);
-			else
-				toSM.send(move(msg));
+				const Message::Type type = msg->getType();
+				forward(move(msg), from, router.getRoute(from, type), destinations);
+
+				// The state machine is shutting down. Once everyone else knows, call it a day.
+				if (from == Endpoint::STATE_MACHINE && type == Message::Type::EXIT)
+					return;
+			}
 		}
 
-		for (auto msg = fromSys.receiveUntil(systemEnd);
-			msg != nullptr;
-			msg = fromSys.receiveUntil(systemEnd)) {
+		// If anything is still waiting, go around again.
+		if (forwarded)
+			continue;
+
+		// Everything was empty. Sleep until one of our sources gets a message,
+		// checking once more after announcing we're about to sleep so we don't miss one.
+		const uint32_t key = events.prepareWait();
 
-			// Messages from the system go to the state machine.
-			// TODO: Make a copy and send it to the UI?
-			toSM.send(move(msg));
+		if (!fromSM.empty() || !fromUI.empty() || !fromSys.empty()) {
+			events.cancelWait();
+			continue;
 		}
+
+		events.wait(key);
 	}
 }
+
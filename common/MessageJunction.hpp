@@ -1,7 +1,34 @@
 #pragma once
 
 #include "MessageQueue.hpp"
+#include "MessageRouter.hpp"
 
+/**
+ * \brief Routes messages between the state machine, the UI, and the system (the hardware)
+ *
+ * Messages are routed with the default MessageRouter:
+ * messages from the UI and the system go to the state machine,
+ * responses from the state machine go to the UI, and everything else it sends goes to the system.
+ *
+ * The junction sleeps until any of its sources has a message and forwards it right away.
+ * Each source gets a quota of messages per turn so that a busy one can't starve the others.
+ *
+ * An ExitMessage from the state machine is passed on to the UI and the system,
+ * and then the junction returns.
+ */
 void runMessageJunction(MessageQueue& toSM, MessageQueue& fromSM,
                         MessageQueue& toUI, MessageQueue& fromUI,
                         MessageQueue& toSys, MessageQueue& fromSys);
+
+/**
+ * \brief Routes messages between the state machine, the UI, and the system using the given routes
+ * \param router Where to send each type of message from each sender.
+ *               It must outlive the junction and must not be changed while the junction runs.
+ * \throws Exceptions::InvalidOperationException if a message arrives that has no route
+ *
+ * Otherwise the same as runMessageJunction, which uses the default routes.
+ */
+void runRoutedMessageJunction(MessageQueue& toSM, MessageQueue& fromSM,
+                              MessageQueue& toUI, MessageQueue& fromUI,
+                              MessageQueue& toSys, MessageQueue& fromSys,
+                              const MessageRouter& router);
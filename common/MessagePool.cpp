@@ -0,0 +1,271 @@
+#include "MessagePool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace MessagePool {
+
+namespace {
+
+/// The difference in size between one size class and the next
+const size_t granularity = 16;
+
+/// The number of size classes
+const size_t classCount = maxPooledSize / granularity;
+
+/// How many blocks move between a thread's cache and the depot at once
+const size_t batchSize = 32;
+
+/// A thread gives a batch to the depot once its cache for a size class holds this many blocks
+const size_t cacheLimit = 2 * batchSize;
+
+/// A free block. Every size class is big enough to hold one.
+struct FreeBlock {
+	FreeBlock* next; ///< The next block in the list
+	FreeBlock* nextBatch; ///< In the depot, the first block of the next batch
+};
+
+static_assert(sizeof(FreeBlock) <= granularity, "Free blocks must fit in the smallest size class");
+
+size_t classOf(size_t size)
+{
+	return size == 0 ? 0 : (size - 1) / granularity;
+}
+
+/**
+ * \brief One thread's counters
+ *
+ * Only the thread they belong to writes them, so a count is a plain load and store
+ * instead of a locked read-modify-write on a cache line every thread fights over.
+ * They are still atomic since getStatistics reads them from other threads.
+ */
+struct Counters {
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> oversized;
+
+	Counters() : hits(0), misses(0), oversized(0) { }
+
+	Counters(const Counters&) = delete;
+	Counters& operator=(const Counters&) = delete;
+};
+
+void count(std::atomic<uint64_t>& counter)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void addTo(Statistics& sum, const Counters& c)
+{
+	sum.hits += c.hits.load(std::memory_order_relaxed);
+	sum.misses += c.misses.load(std::memory_order_relaxed);
+	sum.oversized += c.oversized.load(std::memory_order_relaxed);
+}
+
+/// Every live thread's counters, and the totals of the threads that have exited
+class Registry {
+
+public:
+
+	Registry() : lock(), live(), retired() { }
+
+	void add(const Counters* c)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		live.push_back(c);
+	}
+
+	/// Stops watching a thread's counters, keeping what they counted
+	void remove(const Counters* c)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		addTo(retired, *c);
+		live.erase(std::find(live.begin(), live.end(), c));
+	}
+
+	Statistics sum()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		Statistics ret = retired;
+		for (const Counters* c : live)
+			addTo(ret, *c);
+		return ret;
+	}
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+private:
+
+	std::mutex lock;
+
+	std::vector<const Counters*> live;
+
+	Statistics retired;
+};
+
+Registry& getRegistry()
+{
+	// Never destroyed, for the same reasons as the depot
+	static Registry* registry = new Registry;
+	return *registry;
+}
+
+/// Batches of free blocks shared by all threads
+class Depot {
+
+public:
+
+	Depot() : lock(), batches() { batches.fill(nullptr); }
+
+	/// Adds a list of free blocks as a batch
+	void push(size_t sizeClass, FreeBlock* batch)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		batch->nextBatch = batches[sizeClass];
+		batches[sizeClass] = batch;
+	}
+
+	/// Takes a batch of free blocks, or returns null if there are none
+	FreeBlock* pop(size_t sizeClass)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		FreeBlock* batch = batches[sizeClass];
+		if (batch != nullptr)
+			batches[sizeClass] = batch->nextBatch;
+		return batch;
+	}
+
+	Depot(const Depot&) = delete;
+	Depot& operator=(const Depot&) = delete;
+
+private:
+
+	std::mutex lock;
+
+	std::array<FreeBlock*, classCount> batches;
+};
+
+Depot& getDepot()
+{
+	// Never destroyed, since messages can be freed (and threads can exit) during static destruction.
+	static Depot* depot = new Depot;
+	return *depot;
+}
+
+/// A thread's free blocks
+class ThreadCache {
+
+public:
+
+	ThreadCache() : lists(), counters() { getRegistry().add(&counters); }
+
+	~ThreadCache()
+	{
+		for (size_t c = 0; c < classCount; ++c) {
+			if (lists[c].head != nullptr)
+				getDepot().push(c, lists[c].head);
+		}
+
+		getRegistry().remove(&counters);
+	}
+
+	void* allocate(size_t sizeClass)
+	{
+		List& list = lists[sizeClass];
+
+		if (list.head == nullptr) {
+			list.head = getDepot().pop(sizeClass);
+			for (const FreeBlock* b = list.head; b != nullptr; b = b->next)
+				++list.count;
+		}
+
+		FreeBlock* block = list.head;
+		if (block == nullptr) {
+			count(counters.misses);
+			return ::operator new((sizeClass + 1) * granularity);
+		}
+
+		count(counters.hits);
+		list.head = block->next;
+		--list.count;
+		return block;
+	}
+
+	void deallocate(void* p, size_t sizeClass)
+	{
+		List& list = lists[sizeClass];
+
+		FreeBlock* block = static_cast<FreeBlock*>(p);
+		block->next = list.head;
+		list.head = block;
+
+		if (++list.count < cacheLimit)
+			return;
+
+		// We have more than we're likely to need. Keep the most recently freed (and likely cached) blocks
+		// and hand the rest to the depot.
+		FreeBlock* last = list.head;
+		for (size_t i = 1; i < cacheLimit - batchSize; ++i)
+			last = last->next;
+
+		FreeBlock* batch = last->next;
+		last->next = nullptr;
+		list.count -= batchSize;
+		getDepot().push(sizeClass, batch);
+	}
+
+	void countOversized() { count(counters.oversized); }
+
+	ThreadCache(const ThreadCache&) = delete;
+	ThreadCache& operator=(const ThreadCache&) = delete;
+
+private:
+
+	struct List {
+		FreeBlock* head;
+		size_t count;
+
+		List() : head(nullptr), count(0) { }
+	};
+
+	std::array<List, classCount> lists;
+
+	Counters counters;
+};
+
+thread_local ThreadCache cache;
+
+} // end anonymous namespace
+
+void* allocate(size_t size)
+{
+	if (size > maxPooledSize) {
+		cache.countOversized();
+		return ::operator new(size);
+	}
+
+	return cache.allocate(classOf(size));
+}
+
+void deallocate(void* p, size_t size)
+{
+	if (p == nullptr)
+		return;
+
+	if (size > maxPooledSize)
+		::operator delete(p);
+	else
+		cache.deallocate(p, classOf(size));
+}
+
+Statistics getStatistics()
+{
+	return getRegistry().sum();
+}
+
+} // end namespace MessagePool
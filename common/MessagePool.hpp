@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Recycles the memory used by Message objects
+ *
+ * Messages are created on one thread (say, the state machine's) and destroyed on another
+ * (whoever receives them), many times a second during a match. Rather than going to the global
+ * allocator for each one, Message's operator new and operator delete come here.
+ *
+ * Memory is pooled in size classes of 16 bytes, up to maxPooledSize.
+ * Each thread keeps a small cache of free blocks for each class, so most allocations and frees
+ * touch no locks at all. When a thread frees more blocks than it needs (as a receiver does),
+ * it hands a batch of them to a shared depot, where a thread that allocates more than it frees
+ * (as a sender does) picks them back up. Once the pools have grown to hold the number of messages
+ * in flight, steady-state traffic makes no calls to the global allocator.
+ *
+ * Pooled memory is never given back to the global allocator. A thread's cache is returned
+ * to the depot when the thread exits.
+ */
+namespace MessagePool {
+
+/// The largest allocation that is pooled. Anything bigger goes straight to the global allocator.
+const size_t maxPooledSize = 128;
+
+/// Counters describing how well the pools are working
+struct Statistics {
+	uint64_t hits; ///< Allocations served from a pool
+	uint64_t misses; ///< Allocations that had to go to the global allocator because their pool was empty
+	uint64_t oversized; ///< Allocations bigger than maxPooledSize
+
+	Statistics() : hits(0), misses(0), oversized(0) { }
+};
+
+/**
+ * \brief Allocates memory for a message
+ * \param size The size of the message
+ * \throws std::bad_alloc if the pool is empty and the global allocator fails
+ */
+void* allocate(size_t size);
+
+/**
+ * \brief Returns memory from allocate to its pool
+ * \param p The memory to return. May be null.
+ * \param size The size passed to allocate
+ */
+void deallocate(void* p, size_t size);
+
+/**
+ * \brief Gets the counters for all pools, summed across all threads
+ *
+ * Each thread keeps its own counters so that counting costs allocations next to nothing,
+ * and they are only added up here. Threads that have exited still count.
+ */
+Statistics getStatistics();
+
+} // end namespace MessagePool
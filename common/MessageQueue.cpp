@@ -1,20 +1,63 @@
 #include "MessageQueue.hpp"
 
+#include <thread>
+
 #include "Exceptions.hpp"
 
 using namespace std;
 using namespace Exceptions;
 
+namespace {
+
+/// Priority messages are rare (e.g. telling a thread to exit), so they get a small ring.
+const size_t priorityCapacity = 64;
+
+} // end anonymous namespace
+
+const size_t MessageQueue::defaultCapacity;
+
+MessageQueue::MessageQueue(Backend backend, size_t capacity) :
+	q(),
+	qMutex(),
+	closed(false),
+	notifier(),
+	ring(),
+	priorityRing(),
+	ringEvents(),
+	listener(nullptr),
+	listenerUsers(0)
+{
+	if (backend == Backend::LOCK_FREE) {
+		ring.reset(new MPSCRingBuffer<Message*>(capacity));
+		priorityRing.reset(new MPSCRingBuffer<Message*>(priorityCapacity));
+	}
+}
+
+MessageQueue::~MessageQueue()
+{
+	// The rings hold raw pointers, so free anything left in them.
+	if (ring != nullptr) {
+		while (tryRingReceive() != nullptr) { }
+	}
+}
+
 void MessageQueue::send(std::unique_ptr<Message>&& toSend)
 {
 	ENFORCE(ArgumentException, toSend != nullptr, "You can not enqueue a null message.");
 	ENFORCE(InvalidOperationException, !closed, "The queue has been closed. You cannot send until it is reset.");
 
-	lock_guard<mutex> lock(qMutex);
-	q.emplace_back(std::move(toSend));
+	if (ring != nullptr) {
+		ringSend(*ring, std::move(toSend));
+	}
+	else {
+		lock_guard<mutex> lock(qMutex);
+		q.emplace_back(std::move(toSend));
+
+		// Notify anyone waiting for additional files that more have arrived
+		notifier.notify_one();
+	}
 
-	// Notify anyone waiting for additional files that more have arrived
-	notifier.notify_one();
+	notifyListener();
 }
 
 void MessageQueue::prioritySend(std::unique_ptr<Message>&& toSend)
@@ -22,21 +65,54 @@ void MessageQueue::prioritySend(std::unique_ptr<Message>&& toSend)
 	ENFORCE(ArgumentException, toSend != nullptr, "You can not enqueue a null message.");
 	ENFORCE(InvalidOperationException, !closed, "The queue has been closed. You cannot send until it is reset.");
 
-	lock_guard<mutex> lock(qMutex);
-	q.emplace_front(std::move(toSend));
+	if (ring != nullptr) {
+		ringSend(*priorityRing, std::move(toSend));
+	}
+	else {
+		lock_guard<mutex> lock(qMutex);
+		q.emplace_front(std::move(toSend));
+
+		// Notify anyone waiting for additional files that more have arrived
+		notifier.notify_one();
+	}
 
-	// Notify anyone waiting for additional files that more have arrived
-	notifier.notify_one();
+	notifyListener();
 }
 
 const Message* MessageQueue::peek()
 {
+	if (ring != nullptr) {
+		Message* top = nullptr;
+		if (!priorityRing->tryPeek(top))
+			ring->tryPeek(top);
+		return top;
+	}
+
 	unique_lock<mutex> lock(qMutex);
 	return q.front().get();
 }
 
 std::unique_ptr<Message> MessageQueue::receive()
 {
+	if (ring != nullptr) {
+		while (true) {
+			auto ret = tryRingReceive();
+			if (ret != nullptr)
+				return ret;
+
+			// See ringReceiveUntil
+			const uint32_t key = ringEvents.prepareWait();
+
+			ret = tryRingReceive();
+			if (ret != nullptr) {
+				ringEvents.cancelWait();
+				return ret;
+			}
+
+			ringEvents.wait(key);
+		}
+	}
+
 	// If we are not allowed to dequeue right now, just wait the expected time and return
 	unique_lock<mutex> lock(qMutex);
 	notifier.wait(lock, [this] { return !q.empty(); });
@@ -45,8 +121,25 @@ std::unique_ptr<Message> MessageQueue::receive()
 	return ret;
 }
 
+std::unique_ptr<Message> MessageQueue::tryReceive()
+{
+	if (ring != nullptr)
+		return tryRingReceive();
+
+	lock_guard<mutex> lock(qMutex);
+	if (q.empty())
+		return nullptr;
+
+	auto ret = std::move(q.front());
+	q.pop_front();
+	return ret;
+}
+
 bool MessageQueue::empty()
 {
+	if (ring != nullptr)
+		return priorityRing->empty() && ring->empty();
+
 	unique_lock<mutex> lock(qMutex);
 	return q.empty();
 }
@@ -58,7 +151,61 @@ void MessageQueue::close()
 
 void MessageQueue::reset()
 {
+	if (ring != nullptr) {
+		while (tryRingReceive() != nullptr) { }
+		closed = false;
+		return;
+	}
+
 	lock_guard<mutex> lock(qMutex);
 	q.clear();
 	closed = false;
 }
+
+void MessageQueue::setListener(EventCount* l)
+{
+	listener.store(l);
+
+	// Wait out anybody who might have grabbed the old listener before we swapped it out.
+	while (listenerUsers.load() != 0)
+		this_thread::yield();
+}
+
+void MessageQueue::notifyListener()
+{
+	// Most queues have no listener, so check without announcing ourselves first.
+	if (listener.load() == nullptr)
+		return;
+
+	// Announce ourselves before loading the listener for real so that setListener
+	// can't free it out from under us.
+	listenerUsers.fetch_add(1);
+
+	EventCount* l = listener.load();
+	if (l != nullptr)
+		l->notify();
+
+	listenerUsers.fetch_sub(1);
+}
+
+std::unique_ptr<Message> MessageQueue::tryRingReceive()
+{
+	Message* ret;
+
+	if (priorityRing->tryPop(ret) || ring->tryPop(ret))
+		return unique_ptr<Message>(ret);
+
+	return nullptr;
+}
+
+void MessageQueue::ringSend(MPSCRingBuffer<Message*>& r, std::unique_ptr<Message>&& toSend)
+{
+	// If the receiver has fallen behind, wait for it to make room.
+	while (!r.tryPush(toSend.get()))
+		this_thread::yield();
+
+	// The ring owns the message now.
+	toSend.release();
+
+	ringEvents.notify();
+}
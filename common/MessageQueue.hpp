@@ -7,14 +7,36 @@
 #include <mutex>
 #include <deque>
 
+#include "EventCount.hpp"
 #include "Message.hpp"
+#include "RingBuffer.hpp"
 
 /// A thread-safe message queue
 class MessageQueue {
 
 public:
 
-	MessageQueue() : q(), qMutex(), closed(false), notifier() { }
+	/// The data structure backing a queue, chosen at construction time
+	enum class Backend {
+		/// A mutex-protected deque. It is unbounded and any number of threads may receive from it.
+		LOCKING,
+		/// A bounded, lock-free ring buffer. Any number of threads may send,
+		/// but only one thread may receive (or peek, or reset).
+		/// Senders wait for room if the queue is full.
+		LOCK_FREE
+	};
+
+	/// The default capacity of a LOCK_FREE queue
+	static const size_t defaultCapacity = 1024;
+
+	/**
+	 * \brief Constructs a message queue
+	 * \param backend The data structure to back the queue with
+	 * \param capacity The maximum number of messages the queue holds. Ignored for LOCKING queues.
+	 */
+	explicit MessageQueue(Backend backend = Backend::LOCKING, size_t capacity = defaultCapacity);
+
+	~MessageQueue();
 
 	/**
 	 * \brief Places a message at the back of the queue
@@ -29,6 +51,10 @@ public:
 	 * \param toSend An rvalue unique_ptr of the message to send.
 	 *               An rvalue is used so that once sent,
 	 *               the message can no longer be modified in its current context.
+	 *
+	 * LOCK_FREE queues keep priority messages in a separate, smaller ring
+	 * that is drained before the main one, so priority messages are received
+	 * in the order they were sent instead of the most recent one first.
 	 */
 	void prioritySend(std::unique_ptr<Message>&& toSend);
 
@@ -38,6 +64,9 @@ public:
 	/// Dequeues a message, blocking indefinitely if the queue is empty
 	std::unique_ptr<Message> receive();
 
+	/// Dequeues a message if there is one, or returns nullptr immediately if the queue is empty
+	std::unique_ptr<Message> tryReceive();
+
 	/**
 	 * \brief Dequeues a message, blocking for the given timeout duration if the queue is empty
 	 * \param timeout The time interval, in milliseconds, to wait if the queue is empty
@@ -46,6 +75,9 @@ public:
 	template <typename Rep, typename Period>
 	std::unique_ptr<Message> receive(const std::chrono::duration<Rep, Period>& timeout)
 	{
+		if (ring != nullptr)
+			return ringReceiveUntil(std::chrono::steady_clock::now() + timeout);
+
 		// If we are not allowed to dequeue right now, just wait the expected time and return
 		std::unique_lock<std::mutex> lock(qMutex);
 		if (notifier.wait_for(lock, timeout, [this] { return !q.empty(); })) {
@@ -61,6 +93,9 @@ public:
 	template <typename Clock, typename Duration>
 	std::unique_ptr<Message> receiveUntil(const std::chrono::time_point<Clock, Duration>& time)
 	{
+		if (ring != nullptr)
+			return ringReceiveUntil(time);
+
 		std::unique_lock<std::mutex> lock(qMutex);
 		if (notifier.wait_until(lock, time, [this] { return !q.empty(); })) {
 			auto ret = std::move(q.front());
@@ -85,14 +120,71 @@ public:
 	/// Resets the queue - clears it and uncloses it
 	void reset();
 
+	/// Gets the data structure backing this queue
+	Backend getBackend() const { return ring != nullptr ? Backend::LOCK_FREE : Backend::LOCKING; }
+
+	/**
+	 * \brief Sets an EventCount to notify whenever a message is sent to this queue
+	 * \param l The EventCount to notify, or null to stop notifying one
+	 *
+	 * This lets one thread wait on several queues at once (see runMessageJunction).
+	 * Setting a new listener (or null) waits for any sender that is still notifying the old one,
+	 * so the old listener can be destroyed as soon as this returns.
+	 */
+	void setListener(EventCount* l);
+
 	// Disallow copy and assign
 	MessageQueue(const MessageQueue&) = delete;
 	MessageQueue& operator=(const MessageQueue&) = delete;
 
 private:
 
+	/// Pops a message from the priority ring, then the main ring, or returns null if both are empty
+	std::unique_ptr<Message> tryRingReceive();
+
+	/// Pushes a message into the given ring, waiting for room if it is full
+	void ringSend(MPSCRingBuffer<Message*>& r, std::unique_ptr<Message>&& toSend);
+
+	/// Lets the listener (if any) know that a message was sent
+	void notifyListener();
+
+	template <typename Clock, typename Duration>
+	std::unique_ptr<Message> ringReceiveUntil(const std::chrono::time_point<Clock, Duration>& time)
+	{
+		while (true) {
+			auto ret = tryRingReceive();
+			if (ret != nullptr)
+				return ret;
+
+			// Announce that we're about to sleep, then check again
+			// so that we don't miss a message sent in the meantime.
+			const uint32_t key = ringEvents.prepareWait();
+
+			ret = tryRingReceive();
+			if (ret != nullptr) {
+				ringEvents.cancelWait();
+				return ret;
+			}
+
+			if (!ringEvents.waitUntil(key, time))
+				return tryRingReceive();
+		}
+	}
+
 	std::deque<std::unique_ptr<Message>> q;
 	std::mutex qMutex;
 	std::atomic_bool closed;
 	std::condition_variable notifier;
+
+	/// Backs LOCK_FREE queues. Null for LOCKING ones.
+	std::unique_ptr<MPSCRingBuffer<Message*>> ring;
+	/// Holds priority messages for LOCK_FREE queues. Null for LOCKING ones.
+	std::unique_ptr<MPSCRingBuffer<Message*>> priorityRing;
+	/// Lets the receiver of a LOCK_FREE queue sleep while the queue is empty
+	EventCount ringEvents;
+
+	/// Notified on every send, if set. See setListener.
+	std::atomic<EventCount*> listener;
+	/// The number of senders currently notifying the listener
+	std::atomic<int> listenerUsers;
 };
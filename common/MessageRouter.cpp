@@ -0,0 +1,39 @@
+#include "MessageRouter.hpp"
+
+MessageRouter::MessageRouter() :
+	table()
+{
+	typedef Message::Type Type;
+
+	const Destinations sm = only(Endpoint::STATE_MACHINE);
+	const Destinations ui = only(Endpoint::UI);
+	const Destinations sys = only(Endpoint::SYSTEM);
+
+	// Responses from the state machine are going to the UI.
+	// Otherwise they are commands and go to the system.
+	setRoutes(Endpoint::STATE_MACHINE, sys);
+	setRoute(Endpoint::STATE_MACHINE, Type::RESPONSE, ui);
+	setRoute(Endpoint::STATE_MACHINE, Type::STATUS_RESPONSE, ui);
+	setRoute(Endpoint::STATE_MACHINE, Type::RESULTS_RESPONSE, ui);
+	setRoute(Endpoint::STATE_MACHINE, Type::EXIT, ui | sys);
+	// Game events are for live displays.
+	setRoute(Endpoint::STATE_MACHINE, Type::EVENT, ui);
+
+	// Messages from the UI go to the state machine.
+	// Things shouldn't be sending messages to the UI, so it shouldn't be responding.
+	setRoutes(Endpoint::UI, sm);
+	setRoute(Endpoint::UI, Type::RESPONSE, nowhere);
+	setRoute(Endpoint::UI, Type::STATUS_RESPONSE, nowhere);
+	setRoute(Endpoint::UI, Type::RESULTS_RESPONSE, nowhere);
+	// The UI's TCP server handles subscriptions itself, and the UI has no events to report.
+	setRoute(Endpoint::UI, Type::SUBSCRIBE, nowhere);
+	setRoute(Endpoint::UI, Type::EVENT, nowhere);
+
+	// Messages from the system go to the state machine.
+	setRoutes(Endpoint::SYSTEM, sm);
+}
+
+void MessageRouter::setRoutes(Endpoint from, Destinations to)
+{
+	table[(size_t)from].fill(to);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Message.hpp"
+
+/**
+ * \brief A table of where messages go, based on their type and who sent them
+ *
+ * The junction looks up each message it receives here instead of inspecting the message itself,
+ * so routing a message costs one array lookup.
+ * A route can name more than one destination, in which case the message is copied
+ * (see Message::clone) to all but the last of them.
+ * A route with no destinations means the message should never come from that sender.
+ *
+ * Routes are meant to be set up once, before the router is handed to the junction.
+ * Lookups are const and safe to make from any number of threads.
+ */
+class MessageRouter {
+
+public:
+
+	/// The parties the junction passes messages between
+	enum class Endpoint : uint8_t {
+		STATE_MACHINE, ///< The game state machine
+		UI, ///< The user interface
+		SYSTEM ///< The hardware (guns and targets)
+	};
+
+	/// The number of endpoints
+	static const size_t endpointCount = 3;
+
+	/// A set of endpoints, with one bit per Endpoint
+	typedef uint8_t Destinations;
+
+	/// No destinations. Messages routed here are rejected.
+	static const Destinations nowhere = 0;
+
+	/// Returns the set containing only the given endpoint
+	static Destinations only(Endpoint e) { return (Destinations)(1 << (int)e); }
+
+	/**
+	 * \brief Constructs a router with the default routes:
+	 *
+	 * - Messages from the UI and the system go to the state machine.
+	 * - Responses from the state machine go to the UI, and everything else it sends goes to the system.
+	 * - Exit messages from the state machine go to both.
+	 * - Game events from the state machine go to the UI.
+	 * - Responses from the UI are rejected, since nothing sends it anything to respond to.
+	 * - Subscriptions and events from the UI are rejected, since its TCP server handles subscriptions.
+	 */
+	MessageRouter();
+
+	/// Gets the destinations for a type of message from the given sender
+	Destinations getRoute(Endpoint from, Message::Type type) const
+	{
+		return table[(size_t)from][(size_t)type];
+	}
+
+	/// Replaces the destinations for a type of message from the given sender
+	void setRoute(Endpoint from, Message::Type type, Destinations to)
+	{
+		table[(size_t)from][(size_t)type] = to;
+	}
+
+	/// Adds a destination for a type of message from the given sender, keeping the existing ones
+	void addRoute(Endpoint from, Message::Type type, Endpoint to)
+	{
+		table[(size_t)from][(size_t)type] |= only(to);
+	}
+
+	/// Sends every type of message from the given sender to the given destinations
+	void setRoutes(Endpoint from, Destinations to);
+
+private:
+
+	/// The number of message types, which are numbered from 0 to UNKNOWN
+	static const size_t typeCount = (size_t)Message::Type::UNKNOWN + 1;
+
+	/// Destinations, indexed by sender and then by message type
+	std::array<std::array<Destinations, typeCount>, endpointCount> table;
+};
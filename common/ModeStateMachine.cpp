@@ -0,0 +1,212 @@
+#include "ModeStateMachine.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+
+#include "Exceptions.hpp"
+#include "ShotMessage.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+
+typedef GameModeSpec::Event Event;
+typedef GameModeSpec::Op Op;
+
+// In the same order as GameModeSpec::Op
+void (ModeStateMachine::* const ModeStateMachine::ops[])(const Action&) = {
+	&ModeStateMachine::pick,
+	&ModeStateMachine::light,
+	&ModeStateMachine::darken,
+	&ModeStateMachine::beginRound,
+	&ModeStateMachine::wait,
+	&ModeStateMachine::award
+};
+
+ModeStateMachine::ModeStateMachine(std::shared_ptr<const GameMode> m,
+                                   board_id_t numTargets, board_id_t numPlayers,
+                                   const std::chrono::seconds& gameDuration, score_t scoreToWin,
+                                   uint32_t seed) :
+	GameStateMachine(numTargets, numPlayers, gameDuration, scoreToWin),
+	mode(move(m)),
+	rng(seed),
+	state(0),
+	started(false),
+	timerSet(false),
+	timerEnd(),
+	roundStart(),
+	slots(),
+	lit(numTargets, 0),
+	progress(numPlayers),
+	winner(-1),
+	pending()
+{
+	static_assert(sizeof(ops) / sizeof(ops[0]) == (size_t)Op::COUNT, "Every game mode op needs a handler");
+
+	ENFORCE(ArgumentException, mode != nullptr, "A game needs a mode to play.");
+	slots.fill(-1);
+}
+
+std::unique_ptr<ResponseMessage> ModeStateMachine::onShot(uint16_t responseID, const ShotMessage& shot)
+{
+	const bool validPlayer = shot.shot.player >= 0 && (size_t)shot.shot.player < players.size();
+	const size_t shotsBefore = validPlayer ? shots.countFor(shot.shot.player) : 0;
+
+	auto msg = GameStateMachine::onShot(responseID, shot);
+
+	// If there was some error, don't touch this.
+	if (msg->code == ResponseMessage::Code::INVALID_REQUEST)
+		return msg;
+
+	// A shot we've already seen (say, a retransmission) shouldn't count toward a dump twice.
+	if (shots.countFor(shot.shot.player) == shotsBefore)
+		return msg;
+
+	if (gameState != State::RUNNING || !mode->isArmed(state) || shot.shot.target < 0)
+		return msg;
+
+	const auto& sequence = mode->getSequence();
+	Progress& p = progress[shot.shot.player];
+	if (p.step >= sequence.size())
+		return msg;
+
+	const auto& step = sequence[p.step];
+
+	if (slots[step.slot] != shot.shot.target || ++p.hits < step.hits)
+		return msg;
+
+	p.hits = 0;
+	if (++p.step < sequence.size())
+		return msg;
+
+	// They finished the sequence first, so the round is theirs.
+	// Anything the win turns off goes out on a tick right away (which also sees if somebody just won the game).
+	winner = shot.shot.player;
+	fire(Event::WON);
+	scheduleTick(now());
+	return msg;
+}
+
+std::unique_ptr<Message> ModeStateMachine::onTick(uint16_t messageID)
+{
+	// Run the base functionality.
+	auto msg = GameStateMachine::onTick(messageID);
+	assert(msg == nullptr);
+
+	if (gameState == State::RUNNING) {
+		if (!started) {
+			started = true;
+			fire(Event::START);
+		}
+		else if (timerSet && now() >= timerEnd) {
+			fire(Event::TIMER);
+		}
+	}
+
+	if (pending.empty())
+		return nullptr;
+
+	TargetControlMessage::CommandList toSend;
+	toSend.swap(pending);
+	return unique_ptr<Message>(new TargetControlMessage(messageID, move(toSend)));
+}
+
+void ModeStateMachine::resetGame()
+{
+	// The offs go out on the next tick, and keep `lit` in step with the targets
+	// even though the runner turns everything off itself when a game is stopped.
+	darken(Action(Op::DARKEN));
+	state = 0;
+	started = false;
+	timerSet = false;
+	slots.fill(-1);
+	fill(progress.begin(), progress.end(), Progress());
+}
+
+void ModeStateMachine::fire(GameMode::Event e)
+{
+	const auto& row = mode->transition(state, e);
+	if (row.to == GameMode::noState)
+		return;
+
+	// Only a WAIT in the transition sets the next state's timer.
+	timerSet = false;
+
+	const Action* a = mode->actionsOf(row);
+	for (const Action* end = a + row.actionCount; a != end; ++a)
+		(this->*ops[(size_t)a->op])(*a);
+
+	state = row.to;
+}
+
+void ModeStateMachine::setTarget(board_id_t target, bool on)
+{
+	if ((lit[target] != 0) == on)
+		return;
+
+	lit[target] = on;
+	pending.emplace_back(target, on);
+	postEvent(GameEvent::targetChanged(target, on, gameTime()));
+}
+
+void ModeStateMachine::pick(const Action& a)
+{
+	// Avoid the targets in the other slots, if there are enough targets to go around.
+	bitset<128> taken;
+	for (int i = 0; i < GameMode::maxSlots; ++i) {
+		if (i != a.slot && slots[i] >= 0)
+			taken.set((size_t)slots[i]);
+	}
+	const int freeCount = targetCount - (int)taken.count();
+
+	if (freeCount <= 0) {
+		slots[a.slot] = (board_id_t)uniform_int_distribution<int>(0, targetCount - 1)(rng);
+		return;
+	}
+
+	// Pick among the free targets, then find which one that is.
+	int choice = uniform_int_distribution<int>(0, freeCount - 1)(rng);
+	for (int t = 0; t < targetCount; ++t) {
+		if (!taken[(size_t)t] && choice-- == 0) {
+			slots[a.slot] = (board_id_t)t;
+			return;
+		}
+	}
+}
+
+void ModeStateMachine::light(const Action& a)
+{
+	if (slots[a.slot] >= 0)
+		setTarget(slots[a.slot], true);
+}
+
+void ModeStateMachine::darken(const Action&)
+{
+	for (int t = 0; t < targetCount; ++t)
+		setTarget((board_id_t)t, false);
+}
+
+void ModeStateMachine::beginRound(const Action&)
+{
+	slots.fill(-1);
+	fill(progress.begin(), progress.end(), Progress());
+	roundStart = now();
+}
+
+void ModeStateMachine::wait(const Action& a)
+{
+	timerSet = true;
+	timerEnd = now() + milliseconds(uniform_int_distribution<int32_t>(a.min, a.max)(rng));
+	scheduleTick(timerEnd);
+}
+
+void ModeStateMachine::award(const Action&)
+{
+	recordHit(winner, (timestamp_t)duration_cast<milliseconds>(now() - roundStart).count());
+	auto& roundWinner = players[winner];
+	// Score is something like the milliseconds left on the round's timer / 10, but at least 10.
+	const score_t score = (score_t)(duration_cast<milliseconds>(timerEnd - now()).count() / 10);
+	roundWinner.score = (score_t)(roundWinner.score + max((score_t)10, score));
+	postEvent(GameEvent::scoreChanged(winner, roundWinner.score, roundWinner.hits, gameTime()));
+}
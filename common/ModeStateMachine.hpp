@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <random>
+
+#include "GameMode.hpp"
+#include "GameStateMachine.hpp"
+#include "TargetControlMessage.hpp"
+
+/// A state machine that plays any game type described by a GameMode
+class ModeStateMachine : public GameStateMachine {
+
+public:
+
+	/**
+	 * \brief Constructs a state machine for the given game mode
+	 * \param mode The compiled mode to play. It is shared since it never changes once compiled.
+	 * \param numTargets The number of targets in the game
+	 * \param numPlayers The number of players playing the game.
+	 *                   The state machine does not make assumptions about how many players hardware supports,
+	 *                   so that should be checked elsewhere.
+	 * \param gameDuration The duration of the game, in seconds.
+	 *                     Pass std::chrono::seconds::max for infinite (ish) duration.
+	 * \param scoreToWin The winning score. Pass a negative value for no winning score
+	 * \param seed The seed for the random delays and targets.
+	 *             Games with the same seed (and the same shots at the same times) play out the same way.
+	 */
+	ModeStateMachine(std::shared_ptr<const GameMode> mode,
+	                 board_id_t numTargets, board_id_t numPlayers,
+	                 const std::chrono::seconds& gameDuration, score_t scoreToWin,
+	                 uint32_t seed = std::random_device()());
+
+	std::unique_ptr<ResponseMessage> onShot(uint16_t responseID, const ShotMessage& shot) override;
+
+	std::unique_ptr<Message> onTick(uint16_t messageID) override;
+
+protected:
+
+	/// Turns everything off and goes back to the state every game starts in
+	void resetGame() override;
+
+private:
+
+	typedef GameMode::Action Action;
+
+	/// How far a player has made it through the round's sequence
+	struct Progress {
+		uint16_t step;
+		uint16_t hits;
+
+		Progress() : step(0), hits(0) { }
+	};
+
+	/// Runs the mode's transition for the given event in the current state, if it has one
+	void fire(GameMode::Event e);
+
+	/// Turns a target on or off, unless it already is
+	void setTarget(board_id_t target, bool on);
+
+	void pick(const Action& a);
+
+	void light(const Action& a);
+
+	void darken(const Action& a);
+
+	void beginRound(const Action& a);
+
+	void wait(const Action& a);
+
+	void award(const Action& a);
+
+	/// The handler for each GameModeSpec::Op, indexed by op
+	static void (ModeStateMachine::* const ops[])(const Action&);
+
+	const std::shared_ptr<const GameMode> mode;
+
+	/// A pseusdo-random number generator for picking delays and targets
+	std::mt19937 rng;
+
+	uint8_t state;
+
+	/// Set once the mode has been sent Event::START for the current game
+	bool started;
+
+	/// Set if the current state has a timer running
+	bool timerSet;
+
+	/// When the current (or last) state's timer runs out
+	TimePoint timerEnd;
+
+	/// When the current round began, for scoring
+	TimePoint roundStart;
+
+	/// The target in each slot, or -1 if it has none
+	std::array<board_id_t, GameMode::maxSlots> slots;
+
+	/// Whether each target is on
+	std::vector<uint8_t> lit;
+
+	std::vector<Progress> progress;
+
+	/// The player who won the round, for Op::AWARD
+	board_id_t winner;
+
+	/// Target commands waiting for the next tick to send them
+	TargetControlMessage::CommandList pending;
+};
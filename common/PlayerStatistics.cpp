@@ -0,0 +1,296 @@
+#include "PlayerStatistics.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#include "BinaryMessage.hpp"
+#include "Exceptions.hpp"
+#include "JSONReader.hpp"
+#include "JSONWriter.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+#ifdef WITH_JSON
+using namespace Json;
+#endif
+
+namespace {
+
+#ifdef WITH_JSON
+const pair<StaticString, shot_t ShotStatistics::*> countMembers[] = {
+	{StaticString("shots fired"), &ShotStatistics::shotsFired},
+	{StaticString("misses"), &ShotStatistics::misses},
+	{StaticString("streak"), &ShotStatistics::streak},
+	{StaticString("longest streak"), &ShotStatistics::longestStreak}
+};
+
+const pair<StaticString, timestamp_t ShotStatistics::*> reactionMembers[] = {
+	{StaticString("fastest reaction"), &ShotStatistics::fastestReaction},
+	{StaticString("mean reaction"), &ShotStatistics::meanReaction},
+	{StaticString("median reaction"), &ShotStatistics::medianReaction},
+	{StaticString("90th percentile reaction"), &ShotStatistics::reaction90}
+};
+#endif
+
+} // end anonymous namespace
+
+P2Quantile::P2Quantile(double quantile) :
+	p(quantile),
+	n(0),
+	heights(),
+	positions(),
+	desired(),
+	increments()
+{
+	ENFORCE(ArgumentOutOfRangeException, p >= 0 && p <= 1, "The quantile must be between 0 and 1.");
+}
+
+void P2Quantile::add(double x)
+{
+	// Just collect the first five values.
+	if (n < 5) {
+		heights[n++] = x;
+
+		if (n == 5) {
+			sort(begin(heights), end(heights));
+			positions = {{1, 2, 3, 4, 5}};
+			desired = {{1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5}};
+			increments = {{0, p / 2, p, (1 + p) / 2, 1}};
+		}
+		return;
+	}
+
+	++n;
+
+	// Find the cell the value falls in, stretching the end markers if it's a new extreme.
+	size_t k;
+	if (x < heights[0]) {
+		heights[0] = x;
+		k = 0;
+	}
+	else if (x >= heights[4]) {
+		heights[4] = x;
+		k = 3;
+	}
+	else {
+		k = 0;
+		while (x >= heights[k + 1])
+			++k;
+	}
+
+	for (size_t i = k + 1; i < 5; ++i)
+		positions[i] += 1;
+
+	for (size_t i = 0; i < 5; ++i)
+		desired[i] += increments[i];
+
+	// Move the middle markers toward where they should be if they've drifted a full position off.
+	for (size_t i = 1; i < 4; ++i) {
+		const double d = desired[i] - positions[i];
+
+		if (d >= 1 && positions[i + 1] - positions[i] > 1)
+			adjust(i, 1);
+		else if (d <= -1 && positions[i - 1] - positions[i] < -1)
+			adjust(i, -1);
+	}
+}
+
+void P2Quantile::adjust(size_t i, int d)
+{
+	const double qPrev = heights[i - 1];
+	const double q = heights[i];
+	const double qNext = heights[i + 1];
+	const double nPrev = positions[i - 1];
+	const double ni = positions[i];
+	const double nNext = positions[i + 1];
+
+	// Try a parabolic prediction first, and fall back to a linear one if it would put the markers out of order.
+	const double parabolic = q + d / (nNext - nPrev)
+		* ((ni - nPrev + d) * (qNext - q) / (nNext - ni) + (nNext - ni - d) * (q - qPrev) / (ni - nPrev));
+
+	if (qPrev < parabolic && parabolic < qNext) {
+		heights[i] = parabolic;
+	}
+	else {
+		const size_t j = d > 0 ? i + 1 : i - 1;
+		heights[i] = q + d * (heights[j] - q) / (positions[j] - ni);
+	}
+
+	positions[i] += d;
+}
+
+double P2Quantile::get() const
+{
+	if (n >= 5)
+		return heights[2];
+
+	if (n == 0)
+		return 0;
+
+	// With only a few values we can just look it up.
+	array<double, 5> sorted = heights;
+	sort(begin(sorted), begin(sorted) + (ptrdiff_t)n);
+	return sorted[(size_t)lround(p * (double)(n - 1))];
+}
+
+#ifdef WITH_JSON
+void ShotStatistics::addToJSON(Json::Value& object) const
+{
+	for (const auto& member : countMembers)
+		object[member.first] = this->*member.second;
+
+	for (const auto& member : reactionMembers)
+		object[member.first] = this->*member.second;
+}
+
+ShotStatistics ShotStatistics::fromJSON(const Json::Value& object)
+{
+	ShotStatistics ret;
+
+	for (const auto& member : countMembers) {
+		if (object.isMember(member.first)) {
+			const Value& val = object[member.first];
+			ENFORCE(IOException, val.isInt(), "A player's shot statistics contain a value that is not an integer.");
+			ret.*member.second = (shot_t)val.asInt();
+		}
+	}
+
+	for (const auto& member : reactionMembers) {
+		if (object.isMember(member.first)) {
+			const Value& val = object[member.first];
+			ENFORCE(IOException, val.isInt(), "A player's reaction times contain a value that is not an integer.");
+			ret.*member.second = (timestamp_t)val.asInt();
+		}
+	}
+
+	return ret;
+}
+
+void ShotStatistics::writeJSONMembers(JSONWriter& writer) const
+{
+	for (const auto& member : countMembers) {
+		writer.key(member.first.c_str());
+		writer.value(this->*member.second);
+	}
+
+	for (const auto& member : reactionMembers) {
+		writer.key(member.first.c_str());
+		writer.value(this->*member.second);
+	}
+}
+
+bool ShotStatistics::readJSONMember(JSONReader& reader)
+{
+	for (const auto& member : countMembers) {
+		if (reader.isKey(member.first.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::NUMBER,
+			        "A player's shot statistics contain a value that is not an integer.");
+			this->*member.second = (shot_t)reader.readInt();
+			return true;
+		}
+	}
+
+	for (const auto& member : reactionMembers) {
+		if (reader.isKey(member.first.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::NUMBER,
+			        "A player's reaction times contain a value that is not an integer.");
+			this->*member.second = (timestamp_t)reader.readInt();
+			return true;
+		}
+	}
+
+	return false;
+}
+#endif
+
+const size_t ShotStatistics::binaryLength;
+
+uint8_t* ShotStatistics::writeBinary(uint8_t* buf) const
+{
+	buf = BinaryMessage::writeInt(buf, shotsFired);
+	buf = BinaryMessage::writeInt(buf, misses);
+	buf = BinaryMessage::writeInt(buf, streak);
+	buf = BinaryMessage::writeInt(buf, longestStreak);
+	buf = BinaryMessage::writeInt(buf, fastestReaction);
+	buf = BinaryMessage::writeInt(buf, meanReaction);
+	buf = BinaryMessage::writeInt(buf, medianReaction);
+	return BinaryMessage::writeInt(buf, reaction90);
+}
+
+ShotStatistics ShotStatistics::fromBinary(const uint8_t* buf, size_t len)
+{
+	ENFORCE(IOException, len >= binaryLength, "This buffer does not have room for shot statistics.");
+
+	ShotStatistics ret;
+	ret.shotsFired = BinaryMessage::extractInt16(buf);
+	ret.misses = BinaryMessage::extractInt16(buf + 2);
+	ret.streak = BinaryMessage::extractInt16(buf + 4);
+	ret.longestStreak = BinaryMessage::extractInt16(buf + 6);
+	ret.fastestReaction = BinaryMessage::extractInt32(buf + 8);
+	ret.meanReaction = BinaryMessage::extractInt32(buf + 12);
+	ret.medianReaction = BinaryMessage::extractInt32(buf + 16);
+	ret.reaction90 = BinaryMessage::extractInt32(buf + 20);
+	return ret;
+}
+
+bool ShotStatistics::operator==(const ShotStatistics& o) const
+{
+	return shotsFired == o.shotsFired
+		&& misses == o.misses
+		&& streak == o.streak
+		&& longestStreak == o.longestStreak
+		&& fastestReaction == o.fastestReaction
+		&& meanReaction == o.meanReaction
+		&& medianReaction == o.medianReaction
+		&& reaction90 == o.reaction90;
+}
+
+PlayerStatistics::PlayerStatistics() :
+	hits(0),
+	summary(),
+	totalReaction(0),
+	median(0.5),
+	percentile90(0.9)
+{
+}
+
+void PlayerStatistics::recordShot(bool missed)
+{
+	++summary.shotsFired;
+
+	if (missed) {
+		++summary.misses;
+		summary.streak = 0;
+	}
+}
+
+void PlayerStatistics::recordHit(timestamp_t reactionTime)
+{
+	++hits;
+
+	++summary.streak;
+	summary.longestStreak = max(summary.longestStreak, summary.streak);
+
+	if (summary.fastestReaction < 0 || reactionTime < summary.fastestReaction)
+		summary.fastestReaction = reactionTime;
+
+	totalReaction += reactionTime;
+	median.add(reactionTime);
+	percentile90.add(reactionTime);
+}
+
+ShotStatistics PlayerStatistics::summarize() const
+{
+	ShotStatistics ret = summary;
+
+	if (hits > 0) {
+		ret.meanReaction = (timestamp_t)(totalReaction / hits);
+		ret.medianReaction = (timestamp_t)lround(median.get());
+		ret.reaction90 = (timestamp_t)lround(percentile90.get());
+	}
+
+	return ret;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef WITH_JSON
+#include <jsoncpp/json/json.h>
+#endif
+
+#include "GameTypes.hpp"
+
+class JSONReader;
+class JSONWriter;
+
+/**
+ * \brief Estimates a quantile of a stream of values in constant space and time per value
+ *
+ * This is the P² algorithm (Jain and Chlamtac, 1985), which keeps five markers
+ * whose heights are nudged toward the quantile with piecewise-parabolic interpolation as values come in.
+ * The estimate is exact for the first five values and typically within a few percent after that.
+ */
+class P2Quantile {
+
+public:
+
+	/// \param p The quantile to estimate, between 0 and 1 (e.g. 0.5 for the median)
+	explicit P2Quantile(double p);
+
+	void add(double x);
+
+	/// Gets the number of values added
+	size_t count() const { return n; }
+
+	/// Gets the estimate of the quantile, or 0 if no values have been added
+	double get() const;
+
+private:
+
+	/// Moves marker i one position in direction d (+1 or -1), adjusting its height
+	void adjust(size_t i, int d);
+
+	double p;
+
+	size_t n;
+
+	/// Marker heights. Until there are five values, these are just the values so far.
+	std::array<double, 5> heights;
+
+	/// Marker positions, counting from 1
+	std::array<double, 5> positions;
+
+	/// Where each marker should be
+	std::array<double, 5> desired;
+
+	/// How much each marker's desired position moves with each value
+	std::array<double, 5> increments;
+};
+
+/**
+ * \brief A player's shooting statistics beyond score and hits, as reported in status and results responses
+ *
+ * Reaction times are in milliseconds, from a target going up to the player hitting it,
+ * and are -1 if the player hasn't hit anything yet.
+ */
+struct ShotStatistics {
+	shot_t shotsFired; ///< Every shot the player took
+	shot_t misses; ///< Shots that hit no target at all
+	shot_t streak; ///< Hits in a row as of the player's last shot
+	shot_t longestStreak; ///< The most hits in a row so far
+	timestamp_t fastestReaction;
+	timestamp_t meanReaction;
+	timestamp_t medianReaction;
+	timestamp_t reaction90; ///< The 90th percentile reaction time
+
+	ShotStatistics() :
+		shotsFired(0), misses(0), streak(0), longestStreak(0),
+		fastestReaction(-1), meanReaction(-1), medianReaction(-1), reaction90(-1)
+	{ }
+
+	/// Gets the fraction of shots that hit, given the player's hit count
+	double accuracy(shot_t hits) const { return shotsFired > 0 ? (double)hits / shotsFired : 0.0; }
+
+#ifdef WITH_JSON
+	/// Adds the statistics' members to a player's stats object
+	void addToJSON(Json::Value& object) const;
+
+	/// Reads statistics from a player's stats object. Missing members keep their default values.
+	static ShotStatistics fromJSON(const Json::Value& object);
+
+	/// Writes the statistics' members into the object being written
+	void writeJSONMembers(JSONWriter& writer) const;
+
+	/// If the reader is at one of the statistics' members, reads it and returns true
+	bool readJSONMember(JSONReader& reader);
+#endif
+
+	/// The length of the statistics' binary representation
+	static const size_t binaryLength = 4 * sizeof(shot_t) + 4 * sizeof(timestamp_t);
+
+	/**
+	 * \brief Writes the statistics' binary representation (binaryLength bytes) to `buf`
+	 *        and returns a pointer just past it
+	 *
+	 * The counts are written as 16-bit signed integers, followed by the reaction times
+	 * as 32-bit signed integers, both in the order they are declared.
+	 */
+	uint8_t* writeBinary(uint8_t* buf) const;
+
+	static ShotStatistics fromBinary(const uint8_t* buf, size_t len);
+
+	bool operator==(const ShotStatistics& o) const;
+};
+
+/**
+ * \brief Keeps a player's ShotStatistics up to date as they shoot
+ *
+ * Every update takes constant time and space, so statistics can be reported at any point in a game
+ * without going back over its shots.
+ */
+class PlayerStatistics {
+
+public:
+
+	PlayerStatistics();
+
+	/**
+	 * \brief Records a shot
+	 * \param missed true if the shot hit no target at all, which breaks the player's streak
+	 *
+	 * Shots that hit a target aren't counted as hits until the game awards them with recordHit.
+	 */
+	void recordShot(bool missed);
+
+	/// Records a hit that took the player `reactionTime` milliseconds after the target went up
+	void recordHit(timestamp_t reactionTime);
+
+	shot_t getHits() const { return hits; }
+
+	double getAccuracy() const { return summary.accuracy(hits); }
+
+	/// Gets the statistics so far
+	ShotStatistics summarize() const;
+
+private:
+
+	shot_t hits;
+
+	/// The counts, kept in the form they are reported in
+	ShotStatistics summary;
+
+	int64_t totalReaction;
+
+	P2Quantile median;
+
+	P2Quantile percentile90;
+};
@@ -2,23 +2,33 @@
 
 #include <cassert>
 
+#include "Exceptions.hpp"
 #include "ShotMessage.hpp"
-#include "TargetControlMessage.hpp"
 
 using namespace std;
 using namespace std::chrono;
+using namespace Exceptions;
+
+const size_t PopUpStateMachine::maxTargets;
 
 PopUpStateMachine::PopUpStateMachine(board_id_t numTargets, board_id_t numPlayers,
-                                     const std::chrono::seconds& gameDuration, score_t scoreToWin) :
+                                     const std::chrono::seconds& gameDuration, score_t scoreToWin,
+                                     uint32_t seed, board_id_t maxUp) :
 	GameStateMachine(numTargets, numPlayers, gameDuration, scoreToWin),
-	rng(std::random_device()()),
+	rng(seed),
 	delayDistribution(3, 6),
-	targetDistribution(0, (board_id_t)(numTargets - 1)),
-	state(PopUpState::STARTUP),
-	transitionTime(),
-	targetUp(),
-	whichTarget(-1)
+	targetsUp((size_t)maxUp),
+	started(false),
+	up(),
+	hit(),
+	upSince(numTargets),
+	downAt(numTargets),
+	dropDowns(),
+	popUps(),
+	commands()
 {
+	ENFORCE(ArgumentOutOfRangeException, maxUp > 0 && maxUp <= numTargets,
+	        "The number of targets up at once must be between one and the number of targets.");
 }
 
 std::unique_ptr<ResponseMessage> PopUpStateMachine::onShot(uint16_t responseID, const ShotMessage& shot)
@@ -29,20 +39,26 @@ std::unique_ptr<ResponseMessage> PopUpStateMachine::onShot(uint16_t responseID,
 	if (msg->code == ResponseMessage::Code::INVALID_REQUEST)
 		return msg;
 
-	// If we're in the up state and the right target is hit,
-	if (state == PopUpState::UP && shot.shot.target == whichTarget) {
+	const board_id_t target = shot.shot.target;
+
+	// If the target is up, it's a hit. Nothing scores once the game is over, even if we haven't ticked since.
+	if (gameState == State::RUNNING && target >= 0 && target < targetCount && up[(size_t)target]) {
 		// Award a score to the player who hit it first. Something like remaining milliseconds / 10.
 		// TODO: We don't have to worry about hit messages arriving out of order, do we?
 		//       For now, just make the winner the first hit we see.
+		recordHit(shot.shot.player, (timestamp_t)duration_cast<milliseconds>(now() - upSince[target]).count());
 		auto& roundWinner = players[shot.shot.player];
-		++roundWinner.hits;
-		// On the off-chance that due to some timing fluke, this arrives after the transition time,
+		// On the off-chance that due to some timing fluke, this arrives after the target's window,
 		// Award at least 10 points. This is probably unnecessary, but it doesn't hurt to be sure.
-		const score_t score = (score_t)(duration_cast<milliseconds>(transitionTime - Clock::now()).count() / 10);
+		const score_t score = (score_t)(duration_cast<milliseconds>(downAt[target] - now()).count() / 10);
 		// Yes, this is verbose and dumb. See
 		// http://stackoverflow.com/q/23317404/713961
 		roundWinner.score = (score_t)(roundWinner.score + max((score_t)10, score));
-		state = PopUpState::SHUTOFF;
+		postEvent(GameEvent::scoreChanged(shot.shot.player, roundWinner.score, roundWinner.hits, gameTime()));
+		// Shut the target off right away (and see if somebody just won).
+		up.reset((size_t)target);
+		hit.set((size_t)target);
+		scheduleTick(now());
 	}
 
 	return msg;
@@ -54,78 +70,104 @@ std::unique_ptr<Message> PopUpStateMachine::onTick(uint16_t messageID)
 	auto msg = GameStateMachine::onTick(messageID);
 	assert(msg == nullptr);
 
-	// We have nothing special to do if the game isn't running or we're not finishing up.
-	// We fall back to startup when we're all done.
-	if (gameState != State::RUNNING && state == PopUpState::STARTUP)
-		return msg;
-
-	switch (state) {
-		case PopUpState::STARTUP:
-			// The startup state does nothing but switch us to DELAY
-			transitionToDelay();
-			return nullptr;
+	const bool running = gameState == State::RUNNING;
 
-		case PopUpState::DELAY:
-			return duringDelay(messageID);
+	// Shut off the targets that were hit...
+	for (int t = 0; hit.any() && t < targetCount; ++t) {
+		if (hit[(size_t)t]) {
+			hit.reset((size_t)t);
+			setTarget((board_id_t)t, false);
+			schedulePopUp();
+		}
+	}
 
-		case PopUpState::UP:
-			duringUp();
-			return nullptr;
+	// ...and the ones nobody hit in time.
+	while (!dropDowns.empty() && dropDowns.top().first <= now()) {
+		const auto t = dropDowns.top().second;
+		const bool current = up[(size_t)t] && downAt[t] == dropDowns.top().first;
+		dropDowns.pop();
+		if (current) {
+			up.reset((size_t)t);
+			setTarget(t, false);
+			schedulePopUp();
+		}
+	}
 
-		case PopUpState::SHUTOFF:
-			return duringShutoff(messageID);
+	if (running) {
+		if (!started) {
+			started = true;
+			for (size_t i = 0; i < targetsUp; ++i)
+				schedulePopUp();
+		}
+
+		while (!popUps.empty() && popUps.top() <= now()) {
+			popUps.pop();
+			popUp();
+		}
 	}
 
-	// Should be unreachable
-	return msg;
-}
+	if (commands.empty())
+		return nullptr;
 
+	TargetControlMessage::CommandList toSend;
+	toSend.swap(commands);
+	return unique_ptr<Message>(new TargetControlMessage(messageID, move(toSend)));
+}
 
-std::unique_ptr<Message> PopUpStateMachine::duringDelay(uint16_t messageID)
+void PopUpStateMachine::resetGame()
 {
-	// The time the target will stay up before going back down
-	static const seconds targetWindow(5);
-
-	if (Clock::now() >= transitionTime) {
-		// Pick a target
-		whichTarget = targetDistribution(rng);
-		// Update our state
-		state = PopUpState::UP;
-		// If nobody shoots this target in five seconds, drop back down
-		transitionTime = Clock::now() + targetWindow;
-		// Remember when we brought up the target for scoring purposes
-		targetUp = Clock::now();
-		// Actually turn the target on
-		return unique_ptr<Message>(
-			new TargetControlMessage(messageID, TargetCommand(whichTarget, true)));
-	}
-	else {
-		return nullptr;
-	}
+	// Shut off everything that's still up (on this tick) so nobody can score after the fact,
+	// and start from scratch when the next game starts.
+	started = false;
+	popUps = decltype(popUps)();
+	dropDowns = decltype(dropDowns)();
+	hit |= up;
+	up.reset();
 }
 
-void PopUpStateMachine::duringUp()
+void PopUpStateMachine::setTarget(board_id_t target, bool on)
 {
-	// If nobody has shot the target in the five seconds it's been up, shut it down.
-	if (Clock::now() >= transitionTime)
-		state = PopUpState::SHUTOFF;
+	commands.emplace_back(target, on);
+	postEvent(GameEvent::targetChanged(target, on, gameTime()));
 }
 
-std::unique_ptr<Message> PopUpStateMachine::duringShutoff(uint16_t messageID)
+void PopUpStateMachine::schedulePopUp()
 {
-	// If the game is over, fall back to startup. Otherwise, back to delay
-	if (isOver())
-		state = PopUpState::STARTUP;
-	else
-		transitionToDelay();
-
-	// Shut the target off
-	return unique_ptr<Message>(
-		new TargetControlMessage(messageID, TargetCommand(whichTarget, false)));
+	if (!started || up.count() + hit.count() + popUps.size() >= targetsUp)
+		return;
+
+	const auto when = now() + seconds(delayDistribution(rng));
+	popUps.push(when);
+	scheduleTick(when);
 }
 
-void PopUpStateMachine::transitionToDelay()
+void PopUpStateMachine::popUp()
 {
-	state = PopUpState::DELAY;
-	transitionTime = Clock::now() + seconds(delayDistribution(rng));
+	// The time the target will stay up before going back down
+	static const seconds targetWindow(5);
+
+	// Pick a target that isn't busy.
+	const TargetSet busy = up | hit;
+	const int freeCount = targetCount - (int)busy.count();
+	if (freeCount <= 0)
+		return;
+
+	int choice = uniform_int_distribution<int>(0, freeCount - 1)(rng);
+	board_id_t target = 0;
+	for (int t = 0; t < targetCount; ++t) {
+		if (!busy[(size_t)t] && choice-- == 0) {
+			target = (board_id_t)t;
+			break;
+		}
+	}
+
+	up.set((size_t)target);
+	// Remember when we brought up the target for scoring purposes
+	upSince[target] = now();
+	// If nobody shoots this target in five seconds, drop back down
+	downAt[target] = now() + targetWindow;
+	dropDowns.emplace(downAt[target], target);
+	scheduleTick(downAt[target]);
+	// Actually turn the target on
+	setTarget(target, true);
 }
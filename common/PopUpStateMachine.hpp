@@ -1,14 +1,29 @@
 #pragma once
 
+#include <bitset>
+#include <queue>
 #include <random>
+#include <utility>
+#include <vector>
 
 #include "GameStateMachine.hpp"
-
-/// A state machine that handles the "pop up" game type
+#include "TargetControlMessage.hpp"
+
+/**
+ * \brief A state machine that handles the "pop up" game type
+ *
+ * Targets pop up after a random delay and stay up until they are hit or their window runs out,
+ * at which point another one is due to pop up after a delay of its own.
+ * Any number of targets can be up at once, each with its own window.
+ * Every target turned on or off in a tick goes out in a single TargetControlMessage.
+ */
 class PopUpStateMachine : public GameStateMachine {
 
 public:
 
+	/// The most targets a game can have, since target IDs are a board_id_t
+	static const size_t maxTargets = 128;
+
 	/**
 	 * \brief Constructs a state machine for the pop-up game type
 	 * \param numTargets The number of targets in the game
@@ -18,30 +33,38 @@ public:
 	 * \param gameDuration The duration of the game, in seconds.
 	 *                     Pass std::chrono::seconds::max for infinite (ish) duration.
 	 * \param scoreToWin The winning score. Pass a negative value for no winning score
+	 * \param seed The seed for the random delays and targets.
+	 *             Games with the same seed (and the same shots at the same times) play out the same way.
+	 * \param targetsUp How many targets can be up at once, from 1 to numTargets
 	 */
 	PopUpStateMachine(board_id_t numTargets, board_id_t numPlayers,
-	                  const std::chrono::seconds& gameDuration, score_t scoreToWin);
+	                  const std::chrono::seconds& gameDuration, score_t scoreToWin,
+	                  uint32_t seed = std::random_device()(), board_id_t targetsUp = 1);
 
 	std::unique_ptr<ResponseMessage> onShot(uint16_t responseID, const ShotMessage& shot) override;
 
 	std::unique_ptr<Message> onTick(uint16_t messageID) override;
 
+protected:
+
+	/// Takes down every target that is up and forgets the pop-ups and drop-downs to come
+	void resetGame() override;
+
 private:
 
-	enum class PopUpState {
-		STARTUP, ///< An initial state where we do nothing until the first tick
-		DELAY, ///< The delay between targets popping up
-		UP, ///< When a target is up and waiting for a player to shoot it
-		SHUTOFF ///< Shut off the target after it has been hit
-	};
+	typedef std::bitset<maxTargets> TargetSet;
 
-	std::unique_ptr<Message> duringDelay(uint16_t messageID);
+	/// A time at which a target's window runs out
+	typedef std::pair<TimePoint, board_id_t> DropDown;
 
-	void duringUp();
+	/// Turns a target on or off in this tick's message
+	void setTarget(board_id_t target, bool on);
 
-	std::unique_ptr<Message> duringShutoff(uint16_t messageID);
+	/// Waits a random delay before popping up another target, if there is room for one
+	void schedulePopUp();
 
-	void transitionToDelay();
+	/// Pops up a random target that isn't up (or on its way down)
+	void popUp();
 
 	/// A pseusdo-random number generator for creating delay times;
 	std::mt19937 rng;
@@ -49,17 +72,29 @@ private:
 	/// The random distribution for delay times
 	std::uniform_int_distribution<> delayDistribution;
 
-	/// The random distribution of the target to pop up
-	std::uniform_int_distribution<int8_t> targetDistribution;
+	const size_t targetsUp;
+
+	/// Set once the first tick of the game has scheduled the first targets
+	bool started;
+
+	/// Targets that are up and can be hit
+	TargetSet up;
+
+	/// Targets that were hit and go off on the next tick
+	TargetSet hit;
+
+	/// When each target went up, for scoring
+	std::vector<TimePoint> upSince;
 
-	PopUpState state;
+	/// When each target that is up will go down
+	std::vector<TimePoint> downAt;
 
-	/// When applicable, stores the transition time when we move to the next state
-	TimePoint transitionTime;
+	/// Window deadlines, earliest first. Ones for targets that were since hit are skipped when they come up.
+	std::priority_queue<DropDown, std::vector<DropDown>, std::greater<DropDown>> dropDowns;
 
-	/// Stores the time at which a target went up
-	TimePoint targetUp;
+	/// Times at which targets are due to pop up, earliest first
+	std::priority_queue<TimePoint, std::vector<TimePoint>, std::greater<TimePoint>> popUps;
 
-	/// Stores the target we brought up
-	int8_t whichTarget;
+	/// The commands for this tick's message
+	TargetControlMessage::CommandList commands;
 };
@@ -0,0 +1,61 @@
+#include "PseudoTerminal.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "Exceptions.hpp"
+
+using namespace Exceptions;
+
+namespace {
+
+void makeRaw(int fd)
+{
+	termios tio;
+	ENFORCE(IOException, tcgetattr(fd, &tio) == 0, "Could not get the pseudo-terminal's attributes");
+	cfmakeraw(&tio);
+	ENFORCE(IOException, tcsetattr(fd, TCSANOW, &tio) == 0, "Could not put the pseudo-terminal in raw mode");
+}
+
+} // end anonymous namespace
+
+PseudoTerminal::PseudoTerminal() :
+	master(-1),
+	slave(-1),
+	slaveName()
+{
+	master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (master < 0)
+		THROW(IOException, std::string("Could not open a pseudo-terminal: ") + strerror(errno));
+
+	try {
+		ENFORCE(IOException, grantpt(master) == 0 && unlockpt(master) == 0,
+		        "Could not unlock the pseudo-terminal");
+
+		const char* name = ptsname(master);
+		ENFORCE(IOException, name != nullptr, "Could not get the name of the pseudo-terminal");
+		slaveName = name;
+
+		slave = open(name, O_RDWR | O_NOCTTY);
+		if (slave < 0)
+			THROW(IOException, "Could not open " + slaveName + ": " + strerror(errno));
+
+		makeRaw(slave);
+	}
+	catch (...) {
+		if (slave >= 0)
+			close(slave);
+		close(master);
+		throw;
+	}
+}
+
+PseudoTerminal::~PseudoTerminal()
+{
+	close(slave);
+	close(master);
+}
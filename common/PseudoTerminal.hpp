@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+/**
+ * \brief A pseudo-terminal pair, for running the serial bridge without hardware
+ *
+ * The master side stands in for a serial port: hand it to runSerialMessageBridgeFD.
+ * Anything that opens the slave side (see getSlaveName) then looks like the hardware on the other end
+ * of the serial line, so a simulator or load generator can talk to the bridge as if it were a board.
+ *
+ * Both sides are put in raw mode so that bytes pass through untouched.
+ * The master is non-blocking. The slave is kept open for the life of this object
+ * so that the master doesn't see a hangup while nothing else has the slave open.
+ */
+class PseudoTerminal {
+
+public:
+
+	/// Opens a new pseudo-terminal pair
+	/// \throws Exceptions::IOException if the pair could not be created
+	PseudoTerminal();
+
+	~PseudoTerminal();
+
+	/// Gets the (non-blocking) file descriptor of the master side
+	int getMaster() const { return master; }
+
+	/// Gets the (blocking) file descriptor of the slave side
+	int getSlave() const { return slave; }
+
+	/// Gets the path of the slave side, e.g. /dev/pts/3
+	const std::string& getSlaveName() const { return slaveName; }
+
+	// Disallow copy and assign
+	PseudoTerminal(const PseudoTerminal&) = delete;
+	PseudoTerminal& operator=(const PseudoTerminal&) = delete;
+
+private:
+
+	int master;
+
+	int slave;
+
+	std::string slaveName;
+};
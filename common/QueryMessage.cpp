@@ -4,7 +4,9 @@
 #include <limits>
 
 #include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace Exceptions;
 using namespace std;
@@ -74,32 +76,37 @@ Json::Value QueryMessage::toJSON() const
 
 	return ret;
 }
-#endif
 
-std::unique_ptr<QueryMessage> QueryMessage::fromBinary(uint8_t* buf, size_t len)
+void QueryMessage::writeJSONFields(JSONWriter& writer) const
 {
-	auto msg = Message::fromBinary(buf, len);
+	Message::writeJSONFields(writer);
 
-	auto load = BinaryMessage::getPayload(buf);
+	writer.key(idKey.c_str());
+	writer.value(boardID);
+	writer.key(boardTypeKey.c_str());
+	writer.value(type == BoardType::TARGET ? "target" : "gun");
+}
+#endif
 
-	ENFORCE(IOException, load.second >= sizeof(board_id_t) + 1, "The provided message is too small");
+std::unique_ptr<QueryMessage> QueryMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
 
-	static_assert(sizeof(message_id_t) == 2, "Someone changed the message ID size");
-	board_id_t id = (board_id_t)load.first[0];
-	BoardType bt = (BoardType)load.first[1];
+std::unique_ptr<QueryMessage> QueryMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	const BinaryMessage::QueryView query(view);
 
 	return std::unique_ptr<QueryMessage>(
-		new QueryMessage(msg->id, id, bt));
+		new QueryMessage(query.getID(), query.getBoardID(), query.getBoardType()));
 }
 
-std::vector<uint8_t> QueryMessage::getBinaryPayload() const
+void QueryMessage::writeBinaryPayload(uint8_t* buf) const
 {
-	assert(Message::getBinaryPayload().size() == 0);
+	assert(Message::getBinaryPayloadLength() == 0);
 
-	vector<uint8_t> ret;
-	ret.emplace_back((uint8_t)boardID);
-	ret.emplace_back((uint8_t)type);
-	return ret;
+	buf[0] = (uint8_t)boardID;
+	buf[1] = (uint8_t)type;
 }
 
 bool QueryMessage::operator==(const Message& o) const
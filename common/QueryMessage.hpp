@@ -33,20 +33,28 @@ public:
 	static std::unique_ptr<QueryMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
 	/// \brief Deserializes a message from a binary buffer
 	/// \warning Do not call this directly. Call binaryToMessage instead.
 	static std::unique_ptr<QueryMessage> fromBinary(uint8_t* buf, size_t len);
 
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<QueryMessage> fromBinary(const BinaryMessage::MessageView& view);
+
 	/*
-	 * \brief Gets the query's binary payload
+	 * \brief Writes the query's binary payload
 	 *
 	 * A query message has a two-byte payload:
 	 * - The first byte is the board ID
 	 * - The second byte is the type (see QueryMessage::BoardType)
 	 */
-	std::vector<uint8_t> getBinaryPayload() const override;
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override { return 2; }
 
 	const board_id_t boardID;
 
@@ -54,5 +62,7 @@ public:
 
 	Type getType() const override { return Type::QUERY; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new QueryMessage(*this)); }
+
 	bool operator==(const Message& o) const override;
 };
@@ -0,0 +1,101 @@
+#include "ResponseCorrelator.hpp"
+
+#include "Exceptions.hpp"
+#include "ResponseMessage.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+ResponseCorrelator::ResponseCorrelator(MessageQueue& toServer, MessageQueue& fromServer, Clock::duration timeout) :
+	out(toServer),
+	in(fromServer),
+	patience(timeout),
+	uid(0),
+	pushHandler(),
+	pending(),
+	byDeadline()
+{
+}
+
+void ResponseCorrelator::request(std::unique_ptr<Message>&& msg, ResponseHandler onResponse)
+{
+	ENFORCE(ArgumentException, pending.find(msg->id) == end(pending),
+	        "A request with that ID is still waiting for its response.");
+
+	const auto deadline = Clock::now() + patience;
+	pending.emplace(msg->id, Pending{move(onResponse), deadline});
+	byDeadline.emplace_back(msg->id, deadline);
+
+	out.send(move(msg));
+}
+
+std::future<std::unique_ptr<Message>> ResponseCorrelator::request(std::unique_ptr<Message>&& msg)
+{
+	// std::function needs a copyable target, so share the promise.
+	auto promised = make_shared<promise<unique_ptr<Message>>>();
+	auto ret = promised->get_future();
+
+	request(move(msg), [promised](unique_ptr<Message>&& response) {
+		promised->set_value(move(response));
+	});
+
+	return ret;
+}
+
+size_t ResponseCorrelator::poll()
+{
+	size_t handled = 0;
+
+	while (auto msg = in.tryReceive()) {
+		deliver(move(msg));
+		++handled;
+	}
+
+	return handled + expire(Clock::now());
+}
+
+void ResponseCorrelator::clear()
+{
+	pending.clear();
+	byDeadline.clear();
+}
+
+void ResponseCorrelator::deliver(std::unique_ptr<Message>&& msg)
+{
+	const auto* response = dynamic_cast<const ResponseMessage*>(msg.get());
+
+	auto it = response != nullptr ? pending.find(response->respondingTo) : end(pending);
+
+	if (it == end(pending)) {
+		if (pushHandler)
+			pushHandler(move(msg));
+		return;
+	}
+
+	// Take the handler out first so it can send requests of its own.
+	auto handler = move(it->second.handler);
+	pending.erase(it);
+	handler(move(msg));
+}
+
+size_t ResponseCorrelator::expire(Clock::time_point now)
+{
+	size_t expired = 0;
+
+	while (!byDeadline.empty() && byDeadline.front().second <= now) {
+		const auto entry = byDeadline.front();
+		byDeadline.pop_front();
+
+		// Skip requests that were answered (and maybe whose IDs have been reused since).
+		auto it = pending.find(entry.first);
+		if (it == end(pending) || it->second.deadline != entry.second)
+			continue;
+
+		auto handler = move(it->second.handler);
+		pending.erase(it);
+		handler(nullptr);
+		++expired;
+	}
+
+	return expired;
+}
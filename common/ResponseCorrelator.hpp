@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "MessageQueue.hpp"
+
+/**
+ * \brief Matches responses from the game to the requests a client sent, so requests can be pipelined
+ *
+ * Requests go out on one queue and their handlers are kept, keyed by message ID, until
+ * a ResponseMessage responding to that ID arrives on the other. Any number of requests can be in flight,
+ * and responses can come back in any order. Anything that isn't a response to an outstanding request
+ * (game events, for example) goes to the push handler instead.
+ *
+ * Nothing here blocks. Call poll() regularly (e.g. from a UI timer) to deliver whatever has arrived;
+ * handlers are called from poll, on the thread that calls it.
+ * A correlator is not thread-safe: send requests and poll from the same thread.
+ */
+class ResponseCorrelator {
+
+public:
+
+	typedef std::chrono::steady_clock Clock;
+
+	/// Called with a request's response, or with null if the request timed out
+	typedef std::function<void(std::unique_ptr<Message>&&)> ResponseHandler;
+
+	/// Called with messages that aren't responses to anything we are waiting on
+	typedef std::function<void(std::unique_ptr<Message>&&)> PushHandler;
+
+	/**
+	 * \brief Creates a correlator for a connection
+	 * \param toServer The queue requests are sent on
+	 * \param fromServer The queue responses and pushes arrive on
+	 * \param timeout How long to wait for a response before giving up on it
+	 */
+	ResponseCorrelator(MessageQueue& toServer, MessageQueue& fromServer, Clock::duration timeout);
+
+	/// Gets a message ID for a new request
+	message_id_t nextID() { return uid++; }
+
+	/**
+	 * \brief Sends a request and calls `onResponse` with its response from a later call to poll
+	 * \throws Exceptions::ArgumentException if a request with the same ID is still waiting for its response
+	 */
+	void request(std::unique_ptr<Message>&& msg, ResponseHandler onResponse);
+
+	/**
+	 * \brief Sends a request and returns a future for its response
+	 *
+	 * The future is fulfilled by poll, with null if the request times out.
+	 * \see request(std::unique_ptr<Message>&&, ResponseHandler)
+	 */
+	std::future<std::unique_ptr<Message>> request(std::unique_ptr<Message>&& msg);
+
+	/// Sets the handler for messages that aren't responses to outstanding requests. By default they are dropped.
+	void setPushHandler(PushHandler onPush) { pushHandler = std::move(onPush); }
+
+	/**
+	 * \brief Hands everything that has arrived to its handler, then times out requests that have waited too long
+	 * \returns The number of messages and timeouts handled
+	 */
+	size_t poll();
+
+	/// Gets the number of requests waiting for a response
+	size_t outstanding() const { return pending.size(); }
+
+	/// Forgets all outstanding requests without calling their handlers, e.g. after a connection closes.
+	/// Futures for them are left with std::future_errc::broken_promise.
+	void clear();
+
+	// Disallow copy and assign
+	ResponseCorrelator(const ResponseCorrelator&) = delete;
+	ResponseCorrelator& operator=(const ResponseCorrelator&) = delete;
+
+private:
+
+	struct Pending {
+		ResponseHandler handler;
+		Clock::time_point deadline;
+	};
+
+	void deliver(std::unique_ptr<Message>&& msg);
+
+	/// Times out requests whose deadlines have passed and returns how many there were
+	size_t expire(Clock::time_point now);
+
+	MessageQueue& out;
+
+	MessageQueue& in;
+
+	const Clock::duration patience;
+
+	message_id_t uid;
+
+	PushHandler pushHandler;
+
+	std::unordered_map<message_id_t, Pending> pending;
+
+	/// Requests in the order they were sent, which is also the order their deadlines pass in.
+	/// Entries for requests that have already been answered are skipped when they come up.
+	std::deque<std::pair<message_id_t, Clock::time_point>> byDeadline;
+};
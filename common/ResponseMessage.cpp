@@ -4,7 +4,9 @@
 #include <unordered_map>
 
 #include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace Exceptions;
 using namespace std;
@@ -75,15 +77,14 @@ std::unique_ptr<ResponseMessage> ResponseMessage::fromJSON(const Json::Value& ob
 	ENFORCE(IOException, codeValue.isString(), "The response code is not a string.");
 	ENFORCE(IOException, messageValue.isString(), "The response message is not a string.");
 
-	const auto codeIt = nameToCode.find(codeValue.asString());
-	ENFORCE(IOException, codeIt != end(nameToCode), "The response code is invalid.");
+	const Code code = stringToCode(codeValue.asString());
 
 	const int respondingToRaw = respondingToValue.asInt();
 
 	ENFORCE(IOException, respondingToRaw >= 0, "The response ID must be positive");
 
 	return std::unique_ptr<ResponseMessage>(
-		new ResponseMessage(msg->id, (message_id_t)respondingToRaw, codeIt->second, messageValue.asString()));
+		new ResponseMessage(msg->id, (message_id_t)respondingToRaw, code, messageValue.asString()));
 }
 
 Json::Value ResponseMessage::toJSON() const
@@ -96,36 +97,53 @@ Json::Value ResponseMessage::toJSON() const
 
 	return ret;
 }
-#endif
 
-std::unique_ptr<ResponseMessage> ResponseMessage::fromBinary(uint8_t* buf, size_t len)
+void ResponseMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	writer.key(respondingToKey.c_str());
+	writer.value(respondingTo);
+	writer.key(codeKey.c_str());
+	writer.value(codeToString(code));
+	writer.key(messageKey.c_str());
+	writer.value(message);
+}
+
+const char* ResponseMessage::codeToString(Code c)
 {
-	auto msg = Message::fromBinary(buf, len);
+	return codeToName.at(c).c_str();
+}
 
-	using namespace BinaryMessage;
+ResponseMessage::Code ResponseMessage::stringToCode(const std::string& name)
+{
+	const auto codeIt = nameToCode.find(name);
+	ENFORCE(IOException, codeIt != end(nameToCode), "The response code is invalid.");
+	return codeIt->second;
+}
+#endif
 
-	auto load = getPayload(buf);
-	// Make sure the payload contains for our expected data (respondingTo ID and code)
-	ENFORCE(IOException, load.second >= sizeof(message_id_t) + 1, "The provided message is too small.");
+std::unique_ptr<ResponseMessage> ResponseMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
 
+std::unique_ptr<ResponseMessage> ResponseMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
 	static_assert(sizeof(message_id_t) == 2, "Someone changed the message ID size");
-	message_id_t resp = extractUInt16(load.first);
-	load.first += 2;
-	Code c = (Code)*load.first;
+	const BinaryMessage::ResponseView resp(view);
 
 	// Binary response messages contain no strings. Not worth the trouble or bandwidth.
 	return std::unique_ptr<ResponseMessage>(
-		new ResponseMessage(msg->id, resp, c, ""));
+		new ResponseMessage(resp.getID(), resp.getRespondingTo(), resp.getCode(), ""));
 }
 
-std::vector<uint8_t> ResponseMessage::getBinaryPayload() const
+void ResponseMessage::writeBinaryPayload(uint8_t* buf) const
 {
-	assert(Message::getBinaryPayload().size() == 0);
+	assert(Message::getBinaryPayloadLength() == 0);
 
-	vector<uint8_t> ret;
-	BinaryMessage::appendInt(ret, respondingTo);
-	ret.emplace_back((uint8_t)code);
-	return ret;
+	buf = BinaryMessage::writeInt(buf, respondingTo);
+	*buf = (uint8_t)code;
 }
 
 bool ResponseMessage::operator==(const Message& o) const
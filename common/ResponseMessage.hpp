@@ -34,14 +34,27 @@ public:
 	static std::unique_ptr<ResponseMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	/// Gets the name of a response code as it appears in JSON, e.g. "ok"
+	static const char* codeToString(Code c);
+
+	/// Gets the response code with the given JSON name
+	/// \throws Exceptions::IOException if there is no such code
+	static Code stringToCode(const std::string& name);
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
 	/// \brief Deserializes a message from a binary buffer
 	/// \warning Do not call this directly. Call binaryToMessage instead.
 	static std::unique_ptr<ResponseMessage> fromBinary(uint8_t* buf, size_t len);
 
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ResponseMessage> fromBinary(const BinaryMessage::MessageView& view);
+
 	/**
-	 * \brief Gets the response's binary payload
+	 * \brief Writes the response's binary payload
 	 *
 	 * The payload consists of:
 	 * - A 16-bit usnsigned integer representing the ID of the message being acknowledged
@@ -50,7 +63,9 @@ public:
 	 *
 	 * Note that the string is omitted.
 	 */
-	std::vector<uint8_t> getBinaryPayload() const override;
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override { return sizeof(respondingTo) + 1; }
 
 	const message_id_t respondingTo;
 
@@ -60,5 +75,7 @@ public:
 
 	virtual Type getType() const override { return Type::RESPONSE; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new ResponseMessage(*this)); }
+
 	bool operator==(const Message& o) const override;
 };
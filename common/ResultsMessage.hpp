@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BinaryMessageViews.hpp"
 #include "Message.hpp"
 
 /// A request to get the results of a match.
@@ -19,16 +20,24 @@ public:
 	}
 #endif
 
-	/// The ResultsMessage is not serializable to binary
-	/// \throws Exceptions::InvalidOperationException upon being called
-	std::vector<uint8_t> getBinaryPayload() const override
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ResultsMessage> fromBinary(uint8_t* buf, size_t len)
 	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
+		return fromBinary(BinaryMessage::MessageView(buf, len));
+	}
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ResultsMessage> fromBinary(const BinaryMessage::MessageView& view)
+	{
+		return std::unique_ptr<ResultsMessage>(new ResultsMessage(view.getID()));
 	}
 
 	Type getType() const override { return Type::RESULTS; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new ResultsMessage(*this)); }
+
 	bool operator==(const Message& o) const override
 	{
 		return Message::operator==(o) && dynamic_cast<const ResultsMessage*>(&o) != nullptr;
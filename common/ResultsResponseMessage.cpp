@@ -2,7 +2,10 @@
 
 #include <utility>
 
+#include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace std;
 using namespace Exceptions;
@@ -49,7 +52,8 @@ PlayerStats parseStats(const Value& stat)
 	ENFORCE(IOException, hitsValue.isInt(), "A player's hit count is not an integer.");
 	ENFORCE(IOException, shotsValue.isArray(), "A player's shot list is not an array.");
 
-	return PlayerStats((score_t)scoreValue.asInt(), (shot_t)hitsValue.asInt(), parseShots(shotsValue));
+	return PlayerStats((score_t)scoreValue.asInt(), (shot_t)hitsValue.asInt(), parseShots(shotsValue),
+	                   ShotStatistics::fromJSON(stat));
 }
 #endif
 
@@ -102,6 +106,7 @@ Json::Value ResultsResponseMessage::toJSON() const
 
 		statValue[scoreKey] = stat.score;
 		statValue[hitsKey] = stat.hits;
+		stat.statistics.addToJSON(statValue);
 
 		Value shots(arrayValue);
 
@@ -117,8 +122,96 @@ Json::Value ResultsResponseMessage::toJSON() const
 
 	return ret;
 }
+
+void ResultsResponseMessage::writeJSONFields(JSONWriter& writer) const
+{
+	ResponseMessage::writeJSONFields(writer);
+
+	writer.key(playerStatsKey.c_str());
+	writer.beginArray();
+	for (const auto& stat : stats) {
+		writer.beginObject();
+		writer.key(scoreKey.c_str());
+		writer.value(stat.score);
+		writer.key(hitsKey.c_str());
+		writer.value(stat.hits);
+		stat.statistics.writeJSONMembers(writer);
+
+		writer.key(shotsKey.c_str());
+		writer.beginArray();
+		for (const auto& shot : stat.shots)
+			shot.writeJSON(writer);
+		writer.endArray();
+
+		writer.endObject();
+	}
+	writer.endArray();
+}
 #endif
 
+std::unique_ptr<ResultsResponseMessage> ResultsResponseMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<ResultsResponseMessage> ResultsResponseMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	BinaryMessage::PayloadReader reader(view);
+
+	const message_id_t respTo = reader.readUInt16();
+	ENFORCE(IOException, (Code)reader.readByte() == Code::OK,
+	        "Full results response payloads must have an OK response code.");
+
+	StatsList playerStats;
+	while (!reader.atEnd()) {
+		const score_t score = reader.readInt16();
+		const shot_t hits = reader.readInt16();
+		const auto statistics = ShotStatistics::fromBinary(reader.readBytes(ShotStatistics::binaryLength),
+		                                                   ShotStatistics::binaryLength);
+		const size_t shotCount = reader.readUInt16();
+
+		vector<Shot> shots;
+		shots.reserve(shotCount);
+		for (size_t i = 0; i < shotCount; ++i)
+			shots.emplace_back(reader.readShot());
+
+		playerStats.emplace_back(score, hits, move(shots), statistics);
+	}
+
+	return std::unique_ptr<ResultsResponseMessage>(
+		new ResultsResponseMessage(view.getID(), respTo, "", move(playerStats)));
+}
+
+void ResultsResponseMessage::writeBinaryPayload(uint8_t* buf) const
+{
+	ResponseMessage::writeBinaryPayload(buf);
+	buf += ResponseMessage::getBinaryPayloadLength();
+
+	for (const auto& player : stats) {
+		buf = BinaryMessage::writeInt(buf, player.score);
+		buf = BinaryMessage::writeInt(buf, player.hits);
+		buf = player.statistics.writeBinary(buf);
+		buf = BinaryMessage::writeInt(buf, (uint16_t)player.shots.size());
+
+		for (const auto& shot : player.shots)
+			buf = shot.writeBinary(buf);
+	}
+}
+
+size_t ResultsResponseMessage::getBinaryPayloadLength() const
+{
+	size_t ret = ResponseMessage::getBinaryPayloadLength();
+
+	for (const auto& player : stats) {
+		ENFORCE(ArgumentOutOfRangeException, player.shots.size() <= 0xffff,
+		        "A player took too many shots to serialize to binary.");
+		ret += sizeof(score_t) + sizeof(shot_t) + ShotStatistics::binaryLength + sizeof(uint16_t)
+			+ player.shots.size() * Shot::binaryLength;
+	}
+
+	return ret;
+}
+
 bool ResultsResponseMessage::operator==(const Message& o) const
 {
 	if (!ResponseMessage::operator==(o))
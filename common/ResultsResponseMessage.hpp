@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "Exceptions.hpp"
+#include "PlayerStatistics.hpp"
 #include "ResponseMessage.hpp"
 #include "Shot.hpp"
 
@@ -17,14 +18,19 @@ public:
 		const score_t score; ///< The player's final score
 		const shot_t hits; ///< The player's final hit count
 		const std::vector<Shot> shots; ///< A list of shots the player took
+		const ShotStatistics statistics; ///< The player's final statistics
 
-		PlayerStats(score_t s, shot_t h, std::vector<Shot>&& t) :
+		PlayerStats(score_t s, shot_t h, std::vector<Shot>&& t, const ShotStatistics& st = ShotStatistics()) :
 			score(s),
 			hits(h),
-			shots(std::move(t))
+			shots(std::move(t)),
+			statistics(st)
 		{ }
 
-		bool operator==(const PlayerStats& o) const { return score == o.score && hits == o.hits && shots == o.shots; }
+		bool operator==(const PlayerStats& o) const
+		{
+			return score == o.score && hits == o.hits && shots == o.shots && statistics == o.statistics;
+		}
 	};
 
 	typedef std::vector<PlayerStats> StatsList;
@@ -45,18 +51,42 @@ public:
 	static std::unique_ptr<ResultsResponseMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
-	/// The ResultsResponseMessage is not serializable to binary
-	/// \throws Exceptions::InvalidOperationException upon being called
-	std::vector<uint8_t> getBinaryPayload() const override
-	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
-	}
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ResultsResponseMessage> fromBinary(uint8_t* buf, size_t len);
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ResultsResponseMessage> fromBinary(const BinaryMessage::MessageView& view);
+
+	/**
+	 * \brief Writes the results response message's binary payload
+	 *
+	 * A results response message has the following payload:
+	 * - The payload of a ResponseMessage (see ResponseMessage::writeBinaryPayload).
+	 *   Like other binary responses, the message string is not sent.
+	 * - For each player, until the end of the payload:
+	 *   - A 16-bit signed integer for the player's score
+	 *   - A 16-bit signed integer for the player's hit count
+	 *   - The player's statistics, as written by ShotStatistics::writeBinary
+	 *   - A 16-bit unsigned integer for the number of shots that follow
+	 *   - Each shot, as written by Shot::writeBinary
+	 *
+	 * Since a binary payload can be at most 64 KiB, this holds a little under eleven thousand shots.
+	 */
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	/// \throws Exceptions::ArgumentOutOfRangeException if a player took too many shots to count in 16 bits
+	size_t getBinaryPayloadLength() const override;
 
 	Type getType() const override { return Type::RESULTS_RESPONSE; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new ResultsResponseMessage(*this)); }
+
 	bool operator==(const Message& o) const override;
 
 	const StatsList stats;
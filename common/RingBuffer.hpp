@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Exceptions.hpp"
+
+/**
+ * \brief A bounded, lock-free, multi-producer/single-consumer ring buffer
+ * \tparam T The element type. Elements are copied in and out, so keep this small (e.g. a pointer).
+ *
+ * Each cell carries a sequence number which tells producers and the consumer
+ * whose turn it is to use it (see Dmitry Vyukov's bounded MPMC queue).
+ * Producers claim a slot with a single compare-and-swap.
+ * Since there is only one consumer, popping needs no read-modify-write at all.
+ *
+ * Any number of threads may call tryPush, but only one thread at a time may call
+ * tryPop or tryPeek.
+ */
+template <typename T>
+class MPSCRingBuffer {
+
+public:
+
+	/// Creates a buffer with room for at least `minCapacity` elements
+	/// (the capacity is rounded up to a power of two).
+	explicit MPSCRingBuffer(size_t minCapacity) :
+		cells(),
+		mask(roundUp(minCapacity) - 1),
+		enqueuePos(0),
+		padding(),
+		dequeuePos(0)
+	{
+		cells.reset(new Cell[mask + 1]);
+		for (size_t i = 0; i <= mask; ++i)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/// Tries to place an element at the back of the buffer.
+	/// Returns false if the buffer is full.
+	bool tryPush(const T& value)
+	{
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+
+		while (true) {
+			cell = &cells[pos & mask];
+			const size_t seq = cell->sequence.load(std::memory_order_acquire);
+			const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+			if (diff == 0) {
+				// The cell is free. Try to claim it.
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) {
+				// The consumer hasn't gotten to this cell yet. We're full.
+				return false;
+			}
+			else {
+				// Another producer beat us to it.
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data = value;
+		// Publish the element to the consumer
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Tries to take an element from the front of the buffer.
+	/// Returns false if the buffer is empty. Consumer only.
+	bool tryPop(T& out)
+	{
+		const size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		Cell& cell = cells[pos & mask];
+
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+			return false;
+
+		out = cell.data;
+		// Hand the cell back to the producers for the next lap around the buffer
+		cell.sequence.store(pos + mask + 1, std::memory_order_release);
+		dequeuePos.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/// Copies the element at the front of the buffer without removing it.
+	/// Returns false if the buffer is empty. Consumer only.
+	bool tryPeek(T& out) const
+	{
+		const size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		const Cell& cell = cells[pos & mask];
+
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+			return false;
+
+		out = cell.data;
+		return true;
+	}
+
+	/// Returns true if the buffer appeared empty at the time of the call
+	bool empty() const
+	{
+		return dequeuePos.load(std::memory_order_acquire) == enqueuePos.load(std::memory_order_acquire);
+	}
+
+	/// Returns the number of elements the buffer can hold
+	size_t capacity() const { return mask + 1; }
+
+	// Disallow copy and assign
+	MPSCRingBuffer(const MPSCRingBuffer&) = delete;
+	MPSCRingBuffer& operator=(const MPSCRingBuffer&) = delete;
+
+private:
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	static size_t roundUp(size_t minCapacity)
+	{
+		ENFORCE(Exceptions::ArgumentOutOfRangeException, minCapacity > 0,
+		        "A ring buffer must have room for at least one element.");
+
+		size_t ret = 1;
+		while (ret < minCapacity)
+			ret <<= 1;
+		return ret;
+	}
+
+	std::unique_ptr<Cell[]> cells;
+
+	const size_t mask;
+
+	std::atomic<size_t> enqueuePos;
+
+	// Keep the producer and consumer positions on separate cache lines
+	// so they don't bounce back and forth between cores.
+	// (alignas would do this more neatly, but C++11 can't heap-allocate over-aligned types.)
+	char padding[64 - sizeof(std::atomic<size_t>)];
+
+	std::atomic<size_t> dequeuePos;
+};
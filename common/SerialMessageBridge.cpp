@@ -0,0 +1,335 @@
+#include "SerialMessageBridge.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include "BinaryMessageViews.hpp"
+#include "EventCount.hpp"
+#include "Exceptions.hpp"
+#include "FrameDecoder.hpp"
+#include "ShotMessage.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace BinaryMessage;
+
+namespace {
+
+/// The boards buffer 256 bytes per frame, so nothing bigger is legitimate.
+const size_t maxHardwarePayload = 256 - frameOverhead;
+
+/// How many bytes we're willing to read in one go
+const size_t readBufferSize = 4096;
+
+/// How many bytes of outgoing frames we batch into one write
+const size_t writeBufferSize = 4096;
+
+/// How many incoming frames to pass along before checking on outgoing traffic again
+const int maxFramesPerWake = 64;
+
+speed_t toSpeed(unsigned int baud)
+{
+	switch (baud) {
+		case 1200: return B1200;
+		case 2400: return B2400;
+		case 4800: return B4800;
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		default:
+			THROW(ArgumentOutOfRangeException, "Unsupported baud rate: " + to_string(baud));
+	}
+}
+
+/// Closes a file descriptor when it goes out of scope
+class FDCloser {
+public:
+	explicit FDCloser(int f) : fd(f) { }
+	~FDCloser() { close(fd); }
+
+	FDCloser(const FDCloser&) = delete;
+	FDCloser& operator=(const FDCloser&) = delete;
+
+private:
+	const int fd;
+};
+
+/// Has a queue notify an EventCount for as long as it is in scope
+class ListenerScope {
+public:
+	ListenerScope(MessageQueue& queue, EventCount& events) : q(queue) { q.setListener(&events); }
+	~ListenerScope() { q.setListener(nullptr); }
+
+	ListenerScope(const ListenerScope&) = delete;
+	ListenerScope& operator=(const ListenerScope&) = delete;
+
+private:
+	MessageQueue& q;
+};
+
+string errorString(const string& what)
+{
+	return what + ": " + strerror(errno);
+}
+
+/// Outgoing frames waiting to be written
+class WriteBuffer {
+public:
+
+	WriteBuffer() : buf(writeBufferSize), start(0), end(0) { }
+
+	bool empty() const { return start == end; }
+
+	/// Serializes the message onto the end of the buffer. Returns false if there isn't room.
+	bool append(const Message& msg)
+	{
+		const size_t len = msg.getBinaryLength();
+
+		if (start == end)
+			start = end = 0;
+
+		if (len > buf.size() - end) {
+			// Make room by sliding pending bytes to the front, or grow if we're empty
+			// and the message is bigger than the whole buffer.
+			memmove(buf.data(), buf.data() + start, end - start);
+			end -= start;
+			start = 0;
+
+			if (len > buf.size() - end) {
+				if (!empty())
+					return false;
+				buf.resize(len);
+			}
+		}
+
+		end += msg.toBinary(buf.data() + end, buf.size() - end);
+		return true;
+	}
+
+	/// Writes as much as the descriptor will take without blocking
+	void flush(int fd)
+	{
+		while (!empty()) {
+			const ssize_t written = write(fd, buf.data() + start, end - start);
+			if (written < 0) {
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return;
+				THROW(IOException, errorString("Could not write to the serial device"));
+			}
+			start += (size_t)written;
+		}
+	}
+
+	WriteBuffer(const WriteBuffer&) = delete;
+	WriteBuffer& operator=(const WriteBuffer&) = delete;
+
+private:
+
+	std::vector<uint8_t> buf;
+	size_t start;
+	size_t end;
+};
+
+} // end anonymous namespace
+
+void runSerialMessageBridge(MessageQueue& in, MessageQueue& out, const std::string& device, unsigned int baud)
+{
+	const speed_t speed = toSpeed(baud);
+
+	const int fd = open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+		THROW(IOException, errorString("Could not open " + device));
+
+	FDCloser closer(fd);
+
+	termios tio;
+	if (tcgetattr(fd, &tio) != 0)
+		THROW(IOException, errorString("Could not get the attributes of " + device));
+
+	// Raw 8N1, no flow control, and reads return whatever is available
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(tcflag_t)CSTOPB;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+
+	if (tcsetattr(fd, TCSANOW, &tio) != 0)
+		THROW(IOException, errorString("Could not configure " + device));
+
+	// Throw out anything that was sitting in the port from before we showed up.
+	tcflush(fd, TCIOFLUSH);
+
+	runSerialMessageBridgeFD(in, out, fd);
+}
+
+void runSerialMessageBridgeFD(MessageQueue& in, MessageQueue& out, int fd)
+{
+	const int epfd = epoll_create1(0);
+	if (epfd < 0)
+		THROW(IOException, errorString("Could not create an epoll instance"));
+
+	FDCloser closer(epfd);
+
+	epoll_event interest;
+	memset(&interest, 0, sizeof(interest));
+	interest.events = EPOLLIN;
+	interest.data.fd = fd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &interest) != 0)
+		THROW(IOException, errorString("Could not watch the serial device"));
+
+	// `in` signals this whenever a message arrives while we're asleep, so we can sleep in epoll for as long as it takes.
+	const int wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeFD < 0)
+		THROW(IOException, errorString("Could not create an eventfd"));
+
+	FDCloser wakeCloser(wakeFD);
+
+	epoll_event wakeInterest;
+	memset(&wakeInterest, 0, sizeof(wakeInterest));
+	wakeInterest.events = EPOLLIN;
+	wakeInterest.data.fd = wakeFD;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, wakeFD, &wakeInterest) != 0)
+		THROW(IOException, errorString("Could not watch the eventfd"));
+
+	EventCount arrivals;
+	arrivals.setEventFD(wakeFD);
+	ListenerScope listening(in, arrivals);
+
+	FrameDecoder decoder(maxHardwarePayload, readBufferSize);
+	WriteBuffer outgoing;
+
+	// A message we pulled from `in` that didn't fit in the write buffer yet
+	unique_ptr<Message> held;
+
+	while (true) {
+		// Batch up whatever is waiting to go out, then send it in as few writes as we can.
+		while (true) {
+			if (held == nullptr)
+				held = in.receive(milliseconds(0));
+
+			if (held == nullptr)
+				break;
+
+			if (held->getType() == Message::Type::EXIT)
+				return;
+
+			if (!outgoing.append(*held))
+				break;
+
+			held.reset();
+		}
+
+		outgoing.flush(fd);
+
+		// Pass along frames we've already received.
+		// If `out` is full, sending blocks, and we stop reading until it drains.
+		int frames = 0;
+		for (const uint8_t* frame = decoder.next(); frame != nullptr; frame = decoder.next()) {
+			try {
+				const auto view = MessageView::fromValidated(frame);
+
+				// Shots are nearly all the hardware sends, so decode them straight from the frame.
+				// The message still has to be built for the junction, but it comes from the message pool.
+				if (view.getType() == Message::Type::SHOT) {
+					const ShotView shot(view);
+					out.send(unique_ptr<Message>(new ShotMessage(shot.getID(), shot.toShot())));
+				}
+				else {
+					out.send(binaryToMessage(view));
+				}
+			}
+			catch (const Exception&) {
+				// The frame was fine, but it's not a message type we know how to read in binary,
+				// or what it holds doesn't make a valid message (say, a shot with a negative time).
+			}
+
+			if (++frames == maxFramesPerWake)
+				break;
+		}
+
+		// Only ask to read if we have room to read into,
+		// and only ask to write if we have something to write.
+		const bool decoderFull = decoder.prepare().second == 0;
+		uint32_t events = 0;
+		if (!decoderFull)
+			events |= EPOLLIN;
+		if (!outgoing.empty())
+			events |= EPOLLOUT;
+		if (events != interest.events) {
+			interest.events = events;
+			if (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &interest) != 0)
+				THROW(IOException, errorString("Could not watch the serial device"));
+		}
+
+		// Announce that we're about to sleep, then check for messages once more
+		// so that one sent in the meantime signals the eventfd instead of going unnoticed.
+		// If we stopped early with frames left over, or there are messages we could take, don't sleep.
+		arrivals.prepareWait();
+		const bool busy = frames == maxFramesPerWake || (held == nullptr && !in.empty());
+
+		epoll_event ready[2];
+		const int count = epoll_wait(epfd, ready, 2, busy ? 0 : -1);
+		arrivals.cancelWait();
+
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			THROW(IOException, errorString("Could not wait on the serial device"));
+		}
+
+		bool readable = false;
+		for (int i = 0; i < count; ++i) {
+			if (ready[i].data.fd == wakeFD) {
+				// Reset the eventfd. The messages themselves get picked up at the top of the loop.
+				uint64_t ignored;
+				if (read(wakeFD, &ignored, sizeof(ignored)) < 0 && errno != EAGAIN)
+					THROW(IOException, errorString("Could not read the eventfd"));
+				continue;
+			}
+
+			if ((ready[i].events & (EPOLLERR | EPOLLHUP)) != 0)
+				THROW(IOException, "The serial device hung up");
+
+			readable = (ready[i].events & EPOLLIN) != 0;
+		}
+
+		if (!readable)
+			continue;
+
+		// Fill the decoder as far as it will go.
+		while (true) {
+			auto space = decoder.prepare();
+			if (space.second == 0)
+				break;
+
+			const ssize_t got = read(fd, space.first, space.second);
+			if (got < 0) {
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					break;
+				THROW(IOException, errorString("Could not read from the serial device"));
+			}
+
+			if (got == 0)
+				break;
+
+			decoder.commit((size_t)got);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include "MessageQueue.hpp"
+
+/**
+ * \brief Passes binary Messages to and from the hardware over a serial port
+ * \param in Messages to send to the hardware. The bridge returns when it receives an ExitMessage.
+ * \param out Messages received from the hardware
+ * \param device The path of the serial device, e.g. /dev/ttyUSB0
+ * \param baud The baud rate of the serial line. The boards' UARTs run at 9600.
+ * \throws Exceptions::IOException if the device can't be opened or configured, or if it goes away
+ *
+ * The device is put in raw, non-blocking mode. See runSerialMessageBridgeFD for how messages are moved.
+ */
+void runSerialMessageBridge(MessageQueue& in, MessageQueue& out,
+                            const std::string& device, unsigned int baud = 9600);
+
+/**
+ * \brief Passes binary Messages to and from the hardware over an open, non-blocking file descriptor
+ * \param in Messages to send to the hardware. The bridge returns when it receives an ExitMessage.
+ * \param out Messages received from the hardware
+ * \param fd The file descriptor to use, e.g. a configured serial port or the master side of a PseudoTerminal.
+ *           The bridge does not close it.
+ *
+ * Outgoing messages are serialized back to back into a single buffer and written with as few
+ * system calls as possible. Incoming bytes are reassembled into frames by a BinaryMessage::FrameDecoder,
+ * which skips over line noise and anything with a bad CRC.
+ * Frames of types that have no binary form (such as debug output) are dropped.
+ *
+ * The bridge sleeps in epoll until the device is ready or a message arrives on `in`,
+ * which wakes it through an eventfd (see EventCount::setEventFD). It takes over `in`'s listener
+ * (see MessageQueue::setListener) while it runs.
+ *
+ * The bridge only reads as much as its decoder has room for, and only a bounded number of frames
+ * are passed along between checks for outgoing traffic. If `out` is a bounded (LOCK_FREE) queue
+ * and fills up, the bridge stops reading until it drains, leaving bytes in the kernel's buffers
+ * instead of piling them up in memory.
+ */
+void runSerialMessageBridgeFD(MessageQueue& in, MessageQueue& out, int fd);
@@ -3,7 +3,10 @@
 #include <algorithm>
 #include <utility>
 
+#include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace std;
 using namespace Exceptions;
@@ -29,7 +32,7 @@ SetupMessage::DataMap parseGameData(const Value& data)
 {
 	SetupMessage::DataMap ret;
 
-	for (ValueIterator it = begin(data); it != end(data); ++it) {
+	for (ValueConstIterator it = begin(data); it != end(data); ++it) {
 		const Value& val = *it;
 		ENFORCE(IOException, val.isInt(), "The game data contained a value that was not an integer.");
 		ret[it.key().asString()] = val.asInt();
@@ -103,9 +106,82 @@ Json::Value SetupMessage::toJSON() const
 
 	return ret;
 }
+
+void SetupMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	writer.key(gameTypeKey.c_str());
+	writer.value((int)gameType);
+	writer.key(playerCountKey.c_str());
+	writer.value(playerCount);
+	writer.key(gameLengthKey.c_str());
+	writer.value(gameLength);
+	writer.key(winningScoreKey.c_str());
+	writer.value(winningScore);
+
+	writer.key(gameDataKey.c_str());
+	writer.beginObject();
+	for (const auto& pair : gameData) {
+		writer.key(pair.first.c_str());
+		writer.value(pair.second);
+	}
+	writer.endObject();
+}
 #endif
 
 
+std::unique_ptr<SetupMessage> SetupMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<SetupMessage> SetupMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	BinaryMessage::PayloadReader reader(view);
+
+	const GameType gType = (GameType)reader.readByte();
+	const board_id_t pCount = (board_id_t)reader.readByte();
+	const duration_t time = reader.readInt16();
+	const score_t score = reader.readInt16();
+
+	DataMap data;
+	while (!reader.atEnd()) {
+		const size_t keyLength = reader.readByte();
+		const char* key = (const char*)reader.readBytes(keyLength);
+		data[string(key, keyLength)] = reader.readInt32();
+	}
+
+	return std::unique_ptr<SetupMessage>(new SetupMessage(view.getID(), gType, pCount, time, score, move(data)));
+}
+
+void SetupMessage::writeBinaryPayload(uint8_t* buf) const
+{
+	*buf++ = (uint8_t)gameType;
+	*buf++ = (uint8_t)playerCount;
+	buf = BinaryMessage::writeInt(buf, gameLength);
+	buf = BinaryMessage::writeInt(buf, winningScore);
+
+	for (const auto& entry : gameData) {
+		*buf++ = (uint8_t)entry.first.size();
+		buf = copy(begin(entry.first), end(entry.first), buf);
+		buf = BinaryMessage::writeInt(buf, (int32_t)entry.second);
+	}
+}
+
+size_t SetupMessage::getBinaryPayloadLength() const
+{
+	size_t ret = 2 + sizeof(gameLength) + sizeof(winningScore);
+
+	for (const auto& entry : gameData) {
+		ENFORCE(ArgumentOutOfRangeException, entry.first.size() <= 0xff,
+		        "A game data key is too long to serialize to binary.");
+		ret += 1 + entry.first.size() + sizeof(int32_t);
+	}
+
+	return ret;
+}
+
 bool SetupMessage::operator==(const Message& o) const
 {
 	if (!Message::operator==(o))
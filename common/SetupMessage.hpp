@@ -21,16 +21,40 @@ public:
 	static std::unique_ptr<SetupMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
-	std::vector<uint8_t> getBinaryPayload() const override
-	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
-	}
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<SetupMessage> fromBinary(uint8_t* buf, size_t len);
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<SetupMessage> fromBinary(const BinaryMessage::MessageView& view);
+
+	/**
+	 * \brief Writes the setup message's binary payload
+	 *
+	 * A setup message has the following payload:
+	 * - One unsigned byte for the game type
+	 * - One signed byte for the player count
+	 * - A 16-bit signed integer for the game length
+	 * - A 16-bit signed integer for the winning score
+	 * - For each entry in the game data, until the end of the payload:
+	 *   - One unsigned byte for the length of the key
+	 *   - The key's bytes
+	 *   - A 32-bit signed integer for the value
+	 */
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	/// \throws Exceptions::ArgumentOutOfRangeException if a game data key is too long for the binary format
+	size_t getBinaryPayloadLength() const override;
 
 	Type getType() const override { return Type::SETUP; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new SetupMessage(*this)); }
+
 	/// The type of game to play
 	const GameType gameType;
 
@@ -4,6 +4,8 @@
 
 #include "BinaryMessage.hpp"
 #include "Exceptions.hpp"
+#include "JSONReader.hpp"
+#include "JSONWriter.hpp"
 
 using namespace std;
 using namespace Exceptions;
@@ -43,6 +45,18 @@ Json::Value Shot::toJSON() const
 	return shotValue;
 }
 
+void Shot::writeJSON(JSONWriter& writer) const
+{
+	writer.beginObject();
+	writer.key(playerKey.c_str());
+	writer.value(player);
+	writer.key(targetKey.c_str());
+	writer.value(target);
+	writer.key(timeKey.c_str());
+	writer.value(time);
+	writer.endObject();
+}
+
 Shot Shot::fromJSON(const Json::Value& value)
 {
 	ENFORCE(IOException, value.isObject(), "A shot is not an object.");
@@ -68,21 +82,67 @@ Shot Shot::fromJSON(const Json::Value& value)
 
 	return Shot((board_id_t)p, (board_id_t)tar, time);
 }
-#endif
 
-std::vector<uint8_t> Shot::toBinary() const
+Shot Shot::readJSON(JSONReader& reader)
 {
-	using namespace BinaryMessage;
+	ENFORCE(IOException, reader.peek() == JSONReader::Token::OBJECT, "A shot is not an object.");
+
+	bool hasPlayer = false;
+	bool hasTarget = false;
+	bool hasTime = false;
+	int p = 0;
+	int tar = 0;
+	int time = 0;
+
+	reader.beginObject();
+	while (reader.nextMember()) {
+		if (reader.isKey(playerKey.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::NUMBER, "A shot's player ID is not an integer.");
+			p = reader.readInt();
+			hasPlayer = true;
+		}
+		else if (reader.isKey(targetKey.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::NUMBER, "A shot's target ID is not an integer.");
+			tar = reader.readInt();
+			hasTarget = true;
+		}
+		else if (reader.isKey(timeKey.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::NUMBER, "A shot's timestamp is not an integer.");
+			time = reader.readInt();
+			hasTime = true;
+		}
+		else {
+			reader.skipValue();
+		}
+	}
+
+	ENFORCE(IOException, hasPlayer, "A shot is missing its player ID.");
+	ENFORCE(IOException, hasTarget, "A shot is missing its target ID.");
+	ENFORCE(IOException, hasTime, "A shot is missing its timestamp.");
+
+	ENFORCE(IOException, p >= -128 && p < 128, "A shot's player ID is not representable by a byte.");
+	ENFORCE(IOException, tar >= -128 && tar < 128, "A shot's target ID is not representable by a byte.");
 
-	vector<uint8_t> ret;
+	return Shot((board_id_t)p, (board_id_t)tar, time);
+}
+#endif
 
-	ret.emplace_back(player);
-	ret.emplace_back(target);
-	appendInt(ret, time);
+const size_t Shot::binaryLength;
 
+std::vector<uint8_t> Shot::toBinary() const
+{
+	vector<uint8_t> ret(binaryLength);
+	writeBinary(ret.data());
 	return ret;
 }
 
+uint8_t* Shot::writeBinary(uint8_t* buf) const
+{
+	*buf++ = (uint8_t)player;
+	*buf++ = (uint8_t)target;
+	return BinaryMessage::writeInt(buf, time);
+}
+
 Shot Shot::fromBinary(const uint8_t* buf, size_t len)
 {
 	// Quick checks that I didn't forget to update this function if sizes change
@@ -9,6 +9,9 @@
 
 #include "GameTypes.hpp"
 
+class JSONReader;
+class JSONWriter;
+
 /// Represents a shot with an idicator about whether or not it was hit
 class Shot {
 public:
@@ -20,10 +23,23 @@ public:
 	Json::Value toJSON() const;
 
 	static Shot fromJSON(const Json::Value& value);
+
+	/// Writes the shot as a JSON object, the same one toJSON() would give
+	void writeJSON(JSONWriter& writer) const;
+
+	/// Reads a shot from the JSON object the reader is at, as fromJSON would from a Json::Value
+	static Shot readJSON(JSONReader& reader);
 #endif
 
+	/// The length of a shot's binary representation
+	static const size_t binaryLength = sizeof(board_id_t) * 2 + sizeof(timestamp_t);
+
 	std::vector<uint8_t> toBinary() const;
 
+	/// Writes the shot's binary representation (binaryLength bytes) to `buf`
+	/// and returns a pointer just past it
+	uint8_t* writeBinary(uint8_t* buf) const;
+
 	static Shot fromBinary(const uint8_t* buf, size_t len);
 
 	bool operator==(const Shot& o) const;
@@ -0,0 +1,71 @@
+#include "ShotLog.hpp"
+
+#include <algorithm>
+
+#include "Exceptions.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+ShotLog::ShotLog(board_id_t playerCount) :
+	players((size_t)max(playerCount, (board_id_t)0))
+{
+}
+
+bool ShotLog::record(const Shot& s)
+{
+	ENFORCE(ArgumentOutOfRangeException, s.player >= 0 && (size_t)s.player < players.size(),
+	        "The shot came from a player who isn't in the log.");
+
+	Columns& log = players[(size_t)s.player];
+
+	// The common case: the shot is the newest one yet.
+	if (log.times.empty() || log.times.back() < s.time) {
+		log.targets.emplace_back(s.target);
+		log.times.emplace_back(s.time);
+		return true;
+	}
+
+	// Otherwise it arrived late (or twice). Find where it belongs, after any shots taken at the same time.
+	const auto sameTime = equal_range(begin(log.times), end(log.times), s.time);
+	const auto first = (size_t)(sameTime.first - begin(log.times));
+	const auto last = (size_t)(sameTime.second - begin(log.times));
+
+	for (size_t i = first; i < last; ++i) {
+		if (log.targets[i] == s.target)
+			return false;
+	}
+
+	log.targets.insert(begin(log.targets) + (ptrdiff_t)last, s.target);
+	log.times.insert(begin(log.times) + (ptrdiff_t)last, s.time);
+	return true;
+}
+
+void ShotLog::clear()
+{
+	// Keep the columns' storage around for the next game.
+	for (auto& log : players) {
+		log.targets.clear();
+		log.times.clear();
+	}
+}
+
+size_t ShotLog::size() const
+{
+	size_t ret = 0;
+	for (const auto& log : players)
+		ret += log.times.size();
+	return ret;
+}
+
+std::vector<Shot> ShotLog::shotsFor(board_id_t player) const
+{
+	const Columns& log = players.at((size_t)player);
+
+	std::vector<Shot> ret;
+	ret.reserve(log.times.size());
+	for (size_t i = 0; i < log.times.size(); ++i)
+		ret.emplace_back(player, log.targets[i], log.times[i]);
+
+	return ret;
+}
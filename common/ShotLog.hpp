@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "GameTypes.hpp"
+#include "Shot.hpp"
+
+/**
+ * \brief An append-only record of the shots fired during a game, kept in time order for each player
+ *
+ * Each player's shots are stored as columns (one array of targets and one of times)
+ * rather than as an array of Shots. Shots arrive in time order for the most part,
+ * so recording one is almost always an append, and getting a player's shots for the results
+ * takes no hashing or sorting. Shots that show up late are slotted in where they belong.
+ */
+class ShotLog {
+
+public:
+
+	/// Creates an empty log for the given number of players
+	explicit ShotLog(board_id_t playerCount);
+
+	/**
+	 * \brief Records a shot
+	 * \returns false if the same shot was already recorded (e.g. because it was sent twice)
+	 * \throws Exceptions::ArgumentOutOfRangeException if the shot's player isn't in the log
+	 */
+	bool record(const Shot& s);
+
+	/// Forgets all the shots
+	void clear();
+
+	/// Gets the number of players in the log
+	size_t playerCount() const { return players.size(); }
+
+	/// Gets the number of shots recorded for all players
+	size_t size() const;
+
+	/// Gets the number of shots a player took
+	size_t countFor(board_id_t player) const { return players.at((size_t)player).times.size(); }
+
+	/// Gets a player's shots, in the order they were taken
+	std::vector<Shot> shotsFor(board_id_t player) const;
+
+private:
+
+	/// One player's shots, in time order
+	struct Columns {
+		std::vector<board_id_t> targets;
+		std::vector<timestamp_t> times;
+
+		Columns() : targets(), times() { }
+	};
+
+	std::vector<Columns> players;
+};
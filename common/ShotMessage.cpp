@@ -3,7 +3,9 @@
 #include <cassert>
 
 #include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace std;
 using namespace Exceptions;
@@ -51,21 +53,33 @@ Json::Value ShotMessage::toJSON() const
 
 	return ret;
 }
+
+void ShotMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	writer.key(shotKey.c_str());
+	shot.writeJSON(writer);
+}
 #endif
 
 std::unique_ptr<ShotMessage> ShotMessage::fromBinary(uint8_t* buf, size_t len)
 {
-	auto msg = Message::fromBinary(buf, len);
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<ShotMessage> ShotMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	const BinaryMessage::ShotView sv(view);
 
-	auto load = BinaryMessage::getPayload(buf);
 	return unique_ptr<ShotMessage>(
-		new ShotMessage(msg->id, Shot::fromBinary(load.first, load.second)));
+		new ShotMessage(sv.getID(), sv.toShot()));
 }
 
-std::vector<uint8_t> ShotMessage::getBinaryPayload() const
+void ShotMessage::writeBinaryPayload(uint8_t* buf) const
 {
-	assert(Message::getBinaryPayload().size() == 0);
-	return shot.toBinary();
+	assert(Message::getBinaryPayloadLength() == 0);
+	shot.writeBinary(buf);
 }
 
 bool ShotMessage::operator==(const Message& o) const
@@ -18,14 +18,20 @@ public:
 	static std::unique_ptr<ShotMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
 	/// \brief Deserializes a message from a binary buffer
 	/// \warning Do not call this directly. Call binaryToMessage instead.
 	static std::unique_ptr<ShotMessage> fromBinary(uint8_t* buf, size_t len);
 
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<ShotMessage> fromBinary(const BinaryMessage::MessageView& view);
+
 	/*
-	 * \brief Gets the shot message's binary payload
+	 * \brief Writes the shot message's binary payload
 	 *
 	 * A shot message has the following payload:
 	 * - One signed byte for the player/gun that fired the shot
@@ -34,12 +40,16 @@ public:
 	 * - A 32-bit signed integer representing the timestamp of the shot,
 	 *   in milliseconds since the game started.
 	 *
-	 * \see Shot::toBinary
+	 * \see Shot::writeBinary
 	 */
-	std::vector<uint8_t> getBinaryPayload() const override;
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override { return Shot::binaryLength; }
 
 	Type getType() const override { return Type::SHOT; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new ShotMessage(*this)); }
+
 	bool operator==(const Message& o) const override;
 
 	Shot shot;
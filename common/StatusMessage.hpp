@@ -1,7 +1,7 @@
 #pragma once
 
+#include "BinaryMessageViews.hpp"
 #include "Message.hpp"
-#include "Exceptions.hpp"
 
 /**
  * \brief Sent to query the current status of the system
@@ -24,16 +24,24 @@ public:
 	}
 #endif
 
-	/// The StatusMessage is not serializable to binary
-	/// \throws Exceptions::InvalidOperationException upon being called
-	std::vector<uint8_t> getBinaryPayload() const override
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<StatusMessage> fromBinary(uint8_t* buf, size_t len)
 	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
+		return fromBinary(BinaryMessage::MessageView(buf, len));
+	}
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<StatusMessage> fromBinary(const BinaryMessage::MessageView& view)
+	{
+		return std::unique_ptr<StatusMessage>(new StatusMessage(view.getID()));
 	}
 
 	Type getType() const override { return Type::STATUS; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new StatusMessage(*this)); }
+
 	bool operator==(const Message& o) const override
 	{
 		return Message::operator==(o) && dynamic_cast<const StatusMessage*>(&o) != nullptr;
@@ -2,7 +2,10 @@
 
 #include <utility>
 
+#include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace std;
 using namespace Exceptions;
@@ -38,7 +41,7 @@ StatusResponseMessage::PlayerList parseStats(const Value& stats)
 		ENFORCE(IOException, scoreValue.isInt(), "An element of the player stats does not have an integer score.");
 		ENFORCE(IOException, hitsValue.isInt(), "An element of the player stats does not have an integer hits value.");
 
-		ret.emplace_back(scoreValue.asInt(), hitsValue.asInt());
+		ret.emplace_back(scoreValue.asInt(), hitsValue.asInt(), ShotStatistics::fromJSON(obj));
 	}
 
 	return ret;
@@ -105,6 +108,7 @@ Json::Value StatusResponseMessage::toJSON() const
 		Value stat(objectValue);
 		stat[scoreKey] = player.score;
 		stat[hitsKey] = player.hits;
+		player.statistics.addToJSON(stat);
 		playerList.append(move(stat));
 	}
 
@@ -112,9 +116,81 @@ Json::Value StatusResponseMessage::toJSON() const
 
 	return ret;
 }
+
+void StatusResponseMessage::writeJSONFields(JSONWriter& writer) const
+{
+	ResponseMessage::writeJSONFields(writer);
+
+	writer.key(runningKey.c_str());
+	writer.value(running);
+	writer.key(timeRemainingKey.c_str());
+	writer.value(timeRemaining);
+	writer.key(winningScoreKey.c_str());
+	writer.value(winningScore);
+
+	writer.key(playerStatsKey.c_str());
+	writer.beginArray();
+	for (const auto& player : players) {
+		writer.beginObject();
+		writer.key(scoreKey.c_str());
+		writer.value(player.score);
+		writer.key(hitsKey.c_str());
+		writer.value(player.hits);
+		player.statistics.writeJSONMembers(writer);
+		writer.endObject();
+	}
+	writer.endArray();
+}
 #endif
 
 
+std::unique_ptr<StatusResponseMessage> StatusResponseMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<StatusResponseMessage> StatusResponseMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	BinaryMessage::PayloadReader reader(view);
+
+	const message_id_t respTo = reader.readUInt16();
+	ENFORCE(IOException, (Code)reader.readByte() == Code::OK,
+	        "Full status response messages must have an OK response code.");
+
+	const bool isRunning = reader.readByte() != 0;
+	const duration_t timeLeft = reader.readInt16();
+	const score_t winScore = reader.readInt16();
+
+	PlayerList playerStats;
+	playerStats.reserve(reader.remaining() / (sizeof(score_t) + sizeof(shot_t) + ShotStatistics::binaryLength));
+	while (!reader.atEnd()) {
+		const score_t score = reader.readInt16();
+		const shot_t hits = reader.readInt16();
+		const auto statistics = ShotStatistics::fromBinary(reader.readBytes(ShotStatistics::binaryLength),
+		                                                   ShotStatistics::binaryLength);
+		playerStats.emplace_back(score, hits, statistics);
+	}
+
+	return std::unique_ptr<StatusResponseMessage>(
+		new StatusResponseMessage(view.getID(), respTo, "", isRunning, timeLeft, winScore, move(playerStats)));
+}
+
+void StatusResponseMessage::writeBinaryPayload(uint8_t* buf) const
+{
+	ResponseMessage::writeBinaryPayload(buf);
+	buf += ResponseMessage::getBinaryPayloadLength();
+
+	*buf++ = running ? 1 : 0;
+	buf = BinaryMessage::writeInt(buf, timeRemaining);
+	buf = BinaryMessage::writeInt(buf, winningScore);
+
+	for (const auto& player : players) {
+		buf = BinaryMessage::writeInt(buf, player.score);
+		buf = BinaryMessage::writeInt(buf, player.hits);
+		buf = player.statistics.writeBinary(buf);
+	}
+}
+
 bool StatusResponseMessage::operator==(const Message& o) const
 {
 	if (!ResponseMessage::operator==(o))
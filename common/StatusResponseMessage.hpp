@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "Exceptions.hpp"
+#include "PlayerStatistics.hpp"
 #include "ResponseMessage.hpp"
 
 /// Sent as a response to a StatusMessage to indicate the current state of the system
@@ -14,10 +15,16 @@ public:
 	struct PlayerStats {
 		const score_t score;
 		const shot_t hits;
+		const ShotStatistics statistics; ///< Everything else we keep track of as the player shoots
 
-		PlayerStats(score_t s, shot_t h) : score(s), hits(h) { }
+		PlayerStats(score_t s, shot_t h, const ShotStatistics& st = ShotStatistics()) :
+			score(s), hits(h), statistics(st)
+		{ }
 
-		bool operator==(const PlayerStats& o) const { return score == o.score && hits == o.hits; }
+		bool operator==(const PlayerStats& o) const
+		{
+			return score == o.score && hits == o.hits && statistics == o.statistics;
+		}
 	};
 
 	typedef std::vector<PlayerStats> PlayerList;
@@ -43,18 +50,44 @@ public:
 	static std::unique_ptr<StatusResponseMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
-	/// The StatusResponseMessage is not serializable to binary
-	/// \throws Exceptions::InvalidOperationException upon being called
-	std::vector<uint8_t> getBinaryPayload() const override
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<StatusResponseMessage> fromBinary(uint8_t* buf, size_t len);
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<StatusResponseMessage> fromBinary(const BinaryMessage::MessageView& view);
+
+	/**
+	 * \brief Writes the status response message's binary payload
+	 *
+	 * A status response message has the following payload:
+	 * - The payload of a ResponseMessage (see ResponseMessage::writeBinaryPayload).
+	 *   Like other binary responses, the message string is not sent.
+	 * - One byte that is nonzero if the game is running
+	 * - A 16-bit signed integer for the time remaining
+	 * - A 16-bit signed integer for the winning score
+	 * - For each player, until the end of the payload:
+	 *   - A 16-bit signed integer for the player's score
+	 *   - A 16-bit signed integer for the player's hit count
+	 *   - The player's statistics, as written by ShotStatistics::writeBinary
+	 */
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override
 	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
+		return ResponseMessage::getBinaryPayloadLength() + 1 + sizeof(timeRemaining) + sizeof(winningScore)
+			+ players.size() * (sizeof(score_t) + sizeof(shot_t) + ShotStatistics::binaryLength);
 	}
 
 	virtual Type getType() const override { return Type::STATUS_RESPONSE; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new StatusResponseMessage(*this)); }
+
 	const bool running;
 
 	const duration_t timeRemaining;
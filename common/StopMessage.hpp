@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BinaryMessageViews.hpp"
 #include "Message.hpp"
 
 /**
@@ -26,11 +27,20 @@ public:
 	/// \warning Do not call this directly. Call binaryToMessage instead.
 	static std::unique_ptr<StopMessage> fromBinary(uint8_t* buf, size_t len)
 	{
-		return std::unique_ptr<StopMessage>(new StopMessage(Message::fromBinary(buf, len)->id));
+		return fromBinary(BinaryMessage::MessageView(buf, len));
+	}
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<StopMessage> fromBinary(const BinaryMessage::MessageView& view)
+	{
+		return std::unique_ptr<StopMessage>(new StopMessage(view.getID()));
 	}
 
 	Type getType() const override { return Type::STOP; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new StopMessage(*this)); }
+
 	bool operator==(const Message& o) const override
 	{
 		return Message::operator==(o) && dynamic_cast<const StopMessage*>(&o) != nullptr;
@@ -0,0 +1,105 @@
+#include "SubscribeMessage.hpp"
+
+#include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
+#include "Exceptions.hpp"
+#include "JSONWriter.hpp"
+
+using namespace std;
+using namespace Exceptions;
+
+#ifdef WITH_JSON
+using namespace Json;
+#endif
+
+namespace {
+
+#ifdef WITH_JSON
+const StaticString eventsKey("events");
+#endif
+
+} // end anonymous namespace
+
+SubscribeMessage::SubscribeMessage(message_id_t id, GameEvent::KindMask e) :
+	Message(id),
+	events(e)
+{
+	ENFORCE(ArgumentException, (events & ~GameEvent::allKinds) == 0, "The subscription has unknown event kinds.");
+}
+
+#ifdef WITH_JSON
+std::unique_ptr<SubscribeMessage> SubscribeMessage::fromJSON(const Json::Value& object)
+{
+	auto msg = Message::fromJSON(object);
+
+	ENFORCE(IOException, object.isMember(eventsKey), "Subscribe message is missing its events");
+
+	const Value& eventsValue = object[eventsKey];
+
+	ENFORCE(IOException, eventsValue.isArray(), "The subscribed events are not an array.");
+
+	GameEvent::KindMask mask = 0;
+	for (const auto& kind : eventsValue) {
+		ENFORCE(IOException, kind.isString(), "A subscribed event is not a string.");
+		mask = (GameEvent::KindMask)(mask | GameEvent::only(GameEvent::kindFromName(kind.asString())));
+	}
+
+	return std::unique_ptr<SubscribeMessage>(new SubscribeMessage(msg->id, mask));
+}
+
+Json::Value SubscribeMessage::toJSON() const
+{
+	Value ret = Message::toJSON();
+
+	Value kinds(arrayValue);
+	for (size_t i = 0; i < GameEvent::kindCount; ++i) {
+		if (includes((GameEvent::Kind)i))
+			kinds.append(GameEvent::kindName((GameEvent::Kind)i));
+	}
+
+	ret[eventsKey] = move(kinds);
+
+	return ret;
+}
+
+void SubscribeMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	writer.key(eventsKey.c_str());
+	writer.beginArray();
+	for (size_t i = 0; i < GameEvent::kindCount; ++i) {
+		if (includes((GameEvent::Kind)i))
+			writer.value(GameEvent::kindName((GameEvent::Kind)i));
+	}
+	writer.endArray();
+}
+#endif
+
+std::unique_ptr<SubscribeMessage> SubscribeMessage::fromBinary(uint8_t* buf, size_t len)
+{
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
+
+std::unique_ptr<SubscribeMessage> SubscribeMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	BinaryMessage::PayloadReader reader(view);
+
+	const GameEvent::KindMask mask = reader.readByte();
+	ENFORCE(IOException, (mask & ~GameEvent::allKinds) == 0, "The subscription has unknown event kinds.");
+
+	return std::unique_ptr<SubscribeMessage>(new SubscribeMessage(view.getID(), mask));
+}
+
+bool SubscribeMessage::operator==(const Message& o) const
+{
+	if (!Message::operator==(o))
+		return false;
+
+	auto sm = dynamic_cast<const SubscribeMessage*>(&o);
+
+	if (sm == nullptr)
+		return false;
+
+	return events == sm->events;
+}
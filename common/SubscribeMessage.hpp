@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+
+#include "EventMessage.hpp"
+#include "Message.hpp"
+
+/**
+ * \brief Sent by a UI client to ask for events to be pushed to it as they happen
+ *
+ * The TCP server keeps track of subscriptions itself and answers with a ResponseMessage;
+ * the state machine never sees these. Each subscription replaces the client's last one,
+ * so subscribing to no events unsubscribes. Clients start out subscribed to nothing.
+ * \see EventMessage
+ */
+class SubscribeMessage : public Message {
+
+public:
+
+	SubscribeMessage(message_id_t id, GameEvent::KindMask e = GameEvent::allKinds);
+
+#ifdef WITH_JSON
+	/// Deserializes a message from a JSON object.
+	/// \warning Do not call this directly. Call JSONToMessage instead.
+	static std::unique_ptr<SubscribeMessage> fromJSON(const Json::Value& object);
+
+	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
+#endif
+
+	/// \brief Deserializes a message from a binary buffer
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<SubscribeMessage> fromBinary(uint8_t* buf, size_t len);
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<SubscribeMessage> fromBinary(const BinaryMessage::MessageView& view);
+
+	/// A subscribe message's payload is a single byte holding the event kinds, one bit per kind
+	void writeBinaryPayload(uint8_t* buf) const override { *buf = events; }
+
+	size_t getBinaryPayloadLength() const override { return 1; }
+
+	Type getType() const override { return Type::SUBSCRIBE; }
+
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new SubscribeMessage(*this)); }
+
+	bool operator==(const Message& o) const override;
+
+	/// Returns true if the subscription includes the given kind of event
+	bool includes(GameEvent::Kind k) const { return (events & GameEvent::only(k)) != 0; }
+
+	/// The kinds of events to send
+	const GameEvent::KindMask events;
+};
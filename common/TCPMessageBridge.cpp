@@ -1,15 +1,32 @@
 #include "TCPMessageBridge.hpp"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <functional>
+#include <future>
 #include <cctype>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <netinet/tcp.h>
 
+#include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
+#include "EventMessage.hpp"
+#include "Executor.hpp"
 #include "Exceptions.hpp"
+#include "FrameDecoder.hpp"
+#include "JSONWriter.hpp"
 #include "Message.hpp"
+#include "ResponseMessage.hpp"
+#include "SubscribeMessage.hpp"
 
 using namespace std;
 using namespace std::chrono;
@@ -24,79 +41,709 @@ typedef std::chrono::steady_clock Clock;
 
 namespace {
 
-void onReceive(tcp::socket& sock, asio::streambuf& buf,
-               MessageQueue& out, atomic_bool& connected, boost_error e, size_t size)
+// Boost has its own versions of these.
+using std::array;
+using std::enable_shared_from_this;
+using std::make_shared;
+using std::shared_ptr;
+using std::weak_ptr;
+
+/// The line a client sends to ask for binary framing, and that the server echoes back to agree to it
+const string binaryRequest = "BINARY\r\n";
+
+/// How many bytes we read from a socket at a time
+const size_t readSize = 4096;
+
+/// How many messages the server takes off its queue at once
+const size_t maxBatchSize = 64;
+
+/// The longest line we'll wait for the end of before deciding the other end is sending garbage
+const size_t maxLineLength = 1 << 20;
+
+/// IDs are only unique within a lane, so requests waiting on a response are keyed on both
+typedef uint32_t RequestKey;
+
+RequestKey requestKey(lane_id_t lane, message_id_t id) { return (RequestKey)lane << 16 | id; }
+
+/// Checks if a message fits in a binary frame, whose payload can be at most 64 KiB
+bool fitsInFrame(const Message& msg)
 {
-	if (!e) {
-		assert(size > 0);
+	try {
+		return msg.getBinaryPayloadLength() <= BinaryMessage::maxPayloadLength;
+	}
+	catch (const ArgumentOutOfRangeException&) {
+		// It has too many of something to even count in binary.
+		return false;
+	}
+}
+
+/**
+ * \brief Serializes a message onto the end of `buf` in the given framing
+ *
+ * A response too big for a binary frame (say, the results of a very long game) is replaced with
+ * an UNSUPPORTED_REQUEST response so that whoever asked isn't left waiting.
+ * Anything else that big is dropped, since there is nobody to tell.
+ * Either way, this never throws on the server's io thread.
+ */
+void appendMessage(const Message& msg, TCPFraming framing, string& buf)
+{
+	if (framing == TCPFraming::BINARY) {
+		if (!fitsInFrame(msg)) {
+			const auto* response = dynamic_cast<const ResponseMessage*>(&msg);
+			if (response == nullptr)
+				return;
+
+			ResponseMessage tooBig(response->id, response->respondingTo, ResponseMessage::Code::UNSUPPORTED_REQUEST,
+			                       "The response is too big for a binary frame. Ask for it over JSON instead.");
+			tooBig.lane = response->lane;
+			appendMessage(tooBig, framing, buf);
+			return;
+		}
 
-		istream is(&buf);
-		string line;
-		getline(is, line);
+		const size_t start = buf.size();
+		buf.resize(start + msg.getBinaryLength());
+		msg.toBinary((uint8_t*)&buf[start], buf.size() - start);
+	}
+	else {
+		JSONWriter writer(buf);
+		msg.writeJSON(writer);
+		buf += "\r\n";
+	}
+}
 
-		// Only take lines that aren't all whitespace
-		if (any_of(begin(line), end(line), [](char c) { return !isspace(c); })) {
-			thread_local static Json::Reader reader;
-			Json::Value val;
-			if (!reader.parse(line, val))
-				THROW(IOException, "Could not parse JSON:" + reader.getFormatedErrorMessages());
+/**
+ * \brief Decodes the messages coming in on one connection, in whichever framing it is using
+ *
+ * Read into the space given by prepare(), then hand the number of bytes read to commit().
+ */
+class IncomingStream {
+
+public:
+
+	/// \param acceptRequest true if a first line of `BINARY` should switch the stream to binary framing
+	explicit IncomingStream(bool acceptRequest) :
+		framing(TCPFraming::JSON),
+		negotiation(acceptRequest ? Negotiation::FIRST_LINE : Negotiation::NONE),
+		scratch(),
+		lines(),
+		frames()
+	{ }
+
+	/// Switches to binary framing when a line of `BINARY` arrives, after we have asked for it
+	void awaitAgreement() { negotiation = Negotiation::ANY_LINE; }
+
+	bool isAwaitingAgreement() const { return negotiation == Negotiation::ANY_LINE; }
+
+	TCPFraming getFraming() const { return framing; }
+
+	/// Gets space to read more bytes into
+	pair<uint8_t*, size_t> prepare()
+	{
+		if (framing == TCPFraming::BINARY)
+			return frames.prepare();
+		else
+			return make_pair(scratch.data(), scratch.size());
+	}
 
-			out.send(JSONToMessage(val));
+	/**
+	 * \brief Decodes `len` bytes that were read into the space given by prepare()
+	 * \param len The number of bytes read
+	 * \param onMessage Called with each message that was completed
+	 * \returns true if the stream just switched to binary framing
+	 * \throws Exceptions::IOException if the bytes can't be decoded
+	 */
+	template <typename OnMessage>
+	bool commit(size_t len, OnMessage&& onMessage)
+	{
+		if (framing == TCPFraming::BINARY) {
+			frames.commit(len);
+			drainFrames(onMessage);
+			return false;
 		}
 
-		// Re-up for next time
-		async_read_until(sock, buf, "\r\n", [&](boost_error errIn, size_t sizeIn) {
-			onReceive(sock, buf, out, connected, errIn, sizeIn);
-		});
+		lines.append((const char*)scratch.data(), len);
+
+		// Don't search the part we already searched last time.
+		size_t searchFrom = lines.size() - len;
+		if (searchFrom > 0)
+			--searchFrom; // In case the last read ended between \r and \n
+
+		size_t lineStart = 0;
+		bool switched = false;
+
+		while (!switched) {
+			const size_t lineEnd = lines.find("\r\n", searchFrom);
+			if (lineEnd == string::npos)
+				break;
+
+			const char* line = lines.data() + lineStart;
+			const size_t lineLength = lineEnd + 2 - lineStart;
+			lineStart = searchFrom = lineEnd + 2;
+
+			if (negotiation != Negotiation::NONE) {
+				if (lineLength == binaryRequest.size() && equal(begin(binaryRequest), end(binaryRequest), line)) {
+					negotiation = Negotiation::NONE;
+					switched = true;
+					continue;
+				}
+
+				if (negotiation == Negotiation::FIRST_LINE)
+					negotiation = Negotiation::NONE;
+			}
+
+			// Only take lines that aren't all whitespace
+			if (any_of(line, line + lineLength, [](char c) { return !isspace(c); }))
+				onMessage(JSONToMessage(line, lineLength));
+		}
+
+		lines.erase(0, lineStart);
+
+		if (switched) {
+			framing = TCPFraming::BINARY;
+
+			// Normally there is nothing left over, since the other end waits for us to agree before sending frames,
+			// but there's no harm in being careful.
+			ENFORCE(IOException, frames.feed((const uint8_t*)lines.data(), lines.size()) == lines.size(),
+			        "Too much data arrived while negotiating binary framing");
+			lines.clear();
+			lines.shrink_to_fit();
+			drainFrames(onMessage);
+		}
+		else {
+			ENFORCE(IOException, lines.size() <= maxLineLength, "A line is too long to be a message");
+		}
+
+		return switched;
+	}
+
+	// Disallow copy and assign
+	IncomingStream(const IncomingStream&) = delete;
+	IncomingStream& operator=(const IncomingStream&) = delete;
+
+private:
+
+	/// Where we are in switching to binary framing
+	enum class Negotiation {
+		NONE, ///< We aren't (any more)
+		FIRST_LINE, ///< The other end can ask for it with its first line
+		ANY_LINE ///< We asked for it, and are waiting for the other end to agree
+	};
+
+	template <typename OnMessage>
+	void drainFrames(OnMessage& onMessage)
+	{
+		while (const uint8_t* frame = frames.next())
+			onMessage(binaryToMessage(BinaryMessage::MessageView::fromValidated(frame)));
+	}
+
+	TCPFraming framing;
+
+	Negotiation negotiation;
+
+	/// Holds bytes read in JSON mode until they are appended to `lines`
+	array<uint8_t, readSize> scratch;
+
+	/// Holds the start of a line whose end hasn't arrived yet
+	string lines;
+
+	/// Reassembles incoming binary messages
+	BinaryMessage::FrameDecoder frames;
+};
+
+class Server;
+
+/// One client of a Server
+class Session : public enable_shared_from_this<Session> {
+
+public:
+
+	Session(tcp::socket&& s, Server& srv);
+
+	/// Starts reading from the client
+	void start() { read(); }
+
+	/// Queues a message to go out to the client
+	void send(const Message& msg);
+
+	/**
+	 * \brief Queues an already-serialized message to go out to the client
+	 *
+	 * Broadcasts serialize each message once per framing and share the bytes between every client using it.
+	 * Queued messages are written together, with a single gather write, when the session flushes.
+	 */
+	void enqueue(const shared_ptr<const string>& bytes);
+
+	/// Gets the framing messages to this client should be serialized with
+	TCPFraming getFraming() const { return incoming.getFraming(); }
+
+	/// Sets the kinds of game events the client wants pushed to it
+	void subscribe(GameEvent::KindMask kinds) { subscriptions = kinds; }
+
+	/// Returns false for game events the client hasn't subscribed to, and true for anything else
+	bool wants(const Message& msg) const
+	{
+		return msg.getType() != Message::Type::EVENT
+			|| (subscriptions & GameEvent::only(static_cast<const EventMessage&>(msg).event.kind)) != 0;
+	}
+
+	/// Hangs up on the client
+	void close();
+
+	// Disallow copy and assign
+	Session(const Session&) = delete;
+	Session& operator=(const Session&) = delete;
+
+private:
+
+	void read();
+
+	void onRead(boost_error e, size_t len);
+
+	/// Arranges for queued messages to be written soon, per the server's flush delay
+	void scheduleFlush();
+
+	/// Writes everything queued in one go
+	void flush();
+
+	void onWrite(boost_error e);
+
+	/// Turns TCP_CORK on or off, if the server is configured to use it
+	void setCork(bool on);
+
+	tcp::socket sock;
+
+	Server& server;
+
+	IncomingStream incoming;
+
+	/// Serialized messages waiting to be flushed
+	vector<shared_ptr<const string>> queued;
+
+	/// Serialized messages being written right now. We hold on to them until the write finishes.
+	vector<shared_ptr<const string>> writing;
+
+	/// The buffers for the gather write of `writing`. Kept around to reuse its storage.
+	vector<const_buffer> gather;
+
+	/// Fires when it's time to flush if the server has a flush delay
+	steady_timer flushTimer;
+
+	/// True if a flush has been posted or is waiting on the timer
+	bool flushScheduled;
+
+	/// The kinds of game events to send the client
+	GameEvent::KindMask subscriptions;
+
+	bool open;
+};
+
+/// Accepts clients and shuffles messages between them and the queues given to runConfiguredTCPMessageServer
+class Server {
+
+public:
+
+	Server(MessageQueue& i, MessageQueue& o, const TCPServerOptions& opts) :
+		in(i),
+		out(o),
+		options(opts),
+		service(),
+		acceptor(service, tcp::endpoint(tcp::v4(), opts.port)),
+		nextClient(service),
+		sessions(),
+		waiting(),
+		nextID(0)
+	{ }
+
+	/// Serves clients until an ExitMessage arrives on `in`
+	void run();
+
+	/// Passes along a message a client sent
+	void onRequest(const shared_ptr<Session>& from, unique_ptr<Message>&& msg);
+
+	/// Forgets about a client that is gone
+	void onClosed(const shared_ptr<Session>& session) { sessions.erase(session); }
+
+	const TCPServerOptions& getOptions() const { return options; }
+
+	io_service& getService() { return service; }
+
+	// Disallow copy and assign
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+private:
+
+	void accept();
+
+	/// Sends a message from `in` where it needs to go
+	void dispatch(const Message& msg);
+
+	/// Sends a message to every client that wants it, serializing it once for each framing in use
+	void broadcast(const Message& msg);
+
+	/// Hangs up on everyone and stops accepting new clients
+	void shutDown();
+
+	MessageQueue& in;
+
+	MessageQueue& out;
+
+	const TCPServerOptions options;
+
+	io_service service;
+
+	tcp::acceptor acceptor;
+
+	/// The socket the next client will be accepted into
+	tcp::socket nextClient;
+
+	unordered_set<shared_ptr<Session>> sessions;
+
+	/// For each lane and request ID, the clients that sent a request with that ID to that lane
+	/// and are waiting for a response, oldest first
+	unordered_map<RequestKey, deque<weak_ptr<Session>>> waiting;
+
+	/// An ID for the next message the server sends on its own (i.e. responses to subscriptions)
+	message_id_t nextID;
+};
+
+Session::Session(tcp::socket&& s, Server& srv) :
+	sock(move(s)),
+	server(srv),
+	incoming(true),
+	queued(),
+	writing(),
+	gather(),
+	flushTimer(srv.getService()),
+	flushScheduled(false),
+	subscriptions(0),
+	open(true)
+{
+	boost_error ignored;
+	sock.set_option(tcp::no_delay(srv.getOptions().noDelay), ignored);
+}
+
+void Session::send(const Message& msg)
+{
+	if (!open)
+		return;
+
+	auto bytes = make_shared<string>();
+	appendMessage(msg, incoming.getFraming(), *bytes);
+	if (!bytes->empty())
+		enqueue(bytes);
+}
+
+void Session::enqueue(const shared_ptr<const string>& bytes)
+{
+	if (!open)
+		return;
+
+	if (queued.size() + writing.size() >= server.getOptions().maxQueuedMessages) {
+		if (server.getOptions().slowClientPolicy == SlowClientPolicy::DISCONNECT)
+			close();
+		return;
+	}
+
+	queued.emplace_back(bytes);
+
+	if (writing.empty())
+		scheduleFlush();
+}
+
+void Session::scheduleFlush()
+{
+	if (flushScheduled)
+		return;
+
+	flushScheduled = true;
+	auto self = shared_from_this();
+	const auto delay = server.getOptions().flushDelay;
+
+	if (delay == microseconds::zero()) {
+		// Posting the flush instead of doing it now lets everything else queued
+		// in the same batch from the server go out with it.
+		server.getService().post([self] { self->flush(); });
 	}
 	else {
-		connected = false;
+		flushTimer.expires_from_now(delay);
+		flushTimer.async_wait([self](boost_error) { self->flush(); });
 	}
 }
 
-} // end anonymous namespace
+void Session::flush()
+{
+	flushScheduled = false;
 
-void runTCPMessageServer(MessageQueue& in, MessageQueue& out)
+	if (!open || queued.empty() || !writing.empty())
+		return;
+
+	swap(writing, queued);
+
+	gather.clear();
+	for (const auto& bytes : writing)
+		gather.emplace_back(buffer(*bytes));
+
+	setCork(true);
+
+	auto self = shared_from_this();
+	async_write(sock, gather, [self](boost_error e, size_t) { self->onWrite(e); });
+}
+
+void Session::onWrite(boost_error e)
 {
-	io_service service;
-	asio::streambuf buf;
-	tcp::acceptor acceptor(service, tcp::endpoint(tcp::v4(), 2564));
+	writing.clear();
+
+	if (e || !open) {
+		close();
+		return;
+	}
+
+	if (queued.empty())
+		setCork(false); // Push out whatever the kernel is holding on to.
+	else
+		scheduleFlush();
+}
+
+void Session::setCork(bool on)
+{
+#ifdef TCP_CORK
+	if (server.getOptions().cork) {
+		typedef asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_CORK> cork;
+		boost_error ignored;
+		sock.set_option(cork(on), ignored);
+	}
+#else
+	(void)on;
+#endif
+}
+
+void Session::read()
+{
+	auto space = incoming.prepare();
+	auto self = shared_from_this();
+	sock.async_read_some(buffer(space.first, space.second), [self](boost_error e, size_t len) {
+		self->onRead(e, len);
+	});
+}
+
+void Session::onRead(boost_error e, size_t len)
+{
+	if (e || !open) {
+		close();
+		return;
+	}
 
-	while (true) {
-		tcp::socket sock(service);
-		// Take a connection
-		atomic_bool connected(true);
-		acceptor.accept(sock);
+	auto self = shared_from_this();
 
-		async_read_until(sock, buf, "\r\n", [&](boost_error e, size_t size) {
-			onReceive(sock, buf, out, connected, e, size);
+	try {
+		const bool switched = incoming.commit(len, [&](unique_ptr<Message>&& msg) {
+			server.onRequest(self, move(msg));
 		});
 
-		thread_local static Json::FastWriter writer;
+		// Agree to binary framing. Anything we send from here on out will be binary.
+		if (switched)
+			enqueue(make_shared<const string>(binaryRequest));
+	}
+	catch (const std::exception&) {
+		// The client is sending us garbage, or a message that can't be built from what it sent
+		// (say, a setup with no players). Hang up on it, but keep serving everyone else.
+		close();
+		return;
+	}
+
+	read();
+}
+
+void Session::close()
+{
+	if (!open)
+		return;
 
-		while (connected) {
-			service.poll();
+	open = false;
 
-			auto msg = in.receiveUntil(Clock::now() + milliseconds(100));
+	boost_error ignored;
+	sock.shutdown(tcp::socket::shutdown_both, ignored);
+	sock.close(ignored);
 
-			if (msg == nullptr)
-				continue;
+	server.onClosed(shared_from_this());
+}
 
-			if (msg->getType() == Message::Type::EXIT)
+void Server::run()
+{
+	accept();
+
+	// Wait on the incoming queue in another thread and hand its messages to ours,
+	// as many at a time as are waiting so that sessions can write them out together.
+	const auto pump = [this] {
+		while (true) {
+			auto batch = make_shared<vector<shared_ptr<Message>>>();
+			batch->emplace_back(in.receive().release());
+
+			while (batch->size() < maxBatchSize) {
+				auto next = in.tryReceive();
+				if (next == nullptr)
+					break;
+				batch->emplace_back(next.release());
+			}
+
+			const bool exiting = any_of(begin(*batch), end(*batch), [](const shared_ptr<Message>& msg) {
+				return msg->getType() == Message::Type::EXIT;
+			});
+
+			service.post([this, batch] {
+				for (const auto& msg : *batch) {
+					dispatch(*msg);
+					if (msg->getType() == Message::Type::EXIT)
+						return;
+				}
+			});
+
+			if (exiting)
 				return;
+		}
+	};
+
+	if (options.executor != nullptr) {
+		promise<void> pumped;
+		options.executor->postBlocking([&pump, &pumped] {
+			pump();
+			pumped.set_value();
+		});
+
+		// This runs until shutDown closes everything.
+		service.run();
+		pumped.get_future().wait();
+	}
+	else {
+		thread pumpThread(pump);
+		service.run();
+		pumpThread.join();
+	}
+}
+
+void Server::accept()
+{
+	acceptor.async_accept(nextClient, [this](boost_error e) {
+		// The acceptor was closed.
+		if (e == error::operation_aborted)
+			return;
+
+		if (!e) {
+			auto session = make_shared<Session>(move(nextClient), *this);
+			sessions.insert(session);
+			session->start();
+
+			nextClient = tcp::socket(service);
+		}
+
+		accept();
+	});
+}
+
+void Server::onRequest(const shared_ptr<Session>& from, unique_ptr<Message>&& msg)
+{
+	// Subscriptions are between us and the client. The state machine just posts its events.
+	if (msg->getType() == Message::Type::SUBSCRIBE) {
+		from->subscribe(static_cast<const SubscribeMessage&>(*msg).events);
+		from->send(ResponseMessage(nextID++, msg->id, ResponseMessage::Code::OK, "Subscribed."));
+		return;
+	}
+
+	waiting[requestKey(msg->lane, msg->id)].emplace_back(from);
+	out.send(move(msg));
+}
+
+void Server::dispatch(const Message& msg)
+{
+	if (msg.getType() == Message::Type::EXIT) {
+		shutDown();
+		return;
+	}
+
+	const auto* response = dynamic_cast<const ResponseMessage*>(&msg);
+
+	if (response == nullptr) {
+		broadcast(msg);
+		return;
+	}
+
+	// Find the oldest client still around that is waiting on this response from this lane.
+	auto it = waiting.find(requestKey(response->lane, response->respondingTo));
+	if (it == end(waiting))
+		return;
+
+	auto& clients = it->second;
+	shared_ptr<Session> to;
+	while (to == nullptr && !clients.empty()) {
+		to = clients.front().lock();
+		clients.pop_front();
+	}
+
+	if (clients.empty())
+		waiting.erase(it);
+
+	if (to != nullptr)
+		to->send(msg);
+}
+
+void Server::broadcast(const Message& msg)
+{
+	// Serialize the message at most once for each framing.
+	shared_ptr<const string> encoded[2];
+
+	// A slow client can get closed (and removed from the set) as we go, so work from a copy.
+	const vector<shared_ptr<Session>> everyone(begin(sessions), end(sessions));
 
-			string toSend = writer.write(msg->toJSON());
+	for (const auto& session : everyone) {
+		if (!session->wants(msg))
+			continue;
 
-			boost_error sendError;
-			write(sock, buffer(toSend + "\r\n"), transfer_all(), sendError);
+		auto& bytes = encoded[session->getFraming() == TCPFraming::BINARY ? 1 : 0];
 
-			if (sendError)
-				THROW(IOException, sendError.message());
+		if (bytes == nullptr) {
+			auto toShare = make_shared<string>();
+			appendMessage(msg, session->getFraming(), *toShare);
+			bytes = toShare;
 		}
+
+		if (!bytes->empty())
+			session->enqueue(bytes);
 	}
 }
 
+void Server::shutDown()
+{
+	boost_error ignored;
+	acceptor.close(ignored);
+
+	// Closing a session removes it from the set, so close them from a copy.
+	auto toClose = move(sessions);
+	for (const auto& session : toClose)
+		session->close();
+
+	waiting.clear();
+}
+
+} // end anonymous namespace
+
+void runTCPMessageServer(MessageQueue& in, MessageQueue& out)
+{
+	runConfiguredTCPMessageServer(in, out, TCPServerOptions());
+}
+
+void runConfiguredTCPMessageServer(MessageQueue& in, MessageQueue& out, const TCPServerOptions& options)
+{
+	Server server(in, out, options);
+	server.run();
+}
+
 void runTCPMessageClient(MessageQueue& in, MessageQueue& out, std::string server)
+{
+	runFramedTCPMessageClient(in, out, move(server), TCPFraming::JSON);
+}
+
+void runFramedTCPMessageClient(MessageQueue& in, MessageQueue& out, std::string server, TCPFraming framing)
 {
 	io_service service;
 	tcp::resolver resolver(service);
@@ -106,31 +753,69 @@ void runTCPMessageClient(MessageQueue& in, MessageQueue& out, std::string server
 	tcp::socket sock(service);
 	connect(sock, resolution);
 
-	asio::streambuf buf;
+	IncomingStream incoming(false);
+	const auto deliver = [&out](unique_ptr<Message>&& msg) { out.send(move(msg)); };
+
+	if (framing == TCPFraming::BINARY) {
+		asio::write(sock, buffer(binaryRequest));
+		incoming.awaitAgreement();
+
+		// Pass along anything the server sends before it agrees.
+		while (incoming.isAwaitingAgreement()) {
+			auto space = incoming.prepare();
+			boost_error e;
+			const size_t len = sock.read_some(buffer(space.first, space.second), e);
+			ENFORCE(IOException, !e, "The server did not agree to binary framing");
+			incoming.commit(len, deliver);
+		}
+	}
 
 	atomic_bool connected(true);
 
-	async_read_until(sock, buf, "\r\n", [&](boost_error e, size_t size) {
-		onReceive(sock, buf, out, connected, e, size);
-	});
+	function<void(boost_error, size_t)> onRead = [&](boost_error e, size_t len) {
+		if (e) {
+			connected = false;
+			return;
+		}
+
+		incoming.commit(len, deliver);
+
+		auto space = incoming.prepare();
+		sock.async_read_some(buffer(space.first, space.second), onRead);
+	};
 
-	thread_local static Json::FastWriter writer;
+	// Kick off reading with whatever we already have.
+	onRead(boost_error(), 0);
+
+	// We coalesce writes ourselves, so don't let Nagle's algorithm hold them up.
+	boost_error ignored;
+	sock.set_option(tcp::no_delay(true), ignored);
+
+	// Reuse the same buffer for every batch so we aren't reallocating it each time.
+	string toSend;
 
 	while (connected) {
 		service.poll();
 
 		auto msg = in.receiveUntil(Clock::now() + milliseconds(100));
 
-		if (msg == nullptr)
-			continue;
+		// Send everything that's waiting with one write.
+		toSend.clear();
+		while (msg != nullptr) {
+			if (msg->getType() == Message::Type::EXIT) {
+				asio::write(sock, buffer(toSend));
+				return;
+			}
 
-		if (msg->getType() == Message::Type::EXIT)
-			return;
+			appendMessage(*msg, incoming.getFraming(), toSend);
+			msg = in.tryReceive();
+		}
 
-		string toSend = writer.write(msg->toJSON());
+		if (toSend.empty())
+			continue;
 
 		boost_error sendError;
-		write(sock, buffer(toSend + "\r\n"), transfer_all(), sendError);
+		asio::write(sock, buffer(toSend), transfer_all(), sendError);
 
 		if (sendError)
 			THROW(IOException, sendError.message());
@@ -1,10 +1,110 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include "MessageQueue.hpp"
 
-/// Accepts a incoming connections and passes Messages (one per line) over TCP
+// Forward declarations. We just have pointers to these here.
+class Executor;
+
+/// How messages are framed on a TCP connection
+enum class TCPFraming {
+	/// One JSON object per line, ending in \r\n. What the UI speaks.
+	JSON,
+	/// Back-to-back binary messages (see BinaryMessage.hpp), each of which carries its own length.
+	/// Much smaller and cheaper to parse, but binary responses carry no message strings.
+	BINARY
+};
+
+/// What the server does with a client that isn't reading what we send it fast enough
+enum class SlowClientPolicy {
+	/// Drop messages that don't fit in the client's queue
+	DROP,
+	/// Hang up on the client
+	DISCONNECT
+};
+
+/// Settings for runConfiguredTCPMessageServer
+struct TCPServerOptions {
+	/// The port to listen on
+	uint16_t port;
+
+	/// How many messages can be waiting to go out to a client before slowClientPolicy kicks in
+	size_t maxQueuedMessages;
+
+	SlowClientPolicy slowClientPolicy;
+
+	/**
+	 * \brief How long to hold on to outgoing messages, waiting for more to send with them
+	 *
+	 * Zero sends everything the server had on hand as soon as it's done handing out the current batch.
+	 * Anything more trades latency for fewer, larger writes. Either way, messages that arrive
+	 * while a write is in progress go out together in the next one.
+	 */
+	std::chrono::microseconds flushDelay;
+
+	/// Sets TCP_NODELAY on client sockets. Since the server does its own coalescing, it is on by default.
+	bool noDelay;
+
+	/// Sets TCP_CORK (where available) while writing, so the kernel only sends full segments until we're done
+	bool cork;
+
+	/// If set, the server waits on its incoming queue on one of the executor's blocking threads
+	/// instead of starting a thread of its own
+	Executor* executor;
+
+	TCPServerOptions() :
+		port(2564),
+		maxQueuedMessages(256),
+		slowClientPolicy(SlowClientPolicy::DISCONNECT),
+		flushDelay(0),
+		noDelay(true),
+		cork(false),
+		executor(nullptr)
+	{ }
+};
+
+/// Runs runConfiguredTCPMessageServer with the default options
 void runTCPMessageServer(MessageQueue& in, MessageQueue& out);
 
+/**
+ * \brief Accepts any number of clients and passes Messages to and from them over TCP
+ * \param in Messages to send to clients. The server returns when it receives an ExitMessage.
+ * \param out Messages received from all clients
+ * \param options Settings for the server
+ *
+ * Everything is done asynchronously on the calling thread, save for waiting on `in`,
+ * which is done by a helper thread (see TCPServerOptions::executor).
+ *
+ * Responses in `in` go back to the client that sent the request they respond to.
+ * Since clients pick their own message IDs, a response to ID n goes to the earliest client
+ * still waiting on a request with ID n. Responses nobody is waiting for are dropped.
+ * Game events (see EventMessage) go to the clients that subscribed to them with a SubscribeMessage,
+ * which the server answers itself instead of passing along.
+ * Any other message is broadcast to every client.
+ *
+ * Each client has its own queue of outgoing messages, so a client that stops reading only holds up itself.
+ * Everything queued for a client is sent with a single gather write (see TCPServerOptions::flushDelay).
+ * Clients that send something the server can't parse are disconnected.
+ *
+ * Connections start out with JSON framing. If the first line a client sends is `BINARY`,
+ * the server echoes that line back and both sides switch to binary framing for the rest of the connection.
+ */
+void runConfiguredTCPMessageServer(MessageQueue& in, MessageQueue& out, const TCPServerOptions& options);
+
+/**
+ * \brief Connects to a server and passes Messages (one per line) over TCP
+ *
+ * Messages waiting in `in` are sent together with one write.
+ */
 void runTCPMessageClient(MessageQueue& in, MessageQueue& out, std::string server);
+
+/**
+ * \brief Connects to a server and passes Messages over TCP with the given framing
+ * \throws Exceptions::IOException if binary framing is requested and the server does not agree to it
+ * \see runConfiguredTCPMessageServer for how binary framing is negotiated
+ */
+void runFramedTCPMessageClient(MessageQueue& in, MessageQueue& out, std::string server, TCPFraming framing);
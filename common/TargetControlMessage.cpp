@@ -3,7 +3,10 @@
 #include <cassert>
 
 #include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONReader.hpp"
+#include "JSONWriter.hpp"
 
 using namespace std;
 using namespace Exceptions;
@@ -32,6 +35,16 @@ Json::Value TargetCommand::toJSON() const
 	return ret;
 }
 
+void TargetCommand::writeJSON(JSONWriter& writer) const
+{
+	writer.beginObject();
+	writer.key(idKey.c_str());
+	writer.value(id);
+	writer.key(onKey.c_str());
+	writer.value(on);
+	writer.endObject();
+}
+
 TargetCommand TargetCommand::fromJSON(const Json::Value& object)
 {
 	ENFORCE(IOException, object.isObject(), "The provided JSON value is not an object.");
@@ -44,6 +57,38 @@ TargetCommand TargetCommand::fromJSON(const Json::Value& object)
 
 	return TargetCommand((board_id_t)idValue.asInt(), onValue.asBool());
 }
+
+TargetCommand TargetCommand::readJSON(JSONReader& reader)
+{
+	ENFORCE(IOException, reader.peek() == JSONReader::Token::OBJECT, "The provided JSON value is not an object.");
+
+	bool hasID = false;
+	bool hasOn = false;
+	int targetID = 0;
+	bool targetOn = false;
+
+	reader.beginObject();
+	while (reader.nextMember()) {
+		if (reader.isKey(idKey.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::NUMBER, "The target ID is not an integer.");
+			targetID = reader.readInt();
+			hasID = true;
+		}
+		else if (reader.isKey(onKey.c_str())) {
+			ENFORCE(IOException, reader.peek() == JSONReader::Token::BOOLEAN, "The target ID is not a bool.");
+			targetOn = reader.readBool();
+			hasOn = true;
+		}
+		else {
+			reader.skipValue();
+		}
+	}
+
+	ENFORCE(IOException, hasID, "The target ID is not an integer.");
+	ENFORCE(IOException, hasOn, "The target ID is not a bool.");
+
+	return TargetCommand((board_id_t)targetID, targetOn);
+}
 #endif
 
 TargetControlMessage::TargetControlMessage(message_id_t id, CommandList&& comms) :
@@ -91,45 +136,50 @@ Json::Value TargetControlMessage::toJSON() const
 
 	return ret;
 }
+
+void TargetControlMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	writer.key(commandsKey.c_str());
+	writer.beginArray();
+	for (const auto& command : commands)
+		command.writeJSON(writer);
+	writer.endArray();
+}
 #endif
 
 std::unique_ptr<TargetControlMessage> TargetControlMessage::fromBinary(uint8_t* buf, size_t len)
 {
-	auto msg = Message::fromBinary(buf, len);
-	auto load = BinaryMessage::getPayload(buf);
-	ENFORCE(IOException, load.second > 3, "The payload cannot fit target commands.");
-
-	ENFORCE(IOException, load.second % 2 == 0,
-	        "The payload is the incorrect size for target commands.");
+	return fromBinary(BinaryMessage::MessageView(buf, len));
+}
 
-	const uint8_t numCommands = (uint8_t)(load.second / 2);
+std::unique_ptr<TargetControlMessage> TargetControlMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	const BinaryMessage::TargetControlView tcv(view);
 
 	CommandList comms;
+	comms.reserve(tcv.size());
 
-	for (uint8_t i = 0; i < numCommands; ++i) {
-		comms.emplace_back(load.first[0], (bool)load.first[1]);
-		load.first += 2;
-	}
+	for (size_t i = 0; i < tcv.size(); ++i)
+		comms.emplace_back(tcv[i]);
 
 	return unique_ptr<TargetControlMessage>(
-		new TargetControlMessage(msg->id, move(comms)));
+		new TargetControlMessage(tcv.getID(), move(comms)));
 }
 
-std::vector<uint8_t> TargetControlMessage::getBinaryPayload() const
+void TargetControlMessage::writeBinaryPayload(uint8_t* buf) const
 {
-	assert(Message::getBinaryPayload().size() == 0);
-	vector<uint8_t> ret;
+	assert(Message::getBinaryPayloadLength() == 0);
 
 	// We're omitting the number of messages as it can be inferred
 	// from the payload size / 2.
-	// ret.emplace_back((uint8_t)commands.size());
+	// *buf++ = (uint8_t)commands.size();
 
 	for (const auto& command : commands) {
-		ret.emplace_back(command.id);
-		ret.emplace_back((uint8_t)command.on);
+		*buf++ = (uint8_t)command.id;
+		*buf++ = (uint8_t)command.on;
 	}
-
-	return ret;
 }
 
 
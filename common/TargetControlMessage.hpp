@@ -18,6 +18,12 @@ struct TargetCommand {
 	Json::Value toJSON() const;
 
 	static TargetCommand fromJSON(const Json::Value& object);
+
+	/// Writes the command as a JSON object, the same one toJSON() would give
+	void writeJSON(JSONWriter& writer) const;
+
+	/// Reads a command from the JSON object the reader is at, as fromJSON would from a Json::Value
+	static TargetCommand readJSON(JSONReader& reader);
 #endif
 
 	bool operator==(const TargetCommand& o) const { return id == o.id && on == o.on; }
@@ -41,14 +47,20 @@ public:
 	static std::unique_ptr<TargetControlMessage> fromJSON(const Json::Value& object);
 
 	Json::Value toJSON() const override;
+
+	void writeJSONFields(JSONWriter& writer) const override;
 #endif
 
 	/// \brief Deserializes a message from a binary buffer
 	/// \warning Do not call this directly. Call binaryToMessage instead.
 	static std::unique_ptr<TargetControlMessage> fromBinary(uint8_t* buf, size_t len);
 
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<TargetControlMessage> fromBinary(const BinaryMessage::MessageView& view);
+
 	/**
-	 * \brief Gets the target control message's binary payload
+	 * \brief Writes the target control message's binary payload
 	 *
 	 * A target control message has the following payload:
 	 * - One unsigned byte indicating the number of commands to follow
@@ -56,10 +68,14 @@ public:
 	 *   - One byte for the target ID the command pertains to
 	 *   - One byte indicating whether or not the target's lights should be on.
 	 */
-	std::vector<uint8_t> getBinaryPayload() const override;
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override { return commands.size() * 2; }
 
 	Type getType() const override { return Type::TARGET_CONTROL; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new TargetControlMessage(*this)); }
+
 	bool operator==(const Message& o) const override;
 
 	const CommandList commands;
@@ -2,7 +2,11 @@
 
 #include "TestMessage.hpp"
 
+#include <algorithm>
+
+#include "BinaryMessageViews.hpp"
 #include "Exceptions.hpp"
+#include "JSONWriter.hpp"
 
 using namespace Exceptions;
 using namespace std;
@@ -12,6 +16,15 @@ namespace {
 
 const StaticString payloadKey("test payload");
 
+/// Writes the payload as compact JSON, without the newline FastWriter puts on the end
+string toCompactJSON(const Value& val)
+{
+	thread_local static FastWriter writer;
+	string ret = writer.write(val);
+	ret.pop_back();
+	return ret;
+}
+
 } // end anonymous namespace
 
 TestMessage::TestMessage(message_id_t id, const Json::Value& object) :
@@ -30,7 +43,7 @@ std::unique_ptr<TestMessage> TestMessage::fromJSON(const Json::Value& object)
 
 	ENFORCE(IOException, payloadValue.isObject(), "Test message payload is not a JSON object");
 
-	return std::unique_ptr<TestMessage>(new TestMessage(msg->id, object));
+	return std::unique_ptr<TestMessage>(new TestMessage(msg->id, payloadValue));
 }
 
 Json::Value TestMessage::toJSON() const
@@ -42,6 +55,40 @@ Json::Value TestMessage::toJSON() const
 	return ret;
 }
 
+void TestMessage::writeJSONFields(JSONWriter& writer) const
+{
+	Message::writeJSONFields(writer);
+
+	// The payload could be anything, so let jsoncpp deal with it.
+	const string payload = toCompactJSON(val);
+
+	writer.key(payloadKey.c_str());
+	writer.raw(payload.data(), payload.size());
+}
+
+std::unique_ptr<TestMessage> TestMessage::fromBinary(const BinaryMessage::MessageView& view)
+{
+	const char* text = (const char*)view.getPayload();
+
+	thread_local static Reader reader;
+	Value payloadValue;
+	ENFORCE(IOException, reader.parse(text, text + view.getPayloadLength(), payloadValue),
+	        "Could not parse the test message's payload");
+
+	return std::unique_ptr<TestMessage>(new TestMessage(view.getID(), payloadValue));
+}
+
+void TestMessage::writeBinaryPayload(uint8_t* buf) const
+{
+	const string payload = toCompactJSON(val);
+	copy(begin(payload), end(payload), buf);
+}
+
+size_t TestMessage::getBinaryPayloadLength() const
+{
+	return toCompactJSON(val).size();
+}
+
 bool TestMessage::operator==(const Message& o) const
 {
 	if (!Message::operator==(o))
@@ -16,14 +16,21 @@ public:
 
 	Json::Value toJSON() const override;
 
-	std::vector<uint8_t> getBinaryPayload() const override
-	{
-		THROW(Exceptions::InvalidOperationException,
-		      "This messsage type does not support binary serialization");
-	}
+	void writeJSONFields(JSONWriter& writer) const override;
+
+	/// \brief Deserializes a message from a view of an already-validated binary message
+	/// \warning Do not call this directly. Call binaryToMessage instead.
+	static std::unique_ptr<TestMessage> fromBinary(const BinaryMessage::MessageView& view);
+
+	/// The binary payload is just the payload as compact JSON text
+	void writeBinaryPayload(uint8_t* buf) const override;
+
+	size_t getBinaryPayloadLength() const override;
 
 	Type getType() const override { return Type::TEST; }
 
+	std::unique_ptr<Message> clone() const override { return std::unique_ptr<Message>(new TestMessage(*this)); }
+
 	bool operator==(const Message& o) const override;
 
 	Json::Value val;
@@ -0,0 +1,134 @@
+#include "TimerService.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+TimerService::TimerService() :
+	timersMutex(),
+	changed(),
+	deadlines(),
+	callbacks(),
+	nextID(0),
+	stopping(false),
+	worker()
+{
+	// Start the thread last so that it never sees us half-built.
+	worker = thread(&TimerService::threadProc, this);
+}
+
+TimerService::~TimerService()
+{
+	{
+		lock_guard<mutex> lock(timersMutex);
+		stopping = true;
+	}
+	changed.notify_one();
+	worker.join();
+}
+
+TimerService& TimerService::shared()
+{
+	static TimerService service;
+	return service;
+}
+
+TimerService::TimerID TimerService::schedule(TimePoint when, Callback&& callback)
+{
+	TimerID id;
+	bool soonest;
+	{
+		lock_guard<mutex> lock(timersMutex);
+		id = nextID++;
+		callbacks.emplace(id, move(callback));
+		deadlines.emplace_back(when, id);
+		push_heap(begin(deadlines), end(deadlines), greater<Deadline>());
+		soonest = deadlines.front().id == id;
+	}
+
+	// Only bother the thread if it's waiting on something later than this.
+	if (soonest)
+		changed.notify_one();
+
+	return id;
+}
+
+bool TimerService::cancel(TimerID timer)
+{
+	lock_guard<mutex> lock(timersMutex);
+	Callback ignored;
+	return take(timer, ignored);
+}
+
+bool TimerService::runNow(TimerID timer)
+{
+	Callback callback;
+	{
+		lock_guard<mutex> lock(timersMutex);
+		if (!take(timer, callback))
+			return false;
+	}
+
+	callback();
+	return true;
+}
+
+size_t TimerService::size() const
+{
+	lock_guard<mutex> lock(timersMutex);
+	return callbacks.size();
+}
+
+void TimerService::threadProc()
+{
+	unique_lock<mutex> lock(timersMutex);
+
+	while (!stopping) {
+		if (deadlines.empty()) {
+			changed.wait(lock);
+			continue;
+		}
+
+		const Deadline next = deadlines.front();
+		if (next.when > Clock::now()) {
+			changed.wait_until(lock, next.when);
+			continue;
+		}
+
+		pop_heap(begin(deadlines), end(deadlines), greater<Deadline>());
+		deadlines.pop_back();
+
+		Callback callback;
+		// Otherwise it was canceled.
+		if (!take(next.id, callback))
+			continue;
+
+		lock.unlock();
+		callback();
+		lock.lock();
+	}
+}
+
+bool TimerService::take(TimerID timer, Callback& callback)
+{
+	auto it = callbacks.find(timer);
+	if (it == end(callbacks))
+		return false;
+
+	callback = move(it->second);
+	callbacks.erase(it);
+	compact();
+	return true;
+}
+
+void TimerService::compact()
+{
+	// Leave small heaps alone. Canceled deadlines will be popped soon enough.
+	if (deadlines.size() < 64 || deadlines.size() < 2 * callbacks.size())
+		return;
+
+	deadlines.erase(remove_if(begin(deadlines), end(deadlines), [this](const Deadline& d) {
+		return callbacks.count(d.id) == 0;
+	}), end(deadlines));
+	make_heap(begin(deadlines), end(deadlines), greater<Deadline>());
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Runs callbacks at given times, all from one thread
+ *
+ * Pending callbacks are kept in a min-heap of deadlines, so scheduling one is O(log n)
+ * and any number can be waiting at once without costing a thread apiece.
+ * Canceled callbacks are dropped from the heap lazily, as they come due
+ * (or all at once, if they ever outnumber the live ones).
+ *
+ * Callbacks run on the service's thread, one at a time, so they should be quick.
+ * Anything longer should be handed off (say, to an Executor).
+ * Like any other thread's, callbacks must not throw.
+ */
+class TimerService {
+
+public:
+
+	typedef std::function<void()> Callback;
+
+	typedef std::chrono::steady_clock Clock;
+
+	typedef Clock::time_point TimePoint;
+
+	/// Identifies a callback so that it can be canceled or run early
+	typedef uint64_t TimerID;
+
+	/// Starts the service's thread
+	TimerService();
+
+	/// Stops the service's thread. Callbacks that haven't run yet are dropped.
+	~TimerService();
+
+	/**
+	 * \brief Gets a service shared by everyone who doesn't need one of their own
+	 *
+	 * It is started the first time it is asked for and stopped when the program exits.
+	 */
+	static TimerService& shared();
+
+	/**
+	 * \brief Runs a callback once the given time arrives
+	 * \returns An ID that can be passed to cancel or runNow
+	 */
+	TimerID schedule(TimePoint when, Callback&& callback);
+
+	/// Runs a callback after the given delay. \see schedule
+	template <typename Rep, typename Period>
+	TimerID scheduleAfter(const std::chrono::duration<Rep, Period>& delay, Callback&& callback)
+	{
+		return schedule(Clock::now() + std::chrono::duration_cast<Clock::duration>(delay), std::move(callback));
+	}
+
+	/**
+	 * \brief Cancels a callback
+	 * \returns true if the callback was canceled, or false if it has already run (or started running)
+	 *          or been canceled
+	 */
+	bool cancel(TimerID timer);
+
+	/**
+	 * \brief Runs a callback now, on the calling thread, instead of when it was scheduled for
+	 * \returns true if the callback was run, or false if it has already run (or started running)
+	 *          or been canceled
+	 */
+	bool runNow(TimerID timer);
+
+	/// Gets the number of callbacks waiting to run
+	size_t size() const;
+
+private:
+
+	struct Deadline {
+		TimePoint when;
+		TimerID id;
+
+		Deadline(TimePoint w, TimerID i) : when(w), id(i) { }
+
+		bool operator>(const Deadline& o) const { return when > o.when; }
+	};
+
+	void threadProc();
+
+	/// Removes a callback from the pending ones. The caller must hold timersMutex.
+	bool take(TimerID timer, Callback& callback);
+
+	/// Rebuilds the heap without canceled callbacks once they outnumber the live ones.
+	/// The caller must hold timersMutex.
+	void compact();
+
+	// Disallow copy and assign
+	TimerService(const TimerService&) = delete;
+	TimerService& operator=(const TimerService&) = delete;
+
+	/// Guards everything below
+	mutable std::mutex timersMutex;
+
+	/// Signaled when a callback is scheduled (it may be sooner than the one we're waiting on) or we're stopping
+	std::condition_variable changed;
+
+	/// A min-heap of pending deadlines, including those of canceled callbacks that haven't been dropped yet
+	std::vector<Deadline> deadlines;
+
+	/// The callbacks that haven't run or been canceled
+	std::unordered_map<TimerID, Callback> callbacks;
+
+	TimerID nextID;
+
+	bool stopping;
+
+	std::thread worker;
+};
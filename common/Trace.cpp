@@ -0,0 +1,174 @@
+#include "Trace.hpp"
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#include "BinaryMessage.hpp"
+#include "Exceptions.hpp"
+#include "GameRunner.hpp"
+#include "MessageQueue.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+
+namespace {
+
+const uint8_t magic[4] = {'G', 'T', 'R', 'C'};
+
+/// Bumped whenever a trace would replay differently, be it the format or what the state machines do with it.
+/// Version 2: pop-up games can have many targets up and batch their target commands.
+/// Version 3: runners can be told not to acknowledge shots, which the header records.
+/// Version 4: games forget the last game's targets as soon as it ends, even if it's restarted before a tick.
+const uint16_t version = 4;
+
+/// Magic, version, seed, target and player counts, whether shots are acknowledged, and origin
+const size_t headerLength = sizeof(magic) + 2 + 4 + 1 + 1 + 1 + 8;
+
+/// The time and message length at the start of each step
+const size_t stepHeaderLength = 8 + 2;
+
+uint8_t* writeInt64(uint8_t* buf, int64_t i)
+{
+	const auto u = (uint64_t)i;
+	buf = BinaryMessage::writeInt(buf, (uint32_t)(u >> 32));
+	return BinaryMessage::writeInt(buf, (uint32_t)u);
+}
+
+int64_t extractInt64(const uint8_t* buf)
+{
+	return (int64_t)(((uint64_t)BinaryMessage::extractUInt32(buf) << 32) | BinaryMessage::extractUInt32(buf + 4));
+}
+
+} // end anonymous namespace
+
+TraceWriter::TraceWriter(std::ostream& os) :
+	out(os),
+	origin(),
+	started(false),
+	steps(0),
+	buffer()
+{
+}
+
+void TraceWriter::start(uint32_t seed, board_id_t numberTargets, board_id_t numberPlayers, TimePoint startTime,
+                        bool acknowledgeShots)
+{
+	ENFORCE(InvalidOperationException, !started, "The trace has already been started.");
+
+	origin = startTime;
+	started = true;
+
+	uint8_t header[headerLength];
+	memcpy(header, magic, sizeof(magic));
+	uint8_t* it = BinaryMessage::writeInt(header + sizeof(magic), version);
+	it = BinaryMessage::writeInt(it, seed);
+	*it++ = (uint8_t)numberTargets;
+	*it++ = (uint8_t)numberPlayers;
+	*it++ = acknowledgeShots ? 1 : 0;
+	writeInt64(it, duration_cast<nanoseconds>(origin.time_since_epoch()).count());
+
+	out.write(reinterpret_cast<const char*>(header), headerLength);
+	out.flush();
+	ENFORCE(IOException, out.good(), "Could not write the trace's header.");
+}
+
+void TraceWriter::record(TimePoint when, const Message* msg)
+{
+	ENFORCE(InvalidOperationException, started, "The trace must be started before steps are recorded.");
+
+	const size_t messageLength = msg != nullptr ? msg->getBinaryLength() : 0;
+	buffer.resize(stepHeaderLength + messageLength);
+
+	uint8_t* it = writeInt64(buffer.data(), duration_cast<nanoseconds>(when - origin).count());
+	it = BinaryMessage::writeInt(it, (uint16_t)messageLength);
+	if (msg != nullptr)
+		msg->toBinary(it, messageLength);
+
+	out.write(reinterpret_cast<const char*>(buffer.data()), (streamsize)buffer.size());
+	out.flush();
+	ENFORCE(IOException, out.good(), "Could not write a step to the trace.");
+
+	++steps;
+}
+
+TraceReader::TraceReader(std::istream& is) :
+	in(is),
+	seed(0),
+	targetCount(0),
+	playerCount(0),
+	acknowledgeShots(true),
+	origin(),
+	buffer()
+{
+	uint8_t header[headerLength];
+	in.read(reinterpret_cast<char*>(header), headerLength);
+	ENFORCE(IOException, in.gcount() == (streamsize)headerLength && memcmp(header, magic, sizeof(magic)) == 0,
+	        "The stream does not hold a trace.");
+	ENFORCE(IOException, BinaryMessage::extractUInt16(header + sizeof(magic)) == version,
+	        "The trace is from an unknown version.");
+
+	const uint8_t* it = header + sizeof(magic) + 2;
+	seed = BinaryMessage::extractUInt32(it);
+	targetCount = (board_id_t)it[4];
+	playerCount = (board_id_t)it[5];
+	acknowledgeShots = it[6] != 0;
+	origin = TimePoint(duration_cast<TimePoint::duration>(nanoseconds(extractInt64(it + 7))));
+}
+
+bool TraceReader::next(TimePoint& when, std::unique_ptr<Message>& msg)
+{
+	uint8_t stepHeader[stepHeaderLength];
+	in.read(reinterpret_cast<char*>(stepHeader), stepHeaderLength);
+	if (in.gcount() != (streamsize)stepHeaderLength)
+		return false;
+
+	when = origin + duration_cast<TimePoint::duration>(nanoseconds(extractInt64(stepHeader)));
+
+	const size_t messageLength = BinaryMessage::extractUInt16(stepHeader + 8);
+	if (messageLength == 0) {
+		msg.reset();
+		return true;
+	}
+
+	buffer.resize(messageLength);
+	in.read(reinterpret_cast<char*>(buffer.data()), (streamsize)messageLength);
+	if (in.gcount() != (streamsize)messageLength)
+		return false;
+
+	msg = binaryToMessage(buffer.data(), messageLength);
+	return true;
+}
+
+size_t replayTrace(std::istream& trace, std::ostream& output)
+{
+	TraceReader reader(trace);
+
+	MessageQueue sent;
+	GameRunner runner(sent, reader.getTargetCount(), reader.getPlayerCount(), reader.getSeed(), nullptr,
+	                  reader.acknowledgesShots());
+
+	vector<uint8_t> buffer;
+	size_t steps = 0;
+
+	TraceReader::TimePoint when;
+	unique_ptr<Message> msg;
+	while (reader.next(when, msg)) {
+		if (msg == nullptr)
+			runner.onTick(when);
+		else
+			runner.onMessage(move(msg), when);
+
+		++steps;
+
+		while (auto out = sent.tryReceive()) {
+			buffer.resize(out->getBinaryLength());
+			out->toBinary(buffer.data(), buffer.size());
+			output.write(reinterpret_cast<const char*>(buffer.data()), (streamsize)buffer.size());
+		}
+	}
+
+	ENFORCE(IOException, output.good(), "Could not write the replay's output.");
+	return steps;
+}
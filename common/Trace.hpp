@@ -0,0 +1,148 @@
+#pragma once
+
+/**
+ * \file Trace.hpp
+ *
+ * Recording and replaying everything a GameRunner is handed, so that a session can be played back exactly.
+ *
+ * A trace starts with a header:
+ *
+ * - The bytes "GTRC" and a 16-bit version
+ * - The seed the runner was given (32 bits)
+ * - The number of targets and players (8 bits each)
+ * - 1 if the runner acknowledged shots, or 0 if it didn't (8 bits)
+ * - The time the trace started, in steady clock nanoseconds (64 bits)
+ *
+ * Each step follows, in the order they were taken:
+ *
+ * - When the step was taken, in nanoseconds since the trace started (64 bits)
+ * - The length of the message received (16 bits), or zero if the step was a tick
+ * - The message, in its binary form (see BinaryMessage.hpp)
+ *
+ * Like binary messages, all integers are big-endian.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "GameClock.hpp"
+#include "GameTypes.hpp"
+#include "Message.hpp"
+
+/// Records the steps a GameRunner takes to a trace. \see runGame
+class TraceWriter {
+
+public:
+
+	typedef GameClock::TimePoint TimePoint;
+
+	/// Creates a writer that writes the trace to the given stream, which must outlive it
+	explicit TraceWriter(std::ostream& out);
+
+	/**
+	 * \brief Writes the trace's header
+	 * \param seed The seed the GameRunner was given
+	 * \param numberTargets The number of targets the GameRunner was given
+	 * \param numberPlayers The number of players the GameRunner was given
+	 * \param origin The time the trace starts at. Steps must come after it.
+	 * \param acknowledgeShots Whether the GameRunner was told to acknowledge shots
+	 */
+	void start(uint32_t seed, board_id_t numberTargets, board_id_t numberPlayers, TimePoint origin,
+	           bool acknowledgeShots = true);
+
+	/**
+	 * \brief Records a step
+	 * \param when The time the step was taken
+	 * \param msg The message handled in the step, or null if the step was a tick
+	 * \throws Exceptions::IOException if the step could not be written
+	 *
+	 * Each step is flushed as it is recorded, so a trace of a session that crashed is complete up to the crash.
+	 */
+	void record(TimePoint when, const Message* msg);
+
+	/// Gets the number of steps recorded so far
+	size_t size() const { return steps; }
+
+private:
+
+	// Disallow copy and assign
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	std::ostream& out;
+
+	TimePoint origin;
+
+	bool started;
+
+	size_t steps;
+
+	/// Reused for each step so that recording doesn't allocate
+	std::vector<uint8_t> buffer;
+};
+
+/// Reads the steps from a trace written by TraceWriter
+class TraceReader {
+
+public:
+
+	typedef GameClock::TimePoint TimePoint;
+
+	/**
+	 * \brief Reads a trace's header from the given stream, which must outlive the reader
+	 * \throws Exceptions::IOException if the stream does not hold a trace
+	 */
+	explicit TraceReader(std::istream& in);
+
+	uint32_t getSeed() const { return seed; }
+
+	board_id_t getTargetCount() const { return targetCount; }
+
+	board_id_t getPlayerCount() const { return playerCount; }
+
+	bool acknowledgesShots() const { return acknowledgeShots; }
+
+	/**
+	 * \brief Reads the next step
+	 * \param when Set to the time the step was taken
+	 * \param msg Set to the message handled in the step, or null if the step was a tick
+	 * \returns false if there are no more steps. A step that was cut off (say, by a crash while it was written)
+	 *          counts as the end of the trace.
+	 * \throws Exceptions::IOException if the step's message is corrupt
+	 */
+	bool next(TimePoint& when, std::unique_ptr<Message>& msg);
+
+private:
+
+	// Disallow copy and assign
+	TraceReader(const TraceReader&) = delete;
+	TraceReader& operator=(const TraceReader&) = delete;
+
+	std::istream& in;
+
+	uint32_t seed;
+
+	board_id_t targetCount;
+
+	board_id_t playerCount;
+
+	bool acknowledgeShots;
+
+	TimePoint origin;
+
+	std::vector<uint8_t> buffer;
+};
+
+/**
+ * \brief Replays a trace through a GameRunner as fast as it can
+ * \param trace The trace to replay
+ * \param output Where the binary form of every message the runner sends is written, one after another
+ * \returns The number of steps replayed
+ *
+ * The runner's state machines are handed the times in the trace instead of the real time,
+ * so a replay's output is byte-for-byte what the recorded session sent, no matter how fast it runs.
+ */
+size_t replayTrace(std::istream& trace, std::ostream& output);
@@ -1,38 +1,148 @@
-#include <thread>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
 
 #include "common/MessageJunction.hpp"
-#include "common/GameStateMachine.hpp"
+#include "common/Exceptions.hpp"
+#include "common/Executor.hpp"
+#include "common/GameRunner.hpp"
+#include "common/LaneServer.hpp"
+#include "common/MatchHistory.hpp"
 #include "common/TCPMessageBridge.hpp"
 #include "common/MessageQueue.hpp"
+#include "common/PseudoTerminal.hpp"
+#include "common/SerialMessageBridge.hpp"
+#include "common/Trace.hpp"
 
 using namespace std;
 
-int main()
+/**
+ * Usage: gallery [--trace <file> | --lanes <count>] [<serial device> [<baud rate>] | --loopback]
+ *
+ * With --trace, every message the state machine receives is recorded to the given file
+ * so that the session can be replayed later (see replayTrace and bench/ReplayBench.cpp).
+ *
+ * With --lanes, the range is split into the given number of lanes of two targets and two guns each,
+ * and each lane plays its own game (see runLanes). Otherwise the range is one lane.
+ * Lanes can't be traced yet, so --trace runs a single game on a thread of its own.
+ *
+ * With a serial device, we talk to the hardware over it.
+ * With --loopback, we create a pseudo-terminal and print its name
+ * so that a simulator can stand in for the hardware.
+ *
+ * Every game played is saved to match-history.bin in the working directory, if it can be opened.
+ */
+int main(int argc, char** argv)
 {
-	MessageQueue toSM, fromSM;
+	ofstream traceFile;
+	unique_ptr<TraceWriter> trace;
+	size_t laneCount = 1;
+	if (argc > 2 && strcmp(argv[1], "--lanes") == 0) {
+		laneCount = strtoul(argv[2], nullptr, 10);
+		if (laneCount == 0 || laneCount > 64) {
+			fprintf(stderr, "The number of lanes must be from 1 to 64\n");
+			return 1;
+		}
+
+		argc -= 2;
+		argv += 2;
+	}
+	else if (argc > 2 && strcmp(argv[1], "--trace") == 0) {
+		traceFile.open(argv[2], ios::binary | ios::trunc);
+		if (!traceFile) {
+			fprintf(stderr, "Could not open %s to record a trace\n", argv[2]);
+			return 1;
+		}
+		trace.reset(new TraceWriter(traceFile));
+
+		// Shift the trace arguments off so the rest can be parsed as usual.
+		argc -= 2;
+		argv += 2;
+	}
+
+	// The state machine and the system link are our busiest queues,
+	// and each only has one receiver (the state machine and junction, respectively),
+	// so give them lock-free backends.
+	MessageQueue toSM(MessageQueue::Backend::LOCK_FREE), fromSM;
 	MessageQueue toUI, fromUI;
-	MessageQueue toSys, fromSys;
+	MessageQueue toSys, fromSys(MessageQueue::Backend::LOCK_FREE);
 
 	// TODO: Figure out our controller setup from the controller link
-	printf("Lighting up state machine...\n");
+	printf("Opening the match history...\n");
 	fflush(stdout);
-	thread smThread(&runGame, ref(toSM), ref(fromSM), 2, 2);
+	// Games are a minute or two long, so flushing each one as it ends costs next to nothing.
+	// Losing the history is no reason not to play, so carry on without one if it can't be opened.
+	unique_ptr<MatchHistory> history;
+	try {
+		history.reset(new MatchHistory("match-history.bin"));
+	}
+	catch (const Exceptions::IOException& e) {
+		fprintf(stderr, "Playing without a match history: %s\n", e.what());
+	}
+
+	// Everything that waits on a queue, a socket, or the serial port gets a blocking thread of its own:
+	// the game (or its lanes' dispatcher), the UI server and its queue, the system link, and the junction.
+	// The games themselves run on the workers, so more lanes don't mean more threads.
+	Executor executor(0, 5);
+
+	const LaneMap lanes = LaneMap::uniform(laneCount, 2, 2);
+
+	// Responses go to the UI, which has no use for responses to the hardware's shots,
+	// and whose own request IDs they could collide with.
+	const bool acknowledgeShots = false;
+
+	if (trace != nullptr) {
+		printf("Lighting up state machine...\n");
+		fflush(stdout);
+		executor.postBlocking([&] { runGame(toSM, fromSM, 2, 2, history.get(), trace.get(), acknowledgeShots); });
+	}
+	else {
+		printf("Lighting up %zu lane(s) on %zu workers...\n", laneCount, executor.getWorkerCount());
+		fflush(stdout);
+		executor.postBlocking([&] { runLanes(toSM, fromSM, lanes, executor, history.get(), acknowledgeShots); });
+	}
 
 	printf("Lighting up UI communications...\n");
 	fflush(stdout);
-	thread uiThread(&runTCPMessageServer, ref(toUI), ref(fromUI));
+	TCPServerOptions uiOptions;
+	uiOptions.executor = &executor;
+	executor.postBlocking([&] { runConfiguredTCPMessageServer(toUI, fromUI, uiOptions); });
+
+	unique_ptr<PseudoTerminal> loopback;
+	if (argc > 1) {
+		const string device = argv[1];
+
+		if (device == "--loopback") {
+			loopback.reset(new PseudoTerminal);
+			printf("Lighting up system communications on loopback %s...\n", loopback->getSlaveName().c_str());
+			fflush(stdout);
+			const int master = loopback->getMaster();
+			executor.postBlocking([&toSys, &fromSys, master] { runSerialMessageBridgeFD(toSys, fromSys, master); });
+		}
+		else {
+			const unsigned int baud = argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 9600;
+			printf("Lighting up system communications on %s...\n", device.c_str());
+			fflush(stdout);
+			executor.postBlocking([&toSys, &fromSys, device, baud] {
+				runSerialMessageBridge(toSys, fromSys, device, baud);
+			});
+		}
+	}
 
 	printf("Lighting up the message juntion...\n");
 	fflush(stdout);
-	thread junctionThread(&runMessageJunction, ref(toSM), ref(fromSM),
-	                                           ref(toUI), ref(fromUI),
-	                                           ref(toSys), ref(fromSys));
-
-	// We should never finish, but call join so that we stall here forever.
-	junctionThread.join();
-	smThread.join();
-	uiThread.join();
+	promise<void> junctionDone;
+	executor.postBlocking([&] {
+		runMessageJunction(toSM, fromSM, toUI, fromUI, toSys, fromSys);
+		junctionDone.set_value();
+	});
+
+	// We should never finish, but wait on the junction so that we stall here forever.
+	junctionDone.get_future().wait();
 	// We have a problem if we got here
 	return 1;
 }
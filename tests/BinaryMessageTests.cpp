@@ -5,10 +5,14 @@
 #include <vector>
 
 #include "BinaryMessage.hpp"
+#include "BinaryMessageViews.hpp"
+#include "ShotMessage.hpp"
+#include "TargetControlMessage.hpp"
 #include "Test.hpp"
 
 using namespace std;
 using namespace BinaryMessage;
+using namespace Testing;
 
 namespace {
 
@@ -36,6 +40,23 @@ void intConversions()
 	assert(extractInt32(buf.data()) == -2564);
 }
 
+void writeIntConversions()
+{
+	std::array<uint8_t, 4> buf;
+
+	assert(writeInt(buf.data(), (uint16_t)42) == buf.data() + 2);
+	assert(extractUInt16(buf.data()) == 42);
+
+	assert(writeInt(buf.data(), (int16_t)-42) == buf.data() + 2);
+	assert(extractInt16(buf.data()) == -42);
+
+	assert(writeInt(buf.data(), (uint32_t)1337) == buf.data() + 4);
+	assert(extractUInt32(buf.data()) == 1337);
+
+	assert(writeInt(buf.data(), (int32_t)-2564) == buf.data() + 4);
+	assert(extractInt32(buf.data()) == -2564);
+}
+
 void sanity()
 {
 	std::array<uint8_t, 0> emptyPayload;
@@ -76,12 +97,91 @@ void badCRC()
 	assert(why.find("CRC") != string::npos);
 }
 
+void inPlace()
+{
+	TargetControlMessage::CommandList comms;
+	comms.emplace_back(1, true);
+	comms.emplace_back(2, false);
+	comms.emplace_back(3, true);
+	const TargetControlMessage tcm(42, move(comms));
+	const ShotMessage sm(1337, Shot(1, 2, 25));
+
+	// Serializing into a stack buffer should match building the message from its payload
+	std::array<uint8_t, 32> buf;
+
+	size_t len = tcm.toBinary(buf);
+	assert(len == tcm.getBinaryLength());
+	auto payload = tcm.getBinaryPayload();
+	auto expected = makeMessage(tcm.getType(), tcm.id, begin(payload), end(payload));
+	assert(expected.size() == len);
+	assert(equal(begin(expected), end(expected), begin(buf)));
+	assert(isValidMessage(buf.data(), len));
+
+	len = sm.toBinary(buf.data(), buf.size());
+	assert(len == sm.getBinaryLength());
+	payload = sm.getBinaryPayload();
+	expected = makeMessage(sm.getType(), sm.id, begin(payload), end(payload));
+	assert(expected.size() == len);
+	assert(equal(begin(expected), end(expected), begin(buf)));
+	assert(*binaryToMessage(buf.data(), len) == sm);
+}
+
+void bufferTooSmall()
+{
+	const ShotMessage sm(1337, Shot(1, 2, 25));
+	std::array<uint8_t, 14> buf;
+	assert(sm.getBinaryLength() > buf.size());
+	testThrown<ArgumentOutOfRangeException>([&] { sm.toBinary(buf); });
+}
+
+void views()
+{
+	const ShotMessage sm(1337, Shot(1, -1, 25));
+	std::array<uint8_t, 32> buf;
+	size_t len = sm.toBinary(buf);
+
+	const MessageView mv(buf.data(), len);
+	assert(mv.getType() == Message::Type::SHOT);
+	assert(mv.getID() == 1337);
+	assert(mv.size() == len);
+
+	const ShotView shot(mv);
+	assert(shot.getID() == 1337);
+	assert(shot.getPlayer() == 1);
+	assert(shot.getTarget() == -1);
+	assert(shot.getTime() == 25);
+	assert(shot.toShot() == sm.shot);
+
+	// A view of one type can't be made from another
+	testThrown<IOException>([&] { TargetControlView tcv(mv); });
+
+	TargetControlMessage::CommandList comms;
+	comms.emplace_back(1, true);
+	comms.emplace_back(-2, false);
+	const TargetControlMessage tcm(42, move(comms));
+	len = tcm.toBinary(buf);
+
+	const TargetControlView tcv(MessageView::fromValidated(buf.data()));
+	assert(tcv.getID() == 42);
+	assert(tcv.size() == tcm.commands.size());
+	for (size_t i = 0; i < tcv.size(); ++i)
+		assert(tcv[i] == tcm.commands[i]);
+
+	// Corrupt the message. It should no longer be viewable.
+	buf[len - 1] ^= 0xff;
+	testThrown<IOException>([&] { MessageView bad(buf.data(), len); });
+}
+
 } // end anonymous namespace
 
 void Testing::BinaryMessageTests()
 {
 	beginUnit("Binary message serialization");
 	test("int -> buffer -> int conversions", &intConversions);
+	test("int -> raw buffer -> int conversions", &writeIntConversions);
 	test("sanity", &sanity);
 	test("Bad CRC", &badCRC);
+	test("Serialize into a caller-supplied buffer", &inPlace);
+	test("Caller-supplied buffer too small", &bufferTooSmall);
+	test("Message views", &views);
 }
@@ -0,0 +1,88 @@
+#include "CRCTests.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/crc.hpp>
+
+#include "CRC.hpp"
+#include "Test.hpp"
+
+using namespace std;
+
+namespace {
+
+uint16_t boostCRC(const uint8_t* data, size_t len)
+{
+	boost::crc_ccitt_type gen;
+	gen.process_bytes(data, len);
+	return gen.checksum();
+}
+
+vector<uint8_t> randomBytes(size_t len)
+{
+	mt19937 rng(2564);
+	uniform_int_distribution<int> dist(0, 255);
+
+	vector<uint8_t> ret(len);
+	for (auto& b : ret)
+		b = (uint8_t)dist(rng);
+	return ret;
+}
+
+void checkValue()
+{
+	// The standard check value for CRC-16/CCITT-FALSE
+	const char* check = "123456789";
+	assert(CRC::ccitt(check, 9) == 0x29b1);
+	assert(CRC::ccittSlicing(check, 9) == 0x29b1);
+	assert(CRC::ccittFolding(check, 9) == 0x29b1);
+
+	// No data leaves the initial value alone
+	assert(CRC::ccitt(check, 0) == CRC::ccittInit);
+}
+
+void matchesBoost()
+{
+	// Cover the table-only sizes, single-block folding, and four-lane folding,
+	// starting at every alignment within a block.
+	const auto data = randomBytes(1024 + 16);
+
+	for (size_t offset = 0; offset < 16; ++offset) {
+		for (size_t len = 0; len <= 1024; len += (len < 300 ? 1 : 37)) {
+			const uint8_t* start = data.data() + offset;
+			const uint16_t expected = boostCRC(start, len);
+			assert(CRC::ccittSlicing(start, len) == expected);
+			assert(CRC::ccittFolding(start, len) == expected);
+			assert(CRC::ccitt(start, len) == expected);
+		}
+	}
+}
+
+void continuation()
+{
+	const auto data = randomBytes(700);
+	const uint16_t expected = boostCRC(data.data(), data.size());
+
+	for (size_t split = 0; split <= data.size(); split += 23) {
+		uint16_t crc = CRC::ccitt(data.data(), split);
+		crc = CRC::ccitt(data.data() + split, data.size() - split, crc);
+		assert(crc == expected);
+
+		crc = CRC::ccittFolding(data.data(), split);
+		crc = CRC::ccittFolding(data.data() + split, data.size() - split, crc);
+		assert(crc == expected);
+	}
+}
+
+} // end anonymous namespace
+
+void Testing::CRCTests()
+{
+	beginUnit("CRC");
+	test("CRC-16-CCITT check value", &checkValue);
+	test("Matches boost::crc_ccitt_type", &matchesBoost);
+	test("Continue a CRC across buffers", &continuation);
+}
@@ -0,0 +1,162 @@
+#include "ExecutorTests.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "Executor.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+/// Counts down to zero, then wakes whoever is waiting on it
+class Latch {
+
+public:
+
+	explicit Latch(size_t c) : count(c), mtx(), cv() { }
+
+	void countDown()
+	{
+		lock_guard<mutex> lock(mtx);
+		if (--count == 0)
+			cv.notify_all();
+	}
+
+	/// Returns false if the count didn't reach zero within the timeout
+	bool wait(milliseconds timeout = milliseconds(5000))
+	{
+		unique_lock<mutex> lock(mtx);
+		return cv.wait_for(lock, timeout, [this] { return count == 0; });
+	}
+
+private:
+
+	size_t count;
+	mutex mtx;
+	condition_variable cv;
+};
+
+void tasks()
+{
+	atomic<int> ran(0);
+	{
+		Executor executor(4);
+		assert(executor.getWorkerCount() == 4);
+		assert(!executor.isWorker());
+
+		for (int i = 0; i < 10000; ++i)
+			executor.post([&ran] { ++ran; });
+	}
+	// The executor finishes everything that was posted before it stops.
+	assert(ran == 10000);
+}
+
+void stealing()
+{
+	Executor executor(4);
+
+	mutex idsMutex;
+	set<thread::id> ids;
+	Latch done(200);
+
+	// Everything posted from a worker goes on its own deque, so anyone else who runs one of these stole it.
+	executor.post([&] {
+		assert(executor.isWorker());
+		for (int i = 0; i < 200; ++i) {
+			executor.post([&] {
+				this_thread::sleep_for(microseconds(500));
+				{
+					lock_guard<mutex> lock(idsMutex);
+					ids.insert(this_thread::get_id());
+				}
+				done.countDown();
+			});
+		}
+	});
+
+	assert(done.wait());
+	assert(ids.size() > 1);
+}
+
+void timers()
+{
+	Executor executor(2);
+
+	mutex orderMutex;
+	vector<int> order;
+	Latch done(3);
+
+	const auto record = [&](int i) {
+		return [&, i] {
+			{
+				lock_guard<mutex> lock(orderMutex);
+				order.push_back(i);
+			}
+			done.countDown();
+		};
+	};
+
+	const auto start = Executor::Clock::now();
+	executor.postAfter(milliseconds(60), record(3));
+	executor.postAfter(milliseconds(20), record(1));
+	const auto canceled = executor.postAfter(milliseconds(40), record(-1));
+	executor.postAt(start + milliseconds(40), record(2));
+
+	assert(executor.cancel(canceled));
+	assert(!executor.cancel(canceled));
+
+	assert(done.wait());
+	assert(Executor::Clock::now() - start >= milliseconds(60));
+	assert(order == vector<int>({1, 2, 3}));
+
+	// Give the canceled timer a chance to prove it's gone.
+	this_thread::sleep_for(milliseconds(20));
+	lock_guard<mutex> lock(orderMutex);
+	assert(order.size() == 3);
+}
+
+void blocking()
+{
+	Executor executor(1, 2);
+	assert(executor.getBlockingCount() == 2);
+
+	// These two wait on each other, so they only finish if they each get a thread.
+	Latch both(2), done(2);
+	for (int i = 0; i < 2; ++i) {
+		executor.postBlocking([&] {
+			both.countDown();
+			assert(both.wait());
+			done.countDown();
+		});
+	}
+	assert(done.wait());
+
+	Executor noBlocking(1);
+	testThrown<InvalidOperationException>([&] { noBlocking.postBlocking([] { }); });
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void ExecutorTests()
+{
+	beginUnit("Executor");
+	test("Tasks", &tasks);
+	test("Work stealing", &stealing);
+	test("Timers", &timers);
+	test("Blocking tasks", &blocking);
+}
+
+} // end namespace Testing
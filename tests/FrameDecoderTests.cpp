@@ -0,0 +1,172 @@
+#include "FrameDecoderTests.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "BinaryMessageViews.hpp"
+#include "FrameDecoder.hpp"
+#include "ShotMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace BinaryMessage;
+
+namespace {
+
+vector<uint8_t> makeShot(message_id_t id)
+{
+	return ShotMessage(id, Shot(1, 2, id)).toBinary();
+}
+
+void append(vector<uint8_t>& stream, const vector<uint8_t>& bytes)
+{
+	stream.insert(end(stream), begin(bytes), end(bytes));
+}
+
+/// Feeds the whole stream in chunks of the given size and returns the IDs of the frames decoded
+vector<message_id_t> decode(FrameDecoder& decoder, const vector<uint8_t>& stream, size_t chunkSize)
+{
+	vector<message_id_t> ids;
+
+	for (size_t i = 0; i < stream.size(); i += chunkSize) {
+		const size_t len = min(chunkSize, stream.size() - i);
+		assert(decoder.feed(stream.data() + i, len) == len);
+
+		while (const uint8_t* frame = decoder.next()) {
+			assert(isValidMessage(frame, MessageView::fromValidated(frame).size()));
+			ids.emplace_back(ShotView(MessageView::fromValidated(frame)).getTime());
+		}
+	}
+
+	return ids;
+}
+
+void backToBack()
+{
+	vector<uint8_t> stream;
+	for (message_id_t id = 0; id < 10; ++id)
+		append(stream, makeShot(id));
+
+	FrameDecoder decoder;
+	auto ids = decode(decoder, stream, stream.size());
+	assert(ids.size() == 10);
+	for (message_id_t id = 0; id < 10; ++id)
+		assert(ids[id] == id);
+
+	assert(decoder.buffered() == 0);
+	assert(decoder.getStatistics().frames == 10);
+	assert(decoder.getStatistics().resyncs == 0);
+}
+
+void partialFrames()
+{
+	vector<uint8_t> stream;
+	for (message_id_t id = 0; id < 10; ++id)
+		append(stream, makeShot(id));
+
+	// Byte at a time, and a chunk size that doesn't line up with the frames
+	for (size_t chunk : { 1, 7 }) {
+		FrameDecoder decoder;
+		auto ids = decode(decoder, stream, chunk);
+		assert(ids.size() == 10);
+		for (message_id_t id = 0; id < 10; ++id)
+			assert(ids[id] == id);
+	}
+}
+
+void lineNoise()
+{
+	// Noise, including stray magic bytes, before and between frames
+	const vector<uint8_t> noise = { 'x', 'f', 'f', 'q', 'u', 'f' };
+
+	vector<uint8_t> stream;
+	append(stream, noise);
+	append(stream, makeShot(1));
+	append(stream, noise);
+	append(stream, makeShot(2));
+
+	FrameDecoder decoder;
+	auto ids = decode(decoder, stream, 3);
+	assert(ids.size() == 2);
+	assert(ids[0] == 1 && ids[1] == 2);
+
+	const auto& stats = decoder.getStatistics();
+	assert(stats.frames == 2);
+	assert(stats.resyncs > 0);
+	assert(stats.bytesDiscarded == noise.size() * 2);
+}
+
+void badCRC()
+{
+	auto bad = makeShot(1);
+	bad[payloadOffset] ^= 0xff;
+
+	vector<uint8_t> stream;
+	append(stream, bad);
+	append(stream, makeShot(2));
+
+	FrameDecoder decoder;
+	auto ids = decode(decoder, stream, stream.size());
+	assert(ids.size() == 1);
+	assert(ids[0] == 2);
+
+	const auto& stats = decoder.getStatistics();
+	assert(stats.crcFailures == 1);
+	assert(stats.bytesDiscarded == bad.size());
+}
+
+void oversized()
+{
+	// A frame claiming a payload bigger than we accept shouldn't make us wait for it.
+	vector<uint8_t> big(64, 0);
+	auto bigFrame = makeMessage(Message::Type::TEST, 1, begin(big), end(big));
+
+	vector<uint8_t> stream;
+	append(stream, bigFrame);
+	append(stream, makeShot(2));
+
+	FrameDecoder decoder(16);
+	auto ids = decode(decoder, stream, 8);
+	assert(ids.size() == 1);
+	assert(ids[0] == 2);
+	assert(decoder.getStatistics().oversized == 1);
+}
+
+void prepareCommit()
+{
+	const auto shot = makeShot(42);
+
+	FrameDecoder decoder(Shot::binaryLength, Shot::binaryLength + frameOverhead);
+
+	auto space = decoder.prepare();
+	assert(space.second == shot.size());
+	memcpy(space.first, shot.data(), shot.size());
+	decoder.commit(shot.size());
+
+	// Full, so there's no more room until we drain it
+	assert(decoder.prepare().second == 0);
+
+	const uint8_t* frame = decoder.next();
+	assert(frame != nullptr);
+	// The frame is handed out in place
+	assert(frame == space.first);
+	assert(ShotView(MessageView::fromValidated(frame)).getID() == 42);
+	assert(decoder.next() == nullptr);
+
+	assert(decoder.prepare().second == shot.size());
+}
+
+} // end anonymous namespace
+
+void Testing::FrameDecoderTests()
+{
+	beginUnit("Frame decoder");
+	test("Back-to-back frames", &backToBack);
+	test("Frames split across reads", &partialFrames);
+	test("Resync past line noise", &lineNoise);
+	test("Resync past a bad CRC", &badCRC);
+	test("Reject oversized frames", &oversized);
+	test("Decode in place with prepare/commit", &prepareCommit);
+}
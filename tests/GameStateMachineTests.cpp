@@ -6,7 +6,9 @@
 #include "MessageTests.hpp"
 #include "MemoryUtils.hpp"
 #include "MessageQueue.hpp"
+#include "GameRunner.hpp"
 #include "GameStateMachine.hpp"
+#include "PopUpStateMachine.hpp"
 #include "SetupMessage.hpp"
 #include "StatusMessage.hpp"
 #include "ResultsMessage.hpp"
@@ -20,7 +22,7 @@ using namespace std;
 /// Macro to quickly set up a test environment for the game state machine(s)
 #define MACHINE_ENVIRONMENT \
 	MessageQueue in, out; \
-	thread stateThread(&runGame, ref(in), ref(out), 2, 2); \
+	thread stateThread(&runGame, ref(in), ref(out), 2, 2, nullptr, nullptr, true); \
 	int id = -1; \
 	(void)id; // No unused warnings please
 
@@ -131,6 +133,42 @@ void setup()
 	ASSERT_EMPTY_OUT;
 }
 
+void results()
+{
+	PopUpStateMachine machine(2, 2, chrono::seconds(30), -1);
+	machine.start(1, 1);
+
+	// Shots mostly arrive in order, but not always, and sometimes twice.
+	const Shot fired[] = { Shot(0, 1, 100), Shot(1, 0, 150), Shot(0, -1, 300), Shot(0, 0, 200),
+	                       Shot(1, 1, 400), Shot(0, -1, 300), Shot(0, 1, 50) };
+	message_id_t shotID = 10;
+	for (const auto& shot : fired) {
+		assert(machine.onShot(shotID, ShotMessage(shotID, shot))->code == Code::OK);
+		++shotID;
+	}
+
+	// Shots from players who aren't playing are turned away.
+	assert(machine.onShot(shotID, ShotMessage(shotID, Shot(2, 0, 500)))->code == Code::INVALID_REQUEST);
+
+	// Every shot that got through is announced once.
+	assert(machine.getEvents().size() == 6);
+
+	machine.stop(2, 2);
+
+	auto response = unique_dynamic_cast<ResultsResponseMessage>(machine.getResultsResponse(3, 3));
+	assert(response != nullptr);
+	assert(response->stats.size() == 2);
+	assert(response->stats[0].shots ==
+	       vector<Shot>({ Shot(0, 1, 50), Shot(0, 1, 100), Shot(0, 0, 200), Shot(0, -1, 300) }));
+	assert(response->stats[1].shots == vector<Shot>({ Shot(1, 0, 150), Shot(1, 1, 400) }));
+
+	// Statistics count each shot once, however many times it was sent.
+	assert(response->stats[0].statistics.shotsFired == 4);
+	assert(response->stats[0].statistics.misses == 1);
+	assert(response->stats[1].statistics.shotsFired == 2);
+	assert(response->stats[1].statistics.misses == 0);
+}
+
 } // end anonymous namespace
 
 void Testing::GameStateMachineTests()
@@ -143,4 +181,5 @@ void Testing::GameStateMachineTests()
 	test("Early status", &earlyStatus);
 	test("Early results", &earlyResults);
 	test("Setup", &setup);
+	test("Results", &results);
 }
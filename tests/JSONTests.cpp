@@ -0,0 +1,205 @@
+#include "JSONTests.hpp"
+
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include <string>
+
+#include "Exceptions.hpp"
+#include "JSONReader.hpp"
+#include "JSONWriter.hpp"
+#include "Message.hpp"
+#include "Test.hpp"
+
+using namespace Exceptions;
+using namespace Testing;
+using namespace std;
+
+namespace {
+
+typedef JSONReader::Token Token;
+
+void writer()
+{
+	string out;
+	JSONWriter w(out);
+	w.beginObject();
+	w.key("a");
+	w.value(1);
+	w.key("b");
+	w.beginArray();
+	w.value(true);
+	w.value(INT64_MIN);
+	w.beginObject();
+	w.endObject();
+	w.endArray();
+	w.key("c");
+	w.value("x");
+	w.endObject();
+
+	assert(out == "{\"a\":1,\"b\":[true,-9223372036854775808,{}],\"c\":\"x\"}");
+}
+
+void escapes()
+{
+	const string withNul = string("quote\" backslash\\ newline\n tab\t bell\x07 nul") + '\0' + "after";
+
+	string out;
+	JSONWriter w(out);
+	w.value(withNul);
+	assert(out.find("\\u0007") != string::npos);
+	assert(out.find("\\u0000") != string::npos);
+
+	JSONReader r(out.data(), out.size());
+	string back;
+	r.readString(back);
+	r.finish();
+	assert(back == withNul);
+}
+
+void unicode()
+{
+	// An e with an acute accent and a G clef, which needs a surrogate pair
+	const char text[] = "\"\\u00e9\\ud834\\udd1e\"";
+	JSONReader r(text, sizeof(text) - 1);
+	string s;
+	r.readString(s);
+	assert(s == "\xc3\xa9\xf0\x9d\x84\x9e");
+}
+
+void walk()
+{
+	const char text[] =
+		" { \"skip\" : [1, 2.5e3, {\"deep\": [null, false]}, \"s\\\"}\"],"
+		"\"n\": -2147483648, \"k\\u0065y\": true, \"arr\": [] } \r\n";
+
+	JSONReader r(text, sizeof(text) - 1);
+	assert(r.peek() == Token::OBJECT);
+	r.beginObject();
+
+	int n = 0;
+	bool key = false;
+	bool sawArray = false;
+	while (r.nextMember()) {
+		if (r.isKey("n")) {
+			n = r.readInt();
+		}
+		else if (r.isKey("key")) {
+			key = r.readBool();
+		}
+		else if (r.isKey("arr")) {
+			r.beginArray();
+			assert(!r.nextElement());
+			sawArray = true;
+		}
+		else {
+			assert(r.getKey() == "skip");
+			r.skipValue();
+		}
+	}
+	r.finish();
+
+	assert(n == INT_MIN);
+	assert(key);
+	assert(sawArray);
+}
+
+void malformed()
+{
+	const auto bad = [](const char* text) {
+		testThrown<IOException>([=] {
+			JSONReader r(text, strlen(text));
+			r.skipValue();
+			r.finish();
+		});
+	};
+
+	bad("");
+	bad("{");
+	bad("{\"a\" 1}");
+	bad("{\"a\":1,}");
+	bad("[1 2]");
+	bad("\"unterminated");
+	bad("tru");
+	bad("{} {}");
+	bad(string(1000, '[').c_str());
+
+	// Skipping doesn't look inside escape sequences, but reading does.
+	const auto badString = [](const char* text) {
+		testThrown<IOException>([=] {
+			string s;
+			JSONReader(text, strlen(text)).readString(s);
+		});
+	};
+
+	badString("\"bad \\q escape\"");
+	badString("\"\\ud834 lonely\"");
+	badString("\"\\u12\"");
+	badString("\"raw\nnewline\"");
+
+	testThrown<IOException>([] {
+		const char text[] = "2147483648";
+		JSONReader(text, sizeof(text) - 1).readInt();
+	});
+	testThrown<IOException>([] {
+		const char text[] = "1.5";
+		JSONReader(text, sizeof(text) - 1).readInt();
+	});
+	testThrown<IOException>([] {
+		const char text[] = "\"1\"";
+		JSONReader(text, sizeof(text) - 1).readInt();
+	});
+}
+
+void messageDecoding()
+{
+	// Members the decoder doesn't know about are skipped, wherever they are.
+	const char extra[] =
+		"{\"future\":{\"x\":[1,2]},\"type\":\"shot\",\"id\":7,"
+		"\"shot\":{\"player\":1,\"target ID\":2,\"time\":300,\"note\":\"ignored\"}}";
+	auto msg = JSONToMessage(extra, sizeof(extra) - 1);
+	assert(msg->getType() == Message::Type::SHOT);
+	assert(msg->id == 7);
+
+	// Members another message type would use aren't checked either, just as jsoncpp's decoding ignores them.
+	const char foreign[] = "{\"type\":\"start\",\"id\":7,\"time\":\"now\",\"shot\":[]}";
+	Json::Value parsed;
+	assert(Json::Reader().parse(foreign, foreign + sizeof(foreign) - 1, parsed));
+	auto streamed = JSONToMessage(foreign, sizeof(foreign) - 1);
+	assert(streamed->getType() == Message::Type::START);
+	assert(*streamed == *JSONToMessage(parsed));
+
+	testThrown<IOException>([] {
+		const char text[] = "{\"id\":1}";
+		JSONToMessage(text, sizeof(text) - 1);
+	});
+	testThrown<IOException>([] {
+		const char text[] = "{\"id\":1,\"type\":\"nonsense\"}";
+		JSONToMessage(text, sizeof(text) - 1);
+	});
+	testThrown<IOException>([] {
+		const char text[] = "{\"id\":1,\"type\":\"shot\"}";
+		JSONToMessage(text, sizeof(text) - 1);
+	});
+	testThrown<IOException>([] {
+		const char text[] = "[]";
+		JSONToMessage(text, sizeof(text) - 1);
+	});
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void JSONTests()
+{
+	beginUnit("JSON");
+	test("Writer", &writer);
+	test("String escapes", &escapes);
+	test("Unicode escapes", &unicode);
+	test("Walk and skip", &walk);
+	test("Malformed text", &malformed);
+	test("Message decoding", &messageDecoding);
+}
+
+} // end namespace Testing
@@ -0,0 +1,218 @@
+#include "LaneServerTests.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "Exceptions.hpp"
+#include "Executor.hpp"
+#include "ExitMessage.hpp"
+#include "LaneMap.hpp"
+#include "LaneServer.hpp"
+#include "MessageQueue.hpp"
+#include "MemoryUtils.hpp"
+#include "ResponseMessage.hpp"
+#include "SetupMessage.hpp"
+#include "ShotMessage.hpp"
+#include "StartMessage.hpp"
+#include "StatusMessage.hpp"
+#include "StatusResponseMessage.hpp"
+#include "TargetControlMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+/// Puts a message in a lane
+unique_ptr<Message> inLane(Message* msg, lane_id_t lane)
+{
+	unique_ptr<Message> ret(msg);
+	ret->lane = lane;
+	return ret;
+}
+
+/**
+ * \brief Waits for the response to the given message, checking everything that comes before it
+ *
+ * Other lanes' games keep running while we wait, so whatever they send may be mixed in,
+ * but any target a lane lights must be one of its own.
+ */
+unique_ptr<ResponseMessage> awaitResponse(MessageQueue& out, const LaneMap& map, lane_id_t lane, message_id_t to)
+{
+	while (auto msg = out.receive(seconds(2))) {
+		if (msg->getType() == Message::Type::TARGET_CONTROL) {
+			const auto& targets = map.at(msg->lane).targets;
+			for (const auto& command : static_cast<const TargetControlMessage&>(*msg).commands)
+				assert(find(begin(targets), end(targets), command.id) != end(targets));
+		}
+
+		if (msg->lane != lane)
+			continue;
+
+		auto response = unique_dynamic_cast<ResponseMessage>(move(msg));
+		if (response != nullptr && response->respondingTo == to)
+			return response;
+	}
+
+	assert(false); // We timed out.
+	return nullptr;
+}
+
+void laneMap()
+{
+	const auto map = LaneMap::uniform(3, 2, 1);
+	assert(map.size() == 3);
+	assert(map.at(2).targets == vector<board_id_t>({4, 5}));
+	assert(map.at(2).guns == vector<board_id_t>({2}));
+
+	assert(map.findTarget(3).lane == 1 && map.findTarget(3).local == 1);
+	assert(map.findGun(2).lane == 2 && map.findGun(2).local == 0);
+	assert(!map.findTarget(6).isValid());
+	assert(!map.findTarget(-1).isValid());
+	assert(map.globalTarget(1, 0) == 2);
+
+	LaneMap custom;
+	assert(custom.addLane({9, 3}, {1}) == 0);
+	assert(custom.findTarget(9).local == 0);
+	testThrown<ArgumentException>([&] { custom.addLane({4, 3}, {2}); });
+	testThrown<ArgumentException>([&] { custom.addLane({4, 4}, {2}); });
+	testThrown<ArgumentException>([&] { custom.addLane({4}, {}); });
+	// A lane that was turned away leaves nothing behind.
+	assert(custom.size() == 1);
+	assert(!custom.findTarget(4).isValid());
+	assert(custom.addLane({4}, {2}) == 1);
+
+	testThrown<ArgumentException>([] { LaneMap::uniform(65, 2, 2); });
+}
+
+void independentLanes()
+{
+	const auto map = LaneMap::uniform(3, 2, 2);
+	Executor executor(2);
+	MessageQueue in, out;
+	thread server(&runLanes, ref(in), ref(out), cref(map), ref(executor), nullptr, true);
+
+	// Set up and start a game in the second lane only.
+	in.send(inLane(new SetupMessage(1, GameType::POP_UP, 2, 30, -1, SetupMessage::DataMap()), 1));
+	assert(awaitResponse(out, map, 1, 1)->code == ResponseMessage::Code::OK);
+	in.send(inLane(new StartMessage(2), 1));
+	assert(awaitResponse(out, map, 1, 2)->code == ResponseMessage::Code::OK);
+
+	// Gun 3 is the second lane's second player.
+	in.send(unique_ptr<Message>(new ShotMessage(3, Shot(3, -1, 100))));
+	assert(awaitResponse(out, map, 1, 3)->code == ResponseMessage::Code::OK);
+
+	// The third lane hasn't set up a game, so it has nothing to do with the shot.
+	in.send(unique_ptr<Message>(new ShotMessage(4, Shot(4, 2, 100))));
+	assert(awaitResponse(out, map, 2, 4)->code == ResponseMessage::Code::INVALID_REQUEST);
+
+	in.send(inLane(new StatusMessage(5), 1));
+	auto status = unique_dynamic_cast<StatusResponseMessage>(awaitResponse(out, map, 1, 5));
+	assert(status != nullptr && status->running);
+
+	in.send(inLane(new StatusMessage(6), 0));
+	status = unique_dynamic_cast<StatusResponseMessage>(awaitResponse(out, map, 0, 6));
+	assert(status != nullptr && !status->running);
+
+	in.send(unique_ptr<Message>(new ExitMessage(7)));
+	server.join();
+}
+
+void deadlines()
+{
+	const auto map = LaneMap::uniform(2, 2, 2);
+	Executor executor(1);
+	MessageQueue in, out;
+	thread server(&runLanes, ref(in), ref(out), cref(map), ref(executor), nullptr, true);
+
+	// Nothing but the lane's timers are around to end the game.
+	in.send(inLane(new SetupMessage(1, GameType::POP_UP, 2, 1, -1, SetupMessage::DataMap()), 1));
+	assert(awaitResponse(out, map, 1, 1)->code == ResponseMessage::Code::OK);
+	in.send(inLane(new StartMessage(2), 1));
+	assert(awaitResponse(out, map, 1, 2)->code == ResponseMessage::Code::OK);
+
+	this_thread::sleep_for(milliseconds(1500));
+
+	in.send(inLane(new StatusMessage(3), 1));
+	auto status = unique_dynamic_cast<StatusResponseMessage>(awaitResponse(out, map, 1, 3));
+	assert(status != nullptr && !status->running);
+
+	in.send(unique_ptr<Message>(new ExitMessage(4)));
+	server.join();
+}
+
+void unroutable()
+{
+	const auto map = LaneMap::uniform(2, 2, 2);
+	Executor executor(4);
+	MessageQueue in, out;
+	thread server(&runLanes, ref(in), ref(out), cref(map), ref(executor), nullptr, true);
+
+	in.send(inLane(new StatusMessage(1), 2));
+	assert(awaitResponse(out, map, 2, 1)->code == ResponseMessage::Code::INVALID_REQUEST);
+
+	in.send(unique_ptr<Message>(new ShotMessage(2, Shot(4, -1, 100))));
+	auto response = awaitResponse(out, map, 0, 2);
+	assert(response->code == ResponseMessage::Code::INVALID_REQUEST);
+
+	in.send(unique_ptr<Message>(new ExitMessage(3)));
+	server.join();
+}
+
+void unacknowledgedShots()
+{
+	const auto map = LaneMap::uniform(2, 2, 2);
+	Executor executor(2);
+	MessageQueue in, out;
+	thread server(&runLanes, ref(in), ref(out), cref(map), ref(executor), nullptr, false);
+
+	in.send(inLane(new SetupMessage(1, GameType::POP_UP, 2, 30, -1, SetupMessage::DataMap()), 1));
+	assert(awaitResponse(out, map, 1, 1)->code == ResponseMessage::Code::OK);
+	in.send(inLane(new StartMessage(2), 1));
+	assert(awaitResponse(out, map, 1, 2)->code == ResponseMessage::Code::OK);
+
+	// Neither a shot in a lane nor one from a gun in no lane gets a response...
+	in.send(unique_ptr<Message>(new ShotMessage(3, Shot(3, -1, 100))));
+	in.send(unique_ptr<Message>(new ShotMessage(4, Shot(9, -1, 100))));
+	in.send(unique_ptr<Message>(new ShotMessage(5, Shot(0, -1, 100))));
+
+	// ...but the game still sees the shot, and requests are still answered.
+	bool sawShot = false;
+	for (lane_id_t lane = 0; lane < 2; ++lane) {
+		in.send(inLane(new StatusMessage(6), lane));
+
+		while (true) {
+			auto msg = out.receive(seconds(2));
+			assert(msg != nullptr);
+			assert(msg->getType() != Message::Type::RESPONSE);
+			if (msg->getType() == Message::Type::EVENT)
+				sawShot = true;
+			if (msg->getType() == Message::Type::STATUS_RESPONSE && msg->lane == lane)
+				break;
+		}
+	}
+	assert(sawShot);
+
+	in.send(unique_ptr<Message>(new ExitMessage(7)));
+	server.join();
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void LaneServerTests()
+{
+	beginUnit("Lane server");
+	test("Lane map", &laneMap);
+	test("Independent lanes", &independentLanes);
+	test("Deadlines", &deadlines);
+	test("Unroutable messages", &unroutable);
+	test("Unacknowledged shots", &unacknowledgedShots);
+}
+
+} // end namespace Testing
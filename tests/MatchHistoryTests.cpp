@@ -0,0 +1,251 @@
+#include "MatchHistoryTests.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "MatchHistory.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+typedef ResultsResponseMessage::PlayerStats PlayerStats;
+
+/// A file for a test's history that is removed when the test is done with it
+class TempFile {
+
+public:
+
+	TempFile() : path()
+	{
+		char name[] = "/tmp/match-history-XXXXXX";
+		const int fd = mkstemp(name);
+		ENFORCE(IOException, fd >= 0, "Could not create a temporary file");
+		close(fd);
+		path = name;
+	}
+
+	~TempFile() { remove(path.c_str()); }
+
+	string path;
+};
+
+/// Makes the results of a two-player game
+ResultsResponseMessage::StatsList makeGame(score_t firstScore, score_t secondScore, size_t shotsEach = 2)
+{
+	ShotStatistics stats;
+	stats.shotsFired = (shot_t)shotsEach;
+	stats.fastestReaction = 250;
+
+	ResultsResponseMessage::StatsList ret;
+	for (board_id_t p = 0; p < 2; ++p) {
+		vector<Shot> shots;
+		for (size_t i = 0; i < shotsEach; ++i)
+			shots.emplace_back(p, (board_id_t)(i % 3) - 1, (timestamp_t)(i * 100 + (size_t)p));
+
+		ret.emplace_back(p == 0 ? firstScore : secondScore, (shot_t)shotsEach, move(shots), stats);
+	}
+	return ret;
+}
+
+void roundTrip()
+{
+	TempFile file;
+	const auto game = makeGame(40, 25);
+
+	{
+		MatchHistory history(file.path);
+		assert(history.size() == 0);
+
+		history.append(GameType::POP_UP, 1000, game);
+		assert(history.size() == 1);
+		assert(history.unsynced() == 0);
+	}
+
+	// It's all still there when we come back.
+	MatchHistory history(file.path);
+	assert(history.size() == 1);
+
+	const auto games = history.lastGames(5);
+	assert(games.size() == 1);
+
+	const auto& g = games[0];
+	assert(g.getDate() == 1000);
+	assert(g.getGameType() == GameType::POP_UP);
+	assert(g.getPlayerCount() == 2);
+	for (board_id_t p = 0; p < 2; ++p) {
+		assert(g.getScore(p) == game[(size_t)p].score);
+		assert(g.getHits(p) == game[(size_t)p].hits);
+		assert(g.getStatistics(p) == game[(size_t)p].statistics);
+		assert(g.getShots(p) == game[(size_t)p].shots);
+	}
+
+	testThrown<ArgumentOutOfRangeException>([&] { g.getScore(2); });
+}
+
+void queries()
+{
+	TempFile file;
+	MatchHistory history(file.path, 10);
+
+	history.append(GameType::POP_UP, 100, makeGame(10, 50));
+	history.append(GameType::POP_UP, 300, makeGame(30, 5));
+	// Games can end out of order if the clock is set back.
+	history.append(GameType::POP_UP, 200, makeGame(50, 20));
+	// Player 1 didn't play this one.
+	ResultsResponseMessage::StatsList solo;
+	solo.emplace_back(70, 3, vector<Shot>({ Shot(0, 1, 10) }));
+	solo.emplace_back(0, 0, vector<Shot>());
+	history.append(GameType::POP_UP, 400, solo);
+
+	assert(history.unsynced() == 4);
+	history.sync();
+	assert(history.unsynced() == 0);
+
+	const auto last = history.lastGames(2);
+	assert(last.size() == 2);
+	assert(last[0].getDate() == 400);
+	assert(last[1].getDate() == 300);
+
+	const auto player1 = history.lastGamesFor(1, 10);
+	assert(player1.size() == 3);
+	assert(player1[0].getDate() == 300);
+	assert(player1[1].getDate() == 200);
+	assert(player1[2].getDate() == 100);
+	assert(history.lastGamesFor(5, 10).empty());
+
+	const auto between = history.gamesBetween(150, 400);
+	assert(between.size() == 2);
+	assert(between[0].getDate() == 200);
+	assert(between[1].getDate() == 300);
+
+	// Ties go to the earlier game.
+	const auto top = history.leaderboard(3);
+	assert(top.size() == 3);
+	assert(top[0].score == 70 && top[0].date == 400 && top[0].player == 0);
+	assert(top[1].score == 50 && top[1].date == 100 && top[1].player == 1);
+	assert(top[2].score == 50 && top[2].date == 200 && top[2].player == 0);
+
+	const auto recent = history.leaderboard(2, 250);
+	assert(recent.size() == 2);
+	assert(recent[0].score == 70);
+	assert(recent[1].score == 30);
+
+	assert(history.leaderboard(0).empty());
+}
+
+void growth()
+{
+	TempFile file;
+
+	{
+		MatchHistory history(file.path, 50);
+		// Each of these takes a bit over 2 KB, so this will grow the file a few times.
+		for (time_t date = 0; date < 200; ++date)
+			history.append(GameType::POP_UP, date, makeGame((score_t)date, 0, 180));
+	}
+
+	MatchHistory history(file.path);
+	assert(history.size() == 200);
+	assert(history.lastGames(1)[0].getScore(0) == 199);
+	assert(history.lastGames(1)[0].getShots(1) == makeGame(0, 0, 180)[1].shots);
+	assert(history.leaderboard(1)[0].score == 199);
+}
+
+void tornRecords()
+{
+	TempFile file;
+
+	{
+		MatchHistory history(file.path);
+		history.append(GameType::POP_UP, 100, makeGame(10, 20));
+		history.append(GameType::POP_UP, 200, makeGame(30, 40, 20));
+	}
+
+	// Pretend we died partway through writing the second game by mangling the end of it.
+	const auto firstLength = 4 + 10 + 2 * 30 + 4 * Shot::binaryLength + 2;
+	{
+		fstream f(file.path, ios::in | ios::out | ios::binary);
+		f.seekp((streamoff)(8 + firstLength + 100));
+		f.put('\x5a');
+	}
+
+	{
+		MatchHistory history(file.path);
+		assert(history.size() == 1);
+		assert(history.lastGames(1)[0].getDate() == 100);
+
+		// The next game goes where the torn one was.
+		history.append(GameType::POP_UP, 300, makeGame(50, 60));
+	}
+
+	MatchHistory history(file.path);
+	assert(history.size() == 2);
+	assert(history.lastGames(1)[0].getDate() == 300);
+	assert(history.lastGames(1)[0].getScore(1) == 60);
+
+	// Files that aren't histories are turned away.
+	{
+		ofstream f(file.path, ios::binary | ios::trunc);
+		f << "Not a match history";
+	}
+	testThrown<IOException>([&] { MatchHistory bad(file.path); });
+}
+
+void failedGrowth()
+{
+	TempFile file;
+	MatchHistory history(file.path);
+	history.append(GameType::POP_UP, 100, makeGame(10, 20));
+
+	// Don't let the file grow past where it is now. Growing it should fail, not kill us.
+	rlimit old;
+	assert(getrlimit(RLIMIT_FSIZE, &old) == 0);
+	rlimit capped = old;
+	capped.rlim_cur = 64 * 1024;
+	const auto oldHandler = signal(SIGXFSZ, SIG_IGN);
+	assert(setrlimit(RLIMIT_FSIZE, &capped) == 0);
+
+	testThrown<IOException>([&] { history.append(GameType::POP_UP, 200, makeGame(30, 40, 8000)); });
+
+	assert(setrlimit(RLIMIT_FSIZE, &old) == 0);
+	signal(SIGXFSZ, oldHandler);
+
+	// The history is just as it was, and carries on once there's room again.
+	assert(history.size() == 1);
+	assert(history.lastGames(1)[0].getScore(1) == 20);
+	history.append(GameType::POP_UP, 300, makeGame(50, 60));
+	history.append(GameType::POP_UP, 400, makeGame(70, 80, 8000));
+	assert(history.size() == 3);
+	assert(history.leaderboard(1)[0].score == 80);
+
+	MatchHistory reopened(file.path);
+	assert(reopened.size() == 3);
+	assert(reopened.lastGames(1)[0].getDate() == 400);
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void MatchHistoryTests()
+{
+	beginUnit("Match history");
+	test("Round trip", &roundTrip);
+	test("Queries", &queries);
+	test("Growth", &growth);
+	test("Torn records", &tornRecords);
+	test("Failed growth", &failedGrowth);
+}
+
+} // end namespace Testing
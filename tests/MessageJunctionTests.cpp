@@ -0,0 +1,217 @@
+#include "MessageJunctionTests.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "Exceptions.hpp"
+#include "ExitMessage.hpp"
+#include "MessageJunction.hpp"
+#include "MessageQueue.hpp"
+#include "MessageRouter.hpp"
+#include "ResponseMessage.hpp"
+#include "ShotMessage.hpp"
+#include "StartMessage.hpp"
+#include "TargetControlMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace Testing;
+
+typedef std::chrono::steady_clock Clock;
+typedef MessageRouter::Endpoint Endpoint;
+
+namespace {
+
+/// Runs a junction on its own thread for the life of the object
+struct Junction {
+	MessageQueue toSM, fromSM;
+	MessageQueue toUI, fromUI;
+	MessageQueue toSys, fromSys;
+	thread junctionThread;
+
+	Junction() :
+		toSM(), fromSM(),
+		toUI(), fromUI(),
+		toSys(), fromSys(MessageQueue::Backend::LOCK_FREE),
+		junctionThread(&runMessageJunction, ref(toSM), ref(fromSM),
+		                                    ref(toUI), ref(fromUI),
+		                                    ref(toSys), ref(fromSys))
+	{ }
+
+	~Junction()
+	{
+		fromSM.send(unique_ptr<Message>(new ExitMessage(0)));
+		junctionThread.join();
+	}
+
+	Junction(const Junction&) = delete;
+	Junction& operator=(const Junction&) = delete;
+};
+
+void routing()
+{
+	Junction j;
+
+	j.fromSM.send(unique_ptr<Message>(new ResponseMessage(1, 2, ResponseMessage::Code::OK)));
+	j.fromSM.send(unique_ptr<Message>(new TargetControlMessage(3, TargetCommand(1, true))));
+	j.fromUI.send(unique_ptr<Message>(new StartMessage(4)));
+	j.fromSys.send(unique_ptr<Message>(new ShotMessage(5, Shot(1, 2, 3))));
+
+	auto msg = j.toUI.receive(seconds(1));
+	assert(msg != nullptr && msg->getType() == Message::Type::RESPONSE);
+
+	msg = j.toSys.receive(seconds(1));
+	assert(msg != nullptr && msg->getType() == Message::Type::TARGET_CONTROL);
+
+	// UI and system messages both go to the state machine
+	for (int i = 0; i < 2; ++i) {
+		msg = j.toSM.receive(seconds(1));
+		assert(msg != nullptr);
+		assert(msg->getType() == Message::Type::START || msg->getType() == Message::Type::SHOT);
+	}
+}
+
+void latency()
+{
+	Junction j;
+
+	// Give the junction time to go to sleep, then make sure a shot wakes it right away
+	// instead of waiting out some other source's time slice.
+	this_thread::sleep_for(milliseconds(50));
+
+	const auto start = Clock::now();
+	j.fromSys.send(unique_ptr<Message>(new ShotMessage(5, Shot(1, 2, 3))));
+	auto msg = j.toSM.receive(seconds(1));
+	const auto elapsed = Clock::now() - start;
+
+	assert(msg != nullptr);
+	assert(elapsed < milliseconds(20));
+}
+
+void fairness()
+{
+	MessageQueue toSM, fromSM, toUI, fromUI, toSys, fromSys;
+
+	// Back up the UI and put one shot behind it before the junction starts.
+	// The shot should get through long before the UI backlog does.
+	const int flood = 2000;
+	for (int i = 0; i < flood; ++i)
+		fromUI.send(unique_ptr<Message>(new StartMessage((message_id_t)i)));
+	fromSys.send(unique_ptr<Message>(new ShotMessage(5, Shot(1, 2, 3))));
+
+	thread junctionThread(&runMessageJunction, ref(toSM), ref(fromSM),
+	                                           ref(toUI), ref(fromUI),
+	                                           ref(toSys), ref(fromSys));
+
+	int position = 0;
+	while (true) {
+		auto msg = toSM.receive(seconds(1));
+		assert(msg != nullptr);
+		if (msg->getType() == Message::Type::SHOT)
+			break;
+		++position;
+	}
+
+	assert(position < 100);
+
+	fromSM.send(unique_ptr<Message>(new ExitMessage(0)));
+	junctionThread.join();
+}
+
+void exitMessage()
+{
+	MessageQueue toSM, fromSM, toUI, fromUI, toSys, fromSys;
+	thread junctionThread(&runMessageJunction, ref(toSM), ref(fromSM),
+	                                           ref(toUI), ref(fromUI),
+	                                           ref(toSys), ref(fromSys));
+
+	fromSM.send(unique_ptr<Message>(new ExitMessage(0)));
+	junctionThread.join();
+
+	// The exit is passed on to the UI and the system
+	auto msg = toUI.receive(seconds(1));
+	assert(msg != nullptr && msg->getType() == Message::Type::EXIT);
+	msg = toSys.receive(seconds(1));
+	assert(msg != nullptr && msg->getType() == Message::Type::EXIT);
+}
+
+void defaultRoutes()
+{
+	const MessageRouter router;
+
+	const auto sm = MessageRouter::only(Endpoint::STATE_MACHINE);
+	const auto ui = MessageRouter::only(Endpoint::UI);
+	const auto sys = MessageRouter::only(Endpoint::SYSTEM);
+
+	assert(router.getRoute(Endpoint::STATE_MACHINE, Message::Type::RESPONSE) == ui);
+	assert(router.getRoute(Endpoint::STATE_MACHINE, Message::Type::STATUS_RESPONSE) == ui);
+	assert(router.getRoute(Endpoint::STATE_MACHINE, Message::Type::RESULTS_RESPONSE) == ui);
+	assert(router.getRoute(Endpoint::STATE_MACHINE, Message::Type::TARGET_CONTROL) == sys);
+	assert(router.getRoute(Endpoint::STATE_MACHINE, Message::Type::EVENT) == ui);
+	assert(router.getRoute(Endpoint::STATE_MACHINE, Message::Type::EXIT) == (ui | sys));
+
+	assert(router.getRoute(Endpoint::UI, Message::Type::START) == sm);
+	assert(router.getRoute(Endpoint::UI, Message::Type::RESPONSE) == MessageRouter::nowhere);
+
+	assert(router.getRoute(Endpoint::SYSTEM, Message::Type::SHOT) == sm);
+	assert(router.getRoute(Endpoint::SYSTEM, Message::Type::RESPONSE) == sm);
+}
+
+void fanOut()
+{
+	MessageQueue toSM, fromSM, toUI, fromUI, toSys, fromSys;
+
+	// Let the UI see shots as well as the state machine
+	MessageRouter router;
+	router.addRoute(Endpoint::SYSTEM, Message::Type::SHOT, Endpoint::UI);
+
+	thread junctionThread(&runRoutedMessageJunction, ref(toSM), ref(fromSM),
+	                                                 ref(toUI), ref(fromUI),
+	                                                 ref(toSys), ref(fromSys), cref(router));
+
+	const ShotMessage shot(5, Shot(1, 2, 3));
+	fromSys.send(shot.clone());
+
+	auto msg = toSM.receive(seconds(1));
+	assert(msg != nullptr && *msg == shot);
+	msg = toUI.receive(seconds(1));
+	assert(msg != nullptr && *msg == shot);
+	assert(toSys.empty());
+
+	fromSM.send(unique_ptr<Message>(new ExitMessage(0)));
+	junctionThread.join();
+}
+
+void rejected()
+{
+	MessageQueue toSM, fromSM, toUI, fromUI, toSys, fromSys;
+	const MessageRouter router;
+
+	// Nothing should be sending the UI messages, so the UI shouldn't be responding.
+	fromUI.send(unique_ptr<Message>(new ResponseMessage(1, 2, ResponseMessage::Code::OK)));
+
+	auto junction = async(launch::async, &runRoutedMessageJunction, ref(toSM), ref(fromSM),
+	                                                                ref(toUI), ref(fromUI),
+	                                                                ref(toSys), ref(fromSys), cref(router));
+
+	testThrown<InvalidOperationException>([&] { junction.get(); });
+	assert(toSM.empty());
+}
+
+} // end anonymous namespace
+
+void Testing::MessageJunctionTests()
+{
+	beginUnit("Message junction");
+	test("Routing", &routing);
+	test("Forward without waiting on other sources", &latency);
+	test("A busy source doesn't starve the others", &fairness);
+	test("Exit", &exitMessage);
+	test("Default routes", &defaultRoutes);
+	test("Fan-out to more than one destination", &fanOut);
+	test("Messages with no route are rejected", &rejected);
+}
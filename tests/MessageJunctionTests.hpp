@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Testing {
+
+void MessageJunctionTests();
+
+} // end namespace Testing
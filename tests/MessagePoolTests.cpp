@@ -0,0 +1,112 @@
+#include "MessagePoolTests.hpp"
+
+#include <cassert>
+#include <thread>
+
+#include "MessagePool.hpp"
+#include "MessageQueue.hpp"
+#include "ResponseMessage.hpp"
+#include "ShotMessage.hpp"
+#include "StartMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+
+namespace {
+
+void reuse()
+{
+	const Message* first = new StartMessage(1);
+	delete first;
+
+	const auto before = MessagePool::getStatistics();
+
+	// The block we just freed should be the next one handed out for something its size.
+	unique_ptr<Message> second(new StartMessage(2));
+	assert(second.get() == first);
+
+	const auto after = MessagePool::getStatistics();
+	assert(after.hits == before.hits + 1);
+	assert(after.misses == before.misses);
+}
+
+void sizeClasses()
+{
+	// Messages of different sizes shouldn't share memory.
+	const Message* small = new StartMessage(1);
+	delete small;
+
+	unique_ptr<Message> big(new ResponseMessage(2, 1, ResponseMessage::Code::OK, "Hello"));
+	assert(big.get() != small);
+
+	unique_ptr<Message> again(new StartMessage(3));
+	assert(again.get() == small);
+}
+
+void crossThread()
+{
+	MessageQueue q;
+
+	// Send shots from this thread and free them on another, as the state machine and junction do.
+	// After the first round has grown the pools, there's no need for the global allocator.
+	const int rounds = 10;
+	const int perRound = 200;
+
+	uint64_t missesAfterFirst = 0;
+
+	for (int r = 0; r < rounds; ++r) {
+		for (int i = 0; i < perRound; ++i)
+			q.send(unique_ptr<Message>(new ShotMessage((message_id_t)i, Shot(1, 2, 3))));
+
+		thread receiver([&q] {
+			for (int i = 0; i < perRound; ++i)
+				q.receive();
+		});
+		receiver.join();
+
+		if (r == 0)
+			missesAfterFirst = MessagePool::getStatistics().misses;
+	}
+
+	assert(MessagePool::getStatistics().misses == missesAfterFirst);
+}
+
+void oversized()
+{
+	const auto before = MessagePool::getStatistics();
+
+	void* p = MessagePool::allocate(MessagePool::maxPooledSize + 1);
+	MessagePool::deallocate(p, MessagePool::maxPooledSize + 1);
+
+	const auto after = MessagePool::getStatistics();
+	assert(after.oversized == before.oversized + 1);
+	assert(after.hits == before.hits);
+}
+
+void exitedThreads()
+{
+	const auto before = MessagePool::getStatistics();
+
+	// Each thread counts for itself, but what a thread counted outlives it.
+	const int count = 10;
+	thread worker([] {
+		for (int i = 0; i < count; ++i)
+			delete new StartMessage((message_id_t)i);
+	});
+	worker.join();
+
+	const auto after = MessagePool::getStatistics();
+	assert(after.hits + after.misses == before.hits + before.misses + count);
+}
+
+} // end anonymous namespace
+
+void Testing::MessagePoolTests()
+{
+	beginUnit("Message pool");
+	test("Freed messages are reused", &reuse);
+	test("Different sizes use different pools", &sizeClasses);
+	test("Messages freed on another thread are reused", &crossThread);
+	test("Oversized allocations", &oversized);
+	test("Threads that exit still count", &exitedThreads);
+}
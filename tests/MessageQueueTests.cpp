@@ -5,6 +5,7 @@
 #include <thread>
 #include <memory>
 #include <random>
+#include <vector>
 
 #include "Test.hpp"
 #include "MessageQueue.hpp"
@@ -14,6 +15,7 @@
 using namespace Exceptions;
 using namespace Json;
 using namespace std;
+using namespace Testing;
 
 namespace {
 
@@ -106,6 +108,110 @@ void timeoutUntil()
 	sendingThread.join();
 }
 
+/// Gets the value stored in a message from makeTestMessage
+int testValue(const unique_ptr<Message>& msg)
+{
+	auto tm = dynamic_cast<const TestMessage*>(msg.get());
+	assert(tm != nullptr);
+	return tm->val["val"].asInt();
+}
+
+void lockFreeSingleThread()
+{
+	MessageQueue q(MessageQueue::Backend::LOCK_FREE);
+	assert(q.getBackend() == MessageQueue::Backend::LOCK_FREE);
+	assert(q.empty());
+	assert(q.peek() == nullptr);
+
+	for (int msgNum = 0; msgNum < 5; ++msgNum)
+		q.send(makeTestMessage(msgNum));
+
+	assert(!q.empty());
+	assert(*q.peek() == *makeTestMessage(0));
+
+	for (int msgNum = 0; msgNum < 5; ++msgNum)
+		assert(*q.receive() == *makeTestMessage(msgNum));
+
+	assert(q.empty());
+}
+
+void lockFreeMultipleProducers()
+{
+	// Keep the ring small so that producers regularly find it full
+	MessageQueue q(MessageQueue::Backend::LOCK_FREE, 16);
+
+	const int producerCount = 4;
+	const int perProducer = 2000;
+
+	vector<thread> producers;
+	for (int p = 0; p < producerCount; ++p) {
+		producers.emplace_back([&q, p] {
+			for (int msgNum = 0; msgNum < perProducer; ++msgNum)
+				q.send(makeTestMessage(p * perProducer + msgNum));
+		});
+	}
+
+	// Messages from any one producer must arrive in the order they were sent
+	vector<int> lastSeen(producerCount, -1);
+	for (int i = 0; i < producerCount * perProducer; ++i) {
+		const int value = testValue(q.receive());
+		const int producer = value / perProducer;
+		assert(value % perProducer == lastSeen[producer] + 1);
+		lastSeen[producer] = value % perProducer;
+	}
+
+	for (auto& producer : producers)
+		producer.join();
+
+	assert(q.empty());
+}
+
+void lockFreePriority()
+{
+	MessageQueue q(MessageQueue::Backend::LOCK_FREE);
+
+	q.send(makeTestMessage(1));
+	q.prioritySend(makeTestMessage(-1));
+
+	assert(*q.receive() == *makeTestMessage(-1));
+	assert(*q.receive() == *makeTestMessage(1));
+}
+
+void lockFreeTimeoutUntil()
+{
+	MessageQueue q(MessageQueue::Backend::LOCK_FREE);
+
+	auto earlier = chrono::steady_clock::now() + chrono::milliseconds(10);
+	auto later = earlier + chrono::milliseconds(40);
+	auto evenLater = later + chrono::milliseconds(10);
+
+	thread sendingThread([&q, later] {
+		this_thread::sleep_until(later);
+		q.send(makeTestMessage());
+	});
+
+	assert(q.receiveUntil(earlier) == nullptr);
+
+	assert(*q.receiveUntil(evenLater) == *makeTestMessage());
+
+	sendingThread.join();
+}
+
+void lockFreeReset()
+{
+	MessageQueue q(MessageQueue::Backend::LOCK_FREE);
+
+	q.send(makeTestMessage());
+	q.close();
+	testThrown<InvalidOperationException>([&q] { q.send(makeTestMessage()); });
+
+	q.reset();
+	assert(q.empty());
+	assert(q.isOpen());
+	// Anything left in the queue when it is destroyed should be freed.
+	q.send(makeTestMessage());
+}
+
 } // end anonymous namespace
 
 void Testing::MessageQueueTests()
@@ -116,4 +222,9 @@ void Testing::MessageQueueTests()
 	test("Priority", &priority);
 	test("\"wait for\" Timeout", &timeoutFor);
 	test("\"wait until\" Timeout", &timeoutUntil);
+	test("Lock-free single thread", &lockFreeSingleThread);
+	test("Lock-free multiple producers", &lockFreeMultipleProducers);
+	test("Lock-free priority", &lockFreePriority);
+	test("Lock-free \"wait until\" timeout", &lockFreeTimeoutUntil);
+	test("Lock-free reset", &lockFreeReset);
 }
@@ -9,6 +9,11 @@
 #include "StatusMessage.hpp"
 #include "ResultsMessage.hpp"
 #include "ExitMessage.hpp"
+#include "BinaryMessage.hpp"
+#include "JSONWriter.hpp"
+#include "TestMessage.hpp"
+#include "SubscribeMessage.hpp"
+#include "EventMessage.hpp"
 
 using namespace Exceptions;
 using namespace Json;
@@ -25,6 +30,24 @@ void JSONCheck(const unique_ptr<Message>& load, Message::Type t)
 	assert(fromJSON->getType() == load->getType());
 	assert(load->getType() == t); // To make sure we don't forget to override getType()
 	assert(*load == *fromJSON);
+
+	// Round trip through the streaming writer and reader
+	string streamed;
+	JSONWriter writer(streamed);
+	load->writeJSON(writer);
+
+	auto fromStream = JSONToMessage(streamed.data(), streamed.size());
+	assert(*load == *fromStream);
+
+	// The streaming reader should take what jsoncpp writes (which has its keys sorted, so the type comes last)...
+	const string fast = FastWriter().write(jrep);
+	auto fromFast = JSONToMessage(fast.data(), fast.size());
+	assert(*load == *fromFast);
+
+	// ...and jsoncpp should take what the streaming writer writes.
+	Json::Value parsed;
+	assert(Json::Reader().parse(streamed, parsed));
+	assert(parsed == jrep);
 }
 
 void binaryCheck(const unique_ptr<Message>& load, Message::Type t)
@@ -59,10 +82,25 @@ std::unique_ptr<SetupMessage> makeSetupMessage(int16_t gameLength, int16_t maxSc
 		new SetupMessage(0, GameType::POP_UP, 2, gameLength, maxScore, SetupMessage::DataMap()));
 }
 
+/// Some statistics that aren't the defaults, to make sure they make it through serialization
+ShotStatistics makeShotStatistics()
+{
+	ShotStatistics ret;
+	ret.shotsFired = 12;
+	ret.misses = 3;
+	ret.streak = 2;
+	ret.longestStreak = 5;
+	ret.fastestReaction = 180;
+	ret.meanReaction = 450;
+	ret.medianReaction = 420;
+	ret.reaction90 = 900;
+	return ret;
+}
+
 std::unique_ptr<StatusResponseMessage> makeStatusResponseMessage()
 {
 	StatusResponseMessage::PlayerList stats;
-	stats.emplace_back(2, 4);
+	stats.emplace_back(2, 4, makeShotStatistics());
 	stats.emplace_back(25, 64);
 	stats.emplace_back(33, 89);
 
@@ -75,7 +113,7 @@ std::unique_ptr<ResultsResponseMessage> makeResultsResponseMessage()
 {
 	typedef ResultsResponseMessage::PlayerStats PlayerStats;
 
-	PlayerStats stat(20, 1, vector<Shot>({ Shot(2, 4, 240) }));
+	PlayerStats stat(20, 1, vector<Shot>({ Shot(2, 4, 240) }), makeShotStatistics());
 
 	return unique_ptr<ResultsResponseMessage>(
 		new ResultsResponseMessage(0, 21, "I'm some results!", vector<PlayerStats>({stat})));
@@ -112,6 +150,39 @@ void MessageTests()
 	test("ShotMessage -> JSON", []{ JSONCheck(makeShotMessage(), Type::SHOT); });
 	test("TargetControlMessage -> JSON", [] { JSONCheck(makeTargetControlMessage(), Type::TARGET_CONTROL); });
 	test("ExitMessage -> JSON", []{ JSONCheck(makeMessage<ExitMessage>(), Type::EXIT); });
+	test("TestMessage -> JSON", []{
+		Json::Value payload(objectValue);
+		payload["nested"]["list"].append(1);
+		payload["nested"]["list"].append("two");
+		payload["flag"] = true;
+		JSONCheck(unique_ptr<Message>(new TestMessage(0, payload)), Type::TEST);
+	});
+	test("SubscribeMessage -> JSON", []{
+		const auto kinds = (GameEvent::KindMask)(GameEvent::only(GameEvent::Kind::SCORE)
+		                                         | GameEvent::only(GameEvent::Kind::GAME_OVER));
+		JSONCheck(unique_ptr<Message>(new SubscribeMessage(0, kinds)), Type::SUBSCRIBE);
+		JSONCheck(unique_ptr<Message>(new SubscribeMessage(0, 0)), Type::SUBSCRIBE);
+	});
+	test("EventMessage -> JSON", []{
+		JSONCheck(unique_ptr<Message>(new EventMessage(0, GameEvent::scoreChanged(1, 310, 2, 4500))), Type::EVENT);
+		JSONCheck(unique_ptr<Message>(new EventMessage(0, GameEvent::shot(Shot(2, -1, 6000)))), Type::EVENT);
+	});
+	test("Lanes -> JSON", []{
+		auto status = makeMessage<StatusMessage>();
+		status->lane = 7;
+		assert(status->toJSON()["lane"].asInt() == 7);
+		JSONCheck(move(status), Type::STATUS);
+
+		// Lane 0 is left out, so single-lane setups don't see it at all.
+		assert(!makeMessage<StatusMessage>()->toJSON().isMember("lane"));
+
+		const string json = "{\"id\":1,\"type\":\"status\",\"lane\":256}";
+		testThrown<IOException>([&] { JSONToMessage(json.data(), json.size()); });
+	});
+	test("Unknown event kinds", []{
+		const string json = "{\"id\":1,\"type\":\"subscribe\",\"events\":[\"score\",\"fireworks\"]}";
+		testThrown<IOException>([&] { JSONToMessage(json.data(), json.size()); });
+	});
 
 
 	test("Message -> Binary", []{ binaryCheck(makeMessage(), Type::EMPTY); });
@@ -121,6 +192,38 @@ void MessageTests()
 	test("StopMessage -> Binary", []{ binaryCheck(makeMessage<StopMessage>(), Type::STOP); });
 	test("ShotMessage -> Binary", []{ binaryCheck(makeShotMessage(), Type::SHOT); });
 	test("TargetControlMessage -> Binary", [] { binaryCheck(makeTargetControlMessage(), Type::TARGET_CONTROL); });
+	test("SetupMessage -> Binary", []{
+		SetupMessage::DataMap data;
+		data["delay"] = -3;
+		data["rounds"] = 100000;
+		binaryCheck(unique_ptr<Message>(new SetupMessage(0, GameType::POP_UP, 2, 60, -1, move(data))), Type::SETUP);
+	});
+	test("StatusMessage -> Binary", []{ binaryCheck(makeMessage<StatusMessage>(), Type::STATUS); });
+	test("StatusResponseMessage -> Binary", []{ binaryCheck(makeStatusResponseMessage(), Type::STATUS_RESPONSE); });
+	test("ResultsMessage -> Binary", []{ binaryCheck(makeMessage<ResultsMessage>(), Type::RESULTS); });
+	test("ResultsResponseMessage -> Binary", []{ binaryCheck(makeResultsResponseMessage(), Type::RESULTS_RESPONSE); });
+	test("ExitMessage -> Binary", []{ binaryCheck(makeMessage<ExitMessage>(), Type::EXIT); });
+	test("TestMessage -> Binary", []{
+		Json::Value payload(objectValue);
+		payload["list"].append("two");
+		binaryCheck(unique_ptr<Message>(new TestMessage(0, payload)), Type::TEST);
+	});
+	test("SubscribeMessage -> Binary", []{
+		binaryCheck(unique_ptr<Message>(new SubscribeMessage(0)), Type::SUBSCRIBE);
+	});
+	test("EventMessage -> Binary", []{
+		binaryCheck(unique_ptr<Message>(new EventMessage(0, GameEvent::targetChanged(3, true, 70000))), Type::EVENT);
+	});
+	test("Truncated binary payloads", []{
+		// Chop the last player's hit count off a status response
+		auto full = makeStatusResponseMessage()->toBinary();
+		const size_t payloadLength = full.size() - BinaryMessage::frameOverhead - 2;
+		vector<uint8_t> shortened(payloadLength + BinaryMessage::frameOverhead);
+		copy(full.begin() + BinaryMessage::payloadOffset, full.begin() + BinaryMessage::payloadOffset + payloadLength,
+		     shortened.begin() + BinaryMessage::payloadOffset);
+		BinaryMessage::finishMessage(shortened.data(), Message::Type::STATUS_RESPONSE, 0, payloadLength);
+		testThrown<IOException>([&] { binaryToMessage(shortened.data(), shortened.size()); });
+	});
 }
 
 } // end namespace Testing
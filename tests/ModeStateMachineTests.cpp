@@ -0,0 +1,303 @@
+#include "ModeStateMachineTests.hpp"
+
+#include <thread>
+
+#include "Exceptions.hpp"
+#include "ExitMessage.hpp"
+#include "GameMode.hpp"
+#include "GameRunner.hpp"
+#include "MemoryUtils.hpp"
+#include "ModeStateMachine.hpp"
+#include "SetupMessage.hpp"
+#include "ShotMessage.hpp"
+#include "TargetControlMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+using Code = ResponseMessage::Code;
+
+typedef GameModeSpec::Event Event;
+typedef GameModeSpec::Op Op;
+typedef GameModeSpec::Action A;
+typedef GameStateMachine::TimePoint TimePoint;
+
+/// Drives a ModeStateMachine by hand, pinning its clock for every step
+class Harness {
+
+public:
+
+	Harness(const GameModeSpec& spec, board_id_t targets) :
+		machine(make_shared<GameMode>(spec), targets, 2, seconds(600), -1, 42),
+		time(GameStateMachine::Clock::now()),
+		shotTime(1),
+		uid(1)
+	{
+		machine.getClock().pin(time);
+		assert(machine.start(uid, uid)->code == Code::OK);
+		++uid;
+	}
+
+	/// Moves the clock to the machine's next deadline and ticks it
+	unique_ptr<TargetControlMessage> tick()
+	{
+		const auto deadline = machine.nextDeadline();
+		assert(deadline != TimePoint::max());
+		time = max(time, deadline);
+		machine.getClock().pin(time);
+		return unique_dynamic_cast<TargetControlMessage>(machine.onTick(uid++));
+	}
+
+	/// Ticks through deadlines that no longer matter until the machine has something to send
+	unique_ptr<TargetControlMessage> nextCommands()
+	{
+		for (int i = 0; i < 10; ++i) {
+			auto msg = tick();
+			if (msg != nullptr)
+				return msg;
+		}
+		return nullptr;
+	}
+
+	/// Moves the clock forward and fires a shot
+	Shot shoot(board_id_t player, board_id_t target, milliseconds after = milliseconds(100))
+	{
+		Shot s(player, target, shotTime++);
+		resend(s, after);
+		return s;
+	}
+
+	void resend(const Shot& s, milliseconds after = milliseconds(0))
+	{
+		time += after;
+		machine.getClock().pin(time);
+		const uint16_t id = uid++;
+		assert(machine.onShot(id, ShotMessage(id, s))->code == Code::OK);
+	}
+
+	/// Gets the last score posted for the given player, or -1 if none was
+	score_t lastScore(board_id_t player)
+	{
+		score_t score = -1;
+		for (const auto& e : machine.getEvents()) {
+			if (e.kind == GameEvent::Kind::SCORE && e.player == player)
+				score = e.score;
+		}
+		return score;
+	}
+
+	ModeStateMachine machine;
+
+	TimePoint time;
+
+	timestamp_t shotTime;
+
+	uint16_t uid;
+};
+
+void compiling()
+{
+	GameMode followUp(GameMode::followUp());
+	assert(followUp.getStateCount() == 4);
+	assert(followUp.transition(0, Event::START).to == 1);
+	assert(followUp.transition(0, Event::WON).to == GameMode::noState);
+	assert(!followUp.isArmed(1) && followUp.isArmed(3));
+	assert(followUp.getSequence().size() == 2);
+
+	const auto& up = followUp.transition(1, Event::TIMER);
+	assert(up.actionCount == 4);
+	assert(followUp.actionsOf(up)[1].op == Op::PICK);
+
+	GameModeSpec spec;
+	spec.states = { "a", "b" };
+	spec.sequence = { { 0, 1 } };
+	spec.transitions = { { "a", Event::START, { A(Op::WAIT, 0, 10, 20) }, "b" } };
+	GameMode ok(spec);
+	assert(ok.transition(0, Event::START).to == 1);
+
+	auto bad = spec;
+	bad.transitions.emplace_back("a", Event::TIMER, vector<A>(), "c");
+	testThrown<ArgumentException>([&] { GameMode m(bad); });
+
+	bad = spec;
+	bad.transitions.emplace_back("a", Event::START, vector<A>(), "a");
+	testThrown<ArgumentException>([&] { GameMode m(bad); });
+
+	bad = spec;
+	bad.transitions[0].actions.emplace_back(Op::LIGHT, GameMode::maxSlots);
+	testThrown<ArgumentException>([&] { GameMode m(bad); });
+
+	bad = spec;
+	bad.transitions[0].actions.emplace_back(Op::WAIT, 0, 20, 10);
+	testThrown<ArgumentException>([&] { GameMode m(bad); });
+
+	bad = spec;
+	bad.sequence.clear();
+	testThrown<ArgumentException>([&] { GameMode m(bad); });
+
+	testThrown<ArgumentOutOfRangeException>([] { GameMode::dump(0); });
+}
+
+void followUp()
+{
+	Harness h(GameMode::followUp(), 4);
+
+	// The first tick just starts the delay before the first round.
+	const auto start = h.time;
+	assert(h.tick() == nullptr);
+	assert(h.machine.nextDeadline() >= start + seconds(3));
+	assert(h.machine.nextDeadline() <= start + seconds(6));
+
+	score_t total = 0;
+	for (int round = 0; round < 3; ++round) {
+		auto first = h.nextCommands();
+		assert(first != nullptr && first->commands.size() == 1 && first->commands[0].on);
+		const board_id_t a = first->commands[0].id;
+
+		// Player 1 hits the first target before the second even comes on.
+		h.shoot(1, a);
+
+		auto second = h.nextCommands();
+		assert(second != nullptr && second->commands.size() == 1 && second->commands[0].on);
+		const board_id_t b = second->commands[0].id;
+		assert(b != a);
+		const auto bUp = h.time;
+
+		// Player 0 hits the second target first, but out of order, so it doesn't count.
+		h.shoot(0, b);
+		h.shoot(0, a);
+		h.machine.clearEvents();
+		h.shoot(1, b, milliseconds(500));
+
+		// Scored on the time left in the window once both are up
+		total = (score_t)(total + (5000 - duration_cast<milliseconds>(h.time - bUp).count()) / 10);
+		assert(h.lastScore(1) == total);
+		assert(h.lastScore(0) == -1);
+
+		// Both go off right away.
+		auto off = h.tick();
+		assert(off != nullptr && off->commands.size() == 2);
+		for (const auto& c : off->commands)
+			assert(!c.on && (c.id == a || c.id == b));
+	}
+}
+
+void dump()
+{
+	Harness h(GameMode::dump(3), 2);
+	assert(h.tick() == nullptr);
+
+	auto up = h.tick();
+	assert(up != nullptr && up->commands.size() == 1 && up->commands[0].on);
+	const board_id_t target = up->commands[0].id;
+
+	// Misses and the other target don't count, and neither does the same shot twice.
+	h.shoot(1, -1);
+	h.shoot(1, (board_id_t)(1 - target));
+	h.shoot(1, target);
+	const auto again = h.shoot(1, target);
+	h.resend(again);
+	h.shoot(0, target);
+	h.shoot(0, target);
+	assert(h.lastScore(0) == -1 && h.lastScore(1) == -1);
+
+	h.shoot(1, target);
+	assert(h.lastScore(1) > 0);
+	assert(h.lastScore(0) == -1);
+
+	auto off = h.tick();
+	assert(off != nullptr && off->commands.size() == 1);
+	assert(off->commands[0].id == target && !off->commands[0].on);
+
+	// If nobody finishes in time, the target goes off on its own.
+	up = h.nextCommands();
+	assert(up != nullptr && up->commands[0].on);
+	h.shoot(0, up->commands[0].id);
+	h.machine.clearEvents();
+	off = h.nextCommands();
+	assert(off != nullptr && !off->commands[0].on);
+	assert(h.lastScore(0) == -1);
+}
+
+void restart()
+{
+	Harness h(GameMode::followUp(), 4);
+	assert(h.tick() == nullptr);
+
+	// Stop while both targets of a round are up...
+	auto first = h.nextCommands();
+	assert(first != nullptr && first->commands[0].on);
+	auto second = h.nextCommands();
+	assert(second != nullptr && second->commands[0].on);
+	const board_id_t a = first->commands[0].id;
+	const board_id_t b = second->commands[0].id;
+
+	assert(h.machine.stop(h.uid, h.uid)->code == Code::OK);
+	++h.uid;
+
+	// ...then start again before the machine gets another tick.
+	assert(h.machine.start(h.uid, h.uid)->code == Code::OK);
+	++h.uid;
+	h.time += milliseconds(1);
+	h.machine.getClock().pin(h.time);
+	h.machine.onTick(h.uid++);
+
+	// The old round's targets don't win the new game a round.
+	h.machine.clearEvents();
+	h.shoot(1, a);
+	h.shoot(1, b);
+	assert(h.lastScore(1) == -1);
+
+	// Targets come on again, even ones that were on when the last game stopped.
+	for (int round = 0; round < 3; ++round) {
+		auto on = h.nextCommands();
+		assert(on != nullptr && on->commands.size() == 1 && on->commands[0].on);
+		on = h.nextCommands();
+		assert(on != nullptr && on->commands.size() == 1 && on->commands[0].on);
+		auto off = h.nextCommands();
+		assert(off != nullptr && off->commands.size() == 2);
+	}
+}
+
+void setup()
+{
+	MessageQueue in, out;
+	thread runner(&runGame, ref(in), ref(out), 2, 2, nullptr, nullptr, true);
+
+	const auto setupResponse = [&](GameType type, SetupMessage::DataMap data) {
+		in.send(unique_ptr<Message>(new SetupMessage(7, type, 2, 30, -1, move(data))));
+		auto ack = unique_dynamic_cast<ResponseMessage>(out.receive());
+		assert(ack != nullptr && ack->respondingTo == 7);
+		return ack->code;
+	};
+
+	assert(setupResponse(GameType::FOLLOW_UP, SetupMessage::DataMap()) == Code::OK);
+	assert(setupResponse(GameType::DUMP, SetupMessage::DataMap()) == Code::INVALID_REQUEST);
+	assert(setupResponse(GameType::DUMP, SetupMessage::DataMap({ { "shot count", 0 } })) == Code::INVALID_REQUEST);
+	assert(setupResponse(GameType::DUMP, SetupMessage::DataMap({ { "shot count", 5 } })) == Code::OK);
+
+	in.send(unique_ptr<Message>(new ExitMessage(1)));
+	runner.join();
+	assert(out.empty());
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void ModeStateMachineTests()
+{
+	beginUnit("ModeStateMachine");
+	test("Compiling", &compiling);
+	test("Follow-up", &followUp);
+	test("Dump", &dump);
+	test("Restart", &restart);
+	test("Setup", &setup);
+}
+
+} // end namespace Testing
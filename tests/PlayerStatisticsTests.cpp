@@ -0,0 +1,115 @@
+#include "PlayerStatisticsTests.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "PlayerStatistics.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+void fewValues()
+{
+	P2Quantile median(0.5);
+	assert(median.get() == 0);
+
+	// With five values or fewer, the estimate is exact.
+	median.add(30);
+	assert(median.get() == 30);
+	median.add(10);
+	median.add(20);
+	assert(median.get() == 20);
+	median.add(50);
+	median.add(40);
+	assert(median.get() == 30);
+	assert(median.count() == 5);
+}
+
+/// Checks a P² estimate against the exact quantile of some random values
+void checkEstimate(double p, const vector<double>& values)
+{
+	P2Quantile estimate(p);
+	for (double v : values)
+		estimate.add(v);
+
+	vector<double> sorted(values);
+	sort(begin(sorted), end(sorted));
+	const double exact = sorted[(size_t)(p * (double)(sorted.size() - 1))];
+	const double range = sorted.back() - sorted.front();
+
+	assert(fabs(estimate.get() - exact) < range * 0.02);
+}
+
+void estimates()
+{
+	mt19937 rng(453);
+	uniform_real_distribution<double> uniform(200, 5000);
+	normal_distribution<double> normal(800, 150);
+
+	vector<double> uniformValues, normalValues;
+	for (int i = 0; i < 10000; ++i) {
+		uniformValues.emplace_back(uniform(rng));
+		normalValues.emplace_back(normal(rng));
+	}
+
+	for (double p : { 0.1, 0.5, 0.9 }) {
+		checkEstimate(p, uniformValues);
+		checkEstimate(p, normalValues);
+	}
+
+	testThrown<ArgumentOutOfRangeException>([] { P2Quantile(1.5); });
+}
+
+void counting()
+{
+	PlayerStatistics stats;
+
+	ShotStatistics empty = stats.summarize();
+	assert(empty == ShotStatistics());
+	assert(empty.meanReaction == -1);
+	assert(stats.getAccuracy() == 0);
+
+	// Hit, hit, miss, a shot at the wrong target, then hit.
+	stats.recordShot(false);
+	stats.recordHit(400);
+	stats.recordShot(false);
+	stats.recordHit(200);
+	stats.recordShot(true);
+	stats.recordShot(false);
+	stats.recordShot(false);
+	stats.recordHit(600);
+
+	const ShotStatistics summary = stats.summarize();
+	assert(summary.shotsFired == 5);
+	assert(summary.misses == 1);
+	assert(summary.streak == 1);
+	assert(summary.longestStreak == 2);
+	assert(summary.fastestReaction == 200);
+	assert(summary.meanReaction == 400);
+	assert(summary.medianReaction == 400);
+	assert(summary.reaction90 == 600);
+	assert(stats.getHits() == 3);
+	assert(stats.getAccuracy() == 0.6);
+	assert(summary.accuracy(3) == 0.6);
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void PlayerStatisticsTests()
+{
+	beginUnit("Player statistics");
+	test("Few values", &fewValues);
+	test("Estimates", &estimates);
+	test("Counting", &counting);
+}
+
+} // end namespace Testing
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Testing {
+
+void PlayerStatisticsTests();
+
+} // end namespace Testing
@@ -1,8 +1,13 @@
 #include "PopUpStateMachineTests.hpp"
 
+#include <bitset>
 #include <thread>
+#include <vector>
 
-#include "GameStateMachine.hpp"
+#include "EventMessage.hpp"
+#include "Exceptions.hpp"
+#include "GameRunner.hpp"
+#include "PopUpStateMachine.hpp"
 #include "SetupMessage.hpp"
 #include "StartMessage.hpp"
 #include "ExitMessage.hpp"
@@ -12,11 +17,12 @@
 
 using namespace std;
 using namespace chrono;
+using namespace Exceptions;
 
 /// Macro to quickly set up a test environment for the game state machine(s)
 #define MACHINE_ENVIRONMENT \
 	MessageQueue in, out; \
-	thread stateThread(&runGame, ref(in), ref(out), 2, 2); \
+	thread stateThread(&runGame, ref(in), ref(out), 2, 2, nullptr, nullptr, true); \
 	int id = -1; \
 	(void)id; // No unused warnings please
 
@@ -71,6 +77,182 @@ void setup()
 	ASSERT_EMPTY_OUT;
 }
 
+void deadlines()
+{
+	PopUpStateMachine machine(2, 2, seconds(30), -1);
+
+	// Nothing to do until the game starts
+	assert(machine.nextDeadline() == Clock::time_point::max());
+
+	const auto startTime = Clock::now();
+	machine.start(1, 1);
+
+	// The machine wants a tick right away to get going...
+	assert(machine.nextDeadline() <= Clock::now());
+	assert(machine.onTick(2) == nullptr);
+
+	// ...and then not until the first target is due to pop up.
+	const auto popUp = machine.nextDeadline();
+	assert(popUp >= startTime + seconds(3));
+	assert(popUp <= Clock::now() + seconds(6));
+}
+
+void manyUp()
+{
+	const board_id_t targets = 16;
+	const size_t targetsUp = 6;
+	PopUpStateMachine machine(targets, 2, seconds(600), -1, 42, (board_id_t)targetsUp);
+
+	auto now = Clock::now();
+	machine.getClock().pin(now);
+	machine.start(1, 1);
+
+	uint16_t uid = 2;
+	timestamp_t shotTime = 1;
+	bitset<PopUpStateMachine::maxTargets> lit;
+	size_t mostLit = 0;
+	int batched = 0;
+	int hits = 0;
+
+	// Step from deadline to deadline for a couple of minutes of game time, shooting every other target that comes up.
+	for (int step = 0; step < 400; ++step) {
+		now = max(now, machine.nextDeadline());
+		machine.getClock().pin(now);
+		auto tm = unique_dynamic_cast<TargetControlMessage>(machine.onTick(uid++));
+		if (tm == nullptr)
+			continue;
+
+		// Everything that changed in the tick comes in one message.
+		if (tm->commands.size() > 1)
+			++batched;
+
+		vector<board_id_t> toShoot;
+		for (const auto& c : tm->commands) {
+			assert(c.id >= 0 && c.id < targets);
+			// Targets only go on when they're off, and off when they're on.
+			assert(lit[(size_t)c.id] != c.on);
+			lit[(size_t)c.id] = c.on;
+			if (c.on && c.id % 2 == 0)
+				toShoot.push_back(c.id);
+		}
+		assert(lit.count() <= targetsUp);
+		mostLit = max(mostLit, lit.count());
+
+		for (auto t : toShoot) {
+			machine.clearEvents();
+			now += milliseconds(100);
+			machine.getClock().pin(now);
+			const uint16_t id = uid++;
+			machine.onShot(id, ShotMessage(id, Shot(0, t, shotTime++)));
+			assert(machine.getEvents().size() == 2);
+			assert(machine.getEvents()[1].kind == GameEvent::Kind::SCORE);
+			++hits;
+		}
+
+		// Shooting a target that isn't up does nothing but record the shot.
+		for (board_id_t t = 0; t < targets; ++t) {
+			if (!lit[(size_t)t]) {
+				machine.clearEvents();
+				const uint16_t id = uid++;
+				machine.onShot(id, ShotMessage(id, Shot(1, t, shotTime++)));
+				assert(machine.getEvents().size() == 1);
+				break;
+			}
+		}
+	}
+
+	assert(mostLit == targetsUp);
+	assert(batched > 0);
+	assert(hits > 0);
+
+	testThrown<ArgumentOutOfRangeException>([] { PopUpStateMachine(2, 2, seconds(30), -1, 1, 3); });
+}
+
+void gameOver()
+{
+	const board_id_t targets = 8;
+	PopUpStateMachine machine(targets, 2, seconds(20), -1, 7, 4);
+
+	auto now = Clock::now();
+	machine.getClock().pin(now);
+	machine.start(1, 1);
+
+	uint16_t uid = 2;
+	bitset<PopUpStateMachine::maxTargets> lit;
+
+	// Run until the game ends, keeping track of what's lit.
+	while (!machine.isOver()) {
+		now = max(now, machine.nextDeadline());
+		machine.getClock().pin(now);
+		auto tm = unique_dynamic_cast<TargetControlMessage>(machine.onTick(uid++));
+		if (tm == nullptr)
+			continue;
+
+		for (const auto& c : tm->commands)
+			lit[(size_t)c.id] = c.on;
+
+		// Everything still up goes off in the tick that ends the game.
+		if (machine.isOver())
+			assert(lit.none());
+	}
+
+	// Nothing scores after the game is over, and nothing else comes on.
+	machine.clearEvents();
+	for (board_id_t t = 0; t < targets; ++t) {
+		const uint16_t id = uid++;
+		machine.onShot(id, ShotMessage(id, Shot(0, t, 100000 + t)));
+	}
+	for (const auto& e : machine.getEvents())
+		assert(e.kind == GameEvent::Kind::SHOT);
+
+	while (machine.nextDeadline() != Clock::time_point::max()) {
+		now = max(now, machine.nextDeadline());
+		machine.getClock().pin(now);
+		assert(machine.onTick(uid++) == nullptr);
+	}
+}
+
+void restart()
+{
+	PopUpStateMachine machine(4, 2, seconds(600), -1, 42, 2);
+
+	auto now = Clock::now();
+	machine.getClock().pin(now);
+	machine.start(1, 1);
+
+	uint16_t uid = 2;
+
+	// Wait for a target to come up...
+	board_id_t target = -1;
+	while (target < 0) {
+		now = max(now, machine.nextDeadline());
+		machine.getClock().pin(now);
+		auto tm = unique_dynamic_cast<TargetControlMessage>(machine.onTick(uid++));
+		if (tm != nullptr && tm->commands[0].on)
+			target = tm->commands[0].id;
+	}
+
+	// ...then stop and start again before the machine gets another tick.
+	assert(machine.stop(uid, uid)->code == Code::OK);
+	++uid;
+	assert(machine.start(uid, uid)->code == Code::OK);
+	++uid;
+
+	now += milliseconds(1);
+	machine.getClock().pin(now);
+	machine.onTick(uid++);
+
+	// The old game's target is down, so it doesn't score in the new one.
+	machine.clearEvents();
+	const uint16_t id = uid++;
+	assert(machine.onShot(id, ShotMessage(id, Shot(0, target, 1)))->code == Code::OK);
+	for (const auto& e : machine.getEvents())
+		assert(e.kind == GameEvent::Kind::SHOT);
+
+	// The new game starts from scratch, with nothing up until after the usual delay.
+	assert(machine.nextDeadline() >= now + seconds(3) - milliseconds(1));
+}
+
 void noShoot()
 {
 	const int gameDuration = 30;
@@ -93,8 +275,25 @@ void noShoot()
 	auto endTime = Clock::now() + seconds(gameDuration + 1);
 	int8_t lastTarget = -1;
 	int messagesReceived = 0;
+	int gameOvers = 0;
 	for (unique_ptr<Message> msg = out.receiveUntil(endTime); msg != nullptr; msg = out.receiveUntil(endTime)) {
 
+		// Each target going up or down should be followed by an event saying so.
+		if (msg->getType() == Message::Type::EVENT) {
+			auto em = unique_dynamic_cast<EventMessage>(move(msg));
+			const auto& event = em->event;
+			if (event.kind == GameEvent::Kind::GAME_OVER) {
+				++gameOvers;
+			}
+			else {
+				const auto expected = messagesReceived % 2 == 1 ? GameEvent::Kind::TARGET_UP
+				                                                : GameEvent::Kind::TARGET_DOWN;
+				assert(event.kind == expected);
+				assert(event.target == lastTarget);
+			}
+			continue;
+		}
+
 		assert(msg->getType() == Message::Type::TARGET_CONTROL);
 
 		auto tm = unique_dynamic_cast<TargetControlMessage>(move(msg));
@@ -118,6 +317,7 @@ void noShoot()
 
 		lastTarget = command.id;
 	}
+	assert(gameOvers == 1);
 	EXIT;
 	ASSERT_EMPTY_OUT;
 }
@@ -143,46 +343,88 @@ void shoot()
 
 	auto startTime = Clock::now();
 	auto endTime = Clock::now() + seconds(gameDuration + 1);
+	auto shotTime = startTime;
 	int8_t lastTarget = -1;
-	int messagesReceived = 0;
+	bool targetUp = false;
+	int shotsFired = 0;
+	int shotsAcknowledged = 0;
+	score_t lastScore = 0;
+	int gameOvers = 0;
 	for (unique_ptr<Message> msg = out.receiveUntil(endTime); msg != nullptr; msg = out.receiveUntil(endTime)) {
 
-		switch (messagesReceived++ % 3) {
-			case 0: {
+		switch (msg->getType()) {
+			case Message::Type::TARGET_CONTROL: {
 				auto tm = unique_dynamic_cast<TargetControlMessage>(move(msg));
-				assert(tm != nullptr);
 				assert(tm->commands.size() == 1); // We should only be controlling one target at a time.
-				assert(tm->commands[0].on == true);
-				lastTarget = tm->commands[0].id;
-				printf("Turning target on. Firing!\n");
-				fflush(stdout);
-				SEND(shootAt(lastTarget, (int)duration_cast<milliseconds>(Clock::now() - startTime).count()));
+
+				// Targets should go up and down in turn.
+				assert(tm->commands[0].on != targetUp);
+				targetUp = tm->commands[0].on;
+
+				if (targetUp) {
+					lastTarget = tm->commands[0].id;
+					printf("Turning target on. Firing!\n");
+					fflush(stdout);
+					shotTime = Clock::now();
+					SEND(shootAt(lastTarget, (int)duration_cast<milliseconds>(shotTime - startTime).count()));
+					++shotsFired;
+				}
+				else {
+					assert(tm->commands[0].id == lastTarget);
+					// The target should go down as soon as it is hit, not on some later tick.
+					assert(Clock::now() - shotTime < milliseconds(50));
+					printf("Turning target off\n");
+					fflush(stdout);
+				}
 				break;
 			}
 
-			case 1: {
+			case Message::Type::RESPONSE: {
 				ack = unique_dynamic_cast<ResponseMessage>(move(msg));
 				assert(ack != nullptr);
 				assert(ack->code == Code::OK);
 				assert(ack->respondingTo == id);
+				++shotsAcknowledged;
 				printf("Shot acknowledged.\n");
 				fflush(stdout);
 				break;
 			}
 
-			case 2: {
-				auto tm = unique_dynamic_cast<TargetControlMessage>(move(msg));
-				assert(tm != nullptr);
-				assert(tm->commands.size() == 1); // We should only be controlling one target at a time.
-				assert(tm->commands[0].on == false);
-				assert(tm->commands[0].id == lastTarget);
-				printf("Turning target off\n");
-				fflush(stdout);
+			case Message::Type::EVENT: {
+				auto em = unique_dynamic_cast<EventMessage>(move(msg));
+				const auto& event = em->event;
+				switch (event.kind) {
+					case GameEvent::Kind::SHOT:
+						assert(event.player == 1 && event.target == lastTarget);
+						break;
+
+					case GameEvent::Kind::SCORE:
+						// Every shot hits, so our hero's score should climb by at least 10 a shot.
+						assert(event.player == 1);
+						assert(event.hits == shotsFired);
+						assert(event.score >= lastScore + 10);
+						lastScore = event.score;
+						break;
+
+					case GameEvent::Kind::TARGET_UP:
+					case GameEvent::Kind::TARGET_DOWN:
+						assert(event.target == lastTarget);
+						assert((event.kind == GameEvent::Kind::TARGET_UP) == targetUp);
+						break;
+
+					case GameEvent::Kind::GAME_OVER:
+						++gameOvers;
+						break;
+				}
 				break;
 			}
-		}
 
+			default:
+				assert(false);
+		}
 	}
+	assert(shotsFired > 0 && shotsAcknowledged == shotsFired);
+	assert(gameOvers == 1);
 	EXIT;
 	ASSERT_EMPTY_OUT;
 }
@@ -194,6 +436,10 @@ void Testing::PopUpStateMachineTests()
 	beginUnit("PopUpStateMachine");
 	test("Sanity", &sanity);
 	test("Setup", &setup);
+	test("Deadlines", &deadlines);
+	test("Many targets up", &manyUp);
+	test("Game over", &gameOver);
+	test("Restart", &restart);
 	test("No-shoot run", &noShoot);
 	test("Shooting run", &shoot);
 }
@@ -0,0 +1,120 @@
+#include "ResponseCorrelatorTests.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "EventMessage.hpp"
+#include "Exceptions.hpp"
+#include "MessageQueue.hpp"
+#include "ResponseCorrelator.hpp"
+#include "ResponseMessage.hpp"
+#include "StartMessage.hpp"
+#include "StatusMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+typedef ResponseMessage::Code Code;
+
+void pipelining()
+{
+	MessageQueue toServer, fromServer;
+	ResponseCorrelator correlator(toServer, fromServer, seconds(5));
+
+	vector<message_id_t> answered;
+	const auto record = [&](unique_ptr<Message>&& msg) {
+		assert(msg != nullptr);
+		answered.emplace_back(static_cast<const ResponseMessage&>(*msg).respondingTo);
+	};
+
+	const message_id_t first = correlator.nextID();
+	correlator.request(unique_ptr<Message>(new StatusMessage(first)), record);
+	const message_id_t second = correlator.nextID();
+	correlator.request(unique_ptr<Message>(new StartMessage(second)), record);
+	assert(correlator.outstanding() == 2);
+	assert(first != second);
+
+	// Both requests go out without waiting for anything.
+	assert(toServer.receive()->id == first);
+	assert(toServer.receive()->id == second);
+
+	// Answers come back in whatever order the server sends them.
+	fromServer.send(unique_ptr<Message>(new ResponseMessage(100, second, Code::OK)));
+	fromServer.send(unique_ptr<Message>(new ResponseMessage(101, first, Code::OK)));
+	assert(correlator.poll() == 2);
+
+	assert(answered == vector<message_id_t>({second, first}));
+	assert(correlator.outstanding() == 0);
+
+	// IDs can't be reused while their requests are in flight.
+	correlator.request(unique_ptr<Message>(new StatusMessage(7)), record);
+	testThrown<ArgumentException>([&] { correlator.request(unique_ptr<Message>(new StatusMessage(7)), record); });
+}
+
+void pushes()
+{
+	MessageQueue toServer, fromServer;
+	ResponseCorrelator correlator(toServer, fromServer, seconds(5));
+
+	int pushed = 0;
+	correlator.setPushHandler([&](unique_ptr<Message>&&) { ++pushed; });
+
+	auto status = correlator.request(unique_ptr<Message>(new StatusMessage(1)));
+
+	// Neither an event nor a response to something we never asked for is mistaken for our answer.
+	fromServer.send(unique_ptr<Message>(new EventMessage(200, GameEvent::gameOver(1000))));
+	fromServer.send(unique_ptr<Message>(new ResponseMessage(201, 99, Code::OK)));
+	correlator.poll();
+	assert(pushed == 2);
+	assert(status.wait_for(seconds(0)) == future_status::timeout);
+
+	fromServer.send(unique_ptr<Message>(new ResponseMessage(202, 1, Code::OK)));
+	correlator.poll();
+	assert(pushed == 2);
+	assert(*status.get() == ResponseMessage(202, 1, Code::OK));
+}
+
+void timeouts()
+{
+	MessageQueue toServer, fromServer;
+	ResponseCorrelator correlator(toServer, fromServer, milliseconds(20));
+
+	auto ignored = correlator.request(unique_ptr<Message>(new StatusMessage(1)));
+	bool timedOut = false;
+	correlator.request(unique_ptr<Message>(new StatusMessage(2)), [&](unique_ptr<Message>&& msg) {
+		timedOut = msg == nullptr;
+	});
+
+	assert(correlator.poll() == 0);
+	this_thread::sleep_for(milliseconds(30));
+	assert(correlator.poll() == 2);
+
+	assert(ignored.get() == nullptr);
+	assert(timedOut);
+
+	// A late answer is just an unsolicited message now.
+	int pushed = 0;
+	correlator.setPushHandler([&](unique_ptr<Message>&&) { ++pushed; });
+	fromServer.send(unique_ptr<Message>(new ResponseMessage(3, 1, Code::OK)));
+	correlator.poll();
+	assert(pushed == 1);
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void ResponseCorrelatorTests()
+{
+	beginUnit("Response correlator");
+	test("Pipelining", &pipelining);
+	test("Pushes", &pushes);
+	test("Timeouts", &timeouts);
+}
+
+} // end namespace Testing
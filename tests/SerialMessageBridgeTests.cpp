@@ -0,0 +1,140 @@
+#include "SerialMessageBridgeTests.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "BinaryMessageViews.hpp"
+#include "ExitMessage.hpp"
+#include "FrameDecoder.hpp"
+#include "MessageQueue.hpp"
+#include "PseudoTerminal.hpp"
+#include "SerialMessageBridge.hpp"
+#include "ShotMessage.hpp"
+#include "TargetControlMessage.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace BinaryMessage;
+
+namespace {
+
+/// Plays the part of the hardware on the slave side of the pseudo-terminal
+void writeAll(int fd, const vector<uint8_t>& bytes)
+{
+	size_t written = 0;
+	while (written < bytes.size()) {
+		const ssize_t n = write(fd, bytes.data() + written, bytes.size() - written);
+		assert(n > 0);
+		written += (size_t)n;
+	}
+}
+
+/// Reads frames from the slave side until we have `count` of them
+vector<unique_ptr<Message>> readFrames(int fd, size_t count)
+{
+	vector<unique_ptr<Message>> ret;
+	FrameDecoder decoder;
+
+	while (ret.size() < count) {
+		pollfd pfd = { fd, POLLIN, 0 };
+		assert(poll(&pfd, 1, 2000) == 1);
+
+		auto space = decoder.prepare();
+		const ssize_t n = read(fd, space.first, space.second);
+		assert(n > 0);
+		decoder.commit((size_t)n);
+
+		while (const uint8_t* frame = decoder.next())
+			ret.emplace_back(binaryToMessage(MessageView::fromValidated(frame)));
+	}
+
+	return ret;
+}
+
+void loopback()
+{
+	PseudoTerminal pty;
+	MessageQueue in, out(MessageQueue::Backend::LOCK_FREE, 16);
+
+	thread bridge(&runSerialMessageBridgeFD, ref(in), ref(out), pty.getMaster());
+
+	// Outgoing: commands sent to the bridge come out the other side as binary frames
+	const int commandCount = 50;
+	for (int i = 0; i < commandCount; ++i) {
+		in.send(unique_ptr<Message>(new TargetControlMessage((message_id_t)i,
+			TargetCommand((board_id_t)(i % 4), i % 2 == 0))));
+	}
+
+	auto received = readFrames(pty.getSlave(), commandCount);
+	for (int i = 0; i < commandCount; ++i) {
+		const TargetControlMessage expected((message_id_t)i, TargetCommand((board_id_t)(i % 4), i % 2 == 0));
+		assert(*received[(size_t)i] == expected);
+	}
+
+	// Incoming: shots from the hardware, with some line noise mixed in,
+	// come out of the bridge as messages. Send more than the out queue can hold
+	// so that the bridge has to hold off reading while we catch up.
+	const int shotCount = 200;
+
+	// A frame with a good CRC but a shot that can't have happened (at a negative time) is skipped too.
+	auto impossible = ShotMessage(999, Shot(1, 2, 7)).toBinary();
+	fill(begin(impossible) + payloadOffset + 2, begin(impossible) + payloadOffset + Shot::binaryLength, 0xff);
+	finishMessage(impossible.data(), Message::Type::SHOT, 999, Shot::binaryLength);
+
+	vector<uint8_t> stream;
+	for (int i = 0; i < shotCount; ++i) {
+		auto frame = ShotMessage((message_id_t)i, Shot(1, 2, i)).toBinary();
+		stream.insert(end(stream), begin(frame), end(frame));
+		if (i % 10 == 0)
+			stream.insert(end(stream), { 'n', 'o', 'i', 's', 'e', '\r', '\n' });
+		if (i == shotCount / 2)
+			stream.insert(end(stream), begin(impossible), end(impossible));
+	}
+	writeAll(pty.getSlave(), stream);
+
+	for (int i = 0; i < shotCount; ++i) {
+		auto msg = out.receive(seconds(2));
+		assert(msg != nullptr);
+		assert(*msg == ShotMessage((message_id_t)i, Shot(1, 2, i)));
+	}
+
+	in.send(unique_ptr<Message>(new ExitMessage(0)));
+	bridge.join();
+}
+
+void idle()
+{
+	PseudoTerminal pty;
+	MessageQueue in, out;
+
+	thread bridge(&runSerialMessageBridgeFD, ref(in), ref(out), pty.getMaster());
+
+	// The bridge sleeps until there's something to do, so messages have to wake it up...
+	for (int i = 0; i < 3; ++i) {
+		this_thread::sleep_for(milliseconds(50));
+		const TargetControlMessage command((message_id_t)i, TargetCommand(1, true));
+		in.send(command.clone());
+		assert(*readFrames(pty.getSlave(), 1)[0] == command);
+	}
+
+	// ...exit messages included.
+	this_thread::sleep_for(milliseconds(50));
+	in.send(unique_ptr<Message>(new ExitMessage(3)));
+	bridge.join();
+	assert(out.empty());
+}
+
+} // end anonymous namespace
+
+void Testing::SerialMessageBridgeTests()
+{
+	beginUnit("Serial message bridge");
+	test("Pseudo-terminal loopback", &loopback);
+	test("Idle", &idle);
+}
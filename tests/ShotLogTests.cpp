@@ -0,0 +1,90 @@
+#include "ShotLogTests.hpp"
+
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "ShotLog.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+void appending()
+{
+	ShotLog log(2);
+	assert(log.size() == 0);
+
+	assert(log.record(Shot(0, 1, 10)));
+	assert(log.record(Shot(1, -1, 20)));
+	assert(log.record(Shot(0, 0, 30)));
+
+	assert(log.size() == 3);
+	assert(log.countFor(0) == 2);
+	assert(log.countFor(1) == 1);
+	assert(log.shotsFor(0) == vector<Shot>({ Shot(0, 1, 10), Shot(0, 0, 30) }));
+	assert(log.shotsFor(1) == vector<Shot>({ Shot(1, -1, 20) }));
+}
+
+void lateShots()
+{
+	ShotLog log(1);
+
+	log.record(Shot(0, 1, 100));
+	log.record(Shot(0, 1, 300));
+	log.record(Shot(0, 0, 200));
+	log.record(Shot(0, 0, 50));
+	// Two shots at the same time at different targets are both kept, in the order they arrived.
+	log.record(Shot(0, 0, 300));
+
+	assert(log.shotsFor(0) == vector<Shot>({ Shot(0, 0, 50), Shot(0, 1, 100), Shot(0, 0, 200),
+	                                         Shot(0, 1, 300), Shot(0, 0, 300) }));
+}
+
+void duplicates()
+{
+	ShotLog log(1);
+
+	assert(log.record(Shot(0, 1, 100)));
+	assert(log.record(Shot(0, 1, 200)));
+	assert(!log.record(Shot(0, 1, 100)));
+	assert(!log.record(Shot(0, 1, 200)));
+	assert(log.size() == 2);
+}
+
+void badPlayers()
+{
+	ShotLog log(2);
+	testThrown<ArgumentOutOfRangeException>([&] { log.record(Shot(2, 0, 100)); });
+	testThrown<ArgumentOutOfRangeException>([&] { log.record(Shot(-1, 0, 100)); });
+}
+
+void clearing()
+{
+	ShotLog log(2);
+	log.record(Shot(0, 1, 100));
+	log.record(Shot(1, 1, 100));
+	log.clear();
+
+	assert(log.size() == 0);
+	assert(log.playerCount() == 2);
+	assert(log.shotsFor(0).empty());
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void ShotLogTests()
+{
+	beginUnit("Shot log");
+	test("Appending", &appending);
+	test("Late shots", &lateShots);
+	test("Duplicates", &duplicates);
+	test("Bad players", &badPlayers);
+	test("Clearing", &clearing);
+}
+
+} // end namespace Testing
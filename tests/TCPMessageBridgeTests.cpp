@@ -0,0 +1,363 @@
+#include "TCPMessageBridgeTests.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include "EventMessage.hpp"
+#include "ExitMessage.hpp"
+#include "JSONWriter.hpp"
+#include "MemoryUtils.hpp"
+#include "MessageQueue.hpp"
+#include "ResponseMessage.hpp"
+#include "ResultsMessage.hpp"
+#include "ResultsResponseMessage.hpp"
+#include "SetupMessage.hpp"
+#include "ShotMessage.hpp"
+#include "StatusMessage.hpp"
+#include "StatusResponseMessage.hpp"
+#include "SubscribeMessage.hpp"
+#include "TCPMessageBridge.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using boost::asio::ip::tcp;
+
+namespace {
+
+typedef steady_clock Clock;
+
+/// Waits for the server to start listening by connecting to it (and hanging up right away)
+void waitForServer()
+{
+	boost::asio::io_service service;
+	const auto giveUp = Clock::now() + seconds(5);
+
+	while (true) {
+		tcp::socket probe(service);
+		boost::system::error_code e;
+		probe.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), 2564), e);
+		if (!e)
+			return;
+
+		assert(Clock::now() < giveUp);
+		this_thread::sleep_for(milliseconds(10));
+	}
+}
+
+/// Passes a request from a client to the server and a response back with the given framing
+void roundTrip(TCPFraming framing)
+{
+	MessageQueue toServer, fromServer, toClient, fromClient;
+
+	thread server(&runTCPMessageServer, ref(toServer), ref(fromServer));
+	waitForServer();
+
+	thread client(&runFramedTCPMessageClient, ref(toClient), ref(fromClient), string("localhost"), framing);
+
+	toClient.send(unique_ptr<Message>(new StatusMessage(1)));
+	auto request = fromServer.receiveUntil(Clock::now() + seconds(5));
+	assert(request != nullptr);
+	assert(*request == StatusMessage(1));
+
+	StatusResponseMessage::PlayerList players;
+	players.emplace_back(2, 4);
+	players.emplace_back(25, 64);
+	unique_ptr<Message> response(new StatusResponseMessage(2, 1, "", true, 42, -1, move(players)));
+	toServer.send(response->clone());
+	auto received = fromClient.receiveUntil(Clock::now() + seconds(5));
+	assert(received != nullptr);
+	assert(*received == *response);
+
+	toClient.send(unique_ptr<Message>(new ExitMessage(2)));
+	client.join();
+	toServer.send(unique_ptr<Message>(new ExitMessage(3)));
+	server.join();
+}
+
+void json() { roundTrip(TCPFraming::JSON); }
+
+void binary() { roundTrip(TCPFraming::BINARY); }
+
+unique_ptr<Message> receiveSoon(MessageQueue& q)
+{
+	auto ret = q.receiveUntil(Clock::now() + seconds(5));
+	assert(ret != nullptr);
+	return ret;
+}
+
+void multipleClients()
+{
+	typedef ResponseMessage::Code Code;
+
+	MessageQueue toServer, fromServer, toFirst, fromFirst, toSecond, fromSecond;
+
+	thread server(&runTCPMessageServer, ref(toServer), ref(fromServer));
+	waitForServer();
+
+	thread first(&runFramedTCPMessageClient, ref(toFirst), ref(fromFirst), string("localhost"), TCPFraming::JSON);
+	thread second(&runFramedTCPMessageClient, ref(toSecond), ref(fromSecond), string("localhost"),
+	              TCPFraming::BINARY);
+
+	// Both clients use the same request ID. Responses should go back in the order the requests came in.
+	toFirst.send(unique_ptr<Message>(new StatusMessage(1)));
+	receiveSoon(fromServer);
+	toSecond.send(unique_ptr<Message>(new StatusMessage(1)));
+	receiveSoon(fromServer);
+
+	toServer.send(unique_ptr<Message>(new ResponseMessage(10, 1, Code::OK)));
+	toServer.send(unique_ptr<Message>(new ResponseMessage(11, 1, Code::INVALID_REQUEST)));
+
+	assert(*receiveSoon(fromFirst) == ResponseMessage(10, 1, Code::OK));
+	assert(*receiveSoon(fromSecond) == ResponseMessage(11, 1, Code::INVALID_REQUEST));
+
+	// Nobody is waiting on this one, so it goes nowhere.
+	toServer.send(unique_ptr<Message>(new ResponseMessage(12, 1, Code::OK)));
+
+	// Everything else goes to everybody.
+	const ShotMessage shot(13, Shot(1, 2, 300));
+	toServer.send(shot.clone());
+	assert(*receiveSoon(fromFirst) == shot);
+	assert(*receiveSoon(fromSecond) == shot);
+
+	toServer.send(unique_ptr<Message>(new ExitMessage(14)));
+	server.join();
+
+	// Hanging up on the clients makes them return.
+	first.join();
+	second.join();
+}
+
+void lanes()
+{
+	typedef ResponseMessage::Code Code;
+
+	MessageQueue toServer, fromServer, toFirst, fromFirst, toSecond, fromSecond;
+
+	thread server(&runTCPMessageServer, ref(toServer), ref(fromServer));
+	waitForServer();
+
+	thread first(&runFramedTCPMessageClient, ref(toFirst), ref(fromFirst), string("localhost"), TCPFraming::JSON);
+	thread second(&runFramedTCPMessageClient, ref(toSecond), ref(fromSecond), string("localhost"),
+	              TCPFraming::JSON);
+
+	// IDs are only unique within a lane, so both clients can use the same one for different lanes...
+	unique_ptr<Message> toLane0(new StatusMessage(5));
+	unique_ptr<Message> toLane1(new StatusMessage(5));
+	toLane1->lane = 1;
+	toFirst.send(move(toLane0));
+	assert(receiveSoon(fromServer)->lane == 0);
+	toSecond.send(move(toLane1));
+	assert(receiveSoon(fromServer)->lane == 1);
+
+	// ...and each gets its own lane's answer, whichever lane answers first.
+	const ResponseMessage fromLane0(20, 5, Code::OK);
+	ResponseMessage fromLane1(20, 5, Code::INVALID_REQUEST);
+	fromLane1.lane = 1;
+	toServer.send(fromLane1.clone());
+	toServer.send(fromLane0.clone());
+
+	assert(*receiveSoon(fromSecond) == fromLane1);
+	assert(*receiveSoon(fromFirst) == fromLane0);
+
+	toServer.send(unique_ptr<Message>(new ExitMessage(21)));
+	server.join();
+	first.join();
+	second.join();
+}
+
+void subscriptions()
+{
+	typedef ResponseMessage::Code Code;
+
+	MessageQueue toServer, fromServer, toScores, fromScores, toPlain, fromPlain;
+
+	thread server(&runTCPMessageServer, ref(toServer), ref(fromServer));
+	waitForServer();
+
+	thread scores(&runFramedTCPMessageClient, ref(toScores), ref(fromScores), string("localhost"),
+	              TCPFraming::BINARY);
+	thread plain(&runTCPMessageClient, ref(toPlain), ref(fromPlain), string("localhost"));
+
+	// The server answers subscriptions itself instead of passing them along.
+	toScores.send(unique_ptr<Message>(new SubscribeMessage(1, GameEvent::only(GameEvent::Kind::SCORE))));
+	auto ack = receiveSoon(fromScores);
+	assert(ack->getType() == Message::Type::RESPONSE);
+	assert(static_cast<const ResponseMessage&>(*ack).respondingTo == 1);
+	assert(static_cast<const ResponseMessage&>(*ack).code == Code::OK);
+
+	// Make sure the other client is connected before we start broadcasting.
+	toPlain.send(unique_ptr<Message>(new StatusMessage(2)));
+	assert(receiveSoon(fromServer)->getType() == Message::Type::STATUS);
+
+	// Events only go to those who want them...
+	toServer.send(unique_ptr<Message>(new EventMessage(10, GameEvent::shot(Shot(1, 0, 1200)))));
+	const EventMessage score(11, GameEvent::scoreChanged(1, 450, 1, 1200));
+	toServer.send(score.clone());
+
+	// ...while everything else still goes to everybody.
+	const ShotMessage shot(12, Shot(0, 1, 1500));
+	toServer.send(shot.clone());
+
+	assert(*receiveSoon(fromScores) == score);
+	assert(*receiveSoon(fromScores) == shot);
+	assert(*receiveSoon(fromPlain) == shot);
+
+	// Subscribing to nothing unsubscribes.
+	toScores.send(unique_ptr<Message>(new SubscribeMessage(3, 0)));
+	assert(receiveSoon(fromScores)->getType() == Message::Type::RESPONSE);
+	toServer.send(score.clone());
+	toServer.send(shot.clone());
+	assert(*receiveSoon(fromScores) == shot);
+	assert(*receiveSoon(fromPlain) == shot);
+
+	assert(fromServer.empty());
+
+	toServer.send(unique_ptr<Message>(new ExitMessage(13)));
+	server.join();
+	scores.join();
+	plain.join();
+}
+
+void burst()
+{
+	TCPServerOptions options;
+	options.flushDelay = milliseconds(2);
+	options.cork = true;
+	options.maxQueuedMessages = 1000;
+
+	MessageQueue toServer, fromServer, toClient, fromClient;
+
+	thread server(&runConfiguredTCPMessageServer, ref(toServer), ref(fromServer), options);
+	waitForServer();
+
+	thread client(&runFramedTCPMessageClient, ref(toClient), ref(fromClient), string("localhost"),
+	              TCPFraming::BINARY);
+
+	// Make sure the client is connected before we start broadcasting.
+	toClient.send(unique_ptr<Message>(new StatusMessage(1)));
+	receiveSoon(fromServer);
+
+	// A burst of messages should come through intact and in order, however they get batched up.
+	const int burstSize = 500;
+	for (int i = 0; i < burstSize; ++i)
+		toServer.send(unique_ptr<Message>(new ShotMessage((message_id_t)i, Shot(1, 2, i))));
+
+	for (int i = 0; i < burstSize; ++i)
+		assert(*receiveSoon(fromClient) == ShotMessage((message_id_t)i, Shot(1, 2, i)));
+
+	toServer.send(unique_ptr<Message>(new ExitMessage(1)));
+	server.join();
+	client.join();
+}
+
+void oversized()
+{
+	typedef ResponseMessage::Code Code;
+
+	MessageQueue toServer, fromServer, toBinary, fromBinary, toJSON, fromJSON;
+
+	thread server(&runTCPMessageServer, ref(toServer), ref(fromServer));
+	waitForServer();
+
+	thread binaryClient(&runFramedTCPMessageClient, ref(toBinary), ref(fromBinary), string("localhost"),
+	                    TCPFraming::BINARY);
+	thread jsonClient(&runFramedTCPMessageClient, ref(toJSON), ref(fromJSON), string("localhost"),
+	                  TCPFraming::JSON);
+
+	toBinary.send(unique_ptr<Message>(new ResultsMessage(1)));
+	receiveSoon(fromServer);
+	toJSON.send(unique_ptr<Message>(new ResultsMessage(1)));
+	receiveSoon(fromServer);
+
+	// A long enough game has more shots than fit in a binary frame.
+	ResultsResponseMessage::StatsList stats;
+	stats.emplace_back(100, 5, vector<Shot>(12000, Shot(0, 1, 100)));
+	const ResultsResponseMessage results(2, 1, "", move(stats));
+	toServer.send(results.clone());
+	toServer.send(results.clone());
+
+	// The binary client is told it can't have them instead of being left waiting...
+	auto refused = unique_dynamic_cast<ResponseMessage>(receiveSoon(fromBinary));
+	assert(refused != nullptr && refused->getType() == Message::Type::RESPONSE);
+	assert(refused->respondingTo == 1 && refused->code == Code::UNSUPPORTED_REQUEST);
+
+	// ...while the JSON client gets them just fine.
+	assert(*receiveSoon(fromJSON) == results);
+
+	// Both are still connected.
+	const ShotMessage shot(3, Shot(1, 2, 300));
+	toServer.send(shot.clone());
+	assert(*receiveSoon(fromBinary) == shot);
+	assert(*receiveSoon(fromJSON) == shot);
+
+	toServer.send(unique_ptr<Message>(new ExitMessage(4)));
+	server.join();
+	binaryClient.join();
+	jsonClient.join();
+}
+
+void badRequest()
+{
+	MessageQueue toServer, fromServer, toClient, fromClient;
+
+	thread server(&runTCPMessageServer, ref(toServer), ref(fromServer));
+	waitForServer();
+
+	thread client(&runTCPMessageClient, ref(toClient), ref(fromClient), string("localhost"));
+
+	// A setup with no players parses fine, but the message itself can't be made.
+	string line;
+	JSONWriter writer(line);
+	SetupMessage(1, GameType::POP_UP, 2, 30, -1, SetupMessage::DataMap()).writeJSON(writer);
+	const string playerCount = "\"player count\":2";
+	const size_t at = line.find(playerCount);
+	assert(at != string::npos);
+	line.replace(at, playerCount.size(), "\"player count\":0");
+	line += "\r\n";
+
+	boost::asio::io_service service;
+	tcp::socket bad(service);
+	bad.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), 2564));
+	boost::asio::write(bad, boost::asio::buffer(line));
+
+	// The server hangs up on the client that sent it...
+	char ignored[64];
+	boost::system::error_code e;
+	while (!e)
+		bad.read_some(boost::asio::buffer(ignored), e);
+	assert(e == boost::asio::error::eof);
+
+	// ...but keeps serving everyone else.
+	toClient.send(unique_ptr<Message>(new StatusMessage(2)));
+	assert(*receiveSoon(fromServer) == StatusMessage(2));
+	toServer.send(unique_ptr<Message>(new ResponseMessage(3, 2, ResponseMessage::Code::OK)));
+	assert(*receiveSoon(fromClient) == ResponseMessage(3, 2, ResponseMessage::Code::OK));
+	assert(fromServer.empty());
+
+	toServer.send(unique_ptr<Message>(new ExitMessage(4)));
+	server.join();
+	client.join();
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void TCPMessageBridgeTests()
+{
+	beginUnit("TCP Message Bridge");
+	test("JSON round trip", &json);
+	test("Binary round trip", &binary);
+	test("Multiple clients", &multipleClients);
+	test("Lanes", &lanes);
+	test("Subscriptions", &subscriptions);
+	test("Bursts", &burst);
+	test("Oversized responses", &oversized);
+	test("Bad requests", &badRequest);
+}
+
+} // end namespace Testing
@@ -0,0 +1,145 @@
+#include "TimerServiceTests.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DelayedAction.hpp"
+#include "TimerService.hpp"
+#include "Test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Testing;
+
+namespace {
+
+void ordering()
+{
+	TimerService service;
+
+	mutex orderMutex;
+	vector<int> order;
+	const auto record = [&](int i) {
+		return [&, i] {
+			lock_guard<mutex> lock(orderMutex);
+			order.push_back(i);
+		};
+	};
+
+	const auto start = TimerService::Clock::now();
+	service.scheduleAfter(milliseconds(60), record(3));
+	service.scheduleAfter(milliseconds(20), record(1));
+	service.schedule(start + milliseconds(40), record(2));
+	assert(service.size() == 3);
+
+	this_thread::sleep_for(milliseconds(120));
+	assert(service.size() == 0);
+	lock_guard<mutex> lock(orderMutex);
+	assert(order == vector<int>({1, 2, 3}));
+}
+
+void cancelAndRunNow()
+{
+	TimerService service;
+	atomic<int> fired(0);
+
+	const auto canceled = service.scheduleAfter(milliseconds(20), [&fired] { fired += 1; });
+	const auto early = service.scheduleAfter(seconds(10), [&fired] { fired += 10; });
+
+	assert(service.cancel(canceled));
+	assert(!service.cancel(canceled));
+	assert(!service.runNow(canceled));
+
+	// Run-now happens on the calling thread, before it returns.
+	assert(service.runNow(early));
+	assert(fired == 10);
+	assert(!service.runNow(early));
+	assert(!service.cancel(early));
+
+	this_thread::sleep_for(milliseconds(50));
+	assert(fired == 10);
+	assert(service.size() == 0);
+}
+
+void manyPending()
+{
+	atomic<int> fired(0);
+	{
+		TimerService service;
+
+		vector<TimerService::TimerID> ids;
+		for (int i = 0; i < 5000; ++i)
+			ids.emplace_back(service.scheduleAfter(seconds(60 + i % 100), [&fired] { ++fired; }));
+		for (int i = 0; i < 100; ++i)
+			service.scheduleAfter(milliseconds(i % 10), [&fired] { ++fired; });
+
+		// Cancel almost all of the far-off ones, which should let the heap shrink.
+		for (size_t i = 10; i < ids.size(); ++i)
+			assert(service.cancel(ids[i]));
+
+		this_thread::sleep_for(milliseconds(100));
+		assert(fired == 100);
+		assert(service.size() == 10);
+	}
+	// Callbacks still pending when the service stops are dropped.
+	assert(fired == 100);
+}
+
+void delayedActions()
+{
+	atomic<int> fired(0);
+	{
+		DelayedAction<> action(milliseconds(20), [&fired] { ++fired; });
+		assert(!action.isOver());
+		this_thread::sleep_for(milliseconds(100));
+		assert(action.isOver());
+		assert(fired == 1);
+	}
+	assert(fired == 1);
+
+	{
+		DelayedAction<> action(seconds(10), [&fired] { ++fired; });
+		action.runEarly();
+		assert(action.isOver());
+		assert(fired == 2);
+		action.runEarly();
+	}
+	assert(fired == 2);
+
+	// Destroying an action that hasn't fired runs it right away instead of waiting out the delay.
+	const auto start = steady_clock::now();
+	{
+		TimerService service;
+		DelayedAction<seconds> action(service, seconds(10), [&fired] { ++fired; });
+	}
+	assert(fired == 3);
+	assert(steady_clock::now() - start < seconds(1));
+
+	// Thousands of actions can be waiting without a thread apiece.
+	vector<unique_ptr<DelayedAction<>>> actions;
+	for (int i = 0; i < 2000; ++i)
+		actions.emplace_back(new DelayedAction<>(milliseconds(10 + i % 20), [&fired] { ++fired; }));
+	this_thread::sleep_for(milliseconds(100));
+	assert(fired == 2003);
+	actions.clear();
+	assert(fired == 2003);
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void TimerServiceTests()
+{
+	beginUnit("TimerService");
+	test("Ordering", &ordering);
+	test("Cancel and run now", &cancelAndRunNow);
+	test("Many pending", &manyPending);
+	test("Delayed actions", &delayedActions);
+}
+
+} // end namespace Testing
@@ -0,0 +1,237 @@
+#include "TraceTests.hpp"
+
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "Exceptions.hpp"
+#include "ExitMessage.hpp"
+#include "GameRunner.hpp"
+#include "MemoryUtils.hpp"
+#include "MessageQueue.hpp"
+#include "MessageTests.hpp"
+#include "ResultsMessage.hpp"
+#include "SetupMessage.hpp"
+#include "ShotMessage.hpp"
+#include "StartMessage.hpp"
+#include "StatusMessage.hpp"
+#include "Test.hpp"
+#include "Trace.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Exceptions;
+using namespace Testing;
+
+namespace {
+
+typedef GameRunner::TimePoint TimePoint;
+
+/// Writes the binary form of everything waiting in the queue to the stream, like replayTrace does
+void drain(MessageQueue& queue, ostream& os)
+{
+	while (auto msg = queue.tryReceive()) {
+		const auto bin = msg->toBinary();
+		os.write(reinterpret_cast<const char*>(bin.data()), (streamsize)bin.size());
+	}
+}
+
+/// Plays a short pop-up game in real time, recording it
+void playLive(stringstream& trace, stringstream& output, bool acknowledgeShots = true)
+{
+	TraceWriter writer(trace);
+	MessageQueue in, out;
+	thread stateThread(&runGame, ref(in), ref(out), 2, 2, nullptr, &writer, acknowledgeShots);
+
+	in.send(makeSetupMessage(1));
+	in.send(makeMessage<StartMessage>());
+	in.send(unique_ptr<Message>(new ShotMessage(20, Shot(0, -1, 100))));
+	in.send(makeMessage<StatusMessage>());
+	in.send(unique_ptr<Message>(new ShotMessage(21, Shot(1, 0, 150))));
+	// Let the game run out.
+	this_thread::sleep_for(milliseconds(1200));
+	in.send(makeMessage<ResultsMessage>());
+	in.send(unique_ptr<Message>(new ExitMessage(1)));
+	stateThread.join();
+
+	drain(out, output);
+}
+
+void liveReplay()
+{
+	stringstream trace, live;
+	playLive(trace, live);
+	assert(!live.str().empty());
+
+	// The replay sends exactly what the live game did...
+	stringstream replayed;
+	trace.seekg(0);
+	const size_t steps = replayTrace(trace, replayed);
+	assert(replayed.str() == live.str());
+
+	// ...every time.
+	stringstream again;
+	trace.clear();
+	trace.seekg(0);
+	assert(replayTrace(trace, again) == steps);
+	assert(again.str() == live.str());
+
+	// A step that was cut off ends the replay early, but everything before it is the same.
+	const string cutOff = trace.str().substr(0, trace.str().size() - 3);
+	stringstream torn(cutOff), tornOutput;
+	assert(replayTrace(torn, tornOutput) == steps - 1);
+	assert(live.str().compare(0, tornOutput.str().size(), tornOutput.str()) == 0);
+}
+
+void unacknowledgedShots()
+{
+	stringstream trace, live;
+	playLive(trace, live, false);
+
+	// The trace remembers that shots went unanswered, so the replay leaves them unanswered too.
+	trace.seekg(0);
+	assert(!TraceReader(trace).acknowledgesShots());
+
+	stringstream replayed;
+	trace.seekg(0);
+	replayTrace(trace, replayed);
+	assert(replayed.str() == live.str());
+}
+
+void virtualTime()
+{
+	// Record a ten minute game with shots every quarter second
+	// by driving a runner with made-up times instead of waiting for them.
+	stringstream trace, simulated;
+	{
+		TraceWriter writer(trace);
+		MessageQueue out;
+		GameRunner runner(out, 4, 2, 453);
+
+		TimePoint now;
+		writer.start(453, 4, 2, now);
+
+		const auto send = [&](unique_ptr<Message>&& msg) {
+			writer.record(now, msg.get());
+			runner.onMessage(move(msg), now);
+		};
+
+		send(makeSetupMessage(600));
+		send(makeMessage<StartMessage>());
+
+		const TimePoint end = now + minutes(10) + seconds(1);
+		TimePoint nextShot = now + milliseconds(250);
+		message_id_t shotID = 100;
+		while (now < end) {
+			if (runner.nextDeadline() <= nextShot) {
+				now = runner.nextDeadline();
+				writer.record(now, nullptr);
+				runner.onTick(now);
+			}
+			else {
+				now = nextShot;
+				nextShot += milliseconds(250);
+				const auto time = (timestamp_t)duration_cast<milliseconds>(now.time_since_epoch()).count();
+				send(unique_ptr<Message>(new ShotMessage(shotID, Shot((board_id_t)(shotID % 2),
+				                                                      (board_id_t)(shotID % 5) - 1, time))));
+				++shotID;
+			}
+			drain(out, simulated);
+		}
+
+		send(makeMessage<ResultsMessage>());
+		drain(out, simulated);
+	}
+
+	stringstream replayed;
+	const auto replayStart = steady_clock::now();
+	const size_t steps = replayTrace(trace, replayed);
+	assert(steady_clock::now() - replayStart < minutes(10));
+
+	assert(steps > 2400);
+	assert(replayed.str() == simulated.str());
+}
+
+/// A stream buffer with room for only so many bytes, like a disk that's about to fill up
+class FillingBuffer : public streambuf {
+
+public:
+
+	explicit FillingBuffer(size_t r) : room(r) { }
+
+protected:
+
+	int overflow(int c) override
+	{
+		if (room == 0)
+			return traits_type::eof();
+		--room;
+		return c;
+	}
+
+private:
+
+	size_t room;
+};
+
+void fullDisk()
+{
+	// Room for the header and nothing else
+	stringstream header;
+	TraceWriter(header).start(0, 2, 2, TimePoint());
+	FillingBuffer full(header.str().size());
+	ostream os(&full);
+	TraceWriter trace(os);
+
+	MessageQueue in, out;
+	thread runner(&runGame, ref(in), ref(out), 2, 2, nullptr, &trace, true);
+
+	// The game carries on without the trace.
+	in.send(makeSetupMessage());
+	auto ack = unique_dynamic_cast<ResponseMessage>(out.receive());
+	assert(ack != nullptr && ack->code == ResponseMessage::Code::OK);
+	assert(trace.size() == 0);
+
+	in.send(unique_ptr<Message>(new ExitMessage(1)));
+	runner.join();
+}
+
+void badTraces()
+{
+	stringstream empty;
+	testThrown<IOException>([&] { TraceReader reader(empty); });
+
+	stringstream notATrace("This is not a trace, but it is long enough to hold a header.");
+	testThrown<IOException>([&] { TraceReader reader(notATrace); });
+
+	// A trace from an older version would replay differently, so it's turned away.
+	stringstream older;
+	TraceWriter olderWriter(older);
+	olderWriter.start(1, 2, 2, TimePoint());
+	string bytes = older.str();
+	bytes[4] = 0;
+	bytes[5] = 1;
+	stringstream oldTrace(bytes);
+	testThrown<IOException>([&] { TraceReader reader(oldTrace); });
+
+	stringstream ignored;
+	TraceWriter writer(ignored);
+	testThrown<InvalidOperationException>([&] { writer.record(TimePoint(), nullptr); });
+}
+
+} // end anonymous namespace
+
+namespace Testing {
+
+void TraceTests()
+{
+	beginUnit("Trace");
+	test("Live replay", &liveReplay);
+	test("Unacknowledged shots", &unacknowledgedShots);
+	test("Virtual time", &virtualTime);
+	test("Bad traces", &badTraces);
+	test("Full disk", &fullDisk);
+}
+
+} // end namespace Testing
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Testing {
+
+void TraceTests();
+
+} // end namespace Testing
@@ -4,21 +4,53 @@
 #include "Test.hpp"
 
 #include "MemoryUtilsTests.hpp"
+#include "JSONTests.hpp"
 #include "MessageTests.hpp"
+#include "MessagePoolTests.hpp"
 #include "MessageQueueTests.hpp"
+#include "MessageJunctionTests.hpp"
+#include "TimerServiceTests.hpp"
+#include "ExecutorTests.hpp"
+#include "ShotLogTests.hpp"
+#include "PlayerStatisticsTests.hpp"
+#include "MatchHistoryTests.hpp"
 #include "GameStateMachineTests.hpp"
+#include "TraceTests.hpp"
+#include "LaneServerTests.hpp"
 #include "PopUpStateMachineTests.hpp"
+#include "ModeStateMachineTests.hpp"
 #include "BinaryMessageTests.hpp"
+#include "CRCTests.hpp"
+#include "FrameDecoderTests.hpp"
+#include "SerialMessageBridgeTests.hpp"
+#include "TCPMessageBridgeTests.hpp"
+#include "ResponseCorrelatorTests.hpp"
 
 using namespace Testing;
 
 int main()
 {
 	memoryUtilsTests();
+	JSONTests();
 	MessageTests();
+	MessagePoolTests();
 	MessageQueueTests();
+	MessageJunctionTests();
+	TimerServiceTests();
+	ExecutorTests();
+	CRCTests();
 	BinaryMessageTests();
+	FrameDecoderTests();
+	SerialMessageBridgeTests();
+	TCPMessageBridgeTests();
+	ResponseCorrelatorTests();
+	ShotLogTests();
+	PlayerStatisticsTests();
+	MatchHistoryTests();
 	GameStateMachineTests();
+	TraceTests();
+	LaneServerTests();
+	ModeStateMachineTests();
 	// Slowest ones last
 	PopUpStateMachineTests();
 	return 0;
@@ -14,8 +14,8 @@
 #include "StopMessage.hpp"
 #include "SetupMessage.hpp"
 #include "ExitMessage.hpp"
+#include "SubscribeMessage.hpp"
 #include "TCPMessageBridge.hpp"
-#include "MemoryUtils.hpp"
 
 using namespace std;
 
@@ -23,6 +23,9 @@ namespace {
 
 const std::chrono::seconds patienceWithGame(5);
 
+/// How often we check for messages from the game
+const int pollInterval = 20; // milliseconds
+
 } // end anonymous namespace
 
 inline QString fromStd(const std::string& s) { return QString::fromStdString(s); }
@@ -30,9 +33,17 @@ inline QString fromStd(const std::string& s) { return QString::fromStdString(s);
 
 RangeUI::RangeUI(QWidget *parent) :
 	QMainWindow(parent),
-	ui(new Ui::RangeUI)
+	ui(new Ui::RangeUI),
+	requests(toSM, fromSM, patienceWithGame),
+	pollTimer(new QTimer(this))
 {
 	ui->setupUi(this);
+
+	// Responses are handed to whoever asked for them. Anything else (e.g. game events) just gets shown.
+	requests.setPushHandler([this](unique_ptr<Message>&& msg) { showMessage(*msg); });
+	connect(pollTimer, &QTimer::timeout, [this] { requests.poll(); });
+	pollTimer->start(pollInterval);
+
 	// Have the checkboxes for win conditions enable and disable
 	// their corresponding spin boxes and labels
 	connect(ui->chkTime, &QCheckBox::stateChanged, [this](int checked) {
@@ -63,6 +74,9 @@ void RangeUI::connectToSM()
 	closeConnection();
 	commsThread = async(launch::async, &runTCPMessageClient, ref(toSM), ref(fromSM),
 	                                   ui->leEndPoint->text().toStdString());
+
+	// Have the game tell us what happens as it happens.
+	request<ResponseMessage>(new SubscribeMessage(requests.nextID()), "Subscribe");
 }
 
 bool RangeUI::ensureConnection()
@@ -100,104 +114,65 @@ bool RangeUI::ensureConnection()
 void RangeUI::closeConnection()
 {
 	if (commsThread.valid()) {
-		toSM.prioritySend(unique_ptr<Message>(new ExitMessage(++uid)));
+		toSM.prioritySend(unique_ptr<Message>(new ExitMessage(requests.nextID())));
 		commsThread.get();
+		requests.clear();
 		fromSM.reset();
 	}
 }
 
-std::unique_ptr<Message> RangeUI::awaitResponse(Message* toSend)
+template <typename Expected>
+void RangeUI::request(Message* toSend, const char* requestName)
 {
+	std::unique_ptr<Message> msg(toSend);
+
 	if (!ensureConnection())
-		return nullptr;
+		return;
 
-	toSM.send(std::unique_ptr<Message>(toSend));
+	requests.request(std::move(msg), [this, requestName](std::unique_ptr<Message>&& response) {
+		if (response == nullptr) {
+			if (ensureConnection())
+				QMessageBox::critical(this, "Unresponsive game", "The game is not responding.");
+			return;
+		}
 
-	auto msg = fromSM.receive(patienceWithGame);
+		showMessage(*response);
 
-	if (msg == nullptr) {
-		if (ensureConnection())
-			QMessageBox::critical(this, "Unresponsive game", "The game is not responding.");
-	}
+		if (dynamic_cast<const Expected*>(response.get()) == nullptr)
+			QMessageBox::critical(this, "Wrong Message", QString(requestName) + " got the wrong response.");
+	});
+}
 
-	return msg;
+void RangeUI::showMessage(const Message& msg)
+{
+	ui->txtTerminal->append(fromStd(jWriter.write(msg.toJSON())));
 }
 
 void RangeUI::setup()
 {
-	auto msg = awaitResponse(new SetupMessage(++uid, GameType::POP_UP,
+	request<ResponseMessage>(new SetupMessage(requests.nextID(), GameType::POP_UP,
 	                         (board_id_t)ui->spnPlayers->value(),
 	                         ui->chkTime->isChecked() ? ui->spnTime->value() : -1,
-	                         ui->chkScore->isChecked() ? ui->spnScore->value() : -1));
-
-	if (msg == nullptr)
-		return;
-
-	ui->txtTerminal->append(fromStd(jWriter.write(msg->toJSON())));
-
-	auto rm = unique_dynamic_cast<ResponseMessage>(std::move(msg));
-
-	if (rm == nullptr)
-		QMessageBox::critical(this, "Wrong Message", "Setup got the wrong response.");
+	                         ui->chkScore->isChecked() ? ui->spnScore->value() : -1),
+	                         "Setup");
 }
 
 void RangeUI::start()
 {
-	auto msg = awaitResponse(new StartMessage(++uid));
-
-	if (msg == nullptr)
-		return;
-
-	ui->txtTerminal->append(fromStd(jWriter.write(msg->toJSON())));
-
-	auto rm = unique_dynamic_cast<ResponseMessage>(std::move(msg));
-
-	if (rm == nullptr)
-		QMessageBox::critical(this, "Wrong Message", "Start got the wrong response.");
+	request<ResponseMessage>(new StartMessage(requests.nextID()), "Start");
 }
 
 void RangeUI::stop()
 {
-	auto msg = awaitResponse(new StopMessage(++uid));
-
-	if (msg == nullptr)
-		return;
-
-	ui->txtTerminal->append(fromStd(jWriter.write(msg->toJSON())));
-
-	auto rm = unique_dynamic_cast<ResponseMessage>(std::move(msg));
-
-	if (rm == nullptr)
-		QMessageBox::critical(this, "Wrong Message", "Stop got the wrong response.");
+	request<ResponseMessage>(new StopMessage(requests.nextID()), "Stop");
 }
 
 void RangeUI::getStatus()
 {
-	auto msg = awaitResponse(new StatusMessage(++uid));
-
-	if (msg == nullptr)
-		return;
-
-	ui->txtTerminal->append(fromStd(jWriter.write(msg->toJSON())));
-
-	auto srm = unique_dynamic_cast<StatusResponseMessage>(std::move(msg));
-
-	if (srm == nullptr)
-		QMessageBox::critical(this, "Wrong Message", "Get Status got the wrong response.");
+	request<StatusResponseMessage>(new StatusMessage(requests.nextID()), "Get Status");
 }
 
-
 void RangeUI::getResults()
 {
-	auto msg = awaitResponse(new ResultsMessage(++uid));
-
-	if (msg == nullptr)
-		return;
-
-	ui->txtTerminal->append(fromStd(jWriter.write(msg->toJSON())));
-
-	auto rrm = unique_dynamic_cast<ResponseMessage>(std::move(msg));
-
-	if (rrm == nullptr)
-		QMessageBox::critical(this, "Wrong Message", "Get Results got the wrong response.");
+	request<ResponseMessage>(new ResultsMessage(requests.nextID()), "Get Results");
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QTimer>
 
 #include <future>
 #include <memory>
@@ -9,6 +10,7 @@
 
 #include "GameTypes.hpp"
 #include "MessageQueue.hpp"
+#include "ResponseCorrelator.hpp"
 
 namespace Ui {
 class RangeUI;
@@ -32,7 +34,13 @@ private:
 
 	void closeConnection();
 
-	std::unique_ptr<Message> awaitResponse(Message* toSend);
+	/// Sends a request without waiting on it. Once the response arrives, it is shown in the terminal,
+	/// with a complaint if it isn't an `Expected`.
+	template <typename Expected>
+	void request(Message* toSend, const char* requestName);
+
+	/// Shows a message from the game in the terminal
+	void showMessage(const Message& msg);
 
 	void setup();
 
@@ -48,10 +56,14 @@ private:
 
 	Json::StyledWriter jWriter;
 
-	message_id_t uid = 0;
-
 	std::future<void> commsThread;
 
 	MessageQueue toSM;
 	MessageQueue fromSM;
+
+	/// Matches responses from fromSM to our requests, so we never have to wait on them
+	ResponseCorrelator requests;
+
+	/// Hands whatever the game has sent to `requests`
+	QTimer* pollTimer;
 };